@@ -617,6 +617,9 @@ namespace FIFFLIB
 //
 #define FIFF_MNE_RT_COMMAND         3700              /**< Fiff Real-Time Command */
 #define FIFF_MNE_RT_CLIENT_ID       3701              /**< Fiff Real-Time mne_t_server client id */
+#define FIFF_MNE_RT_DATA_SCALES     3702              /**< Fiff Real-Time per channel scales of a profiled data buffer, its size is the number of channels */
+#define FIFF_MNE_RT_COMPRESSED      3703              /**< Fiff Real-Time zlib compressed (qCompress) sequence of tags */
+#define FIFF_MNE_RT_BLOCK_STAMP     3704              /**< Fiff Real-Time block sequence number and server arrival time (sec, usec) of the following data buffer */
 
 //
 // 3710... Real-Time Blocks
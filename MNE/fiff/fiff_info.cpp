@@ -198,7 +198,7 @@ bool FiffInfo::make_compensator(fiff_int_t from, fiff_int_t to, FiffCtfComp& ctf
     qint32 k;
     if (exclude_comp_chs)
     {
-        VectorXi pick  = MatrixXi::Zero(1,this->nchan);
+        VectorXi pick  = VectorXi::Zero(this->nchan);
         qint32 npick = 0;
         for (k = 0; k < this->nchan; ++k)
         {
@@ -218,6 +218,8 @@ bool FiffInfo::make_compensator(fiff_int_t from, fiff_int_t to, FiffCtfComp& ctf
         for (k = 0; k < npick; ++k)
             ctf_comp.data->data.row(k) = comp_tmp.block(pick(k), 0, 1, this->nchan);
     }
+    else
+        ctf_comp.data->data = comp_tmp;
     return true;
 }
 
@@ -270,7 +272,7 @@ bool FiffInfo::make_compensator(fiff_int_t kind, MatrixXd& this_comp) const//pri
                 channelAvailable = 0;
                 for (row = 0; row < this_data->row_names.size(); ++row)
                 {
-                    if (QString::compare(this_data->col_names.at(c),this->ch_names.at(row)) == 0)
+                    if (QString::compare(this->ch_names.at(c),this_data->row_names.at(row)) == 0)
                     {
                         ++channelAvailable;
                         row_ch = row;
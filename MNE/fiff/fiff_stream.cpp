@@ -56,6 +56,7 @@
 //=============================================================================================================
 
 #include <QFile>
+#include <QtEndian>
 
 
 //*************************************************************************************************************
@@ -1060,39 +1061,9 @@ bool FiffStream::read_named_matrix(const FiffDirTree& p_Node, fiff_int_t matkind
 {
     mat.clear();
 
-    FiffDirTree node = p_Node;
-    //
-    //   Descend one level if necessary
-    //
-    bool found_it = false;
-    if (node.block != FIFFB_MNE_NAMED_MATRIX)
-    {
-        for (int k = 0; k < node.nchild; ++k)
-        {
-            if (node.children[k].block == FIFFB_MNE_NAMED_MATRIX)
-            {
-                if(node.children[k].has_tag(matkind))
-                {
-                    node = node.children[k];
-                    found_it = true;
-                    break;
-                }
-            }
-       }
-       if (!found_it)
-       {
-          printf("Fiff::read_named_matrix: Desired named matrix (kind = %d) not available\n",matkind);
-          return false;
-       }
-    }
-    else
-    {
-        if (!node.has_tag(matkind))
-        {
-            printf("Desired named matrix (kind = %d) not available",matkind);
-            return false;
-        }
-    }
+    FiffDirTree node;
+    if(!find_named_matrix_node(p_Node, matkind, node))
+        return false;
 
     FiffTag::SPtr t_pTag;
     //
@@ -1147,6 +1118,166 @@ bool FiffStream::read_named_matrix(const FiffDirTree& p_Node, fiff_int_t matkind
 }
 
 
+//*************************************************************************************************************
+
+bool FiffStream::read_named_matrix_info(const FiffDirTree& p_Node, fiff_int_t matkind, FiffNamedMatrix& mat)
+{
+    mat.clear();
+
+    FiffDirTree node;
+    if(!find_named_matrix_node(p_Node, matkind, node))
+        return false;
+
+    //
+    //   Only the dimensions are read, they are stored behind the matrix data
+    //
+    qint32 k;
+    for(k = 0; k < node.nent; ++k)
+        if(node.dir[k].kind == matkind)
+            break;
+
+    const FiffDirEntry& t_entry = node.dir[k];
+    if(FiffTag::fiff_type_matrix_coding(t_entry.type) != FIFFTS_MC_DENSE || t_entry.size < 12)
+    {
+        printf("FiffStream::read_named_matrix_info: Only dense matrices are supported.\n");
+        return false;
+    }
+
+    qint32 ndim, ncol, nrow;
+    this->device()->seek(t_entry.pos + 16 + t_entry.size - 12);
+    *this >> ncol;
+    *this >> nrow;
+    *this >> ndim;
+
+    if(ndim != 2)
+    {
+        printf("FiffStream::read_named_matrix_info: Only two-dimensional matrices are supported at this time.\n");
+        return false;
+    }
+
+    mat.nrow = nrow;
+    mat.ncol = ncol;
+
+    FiffTag::SPtr t_pTag;
+    if(node.find_tag(this, FIFF_MNE_NROW, t_pTag))
+        if (*t_pTag->toInt() != mat.nrow)
+        {
+            printf("Number of rows in matrix data and FIFF_MNE_NROW tag do not match");
+            return false;
+        }
+    if(node.find_tag(this, FIFF_MNE_NCOL, t_pTag))
+        if (*t_pTag->toInt() != mat.ncol)
+        {
+            printf("Number of columns in matrix data and FIFF_MNE_NCOL tag do not match");
+            return false;
+        }
+
+    if(node.find_tag(this, FIFF_MNE_ROW_NAMES, t_pTag))
+        mat.row_names = split_name_list(t_pTag->toString());
+
+    if(node.find_tag(this, FIFF_MNE_COL_NAMES, t_pTag))
+        mat.col_names = split_name_list(t_pTag->toString());
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+bool FiffStream::read_named_matrix_selection(const FiffDirTree& p_Node, fiff_int_t matkind, const RowVectorXi& p_vecRowSel, const RowVectorXi& p_vecColSel, MatrixXd& p_matData)
+{
+    FiffNamedMatrix t_info;
+    if(!read_named_matrix_info(p_Node, matkind, t_info))
+        return false;
+
+    FiffDirTree node;
+    find_named_matrix_node(p_Node, matkind, node);
+
+    qint32 k;
+    for(k = 0; k < node.nent; ++k)
+        if(node.dir[k].kind == matkind)
+            break;
+
+    const FiffDirEntry& t_entry = node.dir[k];
+    bool t_bDouble = (t_entry.type & DATA_TYPE) == FIFFT_DOUBLE;
+    if(!t_bDouble && (t_entry.type & DATA_TYPE) != FIFFT_FLOAT)
+    {
+        printf("FiffStream::read_named_matrix_selection: Only float and double matrices are supported.\n");
+        return false;
+    }
+
+    qint32 nrow = t_info.nrow;
+    qint32 ncol = t_info.ncol;
+
+    RowVectorXi t_vecRowSel = p_vecRowSel.size() > 0 ? p_vecRowSel : RowVectorXi::LinSpaced(nrow, 0, nrow-1);
+    RowVectorXi t_vecColSel = p_vecColSel.size() > 0 ? p_vecColSel : RowVectorXi::LinSpaced(ncol, 0, ncol-1);
+
+    if((t_vecRowSel.size() > 0 && (t_vecRowSel.minCoeff() < 0 || t_vecRowSel.maxCoeff() >= nrow))
+            || (t_vecColSel.size() > 0 && (t_vecColSel.minCoeff() < 0 || t_vecColSel.maxCoeff() >= ncol)))
+    {
+        printf("FiffStream::read_named_matrix_selection: Selection exceeds the matrix dimensions (%d x %d).\n", nrow, ncol);
+        return false;
+    }
+
+    p_matData.resize(t_vecRowSel.size(), t_vecColSel.size());
+
+    //
+    //   The data is stored row by row in big endian byte order
+    //
+    qint64 t_iDataPos = t_entry.pos + 16;
+    qint32 t_iValueBytes = t_bDouble ? 8 : 4;
+    qint64 t_iRowBytes = (qint64)ncol*t_iValueBytes;
+
+    QFile* t_pFile = qobject_cast<QFile*>(this->device());
+    uchar* t_pMap = t_pFile ? t_pFile->map(t_iDataPos, t_iRowBytes*nrow) : NULL;
+
+    QByteArray t_rowBuffer;
+    if(!t_pMap)
+        t_rowBuffer.resize(t_iRowBytes);
+
+    for(qint32 i = 0; i < t_vecRowSel.size(); ++i)
+    {
+        const uchar* t_pRow;
+        if(t_pMap)
+            t_pRow = t_pMap + t_iRowBytes*t_vecRowSel[i];
+        else
+        {
+            this->device()->seek(t_iDataPos + t_iRowBytes*t_vecRowSel[i]);
+            if(this->readRawData(t_rowBuffer.data(), t_iRowBytes) != t_iRowBytes)
+            {
+                printf("FiffStream::read_named_matrix_selection: Could not read matrix row %d.\n", t_vecRowSel[i]);
+                return false;
+            }
+            t_pRow = (const uchar*)t_rowBuffer.constData();
+        }
+
+        if(t_bDouble)
+        {
+            for(qint32 j = 0; j < t_vecColSel.size(); ++j)
+            {
+                quint64 t_iValue = qFromBigEndian<quint64>(t_pRow + 8*t_vecColSel[j]);
+                memcpy(&p_matData(i,j), &t_iValue, 8);
+            }
+        }
+        else
+        {
+            for(qint32 j = 0; j < t_vecColSel.size(); ++j)
+            {
+                quint32 t_iValue = qFromBigEndian<quint32>(t_pRow + 4*t_vecColSel[j]);
+                float t_fValue;
+                memcpy(&t_fValue, &t_iValue, 4);
+                p_matData(i,j) = t_fValue;
+            }
+        }
+    }
+
+    if(t_pMap)
+        t_pFile->unmap(t_pMap);
+
+    return true;
+}
+
+
 //*************************************************************************************************************
 
 QList<FiffProj> FiffStream::read_proj(const FiffDirTree& p_Node)
@@ -2490,6 +2621,22 @@ bool FiffStream::write_raw_buffer(const MatrixXd& buf)
 }
 
 
+//*************************************************************************************************************
+
+void FiffStream::write_short(fiff_int_t kind, const qint16* data, fiff_int_t nel)
+{
+    fiff_int_t datasize = nel * 2;
+
+    *this << (qint32)kind;
+    *this << (qint32)FIFFT_SHORT;
+    *this << (qint32)datasize;
+    *this << (qint32)FIFFV_NEXT_SEQ;
+
+    for(qint32 i = 0; i < nel; ++i)
+        *this << data[i];
+}
+
+
 //*************************************************************************************************************
 
 void FiffStream::write_string(fiff_int_t kind, const QString& data)
@@ -2517,3 +2664,35 @@ void FiffStream::write_rt_command(fiff_int_t command, const QString& data)
 
     this->writeRawData(data.toUtf8().constData(),datasize);
 }
+
+
+//*************************************************************************************************************
+
+bool FiffStream::find_named_matrix_node(const FiffDirTree& p_Node, fiff_int_t matkind, FiffDirTree& p_MatNode)
+{
+    p_MatNode = p_Node;
+    //
+    //   Descend one level if necessary
+    //
+    if (p_MatNode.block != FIFFB_MNE_NAMED_MATRIX)
+    {
+        for (int k = 0; k < p_Node.nchild; ++k)
+        {
+            if (p_Node.children[k].block == FIFFB_MNE_NAMED_MATRIX)
+            {
+                p_MatNode = p_Node.children[k];
+                if(p_MatNode.has_tag(matkind))
+                    return true;
+            }
+        }
+        printf("Fiff::read_named_matrix: Desired named matrix (kind = %d) not available\n",matkind);
+        return false;
+    }
+    else if (!p_MatNode.has_tag(matkind))
+    {
+        printf("Desired named matrix (kind = %d) not available",matkind);
+        return false;
+    }
+
+    return true;
+}
@@ -312,6 +312,35 @@ public:
     */
     bool read_named_matrix(const FiffDirTree& p_Node, fiff_int_t matkind, FiffNamedMatrix& mat);
 
+    //=========================================================================================================
+    /**
+    * Reads the dimensions and the row and column names of a named matrix without decoding its data.
+    * Use read_named_matrix_selection to decode the part of the matrix which is really needed.
+    *
+    * @param[in] p_Node     The node of interest
+    * @param[in] matkind    The matrix kind to look for
+    * @param[out] mat       The named matrix; data is left empty
+    *
+    * @return true if succeeded, false otherwise
+    */
+    bool read_named_matrix_info(const FiffDirTree& p_Node, fiff_int_t matkind, FiffNamedMatrix& mat);
+
+    //=========================================================================================================
+    /**
+    * Decodes only the selected rows and columns of a dense float or double named matrix. Rows and columns refer to the
+    * matrix as it is stored in the file (i.e. before any transposition). When the stream operates on a QFile
+    * the tag data is memory mapped, otherwise only the selected rows are read from the device.
+    *
+    * @param[in] p_Node         The node of interest
+    * @param[in] matkind        The matrix kind to look for
+    * @param[in] p_vecRowSel    Indices of the stored rows to decode; empty to decode all rows
+    * @param[in] p_vecColSel    Indices of the stored columns to decode; empty to decode all columns
+    * @param[out] p_matData     The decoded selection (p_vecRowSel.size() x p_vecColSel.size())
+    *
+    * @return true if succeeded, false otherwise
+    */
+    bool read_named_matrix_selection(const FiffDirTree& p_Node, fiff_int_t matkind, const RowVectorXi& p_vecRowSel, const RowVectorXi& p_vecColSel, MatrixXd& p_matData);
+
     //=========================================================================================================
     /**
     * fiff_read_proj
@@ -670,6 +699,18 @@ public:
     */
     bool write_raw_buffer(const MatrixXd& buf);
 
+    //=========================================================================================================
+    /**
+    * fiff_write_short
+    *
+    * Writes a 16-bit integer tag to a fif file
+    *
+    * @param[in] kind       Tag kind
+    * @param[in] data       The short data pointer
+    * @param[in] nel        Number of shorts to write (default = 1)
+    */
+    void write_short(fiff_int_t kind, const qint16* data, fiff_int_t nel = 1);
+
     //=========================================================================================================
     /**
     * fiff_write_string
@@ -691,6 +732,20 @@ public:
     * @param[in] data       The string data to write
     */
     void write_rt_command(fiff_int_t command, const QString& data);
+
+private:
+    //=========================================================================================================
+    /**
+    * Locates the FIFFB_MNE_NAMED_MATRIX node which holds a matrix of the given kind. Descends one level if
+    * p_Node is not a named matrix block itself.
+    *
+    * @param[in] p_Node     The node of interest
+    * @param[in] matkind    The matrix kind to look for
+    * @param[out] p_MatNode The named matrix node
+    *
+    * @return true if succeeded, false otherwise
+    */
+    static bool find_named_matrix_node(const FiffDirTree& p_Node, fiff_int_t matkind, FiffDirTree& p_MatNode);
 };
 
 } // NAMESPACE
@@ -0,0 +1,530 @@
+//=============================================================================================================
+/**
+* @file     broadcastmatrixbuffer.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     January, 2015
+*
+* @section  LICENSE
+*
+* Copyright (C) 2012, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief     BroadcastMatrixBuffer class declaration
+*
+*/
+
+#ifndef BROADCASTMATRIXBUFFER_H
+#define BROADCASTMATRIXBUFFER_H
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "generics_global.h"
+#include "buffer.h"
+
+#include <typeinfo>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QMap>
+#include <QVector>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QSharedPointer>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE IOBuffer
+//=============================================================================================================
+
+namespace IOBuffer
+{
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+
+
+//=============================================================================================================
+/**
+* Broadcast Matrix buffer provides a thread safe single producer/multiple consumer ring. Every pushed block is
+* stored once as an immutable shared matrix and every registered consumer reads all blocks with its own read
+* cursor, so fanning out a raw stream to several algorithms does not copy the block per consumer. How a consumer
+* which falls a full ring behind is treated is selected per consumer (see SlowConsumerPolicy).
+*
+* @brief The broadcast matrix buffer
+*/
+template<typename _Tp>
+class BroadcastMatrixBuffer : public Buffer
+{
+public:
+    typedef QSharedPointer<BroadcastMatrixBuffer> SPtr;                 /**< Shared pointer type for BroadcastMatrixBuffer. */
+    typedef QSharedPointer<const BroadcastMatrixBuffer> ConstSPtr;      /**< Const shared pointer type for BroadcastMatrixBuffer. */
+    typedef QSharedPointer<const Matrix<_Tp, Dynamic, Dynamic> > BlockSPtr; /**< Shared pointer type for the immutable blocks. */
+
+    //=========================================================================================================
+    /**
+    * Treatment of a consumer which has a full ring of unread blocks when a new block is pushed.
+    */
+    enum SlowConsumerPolicy
+    {
+        BLOCK,          /**< The producer waits until the consumer has read a block. */
+        DROP_OLDEST,    /**< The oldest unread block of the consumer is dropped. */
+        SKIP_TO_LATEST  /**< As DROP_OLDEST; in addition pop() always skips to the newest block. */
+    };
+
+    //=========================================================================================================
+    /**
+    * Statistics of a consumer.
+    */
+    struct ConsumerStats
+    {
+        quint64 received;   /**< Number of popped blocks. */
+        quint64 dropped;    /**< Number of blocks the consumer missed. */
+        quint64 lag;        /**< Number of currently unread blocks. */
+        quint64 maxLag;     /**< Maximal number of unread blocks seen by a push. */
+    };
+
+    //=========================================================================================================
+    /**
+    * Constructs a BroadcastMatrixBuffer.
+    *
+    * @param [in] uiMaxNumMatrices  Number of blocks kept in the ring.
+    */
+    explicit BroadcastMatrixBuffer(unsigned int uiMaxNumMatrices);
+
+    //=========================================================================================================
+    /**
+    * Registers a new consumer. The consumer receives all blocks pushed after its registration.
+    *
+    * @param [in] policy    Treatment of the consumer if it falls behind.
+    *
+    * @return the consumer id to be used with pop().
+    */
+    qint32 addConsumer(SlowConsumerPolicy policy = BLOCK);
+
+    //=========================================================================================================
+    /**
+    * Unregisters a consumer. A pop() of the consumer which is waiting returns a null block.
+    *
+    * @param [in] id    Consumer id.
+    */
+    void removeConsumer(qint32 id);
+
+    //=========================================================================================================
+    /**
+    * Adds a copy of the matrix at the end of the buffer.
+    *
+    * @param [in] pMatrix pointer to a Matrix which should be apend to the end.
+    */
+    inline void push(const Matrix<_Tp, Dynamic, Dynamic>* pMatrix);
+
+    //=========================================================================================================
+    /**
+    * Adds an immutable block at the end of the buffer without copying it.
+    *
+    * @param [in] pBlock    The block.
+    */
+    void push(const BlockSPtr &pBlock);
+
+    //=========================================================================================================
+    /**
+    * Returns the next block of a consumer. Blocks while the consumer has read all blocks.
+    *
+    * @param [in] id    Consumer id.
+    *
+    * @return the next block, a null block if the wait was released or the consumer is unknown.
+    */
+    BlockSPtr pop(qint32 id);
+
+    //=========================================================================================================
+    /**
+    * Returns the statistics of a consumer.
+    *
+    * @param [in] id    Consumer id.
+    *
+    * @return the consumer statistics.
+    */
+    ConsumerStats stats(qint32 id) const;
+
+    //=========================================================================================================
+    /**
+    * Clears the buffer. All consumers stay registered.
+    */
+    void clear();
+
+    //=========================================================================================================
+    /**
+    * Size of the buffer.
+    */
+    inline quint32 size() const;
+
+    //=========================================================================================================
+    /**
+    * Pauses the buffer. Skips any incoming matrices.
+    */
+    inline void pause(bool);
+
+    //=========================================================================================================
+    /**
+    * Releases a consumer from a waiting pop() function.
+    *
+    * @param [in] id    Consumer id.
+    *
+    * @return true if the consumer had no unread block, i.e. its pop could be waiting, otherwise false.
+    */
+    bool releaseFromPop(qint32 id);
+
+    //=========================================================================================================
+    /**
+    * Releases the producer from a waiting push() function. The released push drops its block.
+    *
+    * @return true if a BLOCK consumer had a full ring, i.e. the push could be waiting, otherwise false.
+    */
+    bool releaseFromPush();
+
+private:
+    //=========================================================================================================
+    /**
+    * Read cursor and statistics of a consumer.
+    */
+    struct Consumer
+    {
+        SlowConsumerPolicy policy;  /**< Slow consumer policy. */
+        quint64 readCount;          /**< Number of the next block to read. */
+        quint64 received;           /**< Number of popped blocks. */
+        quint64 dropped;            /**< Number of missed blocks. */
+        quint64 maxLag;             /**< Maximal lag. */
+        bool released;              /**< Set by releaseFromPop. */
+    };
+
+    //=========================================================================================================
+    /**
+    * Returns whether a BLOCK consumer has a full ring. Requires m_mutex.
+    */
+    inline bool isBlocked() const;
+
+    unsigned int                m_uiMaxNumMatrices; /**< Holds the maximal number of blocks.*/
+    QVector<BlockSPtr>          m_qVecBlocks;       /**< Holds the ring of shared blocks.*/
+    quint64                     m_iWriteCount;      /**< Holds the number of pushed blocks.*/
+    QMap<qint32, Consumer>      m_qMapConsumers;    /**< Holds the registered consumers.*/
+    qint32                      m_iNextConsumerId;  /**< Holds the id of the next registered consumer.*/
+    bool                        m_bReleasePush;     /**< Set by releaseFromPush.*/
+    mutable QMutex              m_mutex;            /**< Guards cursors and ring.*/
+    QWaitCondition              m_condNotEmpty;     /**< Signaled after a push.*/
+    QWaitCondition              m_condNotFull;      /**< Signaled after a pop.*/
+    bool                        m_bPause;
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+template<typename _Tp>
+BroadcastMatrixBuffer<_Tp>::BroadcastMatrixBuffer(unsigned int uiMaxNumMatrices)
+: Buffer(typeid(_Tp).name())
+, m_uiMaxNumMatrices(uiMaxNumMatrices > 0 ? uiMaxNumMatrices : 1)
+, m_qVecBlocks(m_uiMaxNumMatrices)
+, m_iWriteCount(0)
+, m_iNextConsumerId(0)
+, m_bReleasePush(false)
+, m_bPause(false)
+{
+
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+qint32 BroadcastMatrixBuffer<_Tp>::addConsumer(SlowConsumerPolicy policy)
+{
+    QMutexLocker locker(&m_mutex);
+
+    Consumer t_consumer;
+    t_consumer.policy = policy;
+    t_consumer.readCount = m_iWriteCount;
+    t_consumer.received = 0;
+    t_consumer.dropped = 0;
+    t_consumer.maxLag = 0;
+    t_consumer.released = false;
+
+    qint32 id = m_iNextConsumerId++;
+    m_qMapConsumers.insert(id, t_consumer);
+
+    return id;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+void BroadcastMatrixBuffer<_Tp>::removeConsumer(qint32 id)
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_qMapConsumers.remove(id);
+
+    // The removed consumer may have blocked the producer or wait in pop
+    m_condNotFull.wakeAll();
+    m_condNotEmpty.wakeAll();
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline void BroadcastMatrixBuffer<_Tp>::push(const Matrix<_Tp, Dynamic, Dynamic>* pMatrix)
+{
+    if(!m_bPause)
+        push(BlockSPtr(new Matrix<_Tp, Dynamic, Dynamic>(*pMatrix)));
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+void BroadcastMatrixBuffer<_Tp>::push(const BlockSPtr &pBlock)
+{
+    if(m_bPause)
+        return;
+
+    QMutexLocker locker(&m_mutex);
+
+    while(isBlocked())
+    {
+        if(m_bReleasePush)
+        {
+            m_bReleasePush = false;
+            return;
+        }
+        m_condNotFull.wait(&m_mutex);
+    }
+    m_bReleasePush = false;
+
+    // Make room: drop the oldest unread block of full non blocking consumers
+    typename QMap<qint32, Consumer>::iterator it;
+    for(it = m_qMapConsumers.begin(); it != m_qMapConsumers.end(); ++it)
+    {
+        if(m_iWriteCount - it->readCount >= m_uiMaxNumMatrices)
+        {
+            ++it->readCount;
+            ++it->dropped;
+        }
+    }
+
+    m_qVecBlocks[m_iWriteCount % m_uiMaxNumMatrices] = pBlock;
+    ++m_iWriteCount;
+
+    for(it = m_qMapConsumers.begin(); it != m_qMapConsumers.end(); ++it)
+        if(m_iWriteCount - it->readCount > it->maxLag)
+            it->maxLag = m_iWriteCount - it->readCount;
+
+    m_condNotEmpty.wakeAll();
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+typename BroadcastMatrixBuffer<_Tp>::BlockSPtr BroadcastMatrixBuffer<_Tp>::pop(qint32 id)
+{
+    QMutexLocker locker(&m_mutex);
+
+    typename QMap<qint32, Consumer>::iterator it = m_qMapConsumers.find(id);
+    while(it != m_qMapConsumers.end() && it->readCount == m_iWriteCount && !it->released)
+    {
+        m_condNotEmpty.wait(&m_mutex);
+        // The consumers may have changed while waiting
+        it = m_qMapConsumers.find(id);
+    }
+
+    if(it == m_qMapConsumers.end())
+        return BlockSPtr();
+
+    it->released = false;
+    if(it->readCount == m_iWriteCount)
+        return BlockSPtr();
+
+    if(it->policy == SKIP_TO_LATEST && m_iWriteCount - it->readCount > 1)
+    {
+        it->dropped += m_iWriteCount - it->readCount - 1;
+        it->readCount = m_iWriteCount - 1;
+    }
+
+    BlockSPtr t_pBlock = m_qVecBlocks[it->readCount % m_uiMaxNumMatrices];
+    ++it->readCount;
+    ++it->received;
+
+    if(it->policy == BLOCK)
+        m_condNotFull.wakeAll();
+
+    return t_pBlock;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+typename BroadcastMatrixBuffer<_Tp>::ConsumerStats BroadcastMatrixBuffer<_Tp>::stats(qint32 id) const
+{
+    QMutexLocker locker(&m_mutex);
+
+    ConsumerStats t_stats = {0, 0, 0, 0};
+
+    typename QMap<qint32, Consumer>::const_iterator it = m_qMapConsumers.find(id);
+    if(it != m_qMapConsumers.end())
+    {
+        t_stats.received = it->received;
+        t_stats.dropped = it->dropped;
+        t_stats.lag = m_iWriteCount - it->readCount;
+        t_stats.maxLag = it->maxLag;
+    }
+
+    return t_stats;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+void BroadcastMatrixBuffer<_Tp>::clear()
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_qVecBlocks = QVector<BlockSPtr>(m_uiMaxNumMatrices);
+    m_iWriteCount = 0;
+    m_bReleasePush = false;
+
+    typename QMap<qint32, Consumer>::iterator it;
+    for(it = m_qMapConsumers.begin(); it != m_qMapConsumers.end(); ++it)
+    {
+        it->readCount = 0;
+        it->released = false;
+    }
+
+    m_condNotFull.wakeAll();
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline quint32 BroadcastMatrixBuffer<_Tp>::size() const
+{
+    return m_uiMaxNumMatrices;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline void BroadcastMatrixBuffer<_Tp>::pause(bool bPause)
+{
+    m_bPause = bPause;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+bool BroadcastMatrixBuffer<_Tp>::releaseFromPop(qint32 id)
+{
+    QMutexLocker locker(&m_mutex);
+
+    typename QMap<qint32, Consumer>::iterator it = m_qMapConsumers.find(id);
+    if(it == m_qMapConsumers.end() || it->readCount != m_iWriteCount)
+        return false;
+
+    it->released = true;
+    m_condNotEmpty.wakeAll();
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+bool BroadcastMatrixBuffer<_Tp>::releaseFromPush()
+{
+    QMutexLocker locker(&m_mutex);
+
+    if(!isBlocked())
+        return false;
+
+    m_bReleasePush = true;
+    m_condNotFull.wakeAll();
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline bool BroadcastMatrixBuffer<_Tp>::isBlocked() const
+{
+    typename QMap<qint32, Consumer>::const_iterator it;
+    for(it = m_qMapConsumers.constBegin(); it != m_qMapConsumers.constEnd(); ++it)
+        if(it->policy == BLOCK && m_iWriteCount - it->readCount >= m_uiMaxNumMatrices)
+            return true;
+
+    return false;
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// TYPEDEF
+//=============================================================================================================
+
+typedef GENERICSSHARED_EXPORT BroadcastMatrixBuffer<float>      _float_BroadcastMatrixBuffer;   /**< Defines BroadcastMatrixBuffer of float type.*/
+typedef GENERICSSHARED_EXPORT BroadcastMatrixBuffer<double>     _double_BroadcastMatrixBuffer;  /**< Defines BroadcastMatrixBuffer of double type.*/
+
+} // NAMESPACE
+
+#endif // BROADCASTMATRIXBUFFER_H
@@ -46,6 +46,7 @@
 #include "buffer.h"
 
 #include <typeinfo>
+#include <cstring>
 
 
 //*************************************************************************************************************
@@ -61,8 +62,10 @@
 // QT INCLUDES
 //=============================================================================================================
 
-#include <QPair>
-#include <QSemaphore>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
 #include <QSharedPointer>
 
 
@@ -85,7 +88,10 @@ using namespace Eigen;
 
 //=============================================================================================================
 /**
-* Circular Matrix buffer provides a template for thread safe circular matrix buffers.
+* Circular Matrix buffer provides a template for thread safe circular matrix buffers. It is a lock-free single
+* producer/single consumer ring of preallocated matrix slots: push and pop copy a whole matrix with one memcpy
+* and publish it by an atomic index update. A mutex and wait conditions are only touched when the consumer finds
+* the buffer empty or the producer finds it full.
 *
 * @brief The circular matrix buffer
 */
@@ -115,7 +121,8 @@ public:
 
     //=========================================================================================================
     /**
-    * Adds a whole matrix at the end buffer.
+    * Adds a whole matrix at the end buffer. Blocks while the buffer is full. Must only be called by one
+    * producer thread.
     *
     * @param [in] pMatrix pointer to a Matrix which should be apend to the end.
     */
@@ -123,12 +130,45 @@ public:
 
     //=========================================================================================================
     /**
-    * Returns the first matrix (first in first out).
+    * Returns the first matrix (first in first out). Blocks while the buffer is empty. Must only be called by
+    * one consumer thread.
     *
     * @return the first matrix
     */
     inline Matrix<_Tp, Dynamic, Dynamic> pop();
 
+    //=========================================================================================================
+    /**
+    * Borrows the next free slot of the buffer for writing, so that a producer can decode its data directly into
+    * the buffer memory. Blocks while the buffer is full. The slot is published with commit(); acquiring again
+    * before commit() returns the same slot. Must only be called by one producer thread.
+    *
+    * @return a view of the free slot, an empty (0 x 0) view if the buffer is paused or the wait was released.
+    */
+    inline Map<Matrix<_Tp, Dynamic, Dynamic> > acquireWriteSlot();
+
+    //=========================================================================================================
+    /**
+    * Publishes the slot borrowed by acquireWriteSlot().
+    */
+    inline void commit();
+
+    //=========================================================================================================
+    /**
+    * Borrows the first stored matrix (first in first out) for reading, so that a consumer can process it in
+    * place. Blocks while the buffer is empty. The slot is handed back with release(); acquiring again before
+    * release() returns the same slot. Must only be called by one consumer thread.
+    *
+    * @return a view of the first matrix, an empty (0 x 0) view if the buffer is paused or the wait was released.
+    */
+    inline Map<const Matrix<_Tp, Dynamic, Dynamic> > acquireReadSlot();
+
+    //=========================================================================================================
+    /**
+    * Hands the slot borrowed by acquireReadSlot() back to the producer.
+    */
+    inline void release();
+
     //=========================================================================================================
     /**
     * Clears the buffer.
@@ -161,14 +201,16 @@ public:
 
     //=========================================================================================================
     /**
-    * Releases the circular buffer from the acquire statement in the pop() function.
+    * Releases the circular buffer from the acquire statement in the pop() function. The released pop returns
+    * a zero matrix.
     * @param [out] bool returns true if resources were freed so that the aquire statement in the pop function can release, otherwise false.
     */
     inline bool releaseFromPop();
 
     //=========================================================================================================
     /**
-    * Releases the circular buffer from the acquire statement in the push() function.
+    * Releases the circular buffer from the acquire statement in the push() function. The released push drops
+    * its matrix.
     * @param [out] bool returns true if resources were freed so that the aquire statement in the push function can release, otherwise false.
     */
     inline bool releaseFromPush();
@@ -176,22 +218,63 @@ public:
 private:
     //=========================================================================================================
     /**
-    * Returns the current circular index to the corresponding given index.
+    * Returns the number of matrices which are ready to be popped.
+    *
+    * @return the number of stored matrices.
+    */
+    inline unsigned int numUsed() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the slot memory of a ring index. Ring indices run over [0, 2*m_uiMaxNumMatrices) to tell a
+    * full from an empty buffer.
     *
-    * @param [in] index which should be mapped.
-    * @return the mapped index.
+    * @param [in] index ring index.
+    * @return the slot memory.
     */
-    inline unsigned int mapIndex(int& index);
+    inline _Tp* slot(int index) const;
+
+    //=========================================================================================================
+    /**
+    * Returns the ring index following the given one.
+    *
+    * @param [in] index ring index.
+    * @return the next ring index.
+    */
+    inline int nextIndex(int index) const;
+
+    //=========================================================================================================
+    /**
+    * Blocks until a matrix can be popped.
+    *
+    * @return false if the wait was released by releaseFromPop and the buffer is still empty, true otherwise.
+    */
+    inline bool waitWhileEmpty();
+
+    //=========================================================================================================
+    /**
+    * Blocks until a matrix can be pushed.
+    *
+    * @return false if the wait was released by releaseFromPush and the buffer is still full, true otherwise.
+    */
+    inline bool waitWhileFull();
 
     unsigned int    m_uiMaxNumMatrices;         /**< Holds the maximal number of matrices.*/
     unsigned int    m_uiRows;                   /**< Holds the number rows.*/
     unsigned int    m_uiCols;                   /**< Holds the number cols.*/
     unsigned int    m_uiMaxNumElements;         /**< Holds the maximal number of buffer elements.*/
     _Tp*            m_pBuffer;                  /**< Holds the circular buffer.*/
-    int             m_iCurrentReadIndex;        /**< Holds the current read index.*/
-    int             m_iCurrentWriteIndex;       /**< Holds the current write index.*/
-    QSemaphore*     m_pFreeElements;            /**< Holds a semaphore which acquires free elements for thread safe writing. A semaphore is a generalization of a mutex.*/
-    QSemaphore*     m_pUsedElements;            /**< Holds a semaphore which acquires written semaphore for thread safe reading.*/
+    QAtomicInt      m_iReadIndex;               /**< Holds the ring index of the next matrix to pop. Only written by the consumer.*/
+    QAtomicInt      m_iWriteIndex;              /**< Holds the ring index of the next matrix to push. Only written by the producer.*/
+    QAtomicInt      m_iPopWaiting;              /**< Set while the consumer waits on m_condNotEmpty.*/
+    QAtomicInt      m_iPushWaiting;             /**< Set while the producer waits on m_condNotFull.*/
+    QAtomicInt      m_iReleasePop;              /**< Set by releaseFromPop.*/
+    QAtomicInt      m_iReleasePush;             /**< Set by releaseFromPush.*/
+    QMutex          m_mutex;                    /**< Guards the wait conditions, only locked when the buffer is empty or full.*/
+    QWaitCondition  m_condNotEmpty;             /**< Signaled after a push when the consumer waits.*/
+    QWaitCondition  m_condNotFull;              /**< Signaled after a pop when the producer waits.*/
+    bool            m_bWriteSlotAcquired;       /**< Whether the producer holds a slot of acquireWriteSlot().*/
+    bool            m_bReadSlotAcquired;        /**< Whether the consumer holds a slot of acquireReadSlot().*/
     bool            m_bPause;
 };
 
@@ -204,15 +287,19 @@ private:
 template<typename _Tp>
 CircularMatrixBuffer<_Tp>::CircularMatrixBuffer(unsigned int uiMaxNumMatrices, unsigned int uiRows, unsigned int uiCols)
 : Buffer(typeid(_Tp).name())
-, m_uiMaxNumMatrices(uiMaxNumMatrices)
+, m_uiMaxNumMatrices(uiMaxNumMatrices > 0 ? uiMaxNumMatrices : 1)
 , m_uiRows(uiRows)
 , m_uiCols(uiCols)
 , m_uiMaxNumElements(m_uiMaxNumMatrices*m_uiRows*m_uiCols)
 , m_pBuffer(new _Tp[m_uiMaxNumElements])
-, m_iCurrentReadIndex(-1)
-, m_iCurrentWriteIndex(-1)
-, m_pFreeElements(new QSemaphore(m_uiMaxNumElements))
-, m_pUsedElements(new QSemaphore(0))
+, m_iReadIndex(0)
+, m_iWriteIndex(0)
+, m_iPopWaiting(0)
+, m_iPushWaiting(0)
+, m_iReleasePop(0)
+, m_iReleasePush(0)
+, m_bWriteSlotAcquired(false)
+, m_bReadSlotAcquired(false)
 , m_bPause(false)
 {
 
@@ -224,8 +311,6 @@ CircularMatrixBuffer<_Tp>::CircularMatrixBuffer(unsigned int uiMaxNumMatrices, u
 template<typename _Tp>
 CircularMatrixBuffer<_Tp>::~CircularMatrixBuffer()
 {
-    delete m_pFreeElements;
-    delete m_pUsedElements;
     delete [] m_pBuffer;
 }
 
@@ -240,10 +325,12 @@ inline void CircularMatrixBuffer<_Tp>::push(const Matrix<_Tp, Dynamic, Dynamic>*
         unsigned int t_size = pMatrix->size();
         if(t_size == m_uiRows*m_uiCols)
         {
-            m_pFreeElements->acquire(t_size);
-            for(unsigned int i = 0; i < t_size; ++i)
-                m_pBuffer[mapIndex(m_iCurrentWriteIndex)] = pMatrix->data()[i];
-            m_pUsedElements->release(t_size);
+            Map<Matrix<_Tp, Dynamic, Dynamic> > t_slot = acquireWriteSlot();
+            if(t_slot.size() == 0)
+                return;
+
+            memcpy(t_slot.data(), pMatrix->data(), t_size*sizeof(_Tp));
+            commit();
         }
     //    else
     //        printf("Error: Matrix not appended to CircularMatrixBuffer - wrong dimensions\n");
@@ -258,12 +345,11 @@ inline Matrix<_Tp, Dynamic, Dynamic> CircularMatrixBuffer<_Tp>::pop()
 {
     Matrix<_Tp, Dynamic, Dynamic> matrix(m_uiRows, m_uiCols);
 
-    if(!m_bPause)
+    Map<const Matrix<_Tp, Dynamic, Dynamic> > t_slot = acquireReadSlot();
+    if(t_slot.size() > 0)
     {
-        m_pUsedElements->acquire(m_uiRows*m_uiCols);
-        for(quint32 i = 0; i < m_uiRows*m_uiCols; ++i)
-            matrix.data()[i] = m_pBuffer[mapIndex(m_iCurrentReadIndex)];
-        m_pFreeElements->release(m_uiRows*m_uiCols);
+        memcpy(matrix.data(), t_slot.data(), m_uiRows*m_uiCols*sizeof(_Tp));
+        release();
     }
     else
         matrix.setZero();
@@ -275,12 +361,135 @@ inline Matrix<_Tp, Dynamic, Dynamic> CircularMatrixBuffer<_Tp>::pop()
 //*************************************************************************************************************
 
 template<typename _Tp>
-inline unsigned int CircularMatrixBuffer<_Tp>::mapIndex(int& index)
+inline Map<Matrix<_Tp, Dynamic, Dynamic> > CircularMatrixBuffer<_Tp>::acquireWriteSlot()
+{
+    if(m_bPause || !waitWhileFull())
+        return Map<Matrix<_Tp, Dynamic, Dynamic> >(m_pBuffer, 0, 0);
+
+    m_bWriteSlotAcquired = true;
+
+    return Map<Matrix<_Tp, Dynamic, Dynamic> >(slot(m_iWriteIndex.loadAcquire()), m_uiRows, m_uiCols);
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline void CircularMatrixBuffer<_Tp>::commit()
+{
+    if(!m_bWriteSlotAcquired)
+        return;
+    m_bWriteSlotAcquired = false;
+
+    // Full barrier: publish the slot before checking for a waiting consumer
+    m_iWriteIndex.fetchAndStoreOrdered(nextIndex(m_iWriteIndex.loadAcquire()));
+    if(m_iPopWaiting.fetchAndAddOrdered(0))
+    {
+        QMutexLocker locker(&m_mutex);
+        m_condNotEmpty.wakeAll();
+    }
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline Map<const Matrix<_Tp, Dynamic, Dynamic> > CircularMatrixBuffer<_Tp>::acquireReadSlot()
 {
-    int AuxIndex;
-    AuxIndex = ++index;
-    return index = AuxIndex % m_uiMaxNumElements;
+    if(m_bPause || !waitWhileEmpty())
+        return Map<const Matrix<_Tp, Dynamic, Dynamic> >(m_pBuffer, 0, 0);
 
+    m_bReadSlotAcquired = true;
+
+    return Map<const Matrix<_Tp, Dynamic, Dynamic> >(slot(m_iReadIndex.loadAcquire()), m_uiRows, m_uiCols);
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline void CircularMatrixBuffer<_Tp>::release()
+{
+    if(!m_bReadSlotAcquired)
+        return;
+    m_bReadSlotAcquired = false;
+
+    // Full barrier: free the slot before checking for a waiting producer
+    m_iReadIndex.fetchAndStoreOrdered(nextIndex(m_iReadIndex.loadAcquire()));
+    if(m_iPushWaiting.fetchAndAddOrdered(0))
+    {
+        QMutexLocker locker(&m_mutex);
+        m_condNotFull.wakeAll();
+    }
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline unsigned int CircularMatrixBuffer<_Tp>::numUsed() const
+{
+    int t_iDiff = m_iWriteIndex.loadAcquire() - m_iReadIndex.loadAcquire();
+    return t_iDiff >= 0 ? t_iDiff : t_iDiff + 2*m_uiMaxNumMatrices;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline _Tp* CircularMatrixBuffer<_Tp>::slot(int index) const
+{
+    unsigned int t_uiSlot = (unsigned int)index < m_uiMaxNumMatrices ? index : index - m_uiMaxNumMatrices;
+    return m_pBuffer + t_uiSlot*m_uiRows*m_uiCols;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline int CircularMatrixBuffer<_Tp>::nextIndex(int index) const
+{
+    return (unsigned int)(index + 1) < 2*m_uiMaxNumMatrices ? index + 1 : 0;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline bool CircularMatrixBuffer<_Tp>::waitWhileEmpty()
+{
+    if(numUsed() > 0)
+        return true;
+
+    QMutexLocker locker(&m_mutex);
+    // Announce the wait before the final check -> the producer either sees the flag or we see its matrix
+    m_iPopWaiting.fetchAndStoreOrdered(1);
+    while(numUsed() == 0 && !m_iReleasePop.fetchAndAddOrdered(0))
+        m_condNotEmpty.wait(&m_mutex);
+    m_iPopWaiting.fetchAndStoreOrdered(0);
+    m_iReleasePop.fetchAndStoreOrdered(0);
+
+    return numUsed() > 0;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline bool CircularMatrixBuffer<_Tp>::waitWhileFull()
+{
+    if(numUsed() < m_uiMaxNumMatrices)
+        return true;
+
+    QMutexLocker locker(&m_mutex);
+    // Announce the wait before the final check -> the consumer either sees the flag or we see the free slot
+    m_iPushWaiting.fetchAndStoreOrdered(1);
+    while(numUsed() >= m_uiMaxNumMatrices && !m_iReleasePush.fetchAndAddOrdered(0))
+        m_condNotFull.wait(&m_mutex);
+    m_iPushWaiting.fetchAndStoreOrdered(0);
+    m_iReleasePush.fetchAndStoreOrdered(0);
+
+    return numUsed() < m_uiMaxNumMatrices;
 }
 
 
@@ -289,13 +498,16 @@ inline unsigned int CircularMatrixBuffer<_Tp>::mapIndex(int& index)
 template<typename _Tp>
 void CircularMatrixBuffer<_Tp>::clear()
 {
-    delete m_pFreeElements;
-    m_pFreeElements = new QSemaphore(m_uiMaxNumElements);
-    delete m_pUsedElements;
-    m_pUsedElements = new QSemaphore(0);
+    QMutexLocker locker(&m_mutex);
 
-    m_iCurrentReadIndex = -1;
-    m_iCurrentWriteIndex = -1;
+    m_iReadIndex.fetchAndStoreOrdered(0);
+    m_iWriteIndex.fetchAndStoreOrdered(0);
+    m_iReleasePop.fetchAndStoreOrdered(0);
+    m_iReleasePush.fetchAndStoreOrdered(0);
+    m_bWriteSlotAcquired = false;
+    m_bReadSlotAcquired = false;
+
+    m_condNotFull.wakeAll();
 }
 
 
@@ -340,15 +552,11 @@ inline void CircularMatrixBuffer<_Tp>::pause(bool bPause)
 template<typename _Tp>
 inline bool CircularMatrixBuffer<_Tp>::releaseFromPop()
 {
-   if((uint)m_pUsedElements->available() < m_uiRows*m_uiCols)
+    if(numUsed() == 0)
     {
-        //The last matrix which is to be popped from the buffer is supposed to be a zero matrix
-        unsigned int t_size = m_uiRows*m_uiCols;
-        for(unsigned int i = 0; i < t_size; ++i)
-            m_pBuffer[mapIndex(m_iCurrentWriteIndex)] = 0;
-
-        //Release (create) values from m_pUsedElements so that the pop function can leave the acquire statement in the pop function
-        m_pUsedElements->release(m_uiRows*m_uiCols);
+        QMutexLocker locker(&m_mutex);
+        m_iReleasePop.fetchAndStoreOrdered(1);
+        m_condNotEmpty.wakeAll();
 
         return true;
     }
@@ -362,15 +570,11 @@ inline bool CircularMatrixBuffer<_Tp>::releaseFromPop()
 template<typename _Tp>
 inline bool CircularMatrixBuffer<_Tp>::releaseFromPush()
 {
-    if((uint)m_pFreeElements->available() < m_uiRows*m_uiCols)
+    if(numUsed() >= m_uiMaxNumMatrices)
     {
-        //The last matrix which is to be pushed to the buffer is supposed to be a zero matrix
-        unsigned int t_size = m_uiRows*m_uiCols;
-        for(unsigned int i = 0; i < t_size; ++i)
-            m_pBuffer[mapIndex(m_iCurrentWriteIndex)] = 0;
-
-        //Release (create) values from m_pFreeElements so that the push function can leave the acquire statement in the push function
-        m_pFreeElements->release(m_uiRows*m_uiCols);
+        QMutexLocker locker(&m_mutex);
+        m_iReleasePush.fetchAndStoreOrdered(1);
+        m_condNotFull.wakeAll();
 
         return true;
     }
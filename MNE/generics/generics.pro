@@ -72,11 +72,14 @@ else {
 SOURCES += \ 
     circularbuffer.cpp \
     circularmatrixbuffer.cpp \
+    broadcastmatrixbuffer.cpp \
     observerpattern.cpp \
     buffer.cpp
 
 HEADERS += generics_global.h \
     circularmatrixbuffer.h \
+    circularmatrixbuffer_old.h \
+    broadcastmatrixbuffer.h \
     circularbuffer.h \
     observerpattern.h \
     commandpattern.h \
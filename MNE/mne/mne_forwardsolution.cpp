@@ -812,31 +812,44 @@ FiffCov MNEForwardSolution::compute_depth_prior(const MatrixXd &Gain, const Fiff
 {
     printf("\tCreating the depth weighting matrix...\n");
 
-    MatrixXd G(Gain);
     // If possible, pick best depth-weighting channels
+    VectorXi t_vecRowSel;
     if(limit_depth_chs)
-        MNEForwardSolution::restrict_gain_matrix(G, gain_info);
-
-    VectorXd d;
-    // Compute the gain matrix
-    if(is_fixed_ori)
     {
-        d = (G.array().square()).rowwise().sum(); //ToDo: is this correct - is G squared?
-//            d = np.sum(G ** 2, axis=0)
+        if(gain_info.chs.size() != Gain.rows())
+            printf("Error Gain.rows() and length of info.chs do not match: %li != %i", Gain.rows(), gain_info.chs.size()); //ToDo throw
+        else
+            t_vecRowSel = MNEForwardSolution::restrict_gain_selection(gain_info).transpose();
     }
-    else
+
+    //
+    // Compute the gain power of each source in chunks, the gain matrix is not copied
+    //
+    qint32 t_iNumOri = is_fixed_ori ? 1 : 3;
+    qint32 n_pos = Gain.cols() / t_iNumOri;
+    qint32 t_iChunkSize = 256;
+
+    QList<GainChunk> t_qListChunks;
+    for(qint32 k = 0; k < n_pos; k += t_iChunkSize)
     {
-        qint32 n_pos = G.cols() / 3;
-        d = VectorXd::Zero(n_pos);
-        MatrixXd Gk;
-        for (qint32 k = 0; k < n_pos; ++k)
-        {
-            Gk = G.block(0,3*k, G.rows(), 3);
-            JacobiSVD<MatrixXd> svd(Gk.transpose()*Gk);
-            d[k] = svd.singularValues().maxCoeff();
-        }
+        GainChunk t_chunk;
+        t_chunk.pGain = const_cast<MatrixXd*>(&Gain); // computeDepth reads only
+        t_chunk.pWhitener = NULL;
+        t_chunk.pSourceStd = NULL;
+        t_chunk.pRowSel = &t_vecRowSel;
+        t_chunk.iNumOri = t_iNumOri;
+        t_chunk.iFirstSource = k;
+        t_chunk.iNumSources = k + t_iChunkSize > n_pos ? n_pos - k : t_iChunkSize;
+        t_chunk.dSquaredNorm = 0;
+        t_qListChunks.append(t_chunk);
     }
 
+    QtConcurrent::blockingMap(t_qListChunks, &GainChunk::computeDepth);
+
+    VectorXd d(n_pos);
+    for(qint32 i = 0; i < t_qListChunks.size(); ++i)
+        d.segment(t_qListChunks[i].iFirstSource, t_qListChunks[i].iNumSources) = t_qListChunks[i].vecD;
+
     // ToDo Currently the fwd solns never have "patch_areas" defined
     if(patch_areas.cols() > 0)
     {
@@ -916,6 +929,57 @@ FiffCov MNEForwardSolution::compute_depth_prior(const MatrixXd &Gain, const Fiff
 }
 
 
+//*************************************************************************************************************
+
+bool MNEForwardSolution::whiten_gain(MatrixXd &gain, const MatrixXd &whitener, const VectorXd &source_std, double &trace_GRGT)
+{
+    trace_GRGT = 0;
+
+    if(whitener.rows() > whitener.cols() || whitener.cols() != gain.rows() || source_std.size() != gain.cols())
+    {
+        printf("Error in MNEForwardSolution::whiten_gain: Dimensions of gain (%li x %li), whitener (%li x %li) and source_std (%li) do not match.\n",
+               gain.rows(), gain.cols(), whitener.rows(), whitener.cols(), source_std.size()); //ToDo throw
+        return false;
+    }
+
+    // Whitening acts on each column separately, hence chunks are formed over columns regardless of the orientation
+    qint32 n_pos = gain.cols();
+    qint32 t_iChunkSize = 768;
+
+    QList<GainChunk> t_qListChunks;
+    for(qint32 k = 0; k < n_pos; k += t_iChunkSize)
+    {
+        GainChunk t_chunk;
+        t_chunk.pGain = &gain;
+        t_chunk.pWhitener = &whitener;
+        t_chunk.pSourceStd = &source_std;
+        t_chunk.pRowSel = NULL;
+        t_chunk.iNumOri = 1;
+        t_chunk.iFirstSource = k;
+        t_chunk.iNumSources = k + t_iChunkSize > n_pos ? n_pos - k : t_iChunkSize;
+        t_chunk.dSquaredNorm = 0;
+        t_qListChunks.append(t_chunk);
+    }
+
+    // Chunks cover disjoint columns of gain and can be whitened concurrently
+    QtConcurrent::blockingMap(t_qListChunks, &GainChunk::whiten);
+
+    if(whitener.rows() < gain.rows())
+        gain.conservativeResize(whitener.rows(), NoChange);
+
+    for(qint32 i = 0; i < t_qListChunks.size(); ++i)
+        trace_GRGT += t_qListChunks[i].dSquaredNorm;
+
+    if(!(trace_GRGT > 0))
+    {
+        printf("Error in MNEForwardSolution::whiten_gain: The whitened and weighted gain vanishes (trace %e).\n", trace_GRGT); //ToDo throw
+        return false;
+    }
+
+    return true;
+}
+
+
 //*************************************************************************************************************
 
 FiffCov MNEForwardSolution::compute_orient_prior(float loose)
@@ -1098,24 +1162,77 @@ MNEForwardSolution MNEForwardSolution::pick_types(bool meg, bool eeg, const QStr
 //*************************************************************************************************************
 
 void MNEForwardSolution::prepare_forward(const FiffInfo &p_info, const FiffCov &p_noise_cov, bool p_pca, FiffInfo &p_outFwdInfo, MatrixXd &gain, FiffCov &p_outNoiseCov, MatrixXd &p_outWhitener, qint32 &p_outNumNonZero) const
+{
+    QStringList fwd_ch_names;
+    for(qint32 i = 0; i < this->info.chs.size(); ++i)
+        fwd_ch_names << this->info.chs[i].ch_name;
+
+    QStringList ch_names = this->prepare_ch_names(p_info, p_noise_cov);
+
+    printf("Computing inverse operator with %d channels.\n", ch_names.size());
+
+    //
+    //   Handle noise cov
+    //
+    MNEForwardSolution::prepare_whitener(p_info, p_noise_cov, ch_names, p_pca, p_outNoiseCov, p_outWhitener, p_outNumNonZero);
+
+    VectorXi fwd_idx = VectorXi::Zero(ch_names.size());
+    VectorXi info_idx = VectorXi::Zero(ch_names.size());
+    qint32 idx;
+    qint32 count_fwd_idx = 0;
+    qint32 count_info_idx = 0;
+    for(qint32 i = 0; i < ch_names.size(); ++i)
+    {
+        idx = fwd_ch_names.indexOf(ch_names[i]);
+        if(idx > -1)
+        {
+            fwd_idx[count_fwd_idx] = idx;
+            ++count_fwd_idx;
+        }
+        idx = p_info.ch_names.indexOf(ch_names[i]);
+        if(idx > -1)
+        {
+            info_idx[count_info_idx] = idx;
+            ++count_info_idx;
+        }
+    }
+    fwd_idx.conservativeResize(count_fwd_idx);
+    info_idx.conservativeResize(count_info_idx);
+
+    gain.resize(count_fwd_idx, this->sol->data.cols());
+    for(qint32 i = 0; i < count_fwd_idx; ++i)
+        gain.row(i) = this->sol->data.row(fwd_idx[i]);
+
+    p_outFwdInfo = p_info.pick_info(info_idx);
+
+    printf("\tTotal rank is %d\n", p_outNumNonZero);
+}
+
+
+//*************************************************************************************************************
+
+QStringList MNEForwardSolution::prepare_ch_names(const FiffInfo &p_info, const FiffCov &p_noise_cov) const
 {
     QStringList fwd_ch_names, ch_names;
     for(qint32 i = 0; i < this->info.chs.size(); ++i)
         fwd_ch_names << this->info.chs[i].ch_name;
 
-    ch_names.clear();
     for(qint32 i = 0; i < p_info.chs.size(); ++i)
         if(     !p_info.bads.contains(p_info.chs[i].ch_name)
             &&  !p_noise_cov.bads.contains(p_info.chs[i].ch_name)
             &&  fwd_ch_names.contains(p_info.chs[i].ch_name))
             ch_names << p_info.chs[i].ch_name;
 
+    return ch_names;
+}
+
+
+//*************************************************************************************************************
+
+void MNEForwardSolution::prepare_whitener(const FiffInfo &p_info, const FiffCov &p_noise_cov, const QStringList &ch_names, bool p_pca, FiffCov &p_outNoiseCov, MatrixXd &p_outWhitener, qint32 &p_outNumNonZero)
+{
     qint32 n_chan = ch_names.size();
-    printf("Computing inverse operator with %d channels.\n", n_chan);
 
-    //
-    //   Handle noise cov
-    //
     p_outNoiseCov = p_noise_cov.prepare_noise_cov(p_info, ch_names);
 
     //   Omit the zeroes due to projection
@@ -1136,7 +1253,7 @@ void MNEForwardSolution::prepare_forward(const FiffInfo &p_info, const FiffCov &
     {
         if (p_pca)
         {
-            qWarning("Warning in MNEForwardSolution::prepare_forward: if (p_pca) havent been debugged.");
+            qWarning("Warning in MNEForwardSolution::prepare_whitener: if (p_pca) havent been debugged.");
             p_outWhitener = MatrixXd::Zero(n_chan, p_outNumNonZero);
             // Rows of eigvec are the eigenvectors
             for(qint32 i = 0; i < p_outNumNonZero; ++i)
@@ -1146,50 +1263,27 @@ void MNEForwardSolution::prepare_forward(const FiffInfo &p_info, const FiffCov &
         else
         {
             printf("Creating non pca whitener.\n");
-            p_outWhitener = MatrixXd::Zero(n_chan, n_chan);
+            VectorXd t_vecScale = VectorXd::Zero(n_chan);
             for(qint32 i = 0; i < p_outNumNonZero; ++i)
-                p_outWhitener(t_vecNonZero[i],t_vecNonZero[i]) = 1.0 / sqrt(p_outNoiseCov.eig(t_vecNonZero[i]));
+                t_vecScale[t_vecNonZero[i]] = 1.0 / sqrt(p_outNoiseCov.eig(t_vecNonZero[i]));
             // Cols of eigvec are the eigenvectors
-            p_outWhitener *= p_outNoiseCov.eigvec;
+            p_outWhitener = t_vecScale.asDiagonal() * p_outNoiseCov.eigvec;
         }
     }
+}
 
-    VectorXi fwd_idx = VectorXi::Zero(ch_names.size());
-    VectorXi info_idx = VectorXi::Zero(ch_names.size());
-    qint32 idx;
-    qint32 count_fwd_idx = 0;
-    qint32 count_info_idx = 0;
-    for(qint32 i = 0; i < ch_names.size(); ++i)
-    {
-        idx = fwd_ch_names.indexOf(ch_names[i]);
-        if(idx > -1)
-        {
-            fwd_idx[count_fwd_idx] = idx;
-            ++count_fwd_idx;
-        }
-        idx = p_info.ch_names.indexOf(ch_names[i]);
-        if(idx > -1)
-        {
-            info_idx[count_info_idx] = idx;
-            ++count_info_idx;
-        }
-    }
-    fwd_idx.conservativeResize(count_fwd_idx);
-    info_idx.conservativeResize(count_info_idx);
-
-    gain.resize(count_fwd_idx, this->sol->data.cols());
-    for(qint32 i = 0; i < count_fwd_idx; ++i)
-        gain.row(i) = this->sol->data.row(fwd_idx[i]);
 
-    p_outFwdInfo = p_info.pick_info(info_idx);
+//*************************************************************************************************************
 
-    printf("\tTotal rank is %d\n", p_outNumNonZero);
+bool MNEForwardSolution::read(QIODevice& p_IODevice, MNEForwardSolution& fwd, bool force_fixed, bool surf_ori, const QStringList& include, const QStringList& exclude, bool bExcludeBads)
+{
+    return read(p_IODevice, fwd, QList<Label>(), force_fixed, surf_ori, include, exclude, bExcludeBads);
 }
 
 
 //*************************************************************************************************************
 
-bool MNEForwardSolution::read(QIODevice& p_IODevice, MNEForwardSolution& fwd, bool force_fixed, bool surf_ori, const QStringList& include, const QStringList& exclude, bool bExcludeBads)
+bool MNEForwardSolution::read(QIODevice& p_IODevice, MNEForwardSolution& fwd, const QList<Label>& p_qListLabels, bool force_fixed, bool surf_ori, const QStringList& include, const QStringList& exclude, bool bExcludeBads)
 {
     FiffStream::SPtr t_pStream(new FiffStream(&p_IODevice));
     FiffDirTree t_Tree;
@@ -1248,6 +1342,42 @@ bool MNEForwardSolution::read(QIODevice& p_IODevice, MNEForwardSolution& fwd, bo
         }
     }
 
+    QStringList exclude_bads = exclude;
+    if (bads.size() > 0)
+    {
+        for(qint32 k = 0; k < bads.size(); ++k)
+            if(!exclude_bads.contains(bads[k],Qt::CaseInsensitive))
+                exclude_bads << bads[k];
+    }
+
+    //
+    //   Source selection
+    //
+    VectorXi t_vecSourceSel;
+    if(p_qListLabels.size() > 0)
+    {
+        qint32 iSize = 0;
+        for(qint32 i = 0; i < p_qListLabels.size(); ++i)
+        {
+            VectorXi currentSelection;
+            t_SourceSpace.label_src_vertno_sel(p_qListLabels[i], currentSelection);
+
+            t_vecSourceSel.conservativeResize(iSize+currentSelection.size());
+            t_vecSourceSel.block(iSize,0,currentSelection.size(),1) = currentSelection;
+            iSize = t_vecSourceSel.size();
+        }
+
+        if(t_vecSourceSel.size() == 0)
+        {
+            t_pStream->device()->close();
+            std::cout << "No sources remain after picking the regions\n"; // ToDo throw error
+            return false;
+        }
+
+        MNEMath::sort(t_vecSourceSel, false);
+        printf("\t%li sources selected by %d labels\n", t_vecSourceSel.size(), p_qListLabels.size());
+    }
+
     //
     //   Locate and read the forward solutions
     //
@@ -1274,9 +1404,22 @@ bool MNEForwardSolution::read(QIODevice& p_IODevice, MNEForwardSolution& fwd, bo
         }
     }
 
+    //
+    //   Only the selected channels and sources are decoded
+    //
     MNEForwardSolution megfwd;
+    MNEForwardSolution eegfwd;
+    bool t_bMegRead = read_one(t_pStream.data(), megnode, megfwd, include, exclude_bads, t_vecSourceSel);
+    bool t_bEegRead = read_one(t_pStream.data(), eegnode, eegfwd, include, exclude_bads, t_vecSourceSel);
+    if (!t_bMegRead && !t_bEegRead && (include.size() > 0 || exclude_bads.size() > 0) && t_pStream->device()->isOpen())
+    {
+        printf("Nothing remains after picking. Reading all channels.\n");
+        read_one(t_pStream.data(), megnode, megfwd, defaultQStringList, defaultQStringList, t_vecSourceSel);
+        read_one(t_pStream.data(), eegnode, eegfwd, defaultQStringList, defaultQStringList, t_vecSourceSel);
+    }
+
     QString ori;
-    if (read_one(t_pStream.data(), megnode, megfwd))
+    if (!megfwd.isEmpty())
     {
         if (megfwd.source_ori == FIFFV_MNE_FIXED_ORI)
             ori = QString("fixed");
@@ -1284,8 +1427,7 @@ bool MNEForwardSolution::read(QIODevice& p_IODevice, MNEForwardSolution& fwd, bo
             ori = QString("free");
         printf("\tRead MEG forward solution (%d sources, %d channels, %s orientations)\n", megfwd.nsource,megfwd.nchan,ori.toUtf8().constData());
     }
-    MNEForwardSolution eegfwd;
-    if (read_one(t_pStream.data(), eegnode, eegfwd))
+    if (!eegfwd.isEmpty())
     {
         if (eegfwd.source_ori == FIFFV_MNE_FIXED_ORI)
             ori = QString("fixed");
@@ -1390,7 +1532,10 @@ bool MNEForwardSolution::read(QIODevice& p_IODevice, MNEForwardSolution& fwd, bo
         throw("Source spaces do not match the forward solution.\n");
 
     printf("\tSource spaces transformed to the forward solution coordinate frame\n");
-    fwd.src = t_SourceSpace; //not new MNESourceSpace(t_SourceSpace); for sake of speed
+    if(p_qListLabels.size() > 0)
+        fwd.src = t_SourceSpace.pick_regions(p_qListLabels);
+    else
+        fwd.src = t_SourceSpace; //not new MNESourceSpace(t_SourceSpace); for sake of speed
     //
     //   Handle the source locations and orientations
     //
@@ -1408,6 +1553,8 @@ bool MNEForwardSolution::read(QIODevice& p_IODevice, MNEForwardSolution& fwd, bo
             }
             nuse += t_SourceSpace[k].nuse;
         }
+        if(t_vecSourceSel.size() > 0)
+            fwd.pick_source_geometry(t_vecSourceSel);
         //
         //   Modify the forward solution for fixed source orientations
         //
@@ -1498,6 +1645,9 @@ bool MNEForwardSolution::read(QIODevice& p_IODevice, MNEForwardSolution& fwd, bo
             }
             nuse += t_SourceSpace[k].nuse;
         }
+        if(t_vecSourceSel.size() > 0)
+            fwd.pick_source_geometry(t_vecSourceSel);
+
         MatrixXd tmp = fwd.source_nn.transpose().cast<double>();
         SparseMatrix<double>* surf_rot = MNEMath::make_block_diag(tmp,3);
 
@@ -1532,22 +1682,37 @@ bool MNEForwardSolution::read(QIODevice& p_IODevice, MNEForwardSolution& fwd, bo
         Matrix3f t_eye = Matrix3f::Identity();
         fwd.source_nn = kroneckerProduct(t_ones,t_eye);
 
+        if(t_vecSourceSel.size() > 0)
+            fwd.pick_source_geometry(t_vecSourceSel);
+
         printf("[done]\n");
     }
 
     //
-    //   Do the channel selection
+    //   The channel selection was already applied while decoding, restrict the measurement info accordingly
     //
-    QStringList exclude_bads = exclude;
-    if (bads.size() > 0)
+    fwd.surf_ori = surf_ori;
+    if(fwd.info.ch_names.size() != fwd.sol->row_names.size())
     {
-        for(qint32 k = 0; k < bads.size(); ++k)
-            if(!exclude_bads.contains(bads[k],Qt::CaseInsensitive))
-                exclude_bads << bads[k];
-    }
+        RowVectorXi sel(fwd.sol->row_names.size());
+        qint32 count = 0;
+        for(qint32 i = 0; i < fwd.sol->row_names.size(); ++i)
+        {
+            qint32 idx = fwd.info.ch_names.indexOf(fwd.sol->row_names[i]);
+            if(idx > -1)
+                sel[count++] = idx;
+        }
+        sel.conservativeResize(count);
+        printf("\t%d out of %d channels remain after picking\n", fwd.nchan, fwd.info.nchan);
 
-    fwd.surf_ori = surf_ori;
-    fwd = fwd.pick_channels(include, exclude_bads);
+        fwd.info = fwd.info.pick_info(&sel);
+
+        QStringList t_bads;
+        for(qint32 i = 0; i < fwd.info.bads.size(); ++i)
+            if(fwd.info.ch_names.contains(fwd.info.bads[i]))
+                t_bads.append(fwd.info.bads[i]);
+        fwd.info.bads = t_bads;
+    }
 
 //    //
 //    //   Do the channel selection - OLD VERSION
@@ -1679,7 +1844,7 @@ bool MNEForwardSolution::read(QIODevice& p_IODevice, MNEForwardSolution& fwd, bo
 
 //*************************************************************************************************************
 
-bool MNEForwardSolution::read_one(FiffStream* p_pStream, const FiffDirTree& p_Node, MNEForwardSolution& one)
+bool MNEForwardSolution::read_one(FiffStream* p_pStream, const FiffDirTree& p_Node, MNEForwardSolution& one, const QStringList& include, const QStringList& exclude, const VectorXi& p_vecSourceSel)
 {
     //
     //   Read all interesting stuff for one forward solution
@@ -1726,9 +1891,11 @@ bool MNEForwardSolution::read_one(FiffStream* p_pStream, const FiffDirTree& p_No
 
     one.nchan = *t_pTag->toInt();
 
-    if(p_pStream->read_named_matrix(p_Node, FIFF_MNE_FORWARD_SOLUTION, *one.sol.data()))
-        one.sol->transpose_named_matrix();
-    else
+    //
+    //   The solution is stored as sources x channels, decode only the selected part of it
+    //
+    FiffNamedMatrix t_solInfo;
+    if(!p_pStream->read_named_matrix_info(p_Node, FIFF_MNE_FORWARD_SOLUTION, t_solInfo))
     {
         p_pStream->device()->close();
         printf("Forward solution data not found ."); //ToDo: throw error.
@@ -1736,34 +1903,111 @@ bool MNEForwardSolution::read_one(FiffStream* p_pStream, const FiffDirTree& p_No
         return false;
     }
 
-    if(p_pStream->read_named_matrix(p_Node, FIFF_MNE_FORWARD_SOLUTION_GRAD, *one.sol_grad.data()))
-        one.sol_grad->transpose_named_matrix();
-    else
-        one.sol_grad->clear();
-
-
-    if (one.sol->data.rows() != one.nchan ||
-            (one.sol->data.cols() != one.nsource && one.sol->data.cols() != 3*one.nsource))
+    if (t_solInfo.ncol != one.nchan ||
+            (t_solInfo.nrow != one.nsource && t_solInfo.nrow != 3*one.nsource))
     {
         p_pStream->device()->close();
         printf("Forward solution matrix has wrong dimensions.\n"); //ToDo: throw error.
         //error(me,'Forward solution matrix has wrong dimensions');
         return false;
     }
-    if (!one.sol_grad->isEmpty())
+
+    RowVectorXi t_vecChSel;
+    if(include.size() > 0 || exclude.size() > 0)
     {
-        if (one.sol_grad->data.rows() != one.nchan ||
-                (one.sol_grad->data.cols() != 3*one.nsource && one.sol_grad->data.cols() != 3*3*one.nsource))
+        t_vecChSel = FiffInfoBase::pick_channels(t_solInfo.col_names, include, exclude);
+        if(t_vecChSel.size() == 0)
+        {
+            // Nothing of this solution remains after picking
+            one.clear();
+            return false;
+        }
+    }
+
+    MatrixXd t_matSol;
+    RowVectorXi t_vecSolSel = MNEForwardSolution::expand_source_selection(p_vecSourceSel, t_solInfo.nrow / one.nsource);
+    if(!p_pStream->read_named_matrix_selection(p_Node, FIFF_MNE_FORWARD_SOLUTION, t_vecSolSel, t_vecChSel, t_matSol))
+    {
+        p_pStream->device()->close();
+        printf("Forward solution data could not be decoded.\n"); //ToDo: throw error.
+        return false;
+    }
+
+    one.sol->data = t_matSol.transpose();
+    one.sol->nrow = one.sol->data.rows();
+    one.sol->ncol = one.sol->data.cols();
+    for(qint32 i = 0; i < one.sol->nrow; ++i)
+        one.sol->row_names << t_solInfo.col_names[t_vecChSel.size() > 0 ? t_vecChSel[i] : i];
+    if(!t_solInfo.row_names.isEmpty())
+        for(qint32 i = 0; i < one.sol->ncol; ++i)
+            one.sol->col_names << t_solInfo.row_names[t_vecSolSel.size() > 0 ? t_vecSolSel[i] : i];
+
+    FiffNamedMatrix t_solGradInfo;
+    if(p_pStream->read_named_matrix_info(p_Node, FIFF_MNE_FORWARD_SOLUTION_GRAD, t_solGradInfo))
+    {
+        if (t_solGradInfo.ncol != one.nchan ||
+                (t_solGradInfo.nrow != 3*one.nsource && t_solGradInfo.nrow != 3*3*one.nsource))
         {
             p_pStream->device()->close();
             printf("Forward solution gradient matrix has wrong dimensions.\n"); //ToDo: throw error.
             //error(me,'Forward solution gradient matrix has wrong dimensions');
         }
+        else
+        {
+            t_vecSolSel = MNEForwardSolution::expand_source_selection(p_vecSourceSel, t_solGradInfo.nrow / one.nsource);
+            if(p_pStream->read_named_matrix_selection(p_Node, FIFF_MNE_FORWARD_SOLUTION_GRAD, t_vecSolSel, t_vecChSel, t_matSol))
+            {
+                one.sol_grad->data = t_matSol.transpose();
+                one.sol_grad->nrow = one.sol_grad->data.rows();
+                one.sol_grad->ncol = one.sol_grad->data.cols();
+                one.sol_grad->row_names = one.sol->row_names;
+            }
+            else
+                one.sol_grad->clear();
+        }
     }
+    else
+        one.sol_grad->clear();
+
+    one.nchan = one.sol->nrow;
+
     return true;
 }
 
 
+//*************************************************************************************************************
+
+RowVectorXi MNEForwardSolution::expand_source_selection(const VectorXi& p_vecSourceSel, qint32 p_iNumCols)
+{
+    RowVectorXi t_vecSel(p_vecSourceSel.size()*p_iNumCols);
+    for(qint32 i = 0; i < p_vecSourceSel.size(); ++i)
+        for(qint32 j = 0; j < p_iNumCols; ++j)
+            t_vecSel[i*p_iNumCols+j] = p_vecSourceSel[i]*p_iNumCols+j;
+    return t_vecSel;
+}
+
+
+//*************************************************************************************************************
+
+void MNEForwardSolution::pick_source_geometry(const VectorXi& p_vecSourceSel)
+{
+    qint32 t_iNumOri = this->source_nn.rows() / this->source_rr.rows();
+
+    MatrixX3f rr(p_vecSourceSel.size(),3);
+    for(qint32 i = 0; i < p_vecSourceSel.size(); ++i)
+        rr.row(i) = this->source_rr.row(p_vecSourceSel[i]);
+
+    RowVectorXi t_vecNnSel = expand_source_selection(p_vecSourceSel, t_iNumOri);
+    MatrixX3f nn(t_vecNnSel.size(),3);
+    for(qint32 i = 0; i < t_vecNnSel.size(); ++i)
+        nn.row(i) = this->source_nn.row(t_vecNnSel[i]);
+
+    this->source_rr = rr;
+    this->source_nn = nn;
+    this->nsource = p_vecSourceSel.size();
+}
+
+
 //*************************************************************************************************************
 
 void MNEForwardSolution::restrict_gain_matrix(MatrixXd &G, const FiffInfo &info)
@@ -1775,38 +2019,41 @@ void MNEForwardSolution::restrict_gain_matrix(MatrixXd &G, const FiffInfo &info)
         return;
     }
 
-    RowVectorXi sel = info.pick_types(QString("grad"));
+    RowVectorXi sel = restrict_gain_selection(info);
     if(sel.size() > 0)
     {
         for(qint32 i = 0; i < sel.size(); ++i)
             G.row(i) = G.row(sel[i]);
         G.conservativeResize(sel.size(), G.cols());
+    }
+}
+
+
+//*************************************************************************************************************
+
+RowVectorXi MNEForwardSolution::restrict_gain_selection(const FiffInfo &info)
+{
+    RowVectorXi sel = info.pick_types(QString("grad"));
+    if(sel.size() > 0)
+    {
         printf("\t%li planar channels", sel.size());
+        return sel;
     }
-    else
+
+    sel = info.pick_types(QString("mag"));
+    if (sel.size() > 0)
     {
-        sel = info.pick_types(QString("mag"));
-        if (sel.size() > 0)
-        {
-            for(qint32 i = 0; i < sel.size(); ++i)
-                G.row(i) = G.row(sel[i]);
-            G.conservativeResize(sel.size(), G.cols());
-            printf("\t%li magnetometer or axial gradiometer channels", sel.size());
-        }
-        else
-        {
-            sel = info.pick_types(false, true);
-            if(sel.size() > 0)
-            {
-                for(qint32 i = 0; i < sel.size(); ++i)
-                    G.row(i) = G.row(sel[i]);
-                G.conservativeResize(sel.size(), G.cols());
-                printf("\t%li EEG channels\n", sel.size());
-            }
-            else
-                printf("Could not find MEG or EEG channels\n");
-        }
+        printf("\t%li magnetometer or axial gradiometer channels", sel.size());
+        return sel;
     }
+
+    sel = info.pick_types(false, true);
+    if(sel.size() > 0)
+        printf("\t%li EEG channels\n", sel.size());
+    else
+        printf("Could not find MEG or EEG channels\n");
+
+    return sel;
 }
 
 
@@ -69,6 +69,7 @@
 
 #include <Eigen/Core>
 #include <Eigen/SVD>
+#include <Eigen/Eigenvalues>
 #include <Eigen/Sparse>
 #include <unsupported/Eigen/KroneckerProduct>
 
@@ -192,6 +193,81 @@ struct RegionData
 };
 
 
+//=========================================================================================================
+/**
+* Source chunk of a gain matrix, used for the blocked computation of the depth prior and the whitened gain
+*/
+struct GainChunk
+{
+    MatrixXd*       pGain;          /**< Gain matrix sensors x sources(x,y,z); whiten() modifies it in place */
+    const MatrixXd* pWhitener;      /**< Whitener, square or PCA (fewer rows than channels) (whiten only) */
+    const VectorXd* pSourceStd;     /**< Source standard deviations, one per gain column (whiten only) */
+    const VectorXi* pRowSel;        /**< Channels used for the depth weighting; all if empty (computeDepth only) */
+    qint32          iNumOri;        /**< Number of orientations per source (1 or 3) */
+    qint32          iFirstSource;   /**< First source of the chunk */
+    qint32          iNumSources;    /**< Number of sources in the chunk */
+
+    VectorXd        vecD;           /**< Largest eigenvalue of the Gram block of each source (computeDepth only) */
+    double          dSquaredNorm;   /**< Squared Frobenius norm of the whitened and weighted chunk (whiten only) */
+
+    void computeDepth()
+    {
+        vecD.resize(iNumSources);
+        Matrix3d t_matGram;
+        SelfAdjointEigenSolver<Matrix3d> t_eigSolver;
+
+        for(qint32 s = 0; s < iNumSources; ++s)
+        {
+            qint32 c = (iFirstSource + s) * iNumOri;
+
+            if(iNumOri == 1)
+            {
+                if(pRowSel->size() > 0)
+                {
+                    double t_dSum = 0;
+                    for(qint32 r = 0; r < pRowSel->size(); ++r)
+                        t_dSum += pow((*pGain)((*pRowSel)[r], c), 2);
+                    vecD[s] = t_dSum;
+                }
+                else
+                    vecD[s] = pGain->col(c).squaredNorm();
+            }
+            else
+            {
+                if(pRowSel->size() > 0)
+                {
+                    t_matGram.setZero();
+                    for(qint32 r = 0; r < pRowSel->size(); ++r)
+                    {
+                        Vector3d g = pGain->block((*pRowSel)[r], c, 1, 3).transpose();
+                        t_matGram.noalias() += g * g.transpose();
+                    }
+                }
+                else
+                    t_matGram.noalias() = pGain->middleCols(c, 3).transpose() * pGain->middleCols(c, 3);
+
+                // The Gram block is symmetric positive semi-definite -> its eigenvalues are its singular values
+                t_eigSolver.computeDirect(t_matGram, EigenvaluesOnly);
+                vecD[s] = t_eigSolver.eigenvalues().maxCoeff();
+            }
+        }
+    }
+
+    void whiten()
+    {
+        qint32 c = iFirstSource * iNumOri;
+        qint32 n = iNumSources * iNumOri;
+
+        MatrixXd t_matChunk = (*pWhitener) * pGain->middleCols(c, n);
+        t_matChunk *= pSourceStd->segment(c, n).asDiagonal();
+
+        dSquaredNorm = t_matChunk.squaredNorm();
+        // A PCA whitener has fewer rows -> only the top rows of the chunk are used
+        pGain->block(0, c, t_matChunk.rows(), n) = t_matChunk;
+    }
+};
+
+
 const static FiffCov defaultCov;
 const static FiffInfo defaultInfo;
 static MatrixXd defaultD;
@@ -291,6 +367,22 @@ public:
     */
     static FiffCov compute_depth_prior(const MatrixXd &Gain, const FiffInfo &gain_info, bool is_fixed_ori, double exp = 0.8, double limit = 10.0, const MatrixXd &patch_areas = defaultConstMatrixXd, bool limit_depth_chs = false);
 
+    //=========================================================================================================
+    /**
+    * Whitens the gain matrix and applies the source weighting in place. The gain is processed in source
+    * chunks in parallel, so that no further full-size temporary is needed. Square whiteners and PCA whiteners
+    * (n_nzero x nchan) are supported; with a PCA whitener the gain shrinks to n_nzero rows.
+    *
+    * @param[in, out] gain      Gain matrix; replaced by whitener * gain * diag(source_std)
+    * @param[in] whitener       The whitener
+    * @param[in] source_std     Standard deviation of each source component (sqrt of the source covariance)
+    * @param[out] trace_GRGT    The trace of G*R*G' of the weighted whitened gain, i.e. its squared Frobenius norm
+    *
+    * @return true if the gain was whitened and its trace is positive, false if the dimensions do not match or
+    *         the whitened gain vanishes (gain is unchanged on a dimension mismatch)
+    */
+    static bool whiten_gain(MatrixXd &gain, const MatrixXd &whitener, const VectorXd &source_std, double &trace_GRGT);
+
     //=========================================================================================================
     /**
     * Indicates whether fwd conatins a clustered forward solution.
@@ -368,6 +460,33 @@ public:
     */
     void prepare_forward(const FiffInfo &p_info, const FiffCov &p_noise_cov, bool p_pca, FiffInfo &p_outFwdInfo, MatrixXd &gain, FiffCov &p_outNoiseCov, MatrixXd &p_outWhitener, qint32 &p_outNumNonZero) const;
 
+    //=========================================================================================================
+    /**
+    * Channels used by prepare_forward: channels of p_info which are neither bad in p_info nor in the noise
+    * covariance and which are part of the forward solution.
+    *
+    * @param[in] p_info             The measurement info.
+    * @param[in] p_noise_cov        The noise covariance matrix.
+    *
+    * @return the selected channel names
+    */
+    QStringList prepare_ch_names(const FiffInfo &p_info, const FiffCov &p_noise_cov) const;
+
+    //=========================================================================================================
+    /**
+    * Prepares the noise covariance for the selected channels and computes its whitener. This is the noise
+    * covariance dependent part of prepare_forward.
+    *
+    * @param[in] p_info             The measurement info.
+    * @param[in] p_noise_cov        The noise covariance matrix.
+    * @param[in] ch_names           Selected channel names (see prepare_ch_names)
+    * @param[in] p_pca              Calculate pca or not.
+    * @param[out] p_outNoiseCov     noise covariance matrix
+    * @param[out] p_outWhitener     Whitener
+    * @param[out] p_outNumNonZero   the rank (non zeros)
+    */
+    static void prepare_whitener(const FiffInfo &p_info, const FiffCov &p_noise_cov, const QStringList &ch_names, bool p_pca, FiffCov &p_outNoiseCov, MatrixXd &p_outWhitener, qint32 &p_outNumNonZero);
+
 //    //=========================================================================================================
 //    /**
 //    * Prepares a forward solution, Bad channels, after clustering etc ToDo...
@@ -443,6 +562,26 @@ public:
     */
     static bool read(QIODevice& p_IODevice, MNEForwardSolution& fwd, bool force_fixed = false, bool surf_ori = false, const QStringList& include = defaultQStringList, const QStringList& exclude = defaultQStringList, bool bExcludeBads = true);
 
+    //=========================================================================================================
+    /**
+    * Reads a forward solution restricted to the sources of the given regions. Channel and source selections
+    * are applied while decoding the gain matrix, i.e. only the requested part of the FIFF tag is read
+    * (memory mapped when reading from a file) and the full dense gain matrix is never held in memory. The
+    * selected part is stored in double precision like every other forward solution.
+    *
+    * @param[in] p_IODevice    A fiff IO device like a fiff QFile or QTCPSocket
+    * @param[out] fwd          A forward solution from a fif file
+    * @param[in] p_qListLabels ROIs to restrict the sources to; all sources are read if empty
+    * @param[in] force_fixed   Force fixed source orientation mode? (optional)
+    * @param[in] surf_ori      Use surface based source coordinate system? (optional)
+    * @param[in] include       Include these channels (optional)
+    * @param[in] exclude       Exclude these channels (optional)
+    * @param[in] bExcludeBads  If true bads are also read; default = false (optional)
+    *
+    * @return true if succeeded, false otherwise
+    */
+    static bool read(QIODevice& p_IODevice, MNEForwardSolution& fwd, const QList<Label>& p_qListLabels, bool force_fixed = false, bool surf_ori = false, const QStringList& include = defaultQStringList, const QStringList& exclude = defaultQStringList, bool bExcludeBads = true);
+
     //ToDo readFromStream
 
     //=========================================================================================================
@@ -465,6 +604,17 @@ public:
     */
     static void restrict_gain_matrix(MatrixXd &G, const FiffInfo &info);
 
+    //=========================================================================================================
+    /**
+    * Channel selection used for optimal depth weighting: planar gradiometers if available, otherwise
+    * magnetometers or axial gradiometers, otherwise EEG.
+    *
+    * @param[in] info       Fiff information
+    *
+    * @return the selected channel indices; empty if neither MEG nor EEG channels are present
+    */
+    static RowVectorXi restrict_gain_selection(const FiffInfo &info);
+
     //=========================================================================================================
     /**
     * Helper to convert the forward solution to fixed ori from free
@@ -490,15 +640,39 @@ private:
     /**
     * Implementation of the read_one function in mne_read_forward_solution.m
     *
-    * Reads all interesting stuff for one forward solution
+    * Reads all interesting stuff for one forward solution. Only the selected channels and sources of the
+    * solution are decoded.
     *
-    * @param[in] p_pStream  The opened fif file to read from
-    * @param[in] p_Node     The forward solution node
-    * @param[out] one       The read forward solution
+    * @param[in] p_pStream      The opened fif file to read from
+    * @param[in] p_Node         The forward solution node
+    * @param[out] one           The read forward solution
+    * @param[in] include        Include these channels (optional)
+    * @param[in] exclude        Exclude these channels (optional)
+    * @param[in] p_vecSourceSel Indices of the sources to read; all sources are read if empty (optional)
     *
     * @return True if succeeded, false otherwise
     */
-    static bool read_one(FiffStream* p_pStream, const FiffDirTree& p_Node, MNEForwardSolution& one);
+    static bool read_one(FiffStream* p_pStream, const FiffDirTree& p_Node, MNEForwardSolution& one, const QStringList& include = defaultQStringList, const QStringList& exclude = defaultQStringList, const VectorXi& p_vecSourceSel = defaultVectorXi);
+
+    //=========================================================================================================
+    /**
+    * Expands a source selection to the matching gain matrix columns, when each source occupies
+    * p_iNumCols consecutive columns.
+    *
+    * @param[in] p_vecSourceSel Indices of the selected sources
+    * @param[in] p_iNumCols     Number of columns per source
+    *
+    * @return the column selection
+    */
+    static RowVectorXi expand_source_selection(const VectorXi& p_vecSourceSel, qint32 p_iNumCols);
+
+    //=========================================================================================================
+    /**
+    * Restricts the source locations and orientations to the selected sources and updates nsource.
+    *
+    * @param[in] p_vecSourceSel Indices of the selected sources
+    */
+    void pick_source_geometry(const VectorXi& p_vecSourceSel);
 
 public:
     FiffInfoBase info;                  /**< light weighted measurement info */
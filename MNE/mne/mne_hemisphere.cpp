@@ -41,6 +41,16 @@
 
 #include "mne_hemisphere.h"
 
+#include <utils/mnemath.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <algorithm>
+
 
 //*************************************************************************************************************
 //=============================================================================================================
@@ -67,6 +77,7 @@ MNEHemisphere::MNEHemisphere()
 , nuse(-1)
 , inuse(VectorXi::Zero(0))
 , vertno(VectorXi::Zero(0))
+, vertno_inv(VectorXi::Zero(0))
 , nuse_tri(-1)
 , use_tris(MatrixX3i::Zero(0,3))
 , nearest(VectorXi::Zero(0))
@@ -74,6 +85,8 @@ MNEHemisphere::MNEHemisphere()
 , patch_inds(VectorXi::Zero(0))
 , dist_limit(-1)
 , dist(SparseMatrix<double>())
+, neighbor_vert_ptr(VectorXi::Zero(0))
+, neighbor_vert(VectorXi::Zero(0))
 , tri_cent(MatrixX3d::Zero(0,3))
 , tri_nn(MatrixX3d::Zero(0,3))
 , tri_area(VectorXd::Zero(0))
@@ -100,6 +113,7 @@ MNEHemisphere::MNEHemisphere(const MNEHemisphere& p_MNEHemisphere)
 , nuse(p_MNEHemisphere.nuse)
 , inuse(p_MNEHemisphere.inuse)
 , vertno(p_MNEHemisphere.vertno)
+, vertno_inv(p_MNEHemisphere.vertno_inv)
 , nuse_tri(p_MNEHemisphere.nuse_tri)
 , use_tris(p_MNEHemisphere.use_tris)
 , nearest(p_MNEHemisphere.nearest)
@@ -108,6 +122,8 @@ MNEHemisphere::MNEHemisphere(const MNEHemisphere& p_MNEHemisphere)
 , patch_inds(p_MNEHemisphere.patch_inds)
 , dist_limit(p_MNEHemisphere.dist_limit)
 , dist(p_MNEHemisphere.dist)
+, neighbor_vert_ptr(p_MNEHemisphere.neighbor_vert_ptr)
+, neighbor_vert(p_MNEHemisphere.neighbor_vert)
 , tri_cent(p_MNEHemisphere.tri_cent)
 , tri_nn(p_MNEHemisphere.tri_nn)
 , tri_area(p_MNEHemisphere.tri_area)
@@ -144,6 +160,7 @@ void MNEHemisphere::clear()
     nuse = -1;
     inuse = VectorXi::Zero(0);
     vertno = VectorXi::Zero(0);
+    vertno_inv = VectorXi::Zero(0);
     nuse_tri = -1;
     use_tris = MatrixX3i::Zero(0,3);
     nearest = VectorXi::Zero(0);
@@ -152,6 +169,8 @@ void MNEHemisphere::clear()
     patch_inds = VectorXi::Zero(0);
     dist_limit = -1;
     dist = SparseMatrix<double>();
+    neighbor_vert_ptr = VectorXi::Zero(0);
+    neighbor_vert = VectorXi::Zero(0);
     tri_cent = MatrixX3d::Zero(0,3);
     tri_nn = MatrixX3d::Zero(0,3);
     tri_area = VectorXd::Zero(0);
@@ -221,6 +240,103 @@ bool MNEHemisphere::transform_hemisphere_to(fiff_int_t dest, const FiffCoordTran
 }
 
 
+//*************************************************************************************************************
+
+bool MNEHemisphere::compute_neighbors()
+{
+    if(this->np <= 0 || this->tris.rows() == 0)
+    {
+        neighbor_vert_ptr = VectorXi::Zero(0);
+        neighbor_vert = VectorXi::Zero(0);
+        return false;
+    }
+
+    //
+    // Count the triangle incidences -> each incidence adds two (possibly duplicate) neighbors
+    //
+    VectorXi t_vecPtr = VectorXi::Zero(this->np + 1);
+    for(qint32 i = 0; i < this->tris.rows(); ++i)
+        for(qint32 j = 0; j < 3; ++j)
+            t_vecPtr[this->tris(i,j) + 1] += 2;
+    for(qint32 i = 0; i < this->np; ++i)
+        t_vecPtr[i + 1] += t_vecPtr[i];
+
+    VectorXi t_vecFill = t_vecPtr.head(this->np);
+    VectorXi t_vecNeighbors(t_vecPtr[this->np]);
+    for(qint32 i = 0; i < this->tris.rows(); ++i)
+    {
+        for(qint32 j = 0; j < 3; ++j)
+        {
+            qint32 v = this->tris(i,j);
+            t_vecNeighbors[t_vecFill[v]++] = this->tris(i,(j+1)%3);
+            t_vecNeighbors[t_vecFill[v]++] = this->tris(i,(j+2)%3);
+        }
+    }
+
+    //
+    // Sort and compact the rows -> every edge is shared by two triangles
+    //
+    neighbor_vert_ptr = VectorXi::Zero(this->np + 1);
+    qint32 t_iCount = 0;
+    for(qint32 i = 0; i < this->np; ++i)
+    {
+        int* t_pBegin = t_vecNeighbors.data() + t_vecPtr[i];
+        int* t_pEnd = t_vecNeighbors.data() + t_vecPtr[i + 1];
+        std::sort(t_pBegin, t_pEnd);
+        t_pEnd = std::unique(t_pBegin, t_pEnd);
+        for(int* t_pIt = t_pBegin; t_pIt != t_pEnd; ++t_pIt)
+            t_vecNeighbors[t_iCount++] = *t_pIt;
+        neighbor_vert_ptr[i + 1] = t_iCount;
+    }
+    t_vecNeighbors.conservativeResize(t_iCount);
+    neighbor_vert = t_vecNeighbors;
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+void MNEHemisphere::compute_vertno_inv()
+{
+    vertno_inv = VectorXi::Constant(this->np > 0 ? this->np : 0, -1);
+    for(qint32 i = 0; i < vertno.size(); ++i)
+        if(vertno[i] >= 0 && vertno[i] < vertno_inv.size())
+            vertno_inv[vertno[i]] = i;
+}
+
+
+//*************************************************************************************************************
+
+VectorXi MNEHemisphere::vertno_sel(const VectorXi &p_vecVertices, VectorXi &p_vecSel) const
+{
+    // Clustered hemispheres hold label ids in vertno
+    if(isClustered() || vertno_inv.size() == 0)
+        return MNEMath::intersect(vertno, p_vecVertices, p_vecSel);
+
+    std::vector<qint32> t_vecSel;
+    t_vecSel.reserve(p_vecVertices.size());
+    for(qint32 i = 0; i < p_vecVertices.size(); ++i)
+    {
+        qint32 v = p_vecVertices[i];
+        if(v >= 0 && v < vertno_inv.size() && vertno_inv[v] >= 0 && vertno[vertno_inv[v]] == v)
+            t_vecSel.push_back(vertno_inv[v]);
+    }
+    std::sort(t_vecSel.begin(), t_vecSel.end());
+    t_vecSel.erase(std::unique(t_vecSel.begin(), t_vecSel.end()), t_vecSel.end());
+
+    VectorXi p_vecVertno(t_vecSel.size());
+    p_vecSel.resize(t_vecSel.size());
+    for(quint32 i = 0; i < t_vecSel.size(); ++i)
+    {
+        p_vecSel[i] = t_vecSel[i];
+        p_vecVertno[i] = vertno[t_vecSel[i]];
+    }
+
+    return p_vecVertno;
+}
+
+
 //*************************************************************************************************************
 //ToDo
 void MNEHemisphere::writeToStream(FiffStream* p_pStream)
@@ -166,6 +166,47 @@ public:
     */
     bool transform_hemisphere_to(fiff_int_t dest, const FiffCoordTrans &p_Trans);
 
+    //=========================================================================================================
+    /**
+    * Builds the vertex adjacency of the triangulation (tris) in compressed sparse row (CSR) form:
+    * the neighbors of vertex i are neighbor_vert[neighbor_vert_ptr[i]] ... neighbor_vert[neighbor_vert_ptr[i+1]-1],
+    * sorted ascending. Linear in the number of triangles.
+    *
+    * @return true if succeeded, false otherwise
+    */
+    bool compute_neighbors();
+
+    //=========================================================================================================
+    /**
+    * Builds the reverse index vertno_inv of the used vertices: vertno_inv[vertno[i]] = i, -1 for not used
+    * vertices.
+    */
+    void compute_vertno_inv();
+
+    //=========================================================================================================
+    /**
+    * Returns the neighboring vertices of a vertex in the high resolution triangulation. Requires
+    * compute_neighbors.
+    *
+    * @param[in] p_iVert    Vertex number
+    *
+    * @return the ascending neighbor vertices
+    */
+    inline VectorXi::ConstSegmentReturnType neighbors(qint32 p_iVert) const;
+
+    //=========================================================================================================
+    /**
+    * Intersects vertices, e.g. of a label, with the used vertices (vertno) using the reverse index
+    * vertno_inv. Same result as MNEMath::intersect(vertno, p_vecVertices, p_vecSel), but
+    * O(n log n) in the number of given vertices instead of O(n*nuse).
+    *
+    * @param[in] p_vecVertices  Vertices to intersect with vertno
+    * @param[out] p_vecSel      Ascending indices of the selected vertices in vertno
+    *
+    * @return the selected vertices
+    */
+    VectorXi vertno_sel(const VectorXi &p_vecVertices, VectorXi &p_vecSel) const;
+
     //=========================================================================================================
     /**
     * mne_python _write_one_source_space
@@ -198,6 +239,7 @@ public:
     fiff_int_t nuse;            /**< Number of used dipoles. */
     VectorXi inuse;             /**< Used source points indicated by 1, 0 otherwise */
     VectorXi vertno;            /**< Zero based (different to MATLAB) indices of the used vertices/If label based clustered gain matrix vertno contains label IDs*/
+    VectorXi vertno_inv;        /**< Reverse index of vertno: position of a vertex in vertno, -1 if not used. */
     qint32 nuse_tri;            /**< Number of used triangles. */
     MatrixX3i use_tris;         /**< Triangle information of the used triangles. */
     VectorXi nearest;           /**< All indeces mapped to the indeces of the used vertices (using option -cps during mne_setup_source_space) */
@@ -206,6 +248,8 @@ public:
     VectorXi patch_inds;        /**< List of neighboring vertices in the high resolution triangulation. */
     float dist_limit;           /**< ToDo... (using option -cps during mne_setup_source_space) */
     SparseMatrix<double> dist;  /**< ToDo... (using option -cps during mne_setup_source_space) */
+    VectorXi neighbor_vert_ptr; /**< CSR row pointers (np+1) of the vertex adjacency, see compute_neighbors. */
+    VectorXi neighbor_vert;     /**< CSR column indices of the vertex adjacency, see compute_neighbors. */
     MatrixX3d tri_cent;         /**< Triangle centers */
     MatrixX3d tri_nn;           /**< Triangle normals */
     VectorXd tri_area;          /**< Triangle areas */
@@ -230,6 +274,14 @@ inline bool MNEHemisphere::isClustered() const
     return !cluster_info.isEmpty();
 }
 
+
+//*************************************************************************************************************
+
+inline VectorXi::ConstSegmentReturnType MNEHemisphere::neighbors(qint32 p_iVert) const
+{
+    return neighbor_vert.segment(neighbor_vert_ptr[p_iVert], neighbor_vert_ptr[p_iVert+1] - neighbor_vert_ptr[p_iVert]);
+}
+
 } // NAMESPACE
 
 #endif // MNE_HEMISPHERE_H
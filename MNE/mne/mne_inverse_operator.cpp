@@ -87,9 +87,9 @@ MNEInverseOperator::MNEInverseOperator(QIODevice& p_IODevice)
 
 //*************************************************************************************************************
 
-MNEInverseOperator::MNEInverseOperator(const FiffInfo &info, MNEForwardSolution forward, const FiffCov& p_noise_cov, float loose, float depth, bool fixed, bool limit_depth_chs)
+MNEInverseOperator::MNEInverseOperator(const FiffInfo &info, MNEForwardSolution forward, const FiffCov& p_noise_cov, float loose, float depth, bool fixed, bool limit_depth_chs, DecompositionType decomposition)
 {
-    *this = MNEInverseOperator::make_inverse_operator(info, forward, p_noise_cov, loose, depth, fixed, limit_depth_chs);
+    *this = MNEInverseOperator::make_inverse_operator(info, forward, p_noise_cov, loose, depth, fixed, limit_depth_chs, decomposition);
 }
 
 
@@ -663,8 +663,21 @@ MatrixXd MNEInverseOperator::cluster_kernel(const AnnotationSet &p_AnnotationSet
 
 //*************************************************************************************************************
 
-MNEInverseOperator MNEInverseOperator::make_inverse_operator(const FiffInfo &info, MNEForwardSolution forward, const FiffCov &p_noise_cov, float loose, float depth, bool fixed, bool limit_depth_chs)
+MNEInverseOperator MNEInverseOperator::make_inverse_operator(const FiffInfo &info, MNEForwardSolution forward, const FiffCov &p_noise_cov, float loose, float depth, bool fixed, bool limit_depth_chs, DecompositionType decomposition)
 {
+    MatrixXd t_matGain;
+    QStringList t_qListChNames;
+    return make_inverse_operator(info, forward, p_noise_cov, t_matGain, t_qListChNames, loose, depth, fixed, limit_depth_chs, decomposition);
+}
+
+
+//*************************************************************************************************************
+
+MNEInverseOperator MNEInverseOperator::make_inverse_operator(const FiffInfo &info, MNEForwardSolution forward, const FiffCov &p_noise_cov, MatrixXd& p_matGain, QStringList& p_qListChNames, float loose, float depth, bool fixed, bool limit_depth_chs, DecompositionType decomposition)
+{
+    p_matGain.resize(0,0);
+    p_qListChNames.clear();
+
     bool is_fixed_ori = forward.isFixedOrient();
     MNEInverseOperator p_MNEInverseOperator;
 
@@ -729,7 +742,8 @@ MNEInverseOperator MNEInverseOperator::make_inverse_operator(const FiffInfo &inf
     }
     else
     {
-        p_depth_prior->data = MatrixXd::Ones(gain.cols(), gain.cols());
+        p_depth_prior = FiffCov::SDPtr(new FiffCov());
+        p_depth_prior->data = MatrixXd::Ones(gain.cols(), 1);
         p_depth_prior->kind = FIFFV_MNE_DEPTH_PRIOR_COV;
         p_depth_prior->diag = true;
         p_depth_prior->dim = gain.cols();
@@ -783,24 +797,30 @@ MNEInverseOperator MNEInverseOperator::make_inverse_operator(const FiffInfo &inf
     // 8. Apply the linear projection to the forward solution
     // 9. Apply whitening to the forward computation matrix
     //
-    printf("\tWhitening the forward solution.\n");
-    gain = whitener*gain;
-
     // 10. Exclude the source space points within the labels (not done)
 
     //
     // 11. Do appropriate source weighting to the forward computation matrix
     //
+    // Whitening and source weighting are done in one blocked pass over the gain matrix
+    //
+    printf("\tWhitening the forward solution.\n");
+    p_matGain = gain;
+    p_qListChNames = gain_info.ch_names;
+
+    VectorXd source_std = p_source_cov->data.col(0).array().sqrt();
+    double trace_GRGT;
+    if(!MNEForwardSolution::whiten_gain(gain, whitener, source_std, trace_GRGT))
+    {
+        qCritical("Error: Whitening the forward solution failed, no inverse operator is computed.\n");
+        p_matGain.resize(0,0);
+        p_qListChNames.clear();
+        return p_MNEInverseOperator;
+    }
 
     // Adjusting Source Covariance matrix to make trace of G*R*G' equal
     // to number of sensors.
     printf("\tAdjusting source covariance matrix.\n");
-    RowVectorXd source_std = p_source_cov->data.array().sqrt().transpose();
-
-    for(qint32 i = 0; i < gain.rows(); ++i)
-        gain.row(i) = gain.row(i).array() * source_std.array();
-
-    double trace_GRGT = (gain * gain.transpose()).trace();//pow(gain.norm(), 2);
     double scaling_source_cov = (double)n_nzero / trace_GRGT;
 
     p_source_cov->data.array() *= scaling_source_cov;
@@ -813,23 +833,43 @@ MNEInverseOperator MNEInverseOperator::make_inverse_operator(const FiffInfo &inf
     //
     // 12. Decompose the combined matrix
     //
-    printf("Computing SVD of whitened and weighted lead field matrix.\n");
-    JacobiSVD<MatrixXd> svd(gain, ComputeThinU | ComputeThinV);
-    std::cout << "ToDo Sorting Necessary?" << std::endl;
-    VectorXd p_sing = svd.singularValues();
-    MatrixXd t_U = svd.matrixU();
-    MNEMath::sort<double>(p_sing, t_U);
-    FiffNamedMatrix::SDPtr p_eigen_fields = FiffNamedMatrix::SDPtr(new FiffNamedMatrix( svd.matrixU().cols(),
-                                                                                        svd.matrixU().rows(),
+    VectorXd p_sing;
+    MatrixXd t_U;
+    MatrixXd t_V;
+    switch(decomposition)
+    {
+    case GRAM_EIG:
+    {
+        printf("Computing SVD of whitened and weighted lead field matrix via the eigendecomposition of G*G'.\n");
+        MNEMath::svd_gram(gain, p_sing, t_U, t_V);
+        break;
+    }
+    case RANDOMIZED_SVD:
+    {
+        printf("Computing randomized SVD (rank %d) of whitened and weighted lead field matrix.\n", n_nzero);
+        MNEMath::svd_randomized(gain, n_nzero, p_sing, t_U, t_V);
+        break;
+    }
+    default:
+    {
+        printf("Computing SVD of whitened and weighted lead field matrix.\n");
+        JacobiSVD<MatrixXd> svd(gain, ComputeThinU | ComputeThinV);
+        // JacobiSVD returns the singular values in decreasing order already
+        p_sing = svd.singularValues();
+        t_U = svd.matrixU();
+        t_V = svd.matrixV();
+        break;
+    }
+    }
+
+    FiffNamedMatrix::SDPtr p_eigen_fields = FiffNamedMatrix::SDPtr(new FiffNamedMatrix( t_U.cols(),
+                                                                                        t_U.rows(),
                                                                                         defaultQStringList,
                                                                                         gain_info.ch_names,
                                                                                         t_U.transpose() ));
 
-    p_sing = svd.singularValues();
-    MatrixXd t_V = svd.matrixV();
-    MNEMath::sort<double>(p_sing, t_V);
-    FiffNamedMatrix::SDPtr p_eigen_leads = FiffNamedMatrix::SDPtr(new FiffNamedMatrix( svd.matrixV().rows(),
-                                                                                       svd.matrixV().cols(),
+    FiffNamedMatrix::SDPtr p_eigen_leads = FiffNamedMatrix::SDPtr(new FiffNamedMatrix( t_V.rows(),
+                                                                                       t_V.cols(),
                                                                                        defaultQStringList,
                                                                                        defaultQStringList,
                                                                                        t_V ));
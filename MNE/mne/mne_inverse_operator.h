@@ -169,6 +169,15 @@ public:
     typedef QSharedPointer<MNEInverseOperator> SPtr;            /**< Shared pointer type for MNEInverseOperator. */
     typedef QSharedPointer<const MNEInverseOperator> ConstSPtr; /**< Const shared pointer type for MNEInverseOperator. */
 
+    //=========================================================================================================
+    /**
+    * Decomposition used for the whitened and weighted gain matrix in make_inverse_operator.
+    * FULL_SVD:        JacobiSVD of the full gain matrix (reference)
+    * GRAM_EIG:        Eigendecomposition of the nchan x nchan matrix G*G'
+    * RANDOMIZED_SVD:  Randomized SVD truncated to the rank of the whitener
+    */
+    enum DecompositionType { FULL_SVD, GRAM_EIG, RANDOMIZED_SVD };
+
     //=========================================================================================================
     /**
     * Default constructor
@@ -194,8 +203,9 @@ public:
     * @param[in] depth              float in [0, 1]. Depth weighting coefficients. If None, no depth weighting is performed.
     * @param[in] fixed              Use fixed source orientations normal to the cortical mantle. If True, the loose parameter is ignored.
     * @param[in] limit_depth_chs    If True, use only grad channels in depth weighting (equivalent to MNE C code). If grad chanels aren't present, only mag channels will be used (if no mag, then eeg). If False, use all channels.
+    * @param[in] decomposition      Decomposition of the whitened gain matrix (see DecompositionType).
     */
-    MNEInverseOperator(const FiffInfo &info, MNEForwardSolution forward, const FiffCov& p_noise_cov, float loose = 0.2f, float depth = 0.8f, bool fixed = false, bool limit_depth_chs = true);
+    MNEInverseOperator(const FiffInfo &info, MNEForwardSolution forward, const FiffCov& p_noise_cov, float loose = 0.2f, float depth = 0.8f, bool fixed = false, bool limit_depth_chs = true, DecompositionType decomposition = FULL_SVD);
 
     //=========================================================================================================
     /**
@@ -288,10 +298,32 @@ public:
     * @param[in] depth              float in [0, 1]. Depth weighting coefficients. If None, no depth weighting is performed.
     * @param[in] fixed              Use fixed source orientations normal to the cortical mantle. If True, the loose parameter is ignored.
     * @param[in] limit_depth_chs    If True, use only grad channels in depth weighting (equivalent to MNE C code). If grad chanels aren't present, only mag channels will be used (if no mag, then eeg). If False, use all channels.
+    * @param[in] decomposition      Decomposition of the whitened gain matrix. GRAM_EIG and RANDOMIZED_SVD only compute the at most nchan non-trivial singular triplets and are much faster than FULL_SVD.
+    *
+    * @return the assembled inverse operator
+    */
+    static MNEInverseOperator make_inverse_operator(const FiffInfo &info, MNEForwardSolution forward, const FiffCov& p_noise_cov, float loose = 0.2f, float depth = 0.8f, bool fixed = false, bool limit_depth_chs = true, DecompositionType decomposition = FULL_SVD);
+
+    //=========================================================================================================
+    /**
+    * Assembles the inverse operator and returns the picked gain matrix, before whitening and source weighting,
+    * together with its channel names. Callers which update the operator for new noise covariances reuse them
+    * instead of preparing the forward solution a second time.
+    *
+    * @param[in] info               The measurement info to specify the channels to include. Bad channels in info['bads'] are not used.
+    * @param[in] forward            Forward operator.
+    * @param[in] p_noise_cov        The noise covariance matrix.
+    * @param[out] p_matGain         The picked gain matrix; empty if the operator could not be assembled.
+    * @param[out] p_qListChNames    The channel names of the rows of p_matGain.
+    * @param[in] loose              float in [0, 1]. Value that weights the source variances of the dipole components defining the tangent space of the cortical surfaces.
+    * @param[in] depth              float in [0, 1]. Depth weighting coefficients. If None, no depth weighting is performed.
+    * @param[in] fixed              Use fixed source orientations normal to the cortical mantle. If True, the loose parameter is ignored.
+    * @param[in] limit_depth_chs    If True, use only grad channels in depth weighting (equivalent to MNE C code). If grad chanels aren't present, only mag channels will be used (if no mag, then eeg). If False, use all channels.
+    * @param[in] decomposition      Decomposition of the whitened gain matrix (see DecompositionType).
     *
     * @return the assembled inverse operator
     */
-    static MNEInverseOperator make_inverse_operator(const FiffInfo &info, MNEForwardSolution forward, const FiffCov& p_noise_cov, float loose = 0.2f, float depth = 0.8f, bool fixed = false, bool limit_depth_chs = true);
+    static MNEInverseOperator make_inverse_operator(const FiffInfo &info, MNEForwardSolution forward, const FiffCov& p_noise_cov, MatrixXd& p_matGain, QStringList& p_qListChNames, float loose = 0.2f, float depth = 0.8f, bool fixed = false, bool limit_depth_chs = true, DecompositionType decomposition = FULL_SVD);
 
     //=========================================================================================================
     /**
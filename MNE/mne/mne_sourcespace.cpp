@@ -108,18 +108,18 @@ QList<VectorXi> MNESourceSpace::label_src_vertno_sel(const Label &p_label, Vecto
 //        return Exception('Label are only supported with surface source spaces')
 
     QList<VectorXi> vertno;
-    vertno << this->m_qListHemispheres[0].vertno << this->m_qListHemispheres[1].vertno;
+    vertno << VectorXi() << VectorXi();
 
     if (p_label.hemi == 0) //lh
     {
-        VectorXi vertno_sel = MNEMath::intersect(vertno[0], p_label.vertices, src_sel);
+        VectorXi vertno_sel = this->m_qListHemispheres[0].vertno_sel(p_label.vertices, src_sel);
         vertno[0] = vertno_sel;
         vertno[1] = VectorXi();
     }
     else if (p_label.hemi == 1) //rh
     {
-        VectorXi vertno_sel = MNEMath::intersect(vertno[1], p_label.vertices, src_sel);
-        src_sel.array() += p_label.vertices.size();
+        VectorXi vertno_sel = this->m_qListHemispheres[1].vertno_sel(p_label.vertices, src_sel);
+        src_sel.array() += this->m_qListHemispheres[0].vertno.size();
         vertno[0] = VectorXi();
         vertno[1] = vertno_sel;
     }
@@ -179,7 +179,7 @@ MNESourceSpace MNESourceSpace::pick_regions(const QList<Label> &p_qListLabels) c
             {
                 VectorXi currentSelection;
 
-                MNEMath::intersect(m_qListHemispheres[h].vertno, p_qListLabels[i].vertices, currentSelection);
+                m_qListHemispheres[h].vertno_sel(p_qListLabels[i].vertices, currentSelection);
 
                 selVertices.conservativeResize(iSize+currentSelection.size());
                 selVertices.block(iSize,0,currentSelection.size(),1) = currentSelection;
@@ -201,20 +201,18 @@ MNESourceSpace MNESourceSpace::pick_regions(const QList<Label> &p_qListLabels) c
 
         selectedSrc.m_qListHemispheres[h].nuse = selVertices.size();
         selectedSrc.m_qListHemispheres[h].vertno = newVertno;
+        selectedSrc.m_qListHemispheres[h].compute_vertno_inv();
 
         //
-        // Tris
+        // Tris -> select the triangles which touch a selected vertex
         //
-        VectorXi idx_select = VectorXi::Zero(this->m_qListHemispheres[h].use_tris.rows());
-        for(qint32 i = 0; i < 3; ++i)
-        {
-            VectorXi tri_dim = this->m_qListHemispheres[h].use_tris.col(i);
-            VectorXi idx_dim;
-            MNEMath::intersect(tri_dim, newVertno, idx_dim);
-
-            for(qint32 j = 0; j < idx_dim.size(); ++j)
-                idx_select[idx_dim[j]] = 1;
-        }
+        const VectorXi &vertno_inv_new = selectedSrc.m_qListHemispheres[h].vertno_inv;
+        const MatrixX3i &use_tris = this->m_qListHemispheres[h].use_tris;
+        VectorXi idx_select = VectorXi::Zero(use_tris.rows());
+        for(qint32 i = 0; i < use_tris.rows(); ++i)
+            for(qint32 j = 0; j < 3; ++j)
+                if(use_tris(i,j) >= 0 && use_tris(i,j) < vertno_inv_new.size() && vertno_inv_new[use_tris(i,j)] >= 0)
+                    idx_select[i] = 1;
 
         qint32 countSel = 0;
         for(qint32 i = 0; i < idx_select.size(); ++i)
@@ -515,6 +513,7 @@ bool MNESourceSpace::read_source_space(FiffStream* p_pStream, const FiffDirTree&
             }
         }
     }
+    p_Hemisphere.compute_vertno_inv();
 //        qDebug() << "Vertices; type:" << t_pTag->getType() << "nuse:" << p_Hemisphere.nuse;
 
     //
@@ -586,70 +585,59 @@ bool MNESourceSpace::read_source_space(FiffStream* p_pStream, const FiffDirTree&
 
 bool MNESourceSpace::patch_info(MNEHemisphere &p_Hemisphere)//VectorXi& nearest, QList<VectorXi>& pinfo)
 {
+    p_Hemisphere.pinfo.clear();
+
     if (p_Hemisphere.nearest.rows() == 0)
     {
-       p_Hemisphere.pinfo.clear();
        p_Hemisphere.patch_inds = VectorXi();
        return false;
     }
 
     printf("\tComputing patch statistics...");
 
-    std::vector< std::pair<int,int> > t_vIndn;
-
-    for(qint32 i = 0; i < p_Hemisphere.nearest.rows(); ++i)
+    //
+    // Counting sort of the source points by their nearest used vertex -> patches in CSR form
+    //
+    qint32 t_iNumVert = p_Hemisphere.nearest.maxCoeff() + 1;
+    if(p_Hemisphere.nearest.minCoeff() < 0)
     {
-        std::pair<int,int> t_pair(i, p_Hemisphere.nearest(i));
-        t_vIndn.push_back(t_pair);
+        printf("Error: negative entries in the nearest vector.\n"); //ToDo throw
+        p_Hemisphere.patch_inds = VectorXi();
+        return false;
     }
-    std::sort(t_vIndn.begin(),t_vIndn.end(), MNEMath::compareIdxValuePairSmallerThan<int> );
 
-    VectorXi nearest_sorted(t_vIndn.size());
+    VectorXi t_vecPtr = VectorXi::Zero(t_iNumVert + 1);
+    for(qint32 i = 0; i < p_Hemisphere.nearest.rows(); ++i)
+        ++t_vecPtr[p_Hemisphere.nearest[i] + 1];
+    for(qint32 i = 0; i < t_iNumVert; ++i)
+        t_vecPtr[i + 1] += t_vecPtr[i];
 
-    qint32 current = 0;
-    std::vector<qint32> t_vfirsti;
-    t_vfirsti.push_back(current);
-    std::vector<qint32> t_vlasti;
+    // Members are filled in ascending order of the source points
+    VectorXi t_vecFill = t_vecPtr.head(t_iNumVert);
+    VectorXi t_vecMembers(p_Hemisphere.nearest.rows());
+    for(qint32 i = 0; i < p_Hemisphere.nearest.rows(); ++i)
+        t_vecMembers[t_vecFill[p_Hemisphere.nearest[i]]++] = i;
 
-    for(quint32 i = 0; i < t_vIndn.size(); ++i)
+    // pinfo holds the patches in ascending order of their vertices
+    VectorXi t_vecPatchOfVert = VectorXi::Constant(t_iNumVert, -1);
+    for(qint32 v = 0; v < t_iNumVert; ++v)
     {
-        nearest_sorted[i] = t_vIndn[i].second;
-        if (t_vIndn[current].second != t_vIndn[i].second)
+        if(t_vecPtr[v + 1] > t_vecPtr[v])
         {
-            current = i;
-            t_vlasti.push_back(i-1);
-            t_vfirsti.push_back(current);
+            t_vecPatchOfVert[v] = p_Hemisphere.pinfo.size();
+            p_Hemisphere.pinfo.append(t_vecMembers.segment(t_vecPtr[v], t_vecPtr[v + 1] - t_vecPtr[v]));
         }
     }
-    t_vlasti.push_back(t_vIndn.size()-1);
-
-    for(quint32 k = 0; k < t_vfirsti.size(); ++k)
-    {
-        std::vector<int> t_vIndex;
-
-        for(int l = t_vfirsti[k]; l <= t_vlasti[k]; ++l)
-            t_vIndex.push_back(t_vIndn[l].first);
-
-        std::sort(t_vIndex.begin(),t_vIndex.end());
-
-        int* t_pV = &t_vIndex[0];
-        Eigen::Map<Eigen::VectorXi> t_vPInfo(t_pV, t_vIndex.size());
-
-        p_Hemisphere.pinfo.append(t_vPInfo);
-    }
 
     // compute patch indices of the in-use source space vertices
-    std::vector<qint32> patch_verts;
-    patch_verts.reserve(t_vlasti.size());
-    for(quint32 i = 0; i < t_vlasti.size(); ++i)
-        patch_verts.push_back(nearest_sorted[t_vlasti[i]]);
-
     p_Hemisphere.patch_inds.resize(p_Hemisphere.vertno.size());
-    std::vector<qint32>::iterator it;
     for(qint32 i = 0; i < p_Hemisphere.vertno.size(); ++i)
     {
-        it = std::find(patch_verts.begin(), patch_verts.end(), p_Hemisphere.vertno[i]);
-        p_Hemisphere.patch_inds[i] = it-patch_verts.begin();
+        qint32 v = p_Hemisphere.vertno[i];
+        if(v >= 0 && v < t_iNumVert && t_vecPatchOfVert[v] >= 0)
+            p_Hemisphere.patch_inds[i] = t_vecPatchOfVert[v];
+        else
+            p_Hemisphere.patch_inds[i] = p_Hemisphere.pinfo.size();
     }
 
     return true;
@@ -763,6 +751,13 @@ bool MNESourceSpace::complete_source_space_info(MNEHemisphere& p_Hemisphere)
 //        qDebug() << "p_Hemisphere.use_tri_nn:" << p_Hemisphere.use_tri_nn(0,0) << p_Hemisphere.use_tri_nn(0,1) << p_Hemisphere.use_tri_nn(0,2);
 //        qDebug() << "p_Hemisphere.use_tri_nn:" << p_Hemisphere.use_tri_nn(2,0) << p_Hemisphere.use_tri_nn(2,1) << p_Hemisphere.use_tri_nn(2,2);
 
+    //
+    //   Vertex adjacency
+    //
+    printf("\tCompleting vertex neighbors...");
+    p_Hemisphere.compute_neighbors();
+    printf("[done]\n");
+
     return true;
 }
 
@@ -43,12 +43,30 @@
 #include "rtdataclient.h"
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QStringList>
+#include <QtEndian>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <string.h>
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // USED NAMESPACES
 //=============================================================================================================
 
 using namespace RTCLIENTLIB;
+using namespace UTILSLIB;
 
 
 //*************************************************************************************************************
@@ -59,6 +77,15 @@ using namespace RTCLIENTLIB;
 RtDataClient::RtDataClient(QObject *parent)
 : QTcpSocket(parent)
 , m_clientID(-1)
+, m_bStreamProfiled(false)
+, m_iStreamChannels(0)
+, m_iPendingOffset(0)
+, m_bStampPending(false)
+, m_iStampSequence(0)
+, m_iStampTime(0)
+, m_iExpectedSequence(-1)
+, m_iNumLostBuffers(0)
+, m_iLastArrivalTime(0)
 {
     getClientId();
 }
@@ -339,15 +366,312 @@ void RtDataClient::readRawBuffer(qint32 p_nChannels, MatrixXf& data, fiff_int_t&
 
     FiffTag::read_rt_tag(&t_fiffStream, t_pTag);
 
-    kind = t_pTag->kind;
+    //data buffers can be preceded by their block stamp and int16 data buffers by their scales
+    while(!decodeRawBufferTag(t_pTag, p_nChannels, data, kind) && (kind == FIFF_MNE_RT_DATA_SCALES || kind == FIFF_MNE_RT_BLOCK_STAMP))
+        FiffTag::read_rt_tag(&t_fiffStream, t_pTag);
+//        else
+//            data = tag.data;
+}
+
+
+//*************************************************************************************************************
+
+qint32 RtDataClient::readRawBuffers(qint32 p_nChannels, float* p_pData, qint32 p_iMaxSamples, qint32& p_iNumBuffers, fiff_int_t& kind)
+{
+    p_iNumBuffers = 0;
+    kind = FIFF_DATA_BUFFER;
+
+    //
+    // Rest of a buffer which did not fit last time
+    //
+    qint32 t_iNumSamples = takePending(p_pData, p_iMaxSamples, p_iNumBuffers);
+
+    while(t_iNumSamples < p_iMaxSamples)
+    {
+        bool t_bFirst = t_iNumSamples == 0;
+
+        //
+        // Tag header: kind, type, size, next - only the first buffer is waited for. A block stamp is skipped
+        // here and consumed together with its buffer.
+        //
+        qint32 t_aHeader[4];
+        if(!peekTagHeader(0, t_aHeader, t_bFirst))
+            break;
+
+        qint64 t_iStampSize = 0;
+        bool t_bHeader = true;
+        if(t_aHeader[0] == FIFF_MNE_RT_BLOCK_STAMP)
+        {
+            t_iStampSize = sizeof(t_aHeader) + t_aHeader[2];
+            t_bHeader = peekTagHeader(t_iStampSize, t_aHeader, t_bFirst);
+        }
+
+        qint32 t_iKind = t_aHeader[0];
+        qint32 t_iType = t_aHeader[1];
+        qint32 t_iSize = t_aHeader[2];
+
+        bool t_bPlainFloat = t_bHeader && t_iKind == FIFF_DATA_BUFFER && t_iType == FIFFT_FLOAT && p_nChannels > 0;
+
+        if(!t_bPlainFloat)
+        {
+            //
+            // Encoded buffers (see setStreamProfile) and other tags are decoded by readRawBuffer
+            //
+            if(!t_bFirst)
+                break;
+
+            readRawBuffer(p_nChannels, m_matPending, kind);
+            if(kind != FIFF_DATA_BUFFER)
+                return 0;
 
-    if(kind == FIFF_DATA_BUFFER)
+            if(m_matPending.rows() != p_nChannels)
+            {
+                printf("RtDataClient: received %d channels, storage has %d rows.\n", (int)m_matPending.rows(), p_nChannels);//ToDo throw
+                m_matPending.resize(0,0);
+                return 0;
+            }
+
+            m_iPendingOffset = 0;
+            t_iNumSamples += takePending(p_pData, p_iMaxSamples, p_iNumBuffers);
+            break;
+        }
+
+        //
+        // Plain float buffer: read it directly into the storage
+        //
+        qint64 t_iTagSize = t_iStampSize + sizeof(t_aHeader) + t_iSize;
+        if(t_bFirst ? !waitForBytes(t_iTagSize) : this->bytesAvailable() < t_iTagSize)
+            break;
+
+        qint32 t_iBufferSamples = (t_iSize/4)/p_nChannels;
+
+        float* t_pDest;
+        if(t_iBufferSamples <= p_iMaxSamples - t_iNumSamples)
+            t_pDest = p_pData + (qint64)t_iNumSamples*p_nChannels;
+        else if(t_bFirst)
+        {
+            m_matPending.resize(p_nChannels, t_iBufferSamples);
+            m_iPendingOffset = 0;
+            t_pDest = m_matPending.data();
+        }
+        else
+            break;
+
+        if(t_iStampSize > 0)
+            readBlockStamp(t_iStampSize);
+
+        this->read((char*)t_aHeader, sizeof(t_aHeader));
+        this->read((char*)t_pDest, (qint64)t_iBufferSamples*p_nChannels*sizeof(float));
+        if(t_iSize > t_iBufferSamples*p_nChannels*(qint32)sizeof(float))
+            this->read(t_iSize - t_iBufferSamples*p_nChannels*sizeof(float));
+
+        quint32* t_pWords = (quint32*)t_pDest;
+        for(qint64 i = 0; i < (qint64)t_iBufferSamples*p_nChannels; ++i)
+            t_pWords[i] = qFromBigEndian<quint32>(t_pWords[i]);
+
+        applyBlockStamp();
+
+        if(t_pDest == m_matPending.data())
+        {
+            t_iNumSamples += takePending(p_pData, p_iMaxSamples, p_iNumBuffers);
+            break;
+        }
+
+        t_iNumSamples += t_iBufferSamples;
+        ++p_iNumBuffers;
+    }
+
+    return t_iNumSamples;
+}
+
+
+//*************************************************************************************************************
+
+qint32 RtDataClient::takePending(float* p_pData, qint32 p_iMaxSamples, qint32& p_iNumBuffers)
+{
+    qint32 t_iNumSamples = qMin((qint32)m_matPending.cols() - m_iPendingOffset, p_iMaxSamples);
+    if(t_iNumSamples <= 0)
+        return 0;
+
+    memcpy(p_pData, m_matPending.data() + (qint64)m_iPendingOffset*m_matPending.rows(), (qint64)t_iNumSamples*m_matPending.rows()*sizeof(float));
+    m_iPendingOffset += t_iNumSamples;
+
+    if(m_iPendingOffset == m_matPending.cols())
     {
-        qint32 nSamples = (t_pTag->size()/4)/p_nChannels;
-        data = MatrixXf(Map< MatrixXf >(t_pTag->toFloat(), p_nChannels, nSamples));
+        m_matPending.resize(m_matPending.rows(), 0);
+        m_iPendingOffset = 0;
+        ++p_iNumBuffers;
     }
-//        else
-//            data = tag.data;
+
+    return t_iNumSamples;
+}
+
+
+//*************************************************************************************************************
+
+bool RtDataClient::waitForBytes(qint64 p_iNumBytes)
+{
+    while(this->bytesAvailable() < p_iNumBytes)
+    {
+        if(this->state() != QAbstractSocket::ConnectedState)
+            return false;
+        this->waitForReadyRead(10);
+    }
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+bool RtDataClient::peekTagHeader(qint64 p_iOffset, qint32* p_pHeader, bool p_bWait)
+{
+    char t_aPeek[64];
+    qint64 t_iNumBytes = p_iOffset + 4*sizeof(qint32);
+    if(p_iOffset < 0 || t_iNumBytes > (qint64)sizeof(t_aPeek))
+        return false;
+
+    if(p_bWait ? !waitForBytes(t_iNumBytes) : this->bytesAvailable() < t_iNumBytes)
+        return false;
+    if(this->peek(t_aPeek, t_iNumBytes) != t_iNumBytes)
+        return false;
+
+    memcpy(p_pHeader, t_aPeek + p_iOffset, 4*sizeof(qint32));
+    for(qint32 i = 0; i < 4; ++i)
+        p_pHeader[i] = qFromBigEndian<qint32>(p_pHeader[i]);
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+void RtDataClient::readBlockStamp(qint64 p_iStampSize)
+{
+    QByteArray t_blockStamp = this->read(p_iStampSize);
+    if(t_blockStamp.size() < 4*(qint32)sizeof(qint32) + 3*(qint32)sizeof(qint32))
+        return;
+
+    const qint32* t_pStamp = (const qint32*)(t_blockStamp.constData() + 4*sizeof(qint32));
+    setBlockStamp(qFromBigEndian<qint32>(t_pStamp[0]), qFromBigEndian<qint32>(t_pStamp[1]), qFromBigEndian<qint32>(t_pStamp[2]));
+}
+
+
+//*************************************************************************************************************
+
+void RtDataClient::setBlockStamp(qint32 p_iSequence, qint32 p_iSec, qint32 p_iUsec)
+{
+    m_bStampPending = true;
+    m_iStampSequence = p_iSequence;
+    m_iStampTime = (qint64)p_iSec*1000000 + p_iUsec;
+}
+
+
+//*************************************************************************************************************
+
+void RtDataClient::applyBlockStamp()
+{
+    if(!m_bStampPending)
+        return;
+    m_bStampPending = false;
+
+    m_histLatency.add(LatencyHistogram::now() - m_iStampTime);
+
+    if(m_iExpectedSequence >= 0 && m_iStampSequence > m_iExpectedSequence)
+        m_iNumLostBuffers += m_iStampSequence - m_iExpectedSequence;
+    m_iExpectedSequence = m_iStampSequence + 1;
+
+    m_iLastArrivalTime = m_iStampTime;
+}
+
+
+//*************************************************************************************************************
+
+bool RtDataClient::decodeRawBufferTag(FiffTag::SPtr& p_pTag, qint32 p_nChannels, MatrixXf& data, fiff_int_t& kind)
+{
+    kind = p_pTag->kind;
+
+    if(kind == FIFF_MNE_RT_COMPRESSED)
+    {
+        //
+        // Decode the inner tags
+        //
+        QByteArray t_blockTags = qUncompress(*p_pTag);
+        FiffStream t_fiffStreamInner(&t_blockTags, QIODevice::ReadOnly);
+
+        bool t_bData = false;
+        FiffTag::SPtr t_pInnerTag;
+        while(!t_fiffStreamInner.atEnd() && FiffTag::read_tag(&t_fiffStreamInner, t_pInnerTag))
+            t_bData |= decodeRawBufferTag(t_pInnerTag, p_nChannels, data, kind);
+        return t_bData;
+    }
+    else if(kind == FIFF_MNE_RT_BLOCK_STAMP)
+    {
+        if(p_pTag->size() >= 3*(qint32)sizeof(qint32))
+            setBlockStamp(p_pTag->toInt()[0], p_pTag->toInt()[1], p_pTag->toInt()[2]);
+        return false;
+    }
+    else if(kind == FIFF_MNE_RT_DATA_SCALES)
+    {
+        m_vecScales = Map<VectorXf>(p_pTag->toFloat(), p_pTag->size()/4);
+        return false;
+    }
+    else if(kind == FIFF_DATA_BUFFER)
+    {
+        //profiled buffers are preceded by their scales, full width buffers are not
+        bool t_bProfiled = m_vecScales.size() > 0;
+        qint32 t_nChannels = t_bProfiled ? m_vecScales.size() : p_nChannels;
+
+        if(p_pTag->getType() == FIFFT_SHORT)
+        {
+            if(!t_bProfiled)
+            {
+                printf("RtDataClient: int16 data buffer without scales.\n");//ToDo throw
+                data.resize(0,0);
+                return true;
+            }
+            qint32 nSamples = (p_pTag->size()/2)/t_nChannels;
+            data = Map< Matrix<qint16, Dynamic, Dynamic> >(p_pTag->toShort(), t_nChannels, nSamples).cast<float>();
+            data = m_vecScales.asDiagonal() * data;
+        }
+        else
+        {
+            qint32 nSamples = (p_pTag->size()/4)/t_nChannels;
+            data = MatrixXf(Map< MatrixXf >(p_pTag->toFloat(), t_nChannels, nSamples));
+        }
+        m_vecScales.resize(0);
+
+        //the sequence numbers are counted per profile -> start over when the server switched the profile
+        if(t_bProfiled != m_bStreamProfiled || t_nChannels != m_iStreamChannels)
+        {
+            m_bStreamProfiled = t_bProfiled;
+            m_iStreamChannels = t_nChannels;
+            m_iExpectedSequence = -1;
+        }
+
+        applyBlockStamp();
+        return true;
+    }
+
+    return false;
+}
+
+
+//*************************************************************************************************************
+
+void RtDataClient::setStreamProfile(const VectorXi& p_vecSel, qint32 p_iDecimation, bool p_bInt16, bool p_bCompression)
+{
+    QStringList t_qListSel;
+    for(qint32 i = 0; i < p_vecSel.size(); ++i)
+        t_qListSel << QString::number(p_vecSel[i]);
+
+    QString t_sKey = QString("sel=%1;dec=%2;fmt=%3;cmp=%4").arg(t_qListSel.join(","))
+                                                            .arg(p_iDecimation)
+                                                            .arg(p_bInt16 ? "int16" : "float")
+                                                            .arg(p_bCompression ? 1 : 0);
+
+    FiffStream t_fiffStream(this);
+    t_fiffStream.write_rt_command(3, t_sKey);//MNE_RT.MNE_RT_SET_STREAM_PROFILE
+    this->flush();
 }
 
 
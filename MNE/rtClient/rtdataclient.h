@@ -54,6 +54,7 @@
 #include <fiff/fiff_stream.h>
 #include <fiff/fiff_info.h>
 #include <fiff/fiff_tag.h>
+#include <utils/latencyhistogram.h>
 
 
 //*************************************************************************************************************
@@ -146,6 +147,77 @@ public:
     */
     void readRawBuffer(qint32 p_nChannels, MatrixXf& data, fiff_int_t& kind);
 
+    //=========================================================================================================
+    /**
+    * Reads the raw buffers which are queued at the socket into caller provided storage, e.g. a preallocated
+    * matrix or a slot of a CircularMatrixBuffer. Blocks until the first buffer arrived, further buffers are
+    * appended as long as they are completely received and fit into the storage. Float buffers are read from the
+    * socket directly into the storage, without FiffStream and FiffTag. Samples of a buffer which do not fit
+    * anymore are kept and returned first by the next call.
+    *
+    * @param[in] p_nChannels        Number of channels (rows of the storage).
+    * @param[out] p_pData           The storage, column major p_nChannels x p_iMaxSamples.
+    * @param[in] p_iMaxSamples      Number of samples (columns) the storage can hold.
+    * @param[out] p_iNumBuffers     Number of completely read buffers.
+    * @param[out] kind              FIFF_DATA_BUFFER if samples were read, the kind of the received tag otherwise.
+    *
+    * @return the number of read samples.
+    */
+    qint32 readRawBuffers(qint32 p_nChannels, float* p_pData, qint32 p_iMaxSamples, qint32& p_iNumBuffers, fiff_int_t& kind);
+
+    //=========================================================================================================
+    /**
+    * Reads the raw buffers which are queued at the socket into a preallocated matrix (see above). The number of
+    * channels is the number of rows of the matrix.
+    *
+    * @param[out] data              The preallocated storage, the read samples are written to the first columns.
+    * @param[out] p_iNumBuffers     Number of completely read buffers.
+    * @param[out] kind              FIFF_DATA_BUFFER if samples were read, the kind of the received tag otherwise.
+    *
+    * @return the number of read samples.
+    */
+    inline qint32 readRawBuffers(MatrixXf& data, qint32& p_iNumBuffers, fiff_int_t& kind);
+
+    //=========================================================================================================
+    /**
+    * Requests a stream profile at mne_rt_server. Following raw buffers contain only the selected channels,
+    * are low pass filtered and decimated and optionally sent as int16 samples and zlib compressed.
+    * readRawBuffer decodes them transparently. The client switches with the first profiled buffer it receives,
+    * buffers which were on their way before are still decoded full width. Every profiled buffer carries its
+    * number of channels, i.e. the number of selected channels which exist at the server.
+    *
+    * @param[in] p_vecSel           Selected channel indices, empty for all channels.
+    * @param[in] p_iDecimation      Decimation factor (1 to 64).
+    * @param[in] p_bInt16           Whether the samples are sent as int16 with per channel scales.
+    * @param[in] p_bCompression     Whether the buffers are sent zlib compressed.
+    */
+    void setStreamProfile(const VectorXi& p_vecSel, qint32 p_iDecimation = 1, bool p_bInt16 = false, bool p_bCompression = false);
+
+    //=========================================================================================================
+    /**
+    * Latency of the stamped raw buffers, from their arrival at mne_rt_server until they were read completely
+    * (see the blockstamps command of mne_rt_server).
+    *
+    * @return the latency histogram [us].
+    */
+    inline const UTILSLIB::LatencyHistogram& getLatencyHistogram() const;
+
+    //=========================================================================================================
+    /**
+    * Number of stamped raw buffers which were lost, i.e. dropped by the slow client policy of mne_rt_server.
+    *
+    * @return the number of lost buffers.
+    */
+    inline quint64 getNumLostBuffers() const;
+
+    //=========================================================================================================
+    /**
+    * Arrival time of the last read stamped raw buffer at mne_rt_server, the time base of later pipeline stages.
+    *
+    * @return the arrival time [us since the epoch], 0 if no stamped buffer was read.
+    */
+    inline qint64 getLastArrivalTime() const;
+
     //=========================================================================================================
     /**
     * Sets the alias of the data client
@@ -155,14 +227,136 @@ public:
     void setClientAlias(const QString &p_sAlias);
 
 private:
+    //=========================================================================================================
+    /**
+    * Decodes a received tag of a raw buffer. Compressed tags are unpacked and their inner tags are decoded.
+    *
+    * @param[in] p_pTag         The received tag.
+    * @param[in] p_nChannels    Number of channels to reshape the received data.
+    * @param[out] data          The decoded data, if the tag contained a data buffer.
+    * @param[out] kind          Kind of the last decoded tag.
+    *
+    * @return true if a data buffer was decoded.
+    */
+    bool decodeRawBufferTag(FiffTag::SPtr& p_pTag, qint32 p_nChannels, MatrixXf& data, fiff_int_t& kind);
+
+    //=========================================================================================================
+    /**
+    * Copies not yet returned samples of m_matPending into the storage.
+    *
+    * @param[out] p_pData           The storage.
+    * @param[in] p_iMaxSamples      Number of samples the storage can hold.
+    * @param[out] p_iNumBuffers     Incremented if the pending buffer was completely returned.
+    *
+    * @return the number of copied samples.
+    */
+    qint32 takePending(float* p_pData, qint32 p_iMaxSamples, qint32& p_iNumBuffers);
+
+    //=========================================================================================================
+    /**
+    * Blocks until p_iNumBytes are available or the socket is not connected anymore.
+    *
+    * @param[in] p_iNumBytes    Number of bytes to wait for.
+    *
+    * @return true if the bytes are available.
+    */
+    bool waitForBytes(qint64 p_iNumBytes);
+
+    //=========================================================================================================
+    /**
+    * Peeks the header (kind, type, size, next) of a tag which starts p_iOffset bytes after the read position.
+    *
+    * @param[in] p_iOffset      Offset of the tag (at most 48 bytes).
+    * @param[out] p_pHeader     The header, 4 integers in native byte order.
+    * @param[in] p_bWait        Whether to block until the header is available.
+    *
+    * @return true if the header was peeked.
+    */
+    bool peekTagHeader(qint64 p_iOffset, qint32* p_pHeader, bool p_bWait);
+
+    //=========================================================================================================
+    /**
+    * Reads a FIFF_MNE_RT_BLOCK_STAMP tag from the socket, the stamp is applied to the next data buffer.
+    *
+    * @param[in] p_iStampSize   Size of the tag including its header.
+    */
+    void readBlockStamp(qint64 p_iStampSize);
+
+    //=========================================================================================================
+    /**
+    * Keeps a block stamp until the data buffer it belongs to was read.
+    *
+    * @param[in] p_iSequence    Sequence number of the buffer.
+    * @param[in] p_iSec         Arrival time at mne_rt_server, seconds.
+    * @param[in] p_iUsec        Arrival time at mne_rt_server, microseconds.
+    */
+    void setBlockStamp(qint32 p_iSequence, qint32 p_iSec, qint32 p_iUsec);
+
+    //=========================================================================================================
+    /**
+    * Updates the latency histogram and the lost buffers with the pending block stamp, called when a data buffer
+    * was read completely.
+    */
+    void applyBlockStamp();
+
     qint32 m_clientID;  /**< Corresponding client id of the data client at mne_rt_server */
 
+    VectorXf m_vecScales;       /**< Per channel scales of the next profiled data buffer, empty for a full width buffer */
+    bool m_bStreamProfiled;     /**< Whether the last data buffer was profiled */
+    qint32 m_iStreamChannels;   /**< Number of channels of the last data buffer */
+
+    MatrixXf m_matPending;      /**< Buffer which did not fit into the storage of readRawBuffers */
+    qint32 m_iPendingOffset;    /**< Number of samples of m_matPending which were already returned */
+
+    bool m_bStampPending;                   /**< Whether a block stamp waits for its data buffer */
+    qint32 m_iStampSequence;                /**< Sequence number of the pending block stamp */
+    qint64 m_iStampTime;                    /**< Arrival time of the pending block stamp [us] */
+    qint32 m_iExpectedSequence;             /**< Sequence number of the next buffer, -1 if unknown */
+    quint64 m_iNumLostBuffers;              /**< Number of lost stamped buffers */
+    qint64 m_iLastArrivalTime;              /**< Arrival time of the last read stamped buffer [us] */
+    UTILSLIB::LatencyHistogram m_histLatency;   /**< Latency of the stamped buffers [us] */
+
 signals:
     
 public slots:
     
 };
 
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+inline qint32 RtDataClient::readRawBuffers(MatrixXf& data, qint32& p_iNumBuffers, fiff_int_t& kind)
+{
+    return readRawBuffers(data.rows(), data.data(), data.cols(), p_iNumBuffers, kind);
+}
+
+
+//*************************************************************************************************************
+
+inline const UTILSLIB::LatencyHistogram& RtDataClient::getLatencyHistogram() const
+{
+    return m_histLatency;
+}
+
+
+//*************************************************************************************************************
+
+inline quint64 RtDataClient::getNumLostBuffers() const
+{
+    return m_iNumLostBuffers;
+}
+
+
+//*************************************************************************************************************
+
+inline qint64 RtDataClient::getLastArrivalTime() const
+{
+    return m_iLastArrivalTime;
+}
+
 } // NAMESPACE
 
 #endif // RTDATACLIENT_H
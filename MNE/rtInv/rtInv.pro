@@ -90,14 +90,18 @@ SOURCES += \
         rtcov.cpp \
         rtinvop.cpp \
         rtave.cpp \
-    rtnoise.cpp
+    rtnoise.cpp \
+    rtprojop.cpp \
+    rthpifit.cpp
 
 HEADERS +=  \
         rtinv_global.h \
         rtcov.h \
         rtinvop.h \
         rtave.h \
-    rtnoise.h
+    rtnoise.h \
+    rtprojop.h \
+    rthpifit.h
 
 INCLUDEPATH += $${EIGEN_INCLUDE_DIR}
 INCLUDEPATH += $${MNE_INCLUDE_DIR}
@@ -45,6 +45,7 @@
 #include <utils/ioutils.h>
 
 #include <iostream>
+#include <limits>
 
 
 //*************************************************************************************************************
@@ -74,11 +75,14 @@ using namespace UTILSLIB;
 RtAve::RtAve(quint32 numAverages, quint32 p_iPreStimSamples, quint32 p_iPostStimSamples, FiffInfo::SPtr p_pFiffInfo, QObject *parent)
 : QThread(parent)
 , m_iNumAverages(numAverages)
+, m_averagingMode(MovingAverage)
+, m_newAveragingMode(MovingAverage)
 , m_iPreStimSamples(p_iPreStimSamples)
 , m_iPostStimSamples(p_iPostStimSamples)
 , m_pFiffInfo(p_pFiffInfo)
 , m_bIsRunning(false)
 , m_bAutoAspect(true)
+, m_iNumRingSamples(0)
 {
     qRegisterMetaType<FiffEvoked::SPtr>("FiffEvoked::SPtr");
 }
@@ -117,6 +121,15 @@ void RtAve::setAverages(qint32 numAve)
 }
 
 
+//*************************************************************************************************************
+
+void RtAve::setAveragingMode(AveragingMode mode)
+{
+    QMutexLocker locker(&m_qMutex);
+    m_newAveragingMode = mode;
+}
+
+
 //*************************************************************************************************************
 
 void RtAve::setPreStim(qint32 samples)
@@ -137,150 +150,128 @@ void RtAve::setPostStim(qint32 samples)
 
 //*************************************************************************************************************
 
-void RtAve::assemblePostStimulus(const QList<QPair<QList<qint32>, MatrixXd> > &p_qListRawMatBuf, qint32 p_iStimIdx)
+void RtAve::detectStimuli(const MatrixXd &p_matBlock)
 {
-    QMutexLocker locker(&m_qMutex);
-    if(m_iPostStimSamples > 0)
+    for(qint32 i = 0; i < m_qListStimChannelIdcs.size(); ++i)
     {
-        // middle of the assembled buffers
-        float ratio = (float)m_iPreStimSamples/((float)(m_iPreStimSamples+m_iPostStimSamples));
-        qint32 t_iBuffWithStim = floor((p_qListRawMatBuf.size()-1)*ratio) + 1;
-
-        qint32 nrows = p_qListRawMatBuf[t_iBuffWithStim].second.rows();
-        qint32 ncols = p_qListRawMatBuf[t_iBuffWithStim].second.cols();
-
-        //Stimulus channel row
-        qint32 t_iRowIdx = m_qListStimChannelIdcs[p_iStimIdx];
+        qint32 idx = m_qListStimChannelIdcs[i];
+        double t_dLast = m_qListLastStimValues[i];
 
-        qint32 nSampleCount = 0;
-
-        MatrixXd t_matPostStim(nrows, m_iPostStimSamples);
-        qint32 t_curBufIdx = t_iBuffWithStim;
-
-        qint32 t_iSize = 0;
-
-        qint32 pos = 0;
-        p_qListRawMatBuf[t_iBuffWithStim].second.row(t_iRowIdx).maxCoeff(&pos);
-
-        //
-        // assemble poststimulus
-        //
-
-        // start from the stimulus itself
-        if(pos >= 0)
+        for(qint32 j = 0; j < p_matBlock.cols(); ++j)
         {
-            t_iSize = ncols - pos;
-            if(t_iSize <= m_iPostStimSamples)
+            double t_dValue = p_matBlock(idx, j);
+            if(t_dValue > 0 && t_dLast <= 0)
             {
-                t_matPostStim.block(0, 0, nrows, t_iSize) = p_qListRawMatBuf[t_iBuffWithStim].second.block(0, pos, nrows, t_iSize);
-                nSampleCount += t_iSize;
-            }
-            else
-            {
-                t_matPostStim.block(0, 0, nrows, m_iPostStimSamples) = p_qListRawMatBuf[t_iBuffWithStim].second.block(0, pos, nrows, m_iPostStimSamples);
-                nSampleCount = m_iPostStimSamples;
+                m_qListPendingStimuli.append(qMakePair(i, m_iNumRingSamples + j));
+                emit stimulusDetected(idx, m_iNumRingSamples + j);
             }
+            t_dLast = t_dValue;
         }
 
-        ++t_curBufIdx;
+        m_qListLastStimValues[i] = t_dLast;
+    }
+}
 
-        // remaining samples
-        while(nSampleCount < m_iPostStimSamples)
-        {
-            t_iSize = m_iPostStimSamples-nSampleCount;
 
-            if(ncols <= t_iSize)
-            {
-                t_matPostStim.block(0, nSampleCount, nrows, ncols) = p_qListRawMatBuf[t_curBufIdx].second.block(0, 0, nrows, ncols);
-                nSampleCount += ncols;
-            }
-            else
-            {
-                t_matPostStim.block(0, nSampleCount, nrows, t_iSize) = p_qListRawMatBuf[t_curBufIdx].second.block(0, 0, nrows, t_iSize);
-                nSampleCount = m_iPostStimSamples;
-            }
+//*************************************************************************************************************
 
-            ++t_curBufIdx;
-        }
+void RtAve::appendToRing(const MatrixXd &p_matBlock)
+{
+    qint64 t_iRingSize = m_matRing.cols();
+    qint64 t_iPos = m_iNumRingSamples % t_iRingSize;
+    qint64 t_iCount = qMin((qint64)p_matBlock.cols(), t_iRingSize - t_iPos);
 
-        //
-        //Store in right post stimulus buffer vector
-        //
-        m_qListQListPostStimBuf[p_iStimIdx].append(t_matPostStim);
-    }
+    m_matRing.middleCols(t_iPos, t_iCount) = p_matBlock.leftCols(t_iCount);
+    if(t_iCount < p_matBlock.cols())
+        m_matRing.leftCols(p_matBlock.cols() - t_iCount) = p_matBlock.rightCols(p_matBlock.cols() - t_iCount);
+
+    m_iNumRingSamples += p_matBlock.cols();
 }
 
 
 //*************************************************************************************************************
 
-void RtAve::assemblePreStimulus(const QList<QPair<QList<qint32>, MatrixXd> > &p_qListRawMatBuf, qint32 p_iStimIdx)
+void RtAve::extractEpoch(qint64 p_iFirstSample, qint32 p_iNumSamples, MatrixXd &p_matEpoch) const
 {
-    QMutexLocker locker(&m_qMutex);
-    if(m_iPreStimSamples > 0)
-    {
-        // stimulus containing buffer of the assembled buffers
-        float ratio = (float)m_iPreStimSamples/((float)(m_iPreStimSamples+m_iPostStimSamples));
-        qint32 t_iBuffWithStim = floor((p_qListRawMatBuf.size()-1)*ratio) + 1;
-        qint32 nrows = p_qListRawMatBuf[t_iBuffWithStim].second.rows();
-        qint32 ncols = p_qListRawMatBuf[t_iBuffWithStim].second.cols();
+    qint64 t_iRingSize = m_matRing.cols();
+    qint64 t_iPos = p_iFirstSample % t_iRingSize;
+    qint64 t_iCount = qMin((qint64)p_iNumSamples, t_iRingSize - t_iPos);
+
+    p_matEpoch.resize(m_matRing.rows(), p_iNumSamples);
+    p_matEpoch.leftCols(t_iCount) = m_matRing.middleCols(t_iPos, t_iCount);
+    if(t_iCount < p_iNumSamples)
+        p_matEpoch.rightCols(p_iNumSamples - t_iCount) = m_matRing.leftCols(p_iNumSamples - t_iCount);
+}
 
-        //Stimulus channel row
-        qint32 t_iRowIdx = m_qListStimChannelIdcs[p_iStimIdx];
 
-        qint32 nSampleCount = m_iPreStimSamples;
+//*************************************************************************************************************
 
-        MatrixXd t_matPreStim(nrows, m_iPreStimSamples);
-        qint32 t_curBufIdx = t_iBuffWithStim;
+void RtAve::updateAverage(QList<MatrixXd> &p_qListEpochs, MatrixXd &p_matSum, qint64 &p_iNumEpochs, MatrixXd &p_matAve)
+{
+    if(p_qListEpochs.isEmpty())
+        return;
 
-        qint32 t_iStart = 0;
+    const MatrixXd& t_matEpoch = p_qListEpochs.last();
 
-        qint32 pos = 0;
-        p_qListRawMatBuf[t_iBuffWithStim].second.row(t_iRowIdx).maxCoeff(&pos);
+    if(p_iNumEpochs == 0 || p_matSum.rows() != t_matEpoch.rows() || p_matSum.cols() != t_matEpoch.cols())
+    {
+        p_matSum = MatrixXd::Zero(t_matEpoch.rows(), t_matEpoch.cols());
+        p_iNumEpochs = 0;
+    }
+    ++p_iNumEpochs;
 
-        //
-        // assemble prestimulus
-        //
+    switch(m_averagingMode)
+    {
+    case CumulativeAverage:
+        p_matSum += t_matEpoch;
+        p_matAve = p_matSum / (double)p_iNumEpochs;
+        p_qListEpochs.clear();
+        break;
+    case ExponentialAverage:
+    {
+        // cumulative until numAverages epochs are available -> no bias towards the first epoch
+        double w = 1.0/(double)qMin(p_iNumEpochs, (qint64)qMax(m_iNumAverages, 1));
+        p_matSum += w * (t_matEpoch - p_matSum);
+        p_matAve = p_matSum;
+        p_qListEpochs.clear();
+        break;
+    }
+    default:
+        p_matSum += t_matEpoch;
 
-        // start from the stimulus itself
-        if(pos > 0)
+        //if meanwhile number of averages was reduced more than one epoch is subtracted
+        while(p_qListEpochs.size() > m_iNumAverages)
         {
-            t_iStart = m_iPreStimSamples - pos;
-            if(t_iStart >= 0)
-            {
-                t_matPreStim.block(0, t_iStart, nrows, pos) = p_qListRawMatBuf[t_iBuffWithStim].second.block(0, 0, nrows, pos);
-                nSampleCount -= pos;
-            }
-            else
-            {
-                t_matPreStim.block(0, 0, nrows, m_iPreStimSamples) = p_qListRawMatBuf[t_iBuffWithStim].second.block(0, -t_iStart, nrows, m_iPreStimSamples);
-                nSampleCount = 0;
-            }
+            p_matSum -= p_qListEpochs.front();
+            p_qListEpochs.pop_front();
         }
-        --t_curBufIdx;
 
-        // remaining samples
-        while(nSampleCount > 0)
+        if(p_iNumEpochs % RenormInterval == 0)
         {
-            t_iStart = nSampleCount - ncols;
+            p_matSum = p_qListEpochs[0];
+            for(qint32 j = 1; j < p_qListEpochs.size(); ++j)
+                p_matSum += p_qListEpochs[j];
+        }
 
-            if(t_iStart >= 0)
-            {
-                t_matPreStim.block(0, t_iStart, nrows, ncols) = p_qListRawMatBuf[t_curBufIdx].second.block(0, 0, nrows, ncols);
-                nSampleCount -= ncols;
-            }
-            else
-            {
-                t_matPreStim.block(0, 0, nrows, nSampleCount) = p_qListRawMatBuf[t_curBufIdx].second.block(0, -t_iStart, nrows, nSampleCount);
-                nSampleCount = 0;
-            }
+        if(p_qListEpochs.size() == m_iNumAverages)
+            p_matAve = p_matSum / (double)m_iNumAverages;
+        break;
+    }
+}
 
-            --t_curBufIdx;
-        }
 
-        //
-        //Store in right pre stimulus buffer vector
-        //
-        m_qListQListPreStimBuf[p_iStimIdx].append(t_matPreStim);
+//*************************************************************************************************************
+
+qint32 RtAve::effectiveAverages(qint64 p_iNumEpochs) const
+{
+    switch(m_averagingMode)
+    {
+    case CumulativeAverage:
+        return (qint32)qMin(p_iNumEpochs, (qint64)std::numeric_limits<qint32>::max());
+    case ExponentialAverage:
+        return (qint32)qMin(p_iNumEpochs, (qint64)m_iNumAverages);
+    default:
+        return m_iNumAverages;
     }
 }
 
@@ -327,24 +318,28 @@ void RtAve::run()
     // Inits & Clears
     //
     m_qMutex.lock();
-    quint32 t_nSamplesPerBuf = 0;
-    QList<QPair<QList<qint32>, MatrixXd> > t_qListRawMatBuf;
-
     FiffEvoked::SPtr evoked(new FiffEvoked());
     VectorXd mu;
     qint32 i = 0;
-    qint32 j = 0;
 
     m_qListQListPreStimBuf.clear();
     m_qListQListPostStimBuf.clear();
     m_qListPreStimAve.clear();
     m_qListPostStimAve.clear();
     m_qListStimAve.clear();
+    m_qListPreStimSum.clear();
+    m_qListPostStimSum.clear();
+    m_qListPreStimNumEpochs.clear();
+    m_qListPostStimNumEpochs.clear();
 
     //
     // get num stim channels
     //
     m_qListStimChannelIdcs.clear();
+    m_qListLastStimValues.clear();
+    m_qListPendingStimuli.clear();
+    m_matRing.resize(0,0);
+    m_iNumRingSamples = 0;
     MatrixXd t_mat;
     QList<MatrixXd> t_qListMat;
     for(i = 0; i < m_pFiffInfo->nchan; ++i)
@@ -352,12 +347,17 @@ void RtAve::run()
         if(m_pFiffInfo->chs[i].kind == FIFFV_STIM_CH && (m_pFiffInfo->chs[i].ch_name != QString("STI 014")))
         {
             m_qListStimChannelIdcs.append(i);
+            m_qListLastStimValues.append(0);
 
             m_qListQListPreStimBuf.push_back(t_qListMat);
             m_qListQListPostStimBuf.push_back(t_qListMat);
             m_qListPreStimAve.push_back(t_mat);
             m_qListPostStimAve.push_back(t_mat);
             m_qListStimAve.push_back(t_mat);
+            m_qListPreStimSum.push_back(t_mat);
+            m_qListPostStimSum.push_back(t_mat);
+            m_qListPreStimNumEpochs.push_back(0);
+            m_qListPostStimNumEpochs.push_back(0);
         }
     }
 
@@ -401,10 +401,9 @@ void RtAve::run()
     t_stimEvoked.last = t_stimEvoked.times[t_stimEvoked.times.size()-1];
 
 
-    qint32 count = 0;
-
     m_iNewPreStimSamples = m_iPreStimSamples;
     m_iNewPostStimSamples = m_iPostStimSamples;
+    m_newAveragingMode = m_averagingMode;
 
     m_qMutex.unlock();
 
@@ -430,8 +429,10 @@ void RtAve::run()
             // Reset when stim size changed
             //
             m_qMutex.lock();
-            if(m_iNewPreStimSamples != m_iPreStimSamples || m_iNewPostStimSamples != m_iPostStimSamples)
+            if(m_iNewPreStimSamples != m_iPreStimSamples || m_iNewPostStimSamples != m_iPostStimSamples || m_newAveragingMode != m_averagingMode)
             {
+                m_averagingMode = m_newAveragingMode;
+
                 m_iPreStimSamples = m_iNewPreStimSamples;
                 m_iPostStimSamples = m_iNewPostStimSamples;
 
@@ -461,7 +462,8 @@ void RtAve::run()
 
 
                 MatrixXd t_resetMat;
-                t_qListRawMatBuf.clear();
+                m_qListPendingStimuli.clear();
+                m_matRing.resize(0,0);
                 m_qListPreStimAve.clear();
                 m_qListPostStimAve.clear();
                 m_qListStimAve.clear();
@@ -473,6 +475,10 @@ void RtAve::run()
                     m_qListPreStimAve.push_back(t_resetMat);
                     m_qListPostStimAve.push_back(t_resetMat);
                     m_qListStimAve.push_back(t_resetMat);
+                    m_qListPreStimSum[i] = t_resetMat;
+                    m_qListPostStimSum[i] = t_resetMat;
+                    m_qListPreStimNumEpochs[i] = 0;
+                    m_qListPostStimNumEpochs[i] = 0;
                 }
             }
             m_qMutex.unlock();
@@ -481,145 +487,118 @@ void RtAve::run()
             // Acquire Data
             //
             MatrixXd rawSegment = m_pRawMatrixBuffer->pop();
-            if(t_nSamplesPerBuf == 0)
-                t_nSamplesPerBuf = rawSegment.cols();
-
-            ++count;
 
             //
-            // Detect Stimuli
+            // The ring holds the longest epoch plus two blocks -> an epoch is complete before it is overwritten
             //
-            QList<qint32> t_qListStimuli;
-            for(i = 0; i < m_qListStimChannelIdcs.size(); ++i)
-            {
-                qint32 idx = m_qListStimChannelIdcs[i];
-                RowVectorXi stimSegment = rawSegment.row(idx).cast<int>();
-                int iMax = stimSegment.maxCoeff();
+            m_qMutex.lock();
+            qint32 t_iPreStimSamples = m_iPreStimSamples;
+            qint32 t_iPostStimSamples = m_iPostStimSamples;
+            m_qMutex.unlock();
 
-                if(iMax > 0)
-                    t_qListStimuli.append(i);
+            qint64 t_iRingSize = t_iPreStimSamples + t_iPostStimSamples + 2*rawSegment.cols();
+            if(m_matRing.rows() != rawSegment.rows() || m_matRing.cols() < t_iRingSize)
+            {
+                m_matRing.resize(rawSegment.rows(), t_iRingSize);
+                m_iNumRingSamples = 0;
+                m_qListPendingStimuli.clear();
             }
 
             //
-            // Store
+            // Detect Stimuli & Store
             //
-            t_qListRawMatBuf.push_back(qMakePair(t_qListStimuli, rawSegment));
+            this->detectStimuli(rawSegment);
+            this->appendToRing(rawSegment);
 
-            m_qMutex.lock();
-            qint32 minSize = (m_iPreStimSamples+m_iPostStimSamples) + (2 * t_nSamplesPerBuf);
-            m_qMutex.unlock();
+            //
+            // Average every stimulus whose post stimulus is complete
+            //
+            qint64 t_iFirstRingSample = qMax(m_iNumRingSamples - m_matRing.cols(), (qint64)0);
 
-            if(t_nSamplesPerBuf*t_qListRawMatBuf.size() > minSize)
+            for(i = 0; i < m_qListPendingStimuli.size(); )
             {
+                qint32 t_iStimIndex = m_qListPendingStimuli[i].first;
+                qint64 t_iOnset = m_qListPendingStimuli[i].second;
+
+                if(t_iOnset + t_iPostStimSamples > m_iNumRingSamples)
+                {
+                    ++i;
+                    continue;
+                }
+                m_qListPendingStimuli.removeAt(i);
+
+                //the pre stimulus of the first onsets can be missing
+                if(t_iOnset - t_iPreStimSamples < t_iFirstRingSample)
+                    continue;
+
                 //
-                // Average
+                // extract pre & post stimulus
                 //
-                float ratio = (float)m_iPreStimSamples/((float)(m_iPreStimSamples+m_iPostStimSamples));
-                qint32 t_iBuffWithStim = floor((t_qListRawMatBuf.size()-1)*ratio) + 1;
-
-                if(t_iBuffWithStim > 0 && t_qListRawMatBuf[t_iBuffWithStim].first.size() != 0)
+                MatrixXd t_matEpoch;
+                m_qMutex.lock();
+                if(t_iPreStimSamples > 0)
+                {
+                    this->extractEpoch(t_iOnset - t_iPreStimSamples, t_iPreStimSamples, t_matEpoch);
+                    m_qListQListPreStimBuf[t_iStimIndex].append(t_matEpoch);
+                }
+                if(t_iPostStimSamples > 0)
                 {
-                    for(i = 0; i < t_qListRawMatBuf[t_iBuffWithStim].first.size(); ++i)
-                    {
-                        //make sure that previous buffer does not conatin this stim - prevent multiple detection
-                        if(!t_qListRawMatBuf[t_iBuffWithStim-1].first.contains(t_qListRawMatBuf[t_iBuffWithStim].first[i]))
-                        {
-                            qint32 t_iStimIndex = t_qListRawMatBuf[t_iBuffWithStim].first[i];
-
-                            //
-                            // assemble prestimulus
-                            //
-                            this->assemblePreStimulus(t_qListRawMatBuf, t_iStimIndex);
-
-                            //
-                            // assemble poststimulus
-                            //
-                            this->assemblePostStimulus(t_qListRawMatBuf, t_iStimIndex);
-
-                            qDebug() << m_pFiffInfo->ch_names[m_qListStimChannelIdcs[t_iStimIndex]] << ": Buffer Size" << m_qListQListPreStimBuf[t_iStimIndex].size();
-                            //
-                            // Prestimulus average
-                            //
-                            m_qMutex.lock();
-                            if(m_qListQListPreStimBuf[t_iStimIndex].size() >= m_iNumAverages)
-                            {
-                                while(m_qListQListPreStimBuf[t_iStimIndex].size() >= (m_iNumAverages+1))//if meanwhile number of averages was reduced
-                                    m_qListQListPreStimBuf[t_iStimIndex].pop_front();
-
-                                m_qListPreStimAve[t_iStimIndex] = m_qListQListPreStimBuf[t_iStimIndex][0];
-                                for(j = 1; j < m_qListQListPreStimBuf[t_iStimIndex].size(); ++j)
-                                    m_qListPreStimAve[t_iStimIndex] += m_qListQListPreStimBuf[t_iStimIndex][j];
-
-                                m_qListPreStimAve[t_iStimIndex].array() /= (double)m_iNumAverages;
-
-                                m_qListQListPreStimBuf[t_iStimIndex].pop_front();
-                            }
-                            m_qMutex.unlock();
-
-                            //
-                            // Poststimulus average
-                            //
-                            m_qMutex.lock();
-                            if(m_qListQListPostStimBuf[t_iStimIndex].size() >= m_iNumAverages)
-                            {
-                                while(m_qListQListPostStimBuf[t_iStimIndex].size() >= (m_iNumAverages+1))//if meanwhile number of averages was reduced
-                                    m_qListQListPostStimBuf[t_iStimIndex].pop_front();
-
-                                m_qListPostStimAve[t_iStimIndex] = m_qListQListPostStimBuf[t_iStimIndex][0];
-                                for(j = 1; j < m_qListQListPostStimBuf[t_iStimIndex].size(); ++j)
-                                    m_qListPostStimAve[t_iStimIndex] += m_qListQListPostStimBuf[t_iStimIndex][j];
-
-                                m_qListPostStimAve[t_iStimIndex].array() /= (double)m_iNumAverages;
-
-                                m_qListQListPostStimBuf[t_iStimIndex].pop_front();
-                            }
-                            m_qMutex.unlock();
-
-                            //if averages are available -> buffers are filled and first average is stored
-                            m_qMutex.lock();
-                            if(m_qListPreStimAve[t_iStimIndex].size() > 0)
-                            {
-                                //
-                                // concatenate pre + post stimulus to full stimulus
-                                //
-                                m_qListStimAve[t_iStimIndex].resize(m_qListPreStimAve[t_iStimIndex].rows(), m_qListPreStimAve[t_iStimIndex].cols() + m_qListPostStimAve[t_iStimIndex].cols());
-                                // Pre
-                                m_qListStimAve[t_iStimIndex].block(0,0,m_qListPreStimAve[t_iStimIndex].rows(),m_qListPreStimAve[t_iStimIndex].cols()) = m_qListPreStimAve[t_iStimIndex];
-                                // Post
-                                m_qListStimAve[t_iStimIndex].block(0,m_qListPreStimAve[t_iStimIndex].cols(),m_qListPostStimAve[t_iStimIndex].rows(),m_qListPostStimAve[t_iStimIndex].cols()) = m_qListPostStimAve[t_iStimIndex];
-
-                                //
-                                // Emit evoked
-                                //
-                                QString t_sStimChName = m_pFiffInfo->ch_names[m_qListStimChannelIdcs[t_iStimIndex]];
-                                FiffEvoked::SPtr t_pEvokedPreStim(new FiffEvoked(t_preStimEvoked));
-                                t_pEvokedPreStim->nave = m_iNumAverages;
-                                t_pEvokedPreStim->comment = t_sStimChName;
-                                t_pEvokedPreStim->data = m_qListPreStimAve[t_iStimIndex];
-                                emit evokedPreStim(t_pEvokedPreStim);
-
-                                FiffEvoked::SPtr t_pEvokedPostStim(new FiffEvoked(t_postStimEvoked));
-                                t_pEvokedPostStim->nave = m_iNumAverages;
-                                t_pEvokedPostStim->comment = t_sStimChName;
-                                t_pEvokedPostStim->data = m_qListPostStimAve[t_iStimIndex];
-                                emit evokedPostStim(t_pEvokedPostStim);
-
-                                FiffEvoked::SPtr t_pEvokedStim(new FiffEvoked(t_stimEvoked));
-                                t_pEvokedStim->nave = m_iNumAverages;
-                                t_pEvokedStim->comment = t_sStimChName;
-                                t_pEvokedStim->data = m_qListStimAve[t_iStimIndex];
-                                emit evokedStim(t_pEvokedStim);
-                            }
-                            m_qMutex.unlock();
-                        }
-                    }
+                    this->extractEpoch(t_iOnset, t_iPostStimSamples, t_matEpoch);
+                    m_qListQListPostStimBuf[t_iStimIndex].append(t_matEpoch);
                 }
+                m_qMutex.unlock();
 
+                //
+                // Prestimulus average
+                //
+                m_qMutex.lock();
+                this->updateAverage(m_qListQListPreStimBuf[t_iStimIndex], m_qListPreStimSum[t_iStimIndex], m_qListPreStimNumEpochs[t_iStimIndex], m_qListPreStimAve[t_iStimIndex]);
+                m_qMutex.unlock();
 
                 //
-                //dump oldest buffer
+                // Poststimulus average
                 //
-                t_qListRawMatBuf.pop_front();
+                m_qMutex.lock();
+                this->updateAverage(m_qListQListPostStimBuf[t_iStimIndex], m_qListPostStimSum[t_iStimIndex], m_qListPostStimNumEpochs[t_iStimIndex], m_qListPostStimAve[t_iStimIndex]);
+                m_qMutex.unlock();
+
+                //if averages are available -> buffers are filled and first average is stored
+                m_qMutex.lock();
+                if(m_qListPreStimAve[t_iStimIndex].size() > 0)
+                {
+                    //
+                    // concatenate pre + post stimulus to full stimulus
+                    //
+                    m_qListStimAve[t_iStimIndex].resize(m_qListPreStimAve[t_iStimIndex].rows(), m_qListPreStimAve[t_iStimIndex].cols() + m_qListPostStimAve[t_iStimIndex].cols());
+                    // Pre
+                    m_qListStimAve[t_iStimIndex].block(0,0,m_qListPreStimAve[t_iStimIndex].rows(),m_qListPreStimAve[t_iStimIndex].cols()) = m_qListPreStimAve[t_iStimIndex];
+                    // Post
+                    m_qListStimAve[t_iStimIndex].block(0,m_qListPreStimAve[t_iStimIndex].cols(),m_qListPostStimAve[t_iStimIndex].rows(),m_qListPostStimAve[t_iStimIndex].cols()) = m_qListPostStimAve[t_iStimIndex];
+
+                    //
+                    // Emit evoked
+                    //
+                    QString t_sStimChName = m_pFiffInfo->ch_names[m_qListStimChannelIdcs[t_iStimIndex]];
+                    qint32 t_iNave = this->effectiveAverages(m_qListPostStimNumEpochs[t_iStimIndex]);
+                    FiffEvoked::SPtr t_pEvokedPreStim(new FiffEvoked(t_preStimEvoked));
+                    t_pEvokedPreStim->nave = t_iNave;
+                    t_pEvokedPreStim->comment = t_sStimChName;
+                    t_pEvokedPreStim->data = m_qListPreStimAve[t_iStimIndex];
+                    emit evokedPreStim(t_pEvokedPreStim);
+
+                    FiffEvoked::SPtr t_pEvokedPostStim(new FiffEvoked(t_postStimEvoked));
+                    t_pEvokedPostStim->nave = t_iNave;
+                    t_pEvokedPostStim->comment = t_sStimChName;
+                    t_pEvokedPostStim->data = m_qListPostStimAve[t_iStimIndex];
+                    emit evokedPostStim(t_pEvokedPostStim);
+
+                    FiffEvoked::SPtr t_pEvokedStim(new FiffEvoked(t_stimEvoked));
+                    t_pEvokedStim->nave = t_iNave;
+                    t_pEvokedStim->comment = t_sStimChName;
+                    t_pEvokedStim->data = m_qListStimAve[t_iStimIndex];
+                    emit evokedStim(t_pEvokedStim);
+                }
+                m_qMutex.unlock();
             }
         }
     }
@@ -113,6 +113,17 @@ public:
     typedef QSharedPointer<RtAve> SPtr;             /**< Shared pointer type for RtCov. */
     typedef QSharedPointer<const RtAve> ConstSPtr;  /**< Const shared pointer type for RtCov. */
 
+    //=========================================================================================================
+    /**
+    * Averaging modes. All modes keep running sums which are updated in O(1) per stimulus.
+    */
+    enum AveragingMode
+    {
+        MovingAverage,          /**< Average of the last numAverages epochs (default). */
+        CumulativeAverage,      /**< Average of all epochs since the start or the last reset. */
+        ExponentialAverage      /**< Exponentially weighted average with weight 1/numAverages of the newest epoch. */
+    };
+
     //=========================================================================================================
     /**
     * Creates the real-time covariance estimation object.
@@ -147,6 +158,14 @@ public:
     */
     void setAverages(qint32 numAve);
 
+    //=========================================================================================================
+    /**
+    * Sets the averaging mode. The averages are reset.
+    *
+    * @param[in] mode       new averaging mode
+    */
+    void setAveragingMode(AveragingMode mode);
+
     //=========================================================================================================
     /**
     * Sets the number of pre stimulus samples
@@ -216,6 +235,15 @@ signals:
     */
     void numAveragesChanged();
 
+    //=========================================================================================================
+    /**
+    * Emitted for every detected stimulus onset.
+    *
+    * @param[in] p_iStimChannel     Index of the stimulus channel in the measurement info.
+    * @param[in] p_iSample          Absolute sample index of the onset, counted from the start of the averaging.
+    */
+    void stimulusDetected(qint32 p_iStimChannel, qint64 p_iSample);
+
 protected:
     //=========================================================================================================
     /**
@@ -228,26 +256,65 @@ protected:
 private:
     //=========================================================================================================
     /**
-    * Assemble the poststimulus
+    * Detects the rising edges (0 -> >0) of the stimulus channels in a data block and appends every onset to the
+    * pending stimuli. An onset is found at its exact sample, also when a block contains several of them.
+    *
+    * @param[in] p_matBlock     The data block, its first sample has the absolute index m_iNumRingSamples.
+    */
+    void detectStimuli(const MatrixXd &p_matBlock);
+
+    //=========================================================================================================
+    /**
+    * Writes a data block to the sample ring, wrapping around at its end.
     *
-    * @param[in] p_qListRawMatBuf   List of raw buffers
-    * @param[in] p_iStimIdx         Stimulus index to investigate
+    * @param[in] p_matBlock     The data block.
     */
-    void assemblePostStimulus(const QList<QPair<QList<qint32>, MatrixXd> > &p_qListRawMatBuf, qint32 p_iStimIdx);
+    void appendToRing(const MatrixXd &p_matBlock);
 
     //=========================================================================================================
     /**
-    * Assemble the prestimulus
+    * Copies an epoch out of the sample ring, in one or, when it wraps around the end of the ring, two blocks.
     *
-    * @param[in] p_qListRawMatBuf   List of raw buffers
-    * @param[in] p_iStimIdx         Stimulus index to investigate
+    * @param[in] p_iFirstSample     Absolute index of the first sample of the epoch.
+    * @param[in] p_iNumSamples      Number of samples of the epoch.
+    * @param[out] p_matEpoch        The epoch.
     */
-    void assemblePreStimulus(const QList<QPair<QList<qint32>, MatrixXd> > &p_qListRawMatBuf, qint32 p_iStimIdx);
+    void extractEpoch(qint64 p_iFirstSample, qint32 p_iNumSamples, MatrixXd &p_matEpoch) const;
+
+    //=========================================================================================================
+    /**
+    * Adds the newest assembled epoch to the running sum and updates the average according to the averaging mode.
+    * In moving average mode the oldest epochs are subtracted and the sum is recomputed every RenormInterval
+    * epochs to bound the floating point drift. The other modes do not keep the epochs. Has to be called with
+    * m_qMutex locked.
+    *
+    * @param[in, out] p_qListEpochs     Assembled epochs, the newest one is the last.
+    * @param[in, out] p_matSum          Running sum (moving and cumulative) or running average (exponential).
+    * @param[in, out] p_iNumEpochs      Number of epochs added since the last reset.
+    * @param[out] p_matAve              The average, unchanged while less than numAverages epochs are available in
+    *                                   moving average mode.
+    */
+    void updateAverage(QList<MatrixXd> &p_qListEpochs, MatrixXd &p_matSum, qint64 &p_iNumEpochs, MatrixXd &p_matAve);
+
+    //=========================================================================================================
+    /**
+    * Returns the number of averaged epochs reported in the evoked data.
+    *
+    * @param[in] p_iNumEpochs   Number of epochs added since the last reset.
+    *
+    * @return the number of averages.
+    */
+    qint32 effectiveAverages(qint64 p_iNumEpochs) const;
+
+    enum { RenormInterval = 256 };      /**< Number of epochs after which the moving sum is recomputed. */
 
     QMutex m_qMutex;                    /**< Provides access serialization between threads*/
 
     qint32 m_iNumAverages;              /**< Number of averages */
 
+    AveragingMode m_averagingMode;      /**< The averaging mode. */
+    AveragingMode m_newAveragingMode;   /**< New averaging mode. */
+
     qint32     m_iPreStimSamples;       /**< Amount of samples averaged before the stimulus. */
     qint32     m_iPostStimSamples;      /**< Amount of samples averaged after the stimulus, including the stimulus sample.*/
 
@@ -265,6 +332,11 @@ private:
 
 
     QList<qint32> m_qListStimChannelIdcs;   /**< Stimulus channel indeces. */
+    QList<double> m_qListLastStimValues;    /**< Last sample of each stimulus channel, for the edge detection across blocks. */
+
+    MatrixXd m_matRing;                     /**< Sample ring, channels x ring samples. The absolute sample s is stored in column s % m_matRing.cols(). */
+    qint64 m_iNumRingSamples;               /**< Number of samples written to the ring, i.e. the absolute index of the next sample. */
+    QList<QPair<qint32, qint64> > m_qListPendingStimuli;    /**< Detected onsets (stimulus index, absolute sample) whose post stimulus is incomplete. */
 
 //    QList<fiff_int_t>  m_qSetAspectKinds;   /**< List of aspects to average. Each aspect is averaged separetely and released stored in evoked data.*/
 
@@ -274,6 +346,11 @@ private:
     QList<MatrixXd> m_qListPreStimAve;     /**< the current pre stimulus average */
     QList<MatrixXd> m_qListPostStimAve;    /**< the current post stimulus average */
     QList<MatrixXd> m_qListStimAve;     /**< the current stimulus average */
+
+    QList<MatrixXd> m_qListPreStimSum;      /**< running pre stimulus sum, the average in exponential mode */
+    QList<MatrixXd> m_qListPostStimSum;     /**< running post stimulus sum, the average in exponential mode */
+    QList<qint64> m_qListPreStimNumEpochs;  /**< number of pre stimulus epochs added since the last reset */
+    QList<qint64> m_qListPostStimNumEpochs; /**< number of post stimulus epochs added since the last reset */
 };
 
 //*************************************************************************************************************
@@ -51,6 +51,7 @@
 // QT INCLUDES
 //=============================================================================================================
 
+#include <QMutexLocker>
 #include <QDebug>
 
 
@@ -60,6 +61,7 @@
 //=============================================================================================================
 
 using namespace RTINVLIB;
+using namespace UTILSLIB;
 using namespace FIFFLIB;
 
 
@@ -71,6 +73,10 @@ using namespace FIFFLIB;
 RtCov::RtCov(qint32 p_iMaxSamples, FiffInfo::SPtr p_pFiffInfo, QObject *parent)
 : QThread(parent)
 , m_iMaxSamples(p_iMaxSamples)
+, m_iNewMaxSamples(p_iMaxSamples)
+, m_estimationMode(StreamingCovariance::SlidingWindow)
+, m_newEstimationMode(StreamingCovariance::SlidingWindow)
+, m_iUpdateInterval(0)
 , m_pFiffInfo(p_pFiffInfo)
 , m_bIsRunning(false)
 {
@@ -104,10 +110,29 @@ void RtCov::append(const MatrixXd &p_DataSegment)
 
 void RtCov::setSamples(qint32 samples)
 {
+    QMutexLocker locker(&mutex);
     m_iNewMaxSamples = samples;
 }
 
 
+//*************************************************************************************************************
+
+void RtCov::setEstimationMode(StreamingCovariance::Mode mode)
+{
+    QMutexLocker locker(&mutex);
+    m_newEstimationMode = mode;
+}
+
+
+//*************************************************************************************************************
+
+void RtCov::setUpdateInterval(qint32 samples)
+{
+    QMutexLocker locker(&mutex);
+    m_iUpdateInterval = samples;
+}
+
+
 //*************************************************************************************************************
 
 bool RtCov::start()
@@ -141,34 +166,42 @@ bool RtCov::stop()
 
 void RtCov::run()
 {
-    quint32 n_samples = 0;
-
-    FiffCov::SPtr cov(new FiffCov());
-    VectorXd mu;
+    StreamingCovariance t_covEstimator(m_estimationMode, m_iMaxSamples);
+    quint32 t_iSamplesSinceEstimate = 0;
 
     while(m_bIsRunning)
     {
+        //
+        // Restart the estimation when its parameters changed
+        //
+        mutex.lock();
+        if(m_iNewMaxSamples != m_iMaxSamples || m_newEstimationMode != m_estimationMode)
+        {
+            m_iMaxSamples = m_iNewMaxSamples;
+            m_estimationMode = m_newEstimationMode;
+            t_covEstimator.setMode(m_estimationMode, m_iMaxSamples);
+            t_iSamplesSinceEstimate = 0;
+        }
+        quint32 t_iUpdateInterval = m_iUpdateInterval > 0 ? m_iUpdateInterval : m_iMaxSamples;
+        mutex.unlock();
+
         if(m_pRawMatrixBuffer)
         {
-            MatrixXd rawSegment = m_pRawMatrixBuffer->pop();
+            // Process the segment in place
+            Map<const MatrixXd> rawSegment = m_pRawMatrixBuffer->acquireReadSlot();
+            if(rawSegment.size() == 0)
+                continue;
 
-            if(n_samples == 0)
-            {
-                mu = rawSegment.rowwise().sum();
-                cov->data = rawSegment * rawSegment.transpose();
-            }
-            else
-            {
-                mu.array() += rawSegment.rowwise().sum().array();
-                cov->data += rawSegment * rawSegment.transpose();
-            }
-            n_samples += rawSegment.cols();
+            t_covEstimator.update(rawSegment);
+            t_iSamplesSinceEstimate += rawSegment.cols();
+
+            m_pRawMatrixBuffer->release();
 
-            if(n_samples > m_iMaxSamples)
+            if(t_iSamplesSinceEstimate >= t_iUpdateInterval && t_covEstimator.weight() > 1)
             {
-                mu /= (float)n_samples;
-                cov->data.array() -= n_samples * (mu * mu.transpose()).array();
-                cov->data.array() /= (n_samples - 1);
+                FiffCov::SPtr cov(new FiffCov());
+
+                cov->data = t_covEstimator.covariance();
 
                 cov->kind = FIFFV_MNE_NOISE_COV;
                 cov->diag = false;
@@ -178,29 +211,15 @@ void RtCov::run()
                 cov->names = m_pFiffInfo->ch_names;
                 cov->projs = m_pFiffInfo->projs;
                 cov->bads = m_pFiffInfo->bads;
-                cov->nfree = n_samples;
+                cov->nfree = (fiff_int_t)t_covEstimator.weight();
 
                 // regularize noise covariance
                 *cov.data() = cov->regularize(*m_pFiffInfo, 0.05, 0.05, 0.1, true);
 
                 emit covCalculated(cov);
 
-                cov = FiffCov::SPtr(new FiffCov());
-                n_samples = 0;
+                t_iSamplesSinceEstimate = 0;
             }
-
-
-//            qint32 samples = rawSegment.cols();
-//            VectorXf mu = rawSegment.rowwise().sum().array() / (float)samples;
-
-//            MatrixXf noise_covariance = rawSegment * rawSegment.transpose();// noise_covariance == raw_covariance
-//            noise_covariance.array() -= samples * (mu * mu.transpose()).array();
-//            noise_covariance.array() /= (samples - 1);
-
-//            std::cout << "Noise Covariance:\n" << noise_covariance.block(0,0,10,10) << std::endl;
-
-//            printf("%d raw buffer (%d x %d) generated\r\n", count, tmp.rows(), tmp.cols());
-
         }
     }
 }
@@ -61,6 +61,14 @@
 #include <generics/circularmatrixbuffer.h>
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// Utils INCLUDES
+//=============================================================================================================
+
+#include <utils/streamingcovariance.h>
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // QT INCLUDES
@@ -145,12 +153,28 @@ public:
 
     //=========================================================================================================
     /**
-    * Set number of estimation samples
+    * Set number of estimation samples, i.e. the window length (sliding window) or memory (exponential forgetting)
     *
     * @param[in] samples    estimation samples to set
     */
     void setSamples(qint32 samples);
 
+    //=========================================================================================================
+    /**
+    * Sets the estimation mode, the default is a sliding window. The estimation is restarted.
+    *
+    * @param[in] mode       estimation mode to set
+    */
+    void setEstimationMode(UTILSLIB::StreamingCovariance::Mode mode);
+
+    //=========================================================================================================
+    /**
+    * Sets the number of samples after which an intermediate estimate is emitted. The accumulation is not restarted.
+    *
+    * @param[in] samples    update interval to set, 0 to emit once per estimation samples (default)
+    */
+    void setUpdateInterval(qint32 samples);
+
     //=========================================================================================================
     /**
     * Starts the RtCov by starting the producer's thread.
@@ -192,6 +216,10 @@ private:
 
     quint32      m_iNewMaxSamples;      /**< New maximal amount of samples received, before covariance is estimated.*/
 
+    UTILSLIB::StreamingCovariance::Mode m_estimationMode;       /**< Estimation mode.*/
+    UTILSLIB::StreamingCovariance::Mode m_newEstimationMode;    /**< New estimation mode.*/
+    quint32      m_iUpdateInterval;     /**< Number of samples after which an estimate is emitted, 0 for m_iMaxSamples.*/
+
     FiffInfo::SPtr  m_pFiffInfo;        /**< Holds the fiff measurement information. */
 
     bool        m_bIsRunning;           /**< Holds if real-time Covariance estimation is running.*/
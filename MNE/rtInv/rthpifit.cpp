@@ -0,0 +1,511 @@
+//=============================================================================================================
+/**
+* @file     rthpifit.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>;
+* @version  1.0
+* @date     January, 2015
+*
+* @section  LICENSE
+*
+* Copyright (C) 2015, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Implementation of the RtHpiFit class.
+*
+*/
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "rthpifit.h"
+
+#include <math.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QElapsedTimer>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Cholesky>
+#include <Eigen/Eigenvalues>
+#include <Eigen/SVD>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace RTINVLIB;
+using namespace FIFFLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+RtHpiFit::RtHpiFit(FiffInfo::SPtr p_pFiffInfo, const QVector<double>& p_vecCoilFreqs, double p_dWindowLength)
+: m_pFiffInfo(p_pFiffInfo)
+, m_vecCoilFreqs(p_vecCoilFreqs.size())
+, m_dWindowLength(p_dWindowLength)
+, m_iWindowSize(0)
+, m_iTimeBudget(20)
+, m_dGofLimit(0.98)
+, m_iRingPos(0)
+, m_iNumSamples(0)
+, m_iNextCoil(0)
+, m_iNumFittedCoils(0)
+, m_bTransValid(false)
+, m_dTransError(0)
+{
+    for(qint32 i = 0; i < p_vecCoilFreqs.size(); ++i)
+        m_vecCoilFreqs[i] = p_vecCoilFreqs[i];
+
+    init();
+}
+
+
+//*************************************************************************************************************
+
+void RtHpiFit::setCoilPositions(const MatrixX3d& p_matCoilHead)
+{
+    if(p_matCoilHead.rows() != numCoils())
+    {
+        printf("RtHpiFit: %d coil positions given for %d coils.\n", (int)p_matCoilHead.rows(), numCoils());//ToDo throw
+        return;
+    }
+
+    m_matCoilHead = p_matCoilHead;
+    reset();
+}
+
+
+//*************************************************************************************************************
+
+void RtHpiFit::setTimeBudget(qint32 p_iMSec)
+{
+    m_iTimeBudget = p_iMSec;
+}
+
+
+//*************************************************************************************************************
+
+void RtHpiFit::setGofLimit(double p_dGofLimit)
+{
+    m_dGofLimit = p_dGofLimit;
+}
+
+
+//*************************************************************************************************************
+
+void RtHpiFit::reset()
+{
+    m_matRing.setZero();
+    m_iRingPos = 0;
+    m_iNumSamples = 0;
+
+    //
+    // Start from the digitized positions if the head position is known. A zero position, which is the origin
+    // of the device inside the helmet, marks a coil whose start has to be guessed from the field.
+    //
+    m_matCoilDev = MatrixX3d::Zero(numCoils(), 3);
+    const FiffCoordTrans& t_devHeadTrans = m_pFiffInfo->dev_head_t;
+    if(m_matCoilHead.rows() == numCoils() && !t_devHeadTrans.isEmpty())
+    {
+        Matrix4d t_matHeadDev = t_devHeadTrans.from == FIFFV_COORD_DEVICE ? t_devHeadTrans.invtrans.cast<double>() : t_devHeadTrans.trans.cast<double>();
+        for(qint32 i = 0; i < numCoils(); ++i)
+            m_matCoilDev.row(i) = (t_matHeadDev.topLeftCorner<3,3>() * m_matCoilHead.row(i).transpose() + t_matHeadDev.topRightCorner<3,1>()).transpose();
+    }
+
+    m_vecGof = VectorXd::Zero(numCoils());
+    m_iNextCoil = 0;
+    m_iNumFittedCoils = 0;
+
+    m_devHeadTrans = FiffCoordTrans();
+    m_bTransValid = false;
+    m_dTransError = 0;
+}
+
+
+//*************************************************************************************************************
+
+bool RtHpiFit::update(const MatrixXd& p_matData)
+{
+    if(p_matData.rows() != m_pFiffInfo->nchan)
+    {
+        printf("RtHpiFit: block has %d rows instead of %d channels.\n", (int)p_matData.rows(), m_pFiffInfo->nchan);//ToDo throw
+        return false;
+    }
+
+    qint32 t_iNumMeg = m_vecMegIdx.size();
+    if(numCoils() == 0 || t_iNumMeg == 0)
+        return false;
+
+    //
+    // Append the MEG channels to the window; of blocks longer than the window only the end is kept
+    //
+    qint32 t_iNumNew = qMin((qint32)p_matData.cols(), m_iWindowSize);
+    qint32 t_iFirst = p_matData.cols() - t_iNumNew;
+    qint32 t_iLen1 = qMin(t_iNumNew, m_iWindowSize - m_iRingPos);
+    qint32 t_iLen2 = t_iNumNew - t_iLen1;
+
+    for(qint32 i = 0; i < t_iNumMeg; ++i)
+    {
+        m_matRing.row(i).segment(m_iRingPos, t_iLen1) = p_matData.row(m_vecMegIdx[i]).segment(t_iFirst, t_iLen1);
+        if(t_iLen2 > 0)
+            m_matRing.row(i).head(t_iLen2) = p_matData.row(m_vecMegIdx[i]).segment(t_iFirst + t_iLen1, t_iLen2);
+    }
+
+    m_iRingPos = (m_iRingPos + t_iNumNew) % m_iWindowSize;
+    m_iNumSamples = qMin(m_iNumSamples + t_iNumNew, m_iWindowSize);
+
+    if(m_iNumSamples < m_iWindowSize)
+        return false;
+
+    QElapsedTimer t_timer;
+    t_timer.start();
+
+    //
+    // Lock-in demodulation: the oldest sample is at m_iRingPos
+    //
+    MatrixXd t_matCoeffs = m_matRing.rightCols(m_iWindowSize - m_iRingPos) * m_matDemod.topRows(m_iWindowSize - m_iRingPos);
+    if(m_iRingPos > 0)
+        t_matCoeffs += m_matRing.leftCols(m_iRingPos) * m_matDemod.bottomRows(m_iRingPos);
+    t_matCoeffs = m_vecChWeight.asDiagonal() * t_matCoeffs;
+
+    //
+    // Fit the coils in turns until the budget is spent; at least one coil is fitted per block
+    //
+    m_iNumFittedCoils = 0;
+    while(m_iNumFittedCoils < numCoils())
+    {
+        if(m_iNumFittedCoils > 0 && t_timer.elapsed() >= m_iTimeBudget)
+            break;
+
+        qint32 t_iCoil = (m_iNextCoil + m_iNumFittedCoils) % numCoils();
+
+        // The cosine and sine patterns differ only by the phase of the channels; take the dominant pattern
+        MatrixX2d t_matPattern = t_matCoeffs.middleCols(2*t_iCoil, 2);
+        SelfAdjointEigenSolver<Matrix2d> t_eigSolver(t_matPattern.transpose() * t_matPattern);
+        VectorXd t_vecField = t_matPattern * t_eigSolver.eigenvectors().col(1);
+
+        fitCoil(t_iCoil, t_vecField);
+        ++m_iNumFittedCoils;
+    }
+    m_iNextCoil = (m_iNextCoil + m_iNumFittedCoils) % numCoils();
+
+    fitTransform();
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+void RtHpiFit::init()
+{
+    //
+    // MEG channels; a planar gradiometer is integrated at two points along its x-axis and weighted to a
+    // magnetometer scale (T/m * 1 cm)
+    //
+    const double t_dGradBaseline = 0.0168;
+
+    QList<qint32> t_qListMegIdx;
+    for(qint32 k = 0; k < m_pFiffInfo->nchan; ++k)
+        if(m_pFiffInfo->chs[k].kind == FIFFV_MEG_CH && !m_pFiffInfo->bads.contains(m_pFiffInfo->ch_names[k]))
+            t_qListMegIdx.append(k);
+
+    qint32 t_iNumMeg = t_qListMegIdx.size();
+    qint32 t_iNumPoints = 0;
+    for(qint32 i = 0; i < t_iNumMeg; ++i)
+        t_iNumPoints += m_pFiffInfo->chs[t_qListMegIdx[i]].unit == FIFF_UNIT_T_M ? 2 : 1;
+
+    m_vecMegIdx.resize(t_iNumMeg);
+    m_vecChWeight.resize(t_iNumMeg);
+    m_matPointPos.resize(t_iNumPoints, 3);
+    m_matPointNormal.resize(t_iNumPoints, 3);
+    m_vecPointCh.resize(t_iNumPoints);
+    m_vecPointWeight.resize(t_iNumPoints);
+
+    qint32 p = 0;
+    for(qint32 i = 0; i < t_iNumMeg; ++i)
+    {
+        const FiffChInfo& t_chInfo = m_pFiffInfo->chs[t_qListMegIdx[i]];
+        Vector3d t_vecPos = t_chInfo.loc.segment<3>(0);
+        Vector3d t_vecEx = t_chInfo.loc.segment<3>(3);
+        Vector3d t_vecEz = t_chInfo.loc.segment<3>(9);
+
+        m_vecMegIdx[i] = t_qListMegIdx[i];
+
+        if(t_chInfo.unit == FIFF_UNIT_T_M)
+        {
+            m_vecChWeight[i] = 0.01;
+            for(qint32 s = -1; s <= 1; s += 2)
+            {
+                m_matPointPos.row(p) = (t_vecPos + s * 0.5 * t_dGradBaseline * t_vecEx).transpose();
+                m_matPointNormal.row(p) = t_vecEz.transpose();
+                m_vecPointCh[p] = i;
+                m_vecPointWeight[p] = s / t_dGradBaseline;
+                ++p;
+            }
+        }
+        else
+        {
+            m_vecChWeight[i] = 1.0;
+            m_matPointPos.row(p) = t_vecPos.transpose();
+            m_matPointNormal.row(p) = t_vecEz.transpose();
+            m_vecPointCh[p] = i;
+            m_vecPointWeight[p] = 1.0;
+            ++p;
+        }
+    }
+
+    //
+    // Least squares operator of the coil frequencies and a linear drift over the window
+    //
+    qint32 t_iNumCoils = numCoils();
+    m_iWindowSize = qMax((qint32)(m_dWindowLength * m_pFiffInfo->sfreq + 0.5), 2*t_iNumCoils + 3);
+
+    MatrixXd t_matModel(m_iWindowSize, 2*t_iNumCoils + 2);
+    for(qint32 t = 0; t < m_iWindowSize; ++t)
+    {
+        double t_dTime = t / m_pFiffInfo->sfreq;
+        for(qint32 j = 0; j < t_iNumCoils; ++j)
+        {
+            t_matModel(t, 2*j) = cos(2*M_PI*m_vecCoilFreqs[j]*t_dTime);
+            t_matModel(t, 2*j+1) = sin(2*M_PI*m_vecCoilFreqs[j]*t_dTime);
+        }
+        t_matModel(t, 2*t_iNumCoils) = 1.0;
+        t_matModel(t, 2*t_iNumCoils+1) = (double)t / m_iWindowSize - 0.5;
+    }
+
+    JacobiSVD<MatrixXd> t_svd(t_matModel, ComputeThinU | ComputeThinV);
+    VectorXd t_vecSingular = t_svd.singularValues();
+    for(qint32 i = 0; i < t_vecSingular.size(); ++i)
+        t_vecSingular[i] = t_vecSingular[i] > 1e-10 * t_vecSingular[0] ? 1.0 / t_vecSingular[i] : 0.0;
+    m_matDemod = t_svd.matrixU() * t_vecSingular.asDiagonal() * t_svd.matrixV().transpose();
+
+    m_matRing.resize(t_iNumMeg, m_iWindowSize);
+
+    //
+    // Digitized coil positions, in the order of the frequencies
+    //
+    QList<Vector3d> t_qListHpiDig;
+    for(qint32 i = 0; i < m_pFiffInfo->dig.size(); ++i)
+        if(m_pFiffInfo->dig[i].kind == FIFFV_POINT_HPI)
+            t_qListHpiDig.append(Vector3d(m_pFiffInfo->dig[i].r[0], m_pFiffInfo->dig[i].r[1], m_pFiffInfo->dig[i].r[2]));
+
+    if(t_qListHpiDig.size() == t_iNumCoils)
+    {
+        m_matCoilHead.resize(t_iNumCoils, 3);
+        for(qint32 i = 0; i < t_iNumCoils; ++i)
+            m_matCoilHead.row(i) = t_qListHpiDig[i].transpose();
+    }
+
+    reset();
+}
+
+
+//*************************************************************************************************************
+
+void RtHpiFit::leadField(const Vector3d& p_vecPos, MatrixX3d& p_matLeadField) const
+{
+    p_matLeadField = MatrixX3d::Zero(m_vecMegIdx.size(), 3);
+
+    // B = mu0/4pi * (3*(m.R)R/|R|^2 - m)/|R|^3, projected on the coil normal
+    for(qint32 p = 0; p < m_matPointPos.rows(); ++p)
+    {
+        Vector3d t_vecR = m_matPointPos.row(p).transpose() - p_vecPos;
+        Vector3d t_vecN = m_matPointNormal.row(p).transpose();
+        double t_dDist2 = t_vecR.squaredNorm();
+        double t_dScale = 1e-7 * m_vecPointWeight[p] / (t_dDist2 * sqrt(t_dDist2));
+
+        p_matLeadField.row(m_vecPointCh[p]) += t_dScale * (3.0 * t_vecN.dot(t_vecR) / t_dDist2 * t_vecR - t_vecN).transpose();
+    }
+
+    p_matLeadField = m_vecChWeight.asDiagonal() * p_matLeadField;
+}
+
+
+//*************************************************************************************************************
+
+void RtHpiFit::residual(const Vector3d& p_vecPos, const VectorXd& p_vecField, VectorXd& p_vecResidual) const
+{
+    MatrixX3d t_matLeadField;
+    leadField(p_vecPos, t_matLeadField);
+
+    Vector3d t_vecMoment = (t_matLeadField.transpose() * t_matLeadField).ldlt().solve(t_matLeadField.transpose() * p_vecField);
+    p_vecResidual = p_vecField - t_matLeadField * t_vecMoment;
+}
+
+
+//*************************************************************************************************************
+
+void RtHpiFit::fitCoil(qint32 p_iCoil, const VectorXd& p_vecField)
+{
+    Vector3d t_vecPos = m_matCoilDev.row(p_iCoil).transpose();
+
+    // No previous position: start 3 cm below the sensor with the strongest signal
+    if(t_vecPos.isZero())
+    {
+        qint32 t_iMaxCh;
+        (p_vecField.cwiseAbs().cwiseQuotient(m_vecChWeight)).maxCoeff(&t_iMaxCh);
+        Vector3d t_vecSensor = m_pFiffInfo->chs[m_vecMegIdx[t_iMaxCh]].loc.segment<3>(0);
+        t_vecPos = t_vecSensor * (1.0 - 0.03 / t_vecSensor.norm());
+    }
+
+    //
+    // Levenberg-Marquardt on the position; the moment is solved linearly inside residual()
+    //
+    const double t_dStep = 1e-5;        // finite difference step in m
+    const double t_dTolerance = 1e-6;   // convergence in m
+
+    VectorXd t_vecResidual, t_vecResidualStep;
+    residual(t_vecPos, p_vecField, t_vecResidual);
+    double t_dCost = t_vecResidual.squaredNorm();
+
+    MatrixX3d t_matJacobian(p_vecField.size(), 3);
+    double t_dLambda = 1e-3;
+
+    for(qint32 t_iIter = 0; t_iIter < MaxIterations; ++t_iIter)
+    {
+        for(qint32 k = 0; k < 3; ++k)
+        {
+            Vector3d t_vecStepPos = t_vecPos;
+            t_vecStepPos[k] += t_dStep;
+            residual(t_vecStepPos, p_vecField, t_vecResidualStep);
+            t_matJacobian.col(k) = (t_vecResidualStep - t_vecResidual) / t_dStep;
+        }
+
+        Matrix3d t_matJtJ = t_matJacobian.transpose() * t_matJacobian;
+        Vector3d t_vecJtr = t_matJacobian.transpose() * t_vecResidual;
+
+        bool t_bConverged = false;
+        while(t_dLambda < 1e6)
+        {
+            Matrix3d t_matSys = t_matJtJ;
+            t_matSys.diagonal() *= 1.0 + t_dLambda;
+            Vector3d t_vecDelta = -t_matSys.ldlt().solve(t_vecJtr);
+
+            VectorXd t_vecResidualNew;
+            residual(t_vecPos + t_vecDelta, p_vecField, t_vecResidualNew);
+            double t_dCostNew = t_vecResidualNew.squaredNorm();
+
+            if(t_dCostNew < t_dCost)
+            {
+                t_vecPos += t_vecDelta;
+                t_vecResidual = t_vecResidualNew;
+                t_dCost = t_dCostNew;
+                t_dLambda = qMax(t_dLambda * 0.1, 1e-9);
+                t_bConverged = t_vecDelta.norm() < t_dTolerance;
+                break;
+            }
+
+            t_dLambda *= 10.0;
+            t_bConverged = t_vecDelta.norm() < t_dTolerance;
+            if(t_bConverged)
+                break;
+        }
+
+        if(t_bConverged || t_dLambda >= 1e6)
+            break;
+    }
+
+    double t_dSignal = p_vecField.squaredNorm();
+
+    m_matCoilDev.row(p_iCoil) = t_vecPos.transpose();
+    m_vecGof[p_iCoil] = t_dSignal > 0 ? 1.0 - t_dCost / t_dSignal : 0.0;
+}
+
+
+//*************************************************************************************************************
+
+void RtHpiFit::fitTransform()
+{
+    m_bTransValid = false;
+
+    if(m_matCoilHead.rows() != numCoils())
+        return;
+
+    QList<qint32> t_qListGood;
+    for(qint32 i = 0; i < numCoils(); ++i)
+        if(m_vecGof[i] >= m_dGofLimit)
+            t_qListGood.append(i);
+
+    if(t_qListGood.size() < 3)
+        return;
+
+    //
+    // Least squares rotation and translation from head to device coordinates (Kabsch)
+    //
+    Vector3d t_vecHeadMean = Vector3d::Zero(), t_vecDevMean = Vector3d::Zero();
+    for(qint32 i = 0; i < t_qListGood.size(); ++i)
+    {
+        t_vecHeadMean += m_matCoilHead.row(t_qListGood[i]).transpose();
+        t_vecDevMean += m_matCoilDev.row(t_qListGood[i]).transpose();
+    }
+    t_vecHeadMean /= t_qListGood.size();
+    t_vecDevMean /= t_qListGood.size();
+
+    Matrix3d t_matCov = Matrix3d::Zero();
+    for(qint32 i = 0; i < t_qListGood.size(); ++i)
+        t_matCov += (m_matCoilHead.row(t_qListGood[i]).transpose() - t_vecHeadMean) * (m_matCoilDev.row(t_qListGood[i]) - t_vecDevMean.transpose());
+
+    JacobiSVD<Matrix3d> t_svd(t_matCov, ComputeFullU | ComputeFullV);
+    Matrix3d t_matCorrection = Matrix3d::Identity();
+    t_matCorrection(2,2) = (t_svd.matrixV() * t_svd.matrixU().transpose()).determinant() < 0 ? -1.0 : 1.0;
+
+    Matrix3d t_matRot = t_svd.matrixV() * t_matCorrection * t_svd.matrixU().transpose();
+    Vector3d t_vecTrans = t_vecDevMean - t_matRot * t_vecHeadMean;
+
+    m_dTransError = 0;
+    for(qint32 i = 0; i < t_qListGood.size(); ++i)
+        m_dTransError += (t_matRot * m_matCoilHead.row(t_qListGood[i]).transpose() + t_vecTrans - m_matCoilDev.row(t_qListGood[i]).transpose()).norm();
+    m_dTransError /= t_qListGood.size();
+
+    Matrix4d t_matHeadDev = Matrix4d::Identity();
+    t_matHeadDev.topLeftCorner<3,3>() = t_matRot;
+    t_matHeadDev.topRightCorner<3,1>() = t_vecTrans;
+
+    Matrix4d t_matDevHead = Matrix4d::Identity();
+    t_matDevHead.topLeftCorner<3,3>() = t_matRot.transpose();
+    t_matDevHead.topRightCorner<3,1>() = -t_matRot.transpose() * t_vecTrans;
+
+    m_devHeadTrans.from = FIFFV_COORD_DEVICE;
+    m_devHeadTrans.to = FIFFV_COORD_HEAD;
+    m_devHeadTrans.trans = t_matDevHead.cast<float>();
+    m_devHeadTrans.invtrans = t_matHeadDev.cast<float>();
+    m_bTransValid = true;
+}
@@ -0,0 +1,355 @@
+//=============================================================================================================
+/**
+* @file     rthpifit.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>;
+* @version  1.0
+* @date     January, 2015
+*
+* @section  LICENSE
+*
+* Copyright (C) 2015, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    RtHpiFit class declaration
+*
+*/
+
+
+#ifndef RTHPIFIT_H
+#define RTHPIFIT_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "rtinv_global.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// FIFF INCLUDES
+//=============================================================================================================
+
+#include <fiff/fiff_info.h>
+#include <fiff/fiff_coord_trans.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QSharedPointer>
+#include <QVector>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE RTINVLIB
+//=============================================================================================================
+
+namespace RTINVLIB
+{
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+using namespace FIFFLIB;
+
+
+//=============================================================================================================
+/**
+* Continuous head position tracking from the signals of the HPI coils. Every coil is driven at its own frequency.
+* The MEG channels of the most recent window are fitted with sines and cosines of all coil frequencies plus a
+* linear drift (lock-in demodulation); the dominant amplitude pattern of each frequency is then fitted with a
+* magnetic dipole in device coordinates. The dipole position is found with Levenberg-Marquardt iterations which
+* start from the previous fit, the moment is solved linearly for every position. Finally the rigid transform
+* between the digitized coil positions (head coordinates) and the fitted ones is computed.
+*
+* Each update() is given a time budget. Coils which could not be fitted within the budget keep their previous
+* position and are fitted first with the next block.
+*
+* @brief Real-time continuous HPI coil fitting
+*/
+class RTINVSHARED_EXPORT RtHpiFit
+{
+public:
+    typedef QSharedPointer<RtHpiFit> SPtr;             /**< Shared pointer type for RtHpiFit. */
+    typedef QSharedPointer<const RtHpiFit> ConstSPtr;  /**< Const shared pointer type for RtHpiFit. */
+
+    //=========================================================================================================
+    /**
+    * Creates the coil fitting. The coil positions in head coordinates are taken from the HPI digitization
+    * points, in the order of the coil frequencies.
+    *
+    * @param[in] p_pFiffInfo        Fiff measurement info, which provides the MEG sensors and the digitization.
+    * @param[in] p_vecCoilFreqs     Frequencies of the HPI coils in Hz.
+    * @param[in] p_dWindowLength    Length of the demodulation window in seconds.
+    */
+    RtHpiFit(FiffInfo::SPtr p_pFiffInfo, const QVector<double>& p_vecCoilFreqs, double p_dWindowLength = 0.2);
+
+    //=========================================================================================================
+    /**
+    * Sets the coil positions in head coordinates, if they should not be taken from the digitization.
+    *
+    * @param[in] p_matCoilHead      Coil positions in head coordinates in m, ncoils x 3.
+    */
+    void setCoilPositions(const MatrixX3d& p_matCoilHead);
+
+    //=========================================================================================================
+    /**
+    * Sets the time which may be spent for the coil fits in one update() call.
+    *
+    * @param[in] p_iMSec            Time budget in ms.
+    */
+    void setTimeBudget(qint32 p_iMSec);
+
+    //=========================================================================================================
+    /**
+    * Sets the limit of the goodness of fit below which a coil is not used for the head position.
+    *
+    * @param[in] p_dGofLimit        Goodness of fit limit, between 0 and 1.
+    */
+    void setGofLimit(double p_dGofLimit);
+
+    //=========================================================================================================
+    /**
+    * Discards the buffered samples and the previous fits. The next fits start from the digitized positions.
+    */
+    void reset();
+
+    //=========================================================================================================
+    /**
+    * Appends a block to the demodulation window and fits the coils once the window is filled.
+    *
+    * @param[in] p_matData          Raw block, nchan x samples.
+    *
+    * @return true if the coils were fitted.
+    */
+    bool update(const MatrixXd& p_matData);
+
+    //=========================================================================================================
+    /**
+    * Returns the number of coils.
+    *
+    * @return the number of coils.
+    */
+    inline qint32 numCoils() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the number of coils which were fitted by the last update() call.
+    *
+    * @return the number of fitted coils.
+    */
+    inline qint32 numFittedCoils() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the fitted coil positions.
+    *
+    * @return the coil positions in device coordinates in m, ncoils x 3.
+    */
+    inline const MatrixX3d& coilPositions() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the goodness of fit of the coils, 1 - residual variance / signal variance.
+    *
+    * @return the goodness of fit of each coil.
+    */
+    inline const VectorXd& goodnessOfFit() const;
+
+    //=========================================================================================================
+    /**
+    * Returns whether a transform could be computed from at least three coils which fit well.
+    *
+    * @return true if devHeadTrans() is valid.
+    */
+    inline bool isTransValid() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the estimated device to head transform.
+    *
+    * @return the device to head transform.
+    */
+    inline const FiffCoordTrans& devHeadTrans() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the mean distance between the transformed digitized positions and the fitted positions of the
+    * coils which were used for the transform.
+    *
+    * @return the transform error in m.
+    */
+    inline double transError() const;
+
+private:
+    //=========================================================================================================
+    /**
+    * Sets up the integration points of the MEG channels and the demodulation operator.
+    */
+    void init();
+
+    //=========================================================================================================
+    /**
+    * Computes the lead field of a unit magnetic dipole for all MEG channels.
+    *
+    * @param[in] p_vecPos           Position of the dipole in device coordinates.
+    * @param[out] p_matLeadField    Weighted lead field, nmeg x 3.
+    */
+    void leadField(const Vector3d& p_vecPos, MatrixX3d& p_matLeadField) const;
+
+    //=========================================================================================================
+    /**
+    * Returns the residual of the best fitting dipole at a position.
+    *
+    * @param[in] p_vecPos           Position of the dipole in device coordinates.
+    * @param[in] p_vecField         Weighted amplitude pattern, nmeg.
+    * @param[out] p_vecResidual     The residual, nmeg.
+    */
+    void residual(const Vector3d& p_vecPos, const VectorXd& p_vecField, VectorXd& p_vecResidual) const;
+
+    //=========================================================================================================
+    /**
+    * Fits one coil, starting from its current position.
+    *
+    * @param[in] p_iCoil            The coil.
+    * @param[in] p_vecField         Weighted amplitude pattern, nmeg.
+    */
+    void fitCoil(qint32 p_iCoil, const VectorXd& p_vecField);
+
+    //=========================================================================================================
+    /**
+    * Computes the device to head transform from the coils whose goodness of fit reaches the limit.
+    */
+    void fitTransform();
+
+    enum { MaxIterations = 20 };        /**< Maximal number of Levenberg-Marquardt iterations per coil and block. */
+
+    FiffInfo::SPtr  m_pFiffInfo;        /**< Fiff measurement info. */
+
+    VectorXd    m_vecCoilFreqs;         /**< Frequencies of the coils in Hz. */
+    double      m_dWindowLength;        /**< Length of the demodulation window in s. */
+    qint32      m_iWindowSize;          /**< Length of the demodulation window in samples. */
+    qint32      m_iTimeBudget;          /**< Time budget of the coil fits per block in ms. */
+    double      m_dGofLimit;            /**< Goodness of fit limit of the coils which are used for the transform. */
+
+    VectorXi    m_vecMegIdx;            /**< Rows of the good MEG channels in the raw block. */
+    VectorXd    m_vecChWeight;          /**< Weight of each MEG channel, which brings gradiometers to the scale of magnetometers. */
+    MatrixX3d   m_matPointPos;          /**< Integration points of the MEG channels in device coordinates. */
+    MatrixX3d   m_matPointNormal;       /**< Normals of the integration points. */
+    VectorXi    m_vecPointCh;           /**< MEG channel of each integration point. */
+    VectorXd    m_vecPointWeight;       /**< Weight of each integration point. */
+
+    MatrixXd    m_matDemod;             /**< Least squares operator of the sines, cosines and drift, window x (2*ncoils+2). */
+    MatrixXd    m_matRing;              /**< The most recent MEG samples, nmeg x window, in circular order. */
+    qint32      m_iRingPos;             /**< Column of m_matRing which is written next. */
+    qint32      m_iNumSamples;          /**< Number of samples in m_matRing. */
+
+    MatrixX3d   m_matCoilHead;          /**< Coil positions in head coordinates. */
+    MatrixX3d   m_matCoilDev;           /**< Fitted coil positions in device coordinates. */
+    VectorXd    m_vecGof;               /**< Goodness of fit of each coil. */
+    qint32      m_iNextCoil;            /**< Coil which is fitted first with the next block. */
+    qint32      m_iNumFittedCoils;      /**< Number of coils fitted by the last update(). */
+
+    FiffCoordTrans  m_devHeadTrans;     /**< Estimated device to head transform. */
+    bool        m_bTransValid;          /**< Whether m_devHeadTrans is valid. */
+    double      m_dTransError;          /**< Mean distance of the coils used for the transform in m. */
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+inline qint32 RtHpiFit::numCoils() const
+{
+    return m_vecCoilFreqs.size();
+}
+
+
+//*************************************************************************************************************
+
+inline qint32 RtHpiFit::numFittedCoils() const
+{
+    return m_iNumFittedCoils;
+}
+
+
+//*************************************************************************************************************
+
+inline const MatrixX3d& RtHpiFit::coilPositions() const
+{
+    return m_matCoilDev;
+}
+
+
+//*************************************************************************************************************
+
+inline const VectorXd& RtHpiFit::goodnessOfFit() const
+{
+    return m_vecGof;
+}
+
+
+//*************************************************************************************************************
+
+inline bool RtHpiFit::isTransValid() const
+{
+    return m_bTransValid;
+}
+
+
+//*************************************************************************************************************
+
+inline const FiffCoordTrans& RtHpiFit::devHeadTrans() const
+{
+    return m_devHeadTrans;
+}
+
+
+//*************************************************************************************************************
+
+inline double RtHpiFit::transError() const
+{
+    return m_dTransError;
+}
+
+} // NAMESPACE
+
+#endif // RTHPIFIT_H
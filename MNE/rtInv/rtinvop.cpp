@@ -51,12 +51,22 @@
 #include <QDebug>
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Eigenvalues>
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // USED NAMESPACES
 //=============================================================================================================
 
 using namespace RTINVLIB;
+using namespace UTILSLIB;
+
 
 //*************************************************************************************************************
 //=============================================================================================================
@@ -111,19 +121,118 @@ void RtInvOp::run()
 {
     m_bIsRunning = true;
 
+    // Restrict forward solution as necessary for MEG
+    m_fwdMeg = m_pFwd->pick_types(true, false);
+
     while(m_bIsRunning)
     {
+        // Only the most recent noise covariance is of interest
+        bool t_bHasNoiseCov = false;
+        FiffCov t_noiseCov;
+
+        mutex.lock();
         if(m_vecNoiseCov.size() > 0)
         {
-            // Restrict forward solution as necessary for MEG
-            MNEForwardSolution t_forwardMeg = m_pFwd->pick_types(true, false);
+            t_noiseCov = m_vecNoiseCov.last();
+            m_vecNoiseCov.clear();
+            t_bHasNoiseCov = true;
+        }
+        mutex.unlock();
+
+        if(t_bHasNoiseCov)
+        {
+            MNEInverseOperator::SPtr t_invOpMeg = m_pInvOp ? updateInverseOperator(t_noiseCov) : computeInverseOperator(t_noiseCov);
+            if(t_invOpMeg)
+                emit invOperatorCalculated(t_invOpMeg);
+        }
+        else
+            msleep(10);
+    }
+}
+
+
+//*************************************************************************************************************
+
+MNEInverseOperator::SPtr RtInvOp::computeInverseOperator(const FiffCov &p_noiseCov)
+{
+    // The picked gain and its channels are cached as the noise covariance independent parts
+    m_pInvOp = MNEInverseOperator::SPtr(new MNEInverseOperator(MNEInverseOperator::make_inverse_operator(*m_pFiffInfo.data(), m_fwdMeg, p_noiseCov, m_matGain, m_qListChNames, 0.2f, 0.8f, false, true, MNEInverseOperator::GRAM_EIG)));
+    if(m_matGain.size() == 0)
+    {
+        printf("RtInvOp: inverse operator could not be computed.\n");//ToDo throw
+        m_pInvOp.clear();
+        return m_pInvOp;
+    }
 
-            mutex.lock();
-            MNEInverseOperator::SPtr t_invOpMeg(new MNEInverseOperator(*m_pFiffInfo.data(), t_forwardMeg, m_vecNoiseCov[0], 0.2f, 0.8f));
-            m_vecNoiseCov.pop_front();
-            mutex.unlock();
+    m_vecSourceCov = m_pInvOp->source_cov.constData()->data.col(0);
 
-            emit invOperatorCalculated(t_invOpMeg);
+    // G*R*G' -> only the lower triangle is formed
+    MatrixXd t_matWeightedGain = m_matGain * m_vecSourceCov.cwiseSqrt().asDiagonal();
+    m_matGRGt = MatrixXd::Zero(m_matGain.rows(), m_matGain.rows());
+    m_matGRGt.selfadjointView<Lower>().rankUpdate(t_matWeightedGain);
+    m_matGRGt.triangularView<StrictlyUpper>() = m_matGRGt.transpose();
+
+    return m_pInvOp;
+}
+
+
+//*************************************************************************************************************
+
+MNEInverseOperator::SPtr RtInvOp::updateInverseOperator(const FiffCov &p_noiseCov)
+{
+    QStringList t_qListChNames = m_fwdMeg.prepare_ch_names(*m_pFiffInfo.data(), p_noiseCov);
+    if(t_qListChNames != m_qListChNames)
+    {
+        printf("RtInvOp: channel selection changed, recomputing the inverse operator.\n");
+        return computeInverseOperator(p_noiseCov);
+    }
+
+    FiffCov t_noiseCov;
+    MatrixXd t_matWhitener;
+    qint32 t_iNumNonZero;
+    MNEForwardSolution::prepare_whitener(*m_pFiffInfo.data(), p_noiseCov, t_qListChNames, false, t_noiseCov, t_matWhitener, t_iNumNonZero);
+
+    // Whitened W*G*R*G'*W' and trace adjustment of the source covariance
+    MatrixXd t_matGram = t_matWhitener * m_matGRGt * t_matWhitener.transpose();
+    double t_dScaling = (double)t_iNumNonZero / t_matGram.trace();
+    t_matGram *= t_dScaling;
+
+    VectorXd t_vecSourceCov = m_vecSourceCov * t_dScaling;
+
+    // Decompose the whitened and weighted lead field: A = W*G*R^(1/2) = U*S*V'
+    SelfAdjointEigenSolver<MatrixXd> t_eigSolver(t_matGram);
+    VectorXd t_vecSing = t_eigSolver.eigenvalues().reverse().cwiseMax(0.0).cwiseSqrt();
+    MatrixXd t_matU = t_eigSolver.eigenvectors().rowwise().reverse();
+
+    // V = A'*U*S^-1 = R^(1/2)*G'*(W'*U*S^-1)
+    MatrixXd t_matWU = t_matWhitener.transpose() * t_matU;
+    // The Gram route resolves singular values only down to about sqrt(eps) * s(0), see MNEMath::svd_gram
+    double t_dThreshold = t_vecSing.size() > 0 ? t_vecSing[0] * MNEMath::SvdGramTolerance : 0.0;
+    for(qint32 i = 0; i < t_vecSing.size(); ++i)
+    {
+        if(t_vecSing[i] > t_dThreshold)
+            t_matWU.col(i) /= t_vecSing[i];
+        else
+        {
+            t_vecSing[i] = 0.0;
+            t_matWU.col(i).setZero();
         }
     }
+    MatrixXd t_matV = t_vecSourceCov.cwiseSqrt().asDiagonal() * (m_matGain.transpose() * t_matWU);
+
+    MNEInverseOperator::SPtr t_pInvOp(new MNEInverseOperator(*m_pInvOp.data()));
+
+    t_pInvOp->eigen_fields = FiffNamedMatrix::SDPtr(new FiffNamedMatrix(t_matU.cols(), t_matU.rows(), defaultQStringList, t_qListChNames, t_matU.transpose()));
+    t_pInvOp->eigen_leads = FiffNamedMatrix::SDPtr(new FiffNamedMatrix(t_matV.rows(), t_matV.cols(), defaultQStringList, defaultQStringList, t_matV));
+    t_pInvOp->sing = t_vecSing;
+
+    FiffCov::SDPtr t_pSourceCov(new FiffCov(*m_pInvOp->source_cov.constData()));
+    t_pSourceCov->data.col(0) = t_vecSourceCov;
+    t_pInvOp->source_cov = t_pSourceCov;
+    t_pInvOp->depth_prior = m_pInvOp->depth_prior;
+    t_pInvOp->noise_cov = FiffCov::SDPtr(new FiffCov(t_noiseCov));
+
+    printf("RtInvOp: updated inverse operator, largest singular value = %f\n", t_vecSing.size() > 0 ? t_vecSing[0] : 0.0);
+
+    return t_pInvOp;
 }
@@ -169,6 +169,29 @@ protected:
     virtual void run();
 
 private:
+    //=========================================================================================================
+    /**
+    * Computes a full inverse operator for the given noise covariance and caches all parts which do not
+    * depend on the noise covariance: the picked gain matrix G, the source covariance R and G*R*G'.
+    *
+    * @param[in] p_noiseCov     Noise covariance estimation
+    *
+    * @return the inverse operator, NULL if it could not be computed
+    */
+    MNEInverseOperator::SPtr computeInverseOperator(const FiffCov &p_noiseCov);
+
+    //=========================================================================================================
+    /**
+    * Updates the cached inverse operator to a new noise covariance. Only the whitener dependent steps are
+    * done: whitening of the cached G*R*G', trace normalization and the eigendecomposition of the resulting
+    * nchan x nchan matrix. Falls back to computeInverseOperator if the channel selection changed.
+    *
+    * @param[in] p_noiseCov     Noise covariance estimation
+    *
+    * @return the inverse operator
+    */
+    MNEInverseOperator::SPtr updateInverseOperator(const FiffCov &p_noiseCov);
+
     QMutex      mutex;                  /**< Provides access serialization between threads. */
     bool        m_bIsRunning;           /**< Whether RtInv is running. */
 
@@ -176,6 +199,13 @@ private:
 
     FiffInfo::SPtr m_pFiffInfo;         /**< The fiff measurement information. */
     MNEForwardSolution::SPtr m_pFwd;    /**< The forward solution. */
+
+    MNEForwardSolution m_fwdMeg;        /**< The MEG part of the forward solution. */
+    MNEInverseOperator::SPtr m_pInvOp;  /**< The last full inverse operator, used as template for the updates. */
+    QStringList m_qListChNames;         /**< Channels of the cached gain matrix. */
+    MatrixXd    m_matGain;              /**< The cached, not whitened gain matrix G. */
+    VectorXd    m_vecSourceCov;         /**< The cached source covariance R of m_pInvOp. */
+    MatrixXd    m_matGRGt;              /**< The cached G*R*G'. */
 };
 
 //*************************************************************************************************************
@@ -53,6 +53,7 @@
 //=============================================================================================================
 
 #include <QDebug>
+#include <QMutexLocker>
 
 
 //*************************************************************************************************************
@@ -75,6 +76,12 @@ RtNoise::RtNoise(qint32 p_iMaxSamples, FiffInfo::SPtr p_pFiffInfo, qint32 p_data
 , m_pFiffInfo(p_pFiffInfo)
 , m_dataLength(p_dataLen)
 , m_bIsRunning(false)
+, m_spectrumMode(BatchSpectrum)
+, m_newSpectrumMode(BatchSpectrum)
+, m_iNumRingSamples(0)
+, m_iNextSegmentEnd(0)
+, m_iMaxSegments(0)
+, m_iSegmentsSinceRenorm(0)
 {
     qRegisterMetaType<Eigen::MatrixXd>("Eigen::MatrixXd");
     //qRegisterMetaType<QVector<double>>("QVector<double>");
@@ -83,13 +90,8 @@ RtNoise::RtNoise(qint32 p_iMaxSamples, FiffInfo::SPtr p_pFiffInfo, qint32 p_data
 
     SendDataToBuffer = true;
 
-    m_fWin.clear();
-
-    //create a hanning window
-    m_fWin = hanning(m_iFFTlength,0);
-
-    qDebug()<<"Hanning window is created.";
-
+    //Welch estimate with half overlapping hanning windowed segments
+    m_welchPsd.setParameters(m_iFFTlength, m_Fs, 0.5);
 }
 
 
@@ -104,52 +106,6 @@ RtNoise::~RtNoise()
 
 //*************************************************************************************************************
 
-QVector <float> RtNoise::hanning(int N, short itype)
-{
-    int half, i, idx, n;
-    QVector <float> w(N,0.0);
-
-    if(itype==1)    //periodic function
-        n = N-1;
-    else
-        n = N;
-
-    if(n%2==0)
-    {
-        half = n/2;
-        for(i=0; i<half; i++) //CALC_HANNING   Calculates Hanning window samples.
-            w[i] = 0.5 * (1 - cos(2*3.14159265*(i+1) / (n+1)));
-
-        idx = half-1;
-        for(i=half; i<n; i++) {
-            w[i] = w[idx];
-            idx--;
-        }
-    }
-    else
-    {
-        half = (n+1)/2;
-        for(i=0; i<half; i++) //CALC_HANNING   Calculates Hanning window samples.
-            w[i] = 0.5 * (1 - cos(23.14159265*(i+1) / (n+1)));
-
-        idx = half-2;
-        for(i=half; i<n; i++) {
-            w[i] = w[idx];
-            idx--;
-        }
-    }
-
-    if(itype==1)    //periodic function
-    {
-        for(i=N-1; i>=1; i--)
-            w[i] = w[i-1];
-        w[0] = 0.0;
-    }
-    return(w);
-}
-
-//*************************************************************************************************************
-
 void RtNoise::append(const MatrixXd &p_DataSegment)
 {
     if(!m_pRawMatrixBuffer)
@@ -160,6 +116,15 @@ void RtNoise::append(const MatrixXd &p_DataSegment)
 }
 
 
+//*************************************************************************************************************
+
+void RtNoise::setSpectrumMode(SpectrumMode p_mode)
+{
+    QMutexLocker locker(&mutex);
+    m_newSpectrumMode = p_mode;
+}
+
+
 //*************************************************************************************************************
 
 bool RtNoise::start()
@@ -201,9 +166,20 @@ void RtNoise::run()
     {
         if(m_pRawMatrixBuffer)
         {
-            MatrixXd block = m_pRawMatrixBuffer->pop();
+            // Process the block in place
+            Map<const MatrixXd> block = m_pRawMatrixBuffer->acquireReadSlot();
+            if(block.size() == 0)
+                continue;
+
+            mutex.lock();
+            if(m_spectrumMode != m_newSpectrumMode)
+            {
+                m_spectrumMode = m_newSpectrumMode;
+                FirstStart = true;
+            }
+            mutex.unlock();
 
-            if(FirstStart){
+            if(FirstStart || block.cols() != BlockSize){
                 //init the circ buffer and parameters
                 if(m_dataLength < 0) m_dataLength = 10;
                 NumOfBlocks = m_dataLength;//60;
@@ -214,11 +190,29 @@ void RtNoise::run()
 
                 BlockIndex = 0;
                 FirstStart = false;
+
+                resetSlidingSpectrum();
+                SendDataToBuffer = true;
             }
+
+            if(m_spectrumMode == SlidingSpectrum)
+            {
+                bool t_bUpdated = updateSlidingSpectrum(block);
+
+                m_pRawMatrixBuffer->release();
+
+                if(t_bUpdated)
+                {
+                    MatrixXd t_psdx = (10.0/log(10.0))*(m_matSpectrumSum / m_qListSegmentSpectra.size()).array().log();
+                    emit SpecCalculated(t_psdx);
+                }
+                continue;
+            }
+
             //concate blocks
-            for (int i=0; i< Sensors; i++)
-                for (int j=0; j< BlockSize; j++)
-                    CircBuf(i,j+BlockIndex*BlockSize) = block(i,j);
+            CircBuf.block(0, BlockIndex*BlockSize, Sensors, BlockSize) = block;
+
+            m_pRawMatrixBuffer->release();
 
 
             BlockIndex ++;
@@ -230,67 +224,11 @@ void RtNoise::run()
                 //stop collect block and start to calculate the spectrum
                 BlockIndex = 0;
 
-                MatrixXd sum_psdx = MatrixXd::Zero(Sensors,m_iFFTlength/2+1);
-
-                int nb = floor(NumOfBlocks*BlockSize/m_iFFTlength)+1;
-                qDebug()<<"nb"<<nb<<"NumOfBlocks"<<NumOfBlocks<<"BlockSize"<<BlockSize;
-                MatrixXd t_mat(Sensors,m_iFFTlength);
-                MatrixXd t_psdx(Sensors,m_iFFTlength/2+1);
-                for (int n = 0; n<nb; n++){
-                    //collect a data block with data length of m_iFFTlength;
-                    if(n==nb-1)
-                    {
-                        for(qint32 ii=0; ii<Sensors; ii++)
-                        for(qint32 jj=0; jj<m_iFFTlength; jj++)
-                            if(jj+n*m_iFFTlength<NumOfBlocks*BlockSize)
-                                t_mat(ii,jj) = CircBuf(ii,jj+n*m_iFFTlength);
-                            else
-                                t_mat(ii,jj) = 0.0;
-
-                    }
-                    else
-                    {
-                        for(qint32 ii=0; ii<Sensors; ii++)
-                        for(qint32 jj=0; jj<m_iFFTlength; jj++)
-                            t_mat(ii,jj) = CircBuf(ii,jj+n*m_iFFTlength);
-                    }
-
-                    //FFT calculation by row
-                    for(qint32 i = 0; i < t_mat.rows(); i++){
-                        RowVectorXd data;
-
-                        data = t_mat.row(i);
-
-                        //zero-pad data to m_iFFTlength
-                        RowVectorXd t_dataZeroPad = RowVectorXd::Zero(m_iFFTlength);
-                        t_dataZeroPad.head(data.cols()) = data;
-
-                        for (qint32 lk = 0; lk<m_iFFTlength; lk++)
-                            t_dataZeroPad[lk] = t_dataZeroPad[lk]*m_fWin[lk];
-
-                        //generate fft object
-                        Eigen::FFT<double> fft;
-                        fft.SetFlag(fft.HalfSpectrum);
-
-                        //fft-transform data sequence
-                        RowVectorXcd t_freqData(m_iFFTlength/2+1);
-                        fft.fwd(t_freqData,t_dataZeroPad);
-
-                        // calculate spectrum from FFT
-                        for(qint32 j=0; j<m_iFFTlength/2+1;j++)
-                        {
-                            double mag_abs = sqrt(t_freqData(j).real()* t_freqData(j).real() +  t_freqData(j).imag()*t_freqData(j).imag());
-                            double spower = (1.0/(m_Fs*m_iFFTlength))* mag_abs;
-                            if (j>0&&j<m_iFFTlength/2) spower = 2.0*spower;
-                            sum_psdx(i,j) = sum_psdx(i,j) + spower;
-                        }
-                     }//row computing is done
-                }//nb
+                MatrixXd t_psdx = m_welchPsd.compute(CircBuf);
+                qDebug()<<"nb"<<m_welchPsd.numSegments(CircBuf.cols())<<"NumOfBlocks"<<NumOfBlocks<<"BlockSize"<<BlockSize;
 
                 //DB-calculation
-                for(qint32 ii=0; ii<Sensors; ii++)
-                    for(qint32 jj=0; jj<m_iFFTlength/2+1; jj++)
-                        t_psdx(ii,jj) = 10.0*log10(sum_psdx(ii,jj)/nb);
+                t_psdx = (10.0/log(10.0))*t_psdx.array().log();
 
                 qDebug()<<"Send spectrum to Noise Estimator";
                 emit SpecCalculated(t_psdx); //send back the spectrum result
@@ -306,3 +244,72 @@ void RtNoise::run()
 
 }
 
+
+
+//*************************************************************************************************************
+
+void RtNoise::resetSlidingSpectrum()
+{
+    m_matSampleRing = MatrixXd::Zero(Sensors, m_iFFTlength + BlockSize);
+    m_iNumRingSamples = 0;
+    m_iNextSegmentEnd = m_iFFTlength;
+    m_iMaxSegments = m_welchPsd.numSegments(NumOfBlocks*BlockSize);
+    m_iSegmentsSinceRenorm = 0;
+    m_qListSegmentSpectra.clear();
+    m_matSpectrumSum = MatrixXd::Zero(Sensors, m_iFFTlength/2+1);
+}
+
+
+//*************************************************************************************************************
+
+bool RtNoise::updateSlidingSpectrum(const Ref<const MatrixXd>& p_matBlock)
+{
+    qint32 t_iRingSize = m_matSampleRing.cols();
+
+    //
+    // Append the block to the ring
+    //
+    qint32 t_iPos = m_iNumRingSamples % t_iRingSize;
+    qint32 t_iFirstPart = qMin((qint32)p_matBlock.cols(), t_iRingSize - t_iPos);
+    m_matSampleRing.block(0, t_iPos, Sensors, t_iFirstPart) = p_matBlock.leftCols(t_iFirstPart);
+    if(t_iFirstPart < p_matBlock.cols())
+        m_matSampleRing.leftCols(p_matBlock.cols() - t_iFirstPart) = p_matBlock.rightCols(p_matBlock.cols() - t_iFirstPart);
+    m_iNumRingSamples += p_matBlock.cols();
+
+    //
+    // Spectra of the completed segments
+    //
+    bool t_bUpdated = false;
+    MatrixXd t_matSegment(Sensors, m_iFFTlength);
+    while(m_iNextSegmentEnd <= m_iNumRingSamples)
+    {
+        t_iPos = (m_iNextSegmentEnd - m_iFFTlength) % t_iRingSize;
+        t_iFirstPart = qMin(m_iFFTlength, t_iRingSize - t_iPos);
+        t_matSegment.leftCols(t_iFirstPart) = m_matSampleRing.block(0, t_iPos, Sensors, t_iFirstPart);
+        if(t_iFirstPart < m_iFFTlength)
+            t_matSegment.rightCols(m_iFFTlength - t_iFirstPart) = m_matSampleRing.leftCols(m_iFFTlength - t_iFirstPart);
+
+        m_qListSegmentSpectra.append(m_welchPsd.compute(t_matSegment));
+        m_matSpectrumSum += m_qListSegmentSpectra.last();
+
+        if(m_qListSegmentSpectra.size() > m_iMaxSegments)
+        {
+            m_matSpectrumSum -= m_qListSegmentSpectra.first();
+            m_qListSegmentSpectra.removeFirst();
+        }
+
+        // remove the accumulated rounding errors of the additions and subtractions
+        if(++m_iSegmentsSinceRenorm >= RenormInterval)
+        {
+            m_matSpectrumSum.setZero();
+            for(qint32 i = 0; i < m_qListSegmentSpectra.size(); ++i)
+                m_matSpectrumSum += m_qListSegmentSpectra[i];
+            m_iSegmentsSinceRenorm = 0;
+        }
+
+        m_iNextSegmentEnd += m_welchPsd.step();
+        t_bUpdated = true;
+    }
+
+    return t_bUpdated;
+}
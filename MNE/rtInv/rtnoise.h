@@ -62,6 +62,14 @@
 #include <generics/circularmatrixbuffer.h>
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// UTILS INCLUDES
+//=============================================================================================================
+
+#include <utils/welchpsd.h>
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // QT INCLUDES
@@ -69,6 +77,7 @@
 
 #include <QThread>
 #include <QMutex>
+#include <QList>
 #include <QSharedPointer>
 
 
@@ -78,7 +87,6 @@
 //=============================================================================================================
 
 #include <Eigen/Core>
-#include <unsupported/Eigen/FFT>
 
 //*************************************************************************************************************
 //=============================================================================================================
@@ -97,6 +105,7 @@ namespace RTINVLIB
 using namespace Eigen;
 using namespace IOBuffer;
 using namespace FIFFLIB;
+using namespace UTILSLIB;
 
 
 //=============================================================================================================
@@ -112,6 +121,16 @@ public:
     typedef QSharedPointer<RtNoise> SPtr;             /**< Shared pointer type for RtNoise. */
     typedef QSharedPointer<const RtNoise> ConstSPtr;  /**< Const shared pointer type for RtNoise. */
 
+    //=========================================================================================================
+    /**
+    * Spectrum estimation modes.
+    */
+    enum SpectrumMode
+    {
+        BatchSpectrum,      /**< Collects the data length, estimates the spectrum and collects anew (default). */
+        SlidingSpectrum     /**< Updates the spectrum of the last data length with every block. */
+    };
+
     //=========================================================================================================
     /**
     * Creates the real-time covariance estimation object.
@@ -136,6 +155,14 @@ public:
     */
     void append(const MatrixXd &p_DataSegment);
 
+    //=========================================================================================================
+    /**
+    * Sets the spectrum estimation mode. The estimate is restarted with the next block.
+    *
+    * @param[in] p_mode     new spectrum estimation mode
+    */
+    void setSpectrumMode(SpectrumMode p_mode);
+
     //=========================================================================================================
     /**
     * Returns true if is running, otherwise false.
@@ -179,7 +206,22 @@ protected:
     */
     virtual void run();
 
-    QVector <float> hanning(int N, short itype);
+    //=========================================================================================================
+    /**
+    * Clears the sample ring and the segment spectra of the sliding estimate.
+    */
+    void resetSlidingSpectrum();
+
+    //=========================================================================================================
+    /**
+    * Appends a block to the sample ring and updates the running sum of the segment spectra with every segment
+    * which is completed by the block. The oldest segment spectra drop out of the sum.
+    *
+    * @param[in] p_matBlock     The block, Sensors x BlockSize.
+    *
+    * @return true if at least one segment was completed, false otherwise.
+    */
+    bool updateSlidingSpectrum(const Ref<const MatrixXd>& p_matBlock);
 
 private:
     QMutex      mutex;                  /**< Provides access serialization between threads*/
@@ -194,7 +236,20 @@ private:
 
     CircularMatrixBuffer<double>::SPtr m_pRawMatrixBuffer;   /**< The Circular Raw Matrix Buffer. */
 
-    QVector <float> m_fWin;
+    WelchPsd    m_welchPsd;             /**< Welch power spectral density estimator. */
+
+    SpectrumMode m_spectrumMode;        /**< Spectrum estimation mode. */
+    SpectrumMode m_newSpectrumMode;     /**< New spectrum estimation mode, applied with the next block. */
+
+    enum { RenormInterval = 256 };      /**< Number of segments after which the running sum is recomputed. */
+
+    MatrixXd    m_matSampleRing;        /**< The most recent samples, Sensors x (fft length + BlockSize), used circularly. */
+    qint64      m_iNumRingSamples;      /**< Number of samples appended to the ring since the reset. */
+    qint64      m_iNextSegmentEnd;      /**< Sample index after the last sample of the next segment. */
+    qint32      m_iMaxSegments;         /**< Number of segments which cover the data length. */
+    qint32      m_iSegmentsSinceRenorm; /**< Number of segments added to the running sum since it was recomputed. */
+    QList<MatrixXd> m_qListSegmentSpectra;  /**< Spectra of the segments in the running sum, oldest first. */
+    MatrixXd    m_matSpectrumSum;       /**< Running sum of the segment spectra. */
 
     double m_Fs;
 
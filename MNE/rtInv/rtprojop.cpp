@@ -0,0 +1,260 @@
+//=============================================================================================================
+/**
+* @file     rtprojop.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>;
+* @version  1.0
+* @date     January, 2015
+*
+* @section  LICENSE
+*
+* Copyright (C) 2015, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Implementation of the RtProjOp class.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "rtprojop.h"
+
+#include <fiff/fiff_ctf_comp.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QMutexLocker>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace RTINVLIB;
+using namespace FIFFLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+RtProjOp::RtProjOp(FiffInfo::SPtr p_pFiffInfo, qint32 p_iCompTo)
+: m_pFiffInfo(p_pFiffInfo)
+, m_iCompFrom(p_pFiffInfo->get_current_comp())
+, m_iCompTo(p_iCompTo)
+, m_iCompApplied(m_iCompFrom)
+, m_qListProjs(p_pFiffInfo->projs)
+, m_qListBads(p_pFiffInfo->bads)
+, m_bIdentity(true)
+, m_bLowRank(true)
+{
+}
+
+
+//*************************************************************************************************************
+
+void RtProjOp::setCompensation(qint32 p_iCompTo)
+{
+    QMutexLocker locker(&m_qMutex);
+    m_iCompTo = p_iCompTo;
+}
+
+
+//*************************************************************************************************************
+
+void RtProjOp::setProjectors(const QList<FiffProj>& p_qListProjs, const QStringList& p_qListBads)
+{
+    QMutexLocker locker(&m_qMutex);
+    m_qListProjs = p_qListProjs;
+    m_qListBads = p_qListBads;
+}
+
+
+//*************************************************************************************************************
+
+qint32 RtProjOp::compensationGrade() const
+{
+    QMutexLocker locker(&m_qMutex);
+    return m_iCompApplied;
+}
+
+
+//*************************************************************************************************************
+
+qint32 RtProjOp::numProjectionVectors() const
+{
+    QMutexLocker locker(&m_qMutex);
+    return m_matU.cols();
+}
+
+
+//*************************************************************************************************************
+
+void RtProjOp::apply(MatrixXd& p_matData)
+{
+    QMutexLocker locker(&m_qMutex);
+
+    QStringList t_qListSignature = signature();
+    if(t_qListSignature != m_qListSignature)
+    {
+        m_qListSignature = t_qListSignature;
+        update();
+    }
+
+    if(m_bIdentity)
+        return;
+
+    if(p_matData.rows() != m_pFiffInfo->nchan)
+    {
+        printf("RtProjOp: block has %d channels, measurement info %d; data are not projected.\n", (int)p_matData.rows(), m_pFiffInfo->nchan);//ToDo throw
+        return;
+    }
+
+    if(!m_bLowRank)
+    {
+        p_matData = m_matOp * p_matData;
+        return;
+    }
+
+    //
+    //   Compensation: x += D*x_ref; the reference rows of D are zero
+    //
+    if(m_vecCompRefIdx.size() > 0)
+    {
+        MatrixXd t_matRef(m_vecCompRefIdx.size(), p_matData.cols());
+        for(qint32 i = 0; i < m_vecCompRefIdx.size(); ++i)
+            t_matRef.row(i) = p_matData.row(m_vecCompRefIdx[i]);
+        p_matData.noalias() += m_matCompD * t_matRef;
+    }
+
+    //
+    //   SSP: x -= U*(U'*x)
+    //
+    if(m_matU.cols() > 0)
+    {
+        MatrixXd t_matCoeff = m_matU.transpose() * p_matData;
+        p_matData.noalias() -= m_matU * t_matCoeff;
+    }
+}
+
+
+//*************************************************************************************************************
+
+QStringList RtProjOp::signature() const
+{
+    QStringList t_qListSignature;
+
+    for(qint32 i = 0; i < m_qListProjs.size(); ++i)
+    {
+        const FiffProj& t_proj = m_qListProjs[i];
+        t_qListSignature << QString("proj %1 %2 %3 %4").arg(t_proj.desc).arg(t_proj.kind).arg((int)t_proj.active).arg(t_proj.data->nrow);
+    }
+
+    for(qint32 i = 0; i < m_qListBads.size(); ++i)
+        t_qListSignature << QString("bad %1").arg(m_qListBads[i]);
+
+    t_qListSignature << QString("comp %1 %2").arg(m_iCompFrom).arg(m_iCompTo);
+
+    return t_qListSignature;
+}
+
+
+//*************************************************************************************************************
+
+void RtProjOp::update()
+{
+    qint32 nchan = m_pFiffInfo->nchan;
+
+    //
+    //   Projector of the active projection items, bad channels excluded
+    //
+    QList<FiffProj> t_qListActiveProjs;
+    for(qint32 i = 0; i < m_qListProjs.size(); ++i)
+        if(m_qListProjs[i].active)
+            t_qListActiveProjs.append(m_qListProjs[i]);
+
+    MatrixXd t_matProj;
+    m_matU = MatrixXd(nchan, 0);
+    if(t_qListActiveProjs.size() > 0)
+    {
+        MatrixXd t_matU;
+        if(FiffProj::make_projector(t_qListActiveProjs, m_pFiffInfo->ch_names, t_matProj, m_qListBads, t_matU) > 0)
+            m_matU = t_matU;
+    }
+
+    //
+    //   Compensation, only the columns of the reference channels differ from the identity
+    //
+    m_vecCompRefIdx.resize(0);
+    m_matCompD = MatrixXd(nchan, 0);
+    m_iCompApplied = m_iCompFrom;
+    if(m_iCompTo >= 0 && m_iCompTo != m_iCompFrom)
+    {
+        FiffCtfComp t_ctfComp;
+        if(m_pFiffInfo->make_compensator(m_iCompFrom, m_iCompTo, t_ctfComp) && t_ctfComp.data->data.rows() == nchan)
+        {
+            MatrixXd t_matD = t_ctfComp.data->data - MatrixXd::Identity(nchan, nchan);
+
+            qint32 t_iNumRefs = 0;
+            m_vecCompRefIdx.resize(nchan);
+            for(qint32 k = 0; k < nchan; ++k)
+                if(!t_matD.col(k).isZero(0))
+                    m_vecCompRefIdx[t_iNumRefs++] = k;
+            m_vecCompRefIdx.conservativeResize(t_iNumRefs);
+
+            m_matCompD.resize(nchan, t_iNumRefs);
+            for(qint32 i = 0; i < t_iNumRefs; ++i)
+                m_matCompD.col(i) = t_matD.col(m_vecCompRefIdx[i]);
+
+            m_iCompApplied = m_iCompTo;
+        }
+        else
+            printf("RtProjOp: compensator from grade %d to %d could not be created; data are not compensated.\n", m_iCompFrom, m_iCompTo);//ToDo throw
+    }
+
+    //
+    //   Low rank form if it needs less operations per sample than the dense operator
+    //
+    qint32 t_iLowRankCost = m_vecCompRefIdx.size() + 2*m_matU.cols();
+    m_bIdentity = t_iLowRankCost == 0;
+    m_bLowRank = t_iLowRankCost < nchan;
+
+    if(!m_bIdentity && !m_bLowRank)
+    {
+        MatrixXd t_matP = MatrixXd::Identity(nchan, nchan) - m_matU*m_matU.transpose();
+        m_matOp = t_matP;
+        for(qint32 i = 0; i < m_vecCompRefIdx.size(); ++i)
+            m_matOp.col(m_vecCompRefIdx[i]) += t_matP * m_matCompD.col(i);
+    }
+    else
+        m_matOp = MatrixXd();
+
+    printf("RtProjOp: %d projection vectors, compensation grade %d -> %d, %s form.\n", (int)m_matU.cols(), m_iCompFrom, m_iCompApplied, m_bLowRank ? "low rank" : "dense");
+}
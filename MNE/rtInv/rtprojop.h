@@ -0,0 +1,203 @@
+//=============================================================================================================
+/**
+* @file     rtprojop.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>;
+* @version  1.0
+* @date     January, 2015
+*
+* @section  LICENSE
+*
+* Copyright (C) 2015, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    RtProjOp class declaration
+*
+*/
+
+#ifndef RTPROJOP_H
+#define RTPROJOP_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "rtinv_global.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// FIFF INCLUDES
+//=============================================================================================================
+
+#include <fiff/fiff_info.h>
+#include <fiff/fiff_proj.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QList>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QStringList>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE RTINVLIB
+//=============================================================================================================
+
+namespace RTINVLIB
+{
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+using namespace FIFFLIB;
+
+
+//=============================================================================================================
+/**
+* Combined CTF compensation and SSP operator which is applied to every raw block before the data are handed to
+* the processing plugins. The operator is derived from the measurement info once and is only re-derived when the
+* active projectors, the bad channels or the requested compensation change.
+*
+* The projectors and the bad channels are kept as copies, since the measurement info is edited by the GUI while
+* apply() runs in the acquisition thread. Changes are handed over with setProjectors().
+*
+* The projector I - U*U' and the compensation I + D, whose non zero columns D belong to the compensation
+* reference channels, are kept in their low rank form as long as this is cheaper than one dense multiplication.
+*
+* @brief Real-time compensation and SSP operator
+*/
+class RTINVSHARED_EXPORT RtProjOp
+{
+public:
+    typedef QSharedPointer<RtProjOp> SPtr;             /**< Shared pointer type for RtProjOp. */
+    typedef QSharedPointer<const RtProjOp> ConstSPtr;  /**< Const shared pointer type for RtProjOp. */
+
+    //=========================================================================================================
+    /**
+    * Creates the compensation and SSP operator. The compensation grade of the incoming data, the projectors and
+    * the bad channels are taken from the measurement info at construction.
+    *
+    * @param[in] p_pFiffInfo    Fiff measurement info; channels and compensation data must not change afterwards.
+    * @param[in] p_iCompTo      Requested compensation grade; -1 keeps the grade of the data.
+    */
+    explicit RtProjOp(FiffInfo::SPtr p_pFiffInfo, qint32 p_iCompTo = -1);
+
+    //=========================================================================================================
+    /**
+    * Sets the requested compensation grade. The operator is re-derived with the next block.
+    *
+    * @param[in] p_iCompTo      Requested compensation grade; -1 keeps the grade of the data.
+    */
+    void setCompensation(qint32 p_iCompTo);
+
+    //=========================================================================================================
+    /**
+    * Sets the projectors and the bad channels. Copies are taken, the operator is re-derived with the next block
+    * if the active projectors or the bad channels changed.
+    *
+    * @param[in] p_qListProjs   Projectors, the active ones are applied.
+    * @param[in] p_qListBads    Bad channels, which are excluded from the projectors.
+    */
+    void setProjectors(const QList<FiffProj>& p_qListProjs, const QStringList& p_qListBads);
+
+    //=========================================================================================================
+    /**
+    * Returns the compensation grade of the data after apply().
+    *
+    * @return the compensation grade.
+    */
+    qint32 compensationGrade() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the number of projection vectors of the current operator.
+    *
+    * @return the number of projection vectors.
+    */
+    qint32 numProjectionVectors() const;
+
+    //=========================================================================================================
+    /**
+    * Applies compensation and SSP in place. The operator is re-derived first if the active projectors, the bad
+    * channels or the requested compensation changed.
+    *
+    * @param[in, out] p_matData     Raw block, nchan x samples.
+    */
+    void apply(MatrixXd& p_matData);
+
+private:
+    //=========================================================================================================
+    /**
+    * Returns a description of everything the operator depends on.
+    *
+    * @return the signature of the operator.
+    */
+    QStringList signature() const;
+
+    //=========================================================================================================
+    /**
+    * Derives the projector and the compensation and chooses between the low rank and the dense form.
+    */
+    void update();
+
+    FiffInfo::SPtr  m_pFiffInfo;        /**< Fiff measurement info. */
+    mutable QMutex  m_qMutex;           /**< Guards the operator. */
+
+    qint32      m_iCompFrom;            /**< Compensation grade of the incoming data. */
+    qint32      m_iCompTo;              /**< Requested compensation grade, -1 if the grade is kept. */
+    qint32      m_iCompApplied;         /**< Compensation grade of the data after the operator. */
+
+    QList<FiffProj> m_qListProjs;       /**< Copy of the projectors. */
+    QStringList m_qListBads;            /**< Copy of the bad channels. */
+
+    QStringList m_qListSignature;       /**< Signature of the info the operator was derived from. */
+
+    bool        m_bIdentity;            /**< Whether the operator leaves the data unchanged. */
+    bool        m_bLowRank;             /**< Whether the low rank form is applied instead of m_matOp. */
+    MatrixXd    m_matU;                 /**< Orthonormal projection vectors, nchan x nvec. */
+    VectorXi    m_vecCompRefIdx;        /**< Indices of the channels the compensation is computed from. */
+    MatrixXd    m_matCompD;             /**< Non zero columns of the compensation minus identity, nchan x nref. */
+    MatrixXd    m_matOp;                /**< Dense operator (I - U*U')*(I + D), if it is cheaper than the low rank form. */
+};
+
+} // NAMESPACE
+
+#endif // RTPROJOP_H
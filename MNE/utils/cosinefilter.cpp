@@ -40,6 +40,7 @@
 //=============================================================================================================
 
 #include "cosinefilter.h"
+#include "fftplancache.h"
 
 
 //*************************************************************************************************************
@@ -135,8 +136,7 @@ CosineFilter::CosineFilter(int fftLength, float lowpass, float lowpass_width, fl
     m_dFFTCoeffA = filterFreqResp;
 
     //Generate windowed impulse response - invert fft coeeficients to time domain
-    Eigen::FFT<double> fft;
-    fft.SetFlag(fft.HalfSpectrum);
+    Eigen::FFT<double>& fft = FFTPlanCache::workspace(fftLength).fft;
 
     //invert to time domain and
     fft.inv(m_dCoeffA, filterFreqResp);/*
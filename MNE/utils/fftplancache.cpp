@@ -0,0 +1,121 @@
+//=============================================================================================================
+/**
+* @file     fftplancache.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>;
+* @version  1.0
+* @date     January, 2015
+*
+* @section  LICENSE
+*
+* Copyright (C) 2015, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Implementation of the FFTPlanCache class.
+*
+*/
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "fftplancache.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QHash>
+#include <QList>
+#include <QSharedPointer>
+#include <QThreadStorage>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace UTILSLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STATIC DATA
+//=============================================================================================================
+
+namespace
+{
+    struct FFTWorkspaces
+    {
+        QHash<qint32, QSharedPointer<FFTWorkspace> >    hash;   /**< Workspaces by length. */
+        QList<qint32>                                   usage;  /**< Cached lengths, least recently used first. */
+    };
+
+    QThreadStorage<FFTWorkspaces> s_workspaces;    /**< Workspaces of each thread. */
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+FFTWorkspace& FFTPlanCache::workspace(qint32 p_iFFTLength)
+{
+    FFTWorkspaces& t_workspaces = s_workspaces.localData();
+
+    QSharedPointer<FFTWorkspace> t_pWorkspace = t_workspaces.hash.value(p_iFFTLength);
+    if(t_pWorkspace.isNull())
+    {
+        // evict only the least recently used length, the workspaces in use stay valid
+        if(t_workspaces.hash.size() >= MaxLengths)
+            t_workspaces.hash.remove(t_workspaces.usage.takeFirst());
+
+        t_pWorkspace = QSharedPointer<FFTWorkspace>(new FFTWorkspace);
+        t_pWorkspace->fft.SetFlag(t_pWorkspace->fft.HalfSpectrum);
+        t_pWorkspace->vecTime.resize(p_iFFTLength);
+        t_pWorkspace->vecFreq.resize(p_iFFTLength/2+1);
+        t_workspaces.hash.insert(p_iFFTLength, t_pWorkspace);
+        t_workspaces.usage.append(p_iFFTLength);
+    }
+    else if(t_workspaces.usage.last() != p_iFFTLength)
+    {
+        t_workspaces.usage.removeOne(p_iFFTLength);
+        t_workspaces.usage.append(p_iFFTLength);
+    }
+
+    return *t_pWorkspace;
+}
+
+
+//*************************************************************************************************************
+
+void FFTPlanCache::clear()
+{
+    FFTWorkspaces& t_workspaces = s_workspaces.localData();
+    t_workspaces.hash.clear();
+    t_workspaces.usage.clear();
+}
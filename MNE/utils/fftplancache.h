@@ -0,0 +1,126 @@
+//=============================================================================================================
+/**
+* @file     fftplancache.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>;
+* @version  1.0
+* @date     January, 2015
+*
+* @section  LICENSE
+*
+* Copyright (C) 2015, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    FFTPlanCache class declaration
+*
+*/
+
+
+#ifndef FFTPLANCACHE_H
+#define FFTPLANCACHE_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "utils_global.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+#include <unsupported/Eigen/FFT>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE UTILSLIB
+//=============================================================================================================
+
+namespace UTILSLIB
+{
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STRUCTS
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* FFT plan and scratch buffers of one transform length. The plan computes half spectra.
+*/
+struct FFTWorkspace
+{
+    Eigen::FFT<double>  fft;        /**< The plan, created with the first transform */
+    RowVectorXd         vecTime;    /**< Time domain scratch buffer of fft length */
+    RowVectorXcd        vecFreq;    /**< Frequency domain scratch buffer of fft length/2+1 */
+};
+
+
+//=============================================================================================================
+/**
+* Eigen::FFT creates its twiddle factors with the first transform of a length, and the filters used to construct a
+* new FFT object and new zero padded buffers for every row they filtered. The cache keeps one workspace per
+* length and thread, so that workspaces can be used without locking from the threads of QtConcurrent.
+*
+* @brief Thread local cache of FFT plans and scratch buffers
+*/
+class UTILSSHARED_EXPORT FFTPlanCache
+{
+public:
+    enum { MaxLengths = 16 };   /**< Number of lengths which are cached per thread. */
+
+    //=========================================================================================================
+    /**
+    * Returns the workspace of the calling thread for a transform length; buffers have their lengths but undefined
+    * contents. When a new length exceeds MaxLengths, only the least recently requested length is evicted. A
+    * returned workspace therefore stays valid while the thread requests fewer than MaxLengths other lengths,
+    * until the thread ends or until the cache of the thread is cleared.
+    *
+    * @param[in] p_iFFTLength   The transform length.
+    *
+    * @return the workspace.
+    */
+    static FFTWorkspace& workspace(qint32 p_iFFTLength);
+
+    //=========================================================================================================
+    /**
+    * Removes the workspaces of the calling thread.
+    */
+    static void clear();
+};
+
+} // NAMESPACE
+
+#endif // FFTPLANCACHE_H
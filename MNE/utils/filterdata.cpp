@@ -41,6 +41,17 @@
 //=============================================================================================================
 
 #include "filterdata.h"
+#include "fftplancache.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QList>
+#include <QThread>
+#include <QtConcurrent>
 
 
 //*************************************************************************************************************
@@ -51,6 +62,50 @@
 using namespace UTILSLIB;
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// STATIC DEFINITIONS
+//=============================================================================================================
+
+namespace
+{
+
+//=============================================================================================================
+/**
+* Range of rows which is filtered by one thread.
+*/
+struct FilterRowsChunk
+{
+    const FilterData*   pFilter;        /**< The filter */
+    const MatrixXd*     pData;          /**< The sequences, one per row */
+    MatrixXd*           pFiltered;      /**< The filtered sequences */
+    qint32              iFirstRow;      /**< First row of the chunk */
+    qint32              iNumRows;       /**< Number of rows in the chunk */
+
+    void compute()
+    {
+        qint32 t_iFFTLength = pFilter->m_iFFTlength;
+        qint32 t_iNumSamples = pData->cols();
+
+        FFTWorkspace& t_workspace = FFTPlanCache::workspace(t_iFFTLength);
+
+        for(qint32 i = iFirstRow; i < iFirstRow + iNumRows; ++i)
+        {
+            t_workspace.vecTime.head(t_iNumSamples) = pData->row(i);
+            t_workspace.vecTime.tail(t_iFFTLength - t_iNumSamples).setZero();
+
+            t_workspace.fft.fwd(t_workspace.vecFreq, t_workspace.vecTime);
+            t_workspace.vecFreq = t_workspace.vecFreq.cwiseProduct(pFilter->m_dFFTCoeffA);
+            t_workspace.fft.inv(t_workspace.vecTime, t_workspace.vecFreq, t_iFFTLength);
+
+            pFiltered->row(i) = t_workspace.vecTime.segment(pFilter->m_iFilterOrder/2+1, pFiltered->cols());
+        }
+    }
+};
+
+} // NAMESPACE
+
+
 //*************************************************************************************************************
 
 FilterData::FilterData()
@@ -85,38 +140,66 @@ void FilterData::fftTransformCoeffs()
     RowVectorXd t_coeffAzeroPad = RowVectorXd::Zero(m_iFFTlength);
     t_coeffAzeroPad.head(m_dCoeffA.cols()) = m_dCoeffA;
 
-    //generate fft object
-    Eigen::FFT<double> fft;
-    fft.SetFlag(fft.HalfSpectrum);
-
-    //fft-transform filter coeffs
-    m_dFFTCoeffA = RowVectorXcd::Zero(m_iFFTlength);
-    fft.fwd(m_dFFTCoeffA,t_coeffAzeroPad);
+    //fft-transform filter coeffs with the plan of this thread
+    FFTPlanCache::workspace(m_iFFTlength).fft.fwd(m_dFFTCoeffA,t_coeffAzeroPad);
 }
 
 //*************************************************************************************************************
 
 RowVectorXd FilterData::applyFFTFilter(RowVectorXd& data)
 {
-    //zero-pad data to m_iFFTlength
-    RowVectorXd t_dataZeroPad = RowVectorXd::Zero(m_iFFTlength);
-    t_dataZeroPad.head(data.cols()) = data;
+    FFTWorkspace& t_workspace = FFTPlanCache::workspace(m_iFFTlength);
 
-    //generate fft object
-    Eigen::FFT<double> fft;
-    fft.SetFlag(fft.HalfSpectrum);
+    //zero-pad data to m_iFFTlength
+    t_workspace.vecTime.head(data.cols()) = data;
+    t_workspace.vecTime.tail(m_iFFTlength-data.cols()).setZero();
 
     //fft-transform data sequence
-    RowVectorXcd t_freqData;
-    fft.fwd(t_freqData,t_dataZeroPad);
+    t_workspace.fft.fwd(t_workspace.vecFreq,t_workspace.vecTime);
 
     //perform frequency-domain filtering
-    RowVectorXcd t_filteredFreq = m_dFFTCoeffA.array()*t_freqData.array();
+    t_workspace.vecFreq = t_workspace.vecFreq.cwiseProduct(m_dFFTCoeffA);
 
     //inverse-FFT
-    RowVectorXd t_filteredTime;
-    fft.inv(t_filteredTime,t_filteredFreq);
+    t_workspace.fft.inv(t_workspace.vecTime,t_workspace.vecFreq,m_iFFTlength);
 
     //cuts off ends at front and end and return result
-    return t_filteredTime.segment(m_iFilterOrder/2+1,m_iFFTlength-m_iFilterOrder);
+    return t_workspace.vecTime.segment(m_iFilterOrder/2+1,m_iFFTlength-m_iFilterOrder);
+}
+
+//*************************************************************************************************************
+
+void FilterData::applyFFTFilter(MatrixXd& p_matData)
+{
+    qint32 t_iNumRows = p_matData.rows();
+    if(t_iNumRows == 0)
+        return;
+
+    if(p_matData.cols() > m_iFFTlength) {
+        printf("FilterData::applyFFTFilter - %d samples exceed the fft length %d.\n", (int)p_matData.cols(), m_iFFTlength);//ToDo throw
+        return;
+    }
+
+    MatrixXd t_matFiltered(t_iNumRows, m_iFFTlength-m_iFilterOrder);
+
+    qint32 t_iChunkSize = qMax(t_iNumRows / (4*QThread::idealThreadCount()), 1);
+
+    QList<FilterRowsChunk> t_qListChunks;
+    for(qint32 i = 0; i < t_iNumRows; i += t_iChunkSize)
+    {
+        FilterRowsChunk t_chunk;
+        t_chunk.pFilter = this;
+        t_chunk.pData = &p_matData;
+        t_chunk.pFiltered = &t_matFiltered;
+        t_chunk.iFirstRow = i;
+        t_chunk.iNumRows = i + t_iChunkSize > t_iNumRows ? t_iNumRows - i : t_iChunkSize;
+        t_qListChunks.append(t_chunk);
+    }
+
+    if(t_qListChunks.size() > 1)
+        QtConcurrent::blockingMap(t_qListChunks, &FilterRowsChunk::compute);
+    else
+        t_qListChunks[0].compute();
+
+    p_matData = t_matFiltered;
 }
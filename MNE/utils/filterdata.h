@@ -63,7 +63,6 @@
 // Eigen INCLUDES
 //=============================================================================================================
 
-#include <Eigen/Core>
 #include <Eigen/Core>
 #include <Eigen/SparseCore>
 #include <unsupported/Eigen/FFT>
@@ -119,8 +118,20 @@ public:
      */
     void fftTransformCoeffs();
 
+    /**
+     * @brief applyFFTFilter filters one sequence in the frequency domain
+     * @param [in] data the sequence, at most m_iFFTlength samples
+     * @return the filtered sequence without the filter transients, m_iFFTlength-m_iFilterOrder samples
+     */
     RowVectorXd applyFFTFilter(RowVectorXd& data);
 
+    /**
+     * @brief applyFFTFilter filters all rows in one call, the rows are distributed over the available threads
+     * @param [in,out] p_matData the sequences, one per row and at most m_iFFTlength samples; replaced by the filtered
+     *                 sequences of m_iFFTlength-m_iFilterOrder samples, as returned by the single row version
+     */
+    void applyFFTFilter(MatrixXd& p_matData);
+
     int m_iFilterOrder;       /**< represents the order of the filter instance */
     int m_iFFTlength;        /**< represents the filter length */
 
@@ -0,0 +1,181 @@
+//=============================================================================================================
+/**
+* @file     latencyhistogram.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>;
+* @version  1.0
+* @date     January, 2015
+*
+* @section  LICENSE
+*
+* Copyright (C) 2015, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Implementation of the LatencyHistogram class.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "latencyhistogram.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QAtomicInt>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace UTILSLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+LatencyHistogram::LatencyHistogram()
+{
+    clear();
+}
+
+
+//*************************************************************************************************************
+
+void LatencyHistogram::add(qint64 p_iValue)
+{
+    if(p_iValue < 0)
+        p_iValue = 0;
+
+    qint32 t_iBin = 0;
+    for(quint64 v = (quint64)p_iValue; v > 0 && t_iBin < NumBins - 1; v >>= 1)
+        ++t_iBin;
+
+    ++m_aBins[t_iBin];
+    ++m_iCount;
+    m_dSum += p_iValue;
+    if(p_iValue > m_iMax)
+        m_iMax = p_iValue;
+}
+
+
+//*************************************************************************************************************
+
+void LatencyHistogram::clear()
+{
+    for(qint32 i = 0; i < NumBins; ++i)
+        m_aBins[i] = 0;
+    m_iCount = 0;
+    m_dSum = 0.0;
+    m_iMax = 0;
+}
+
+
+//*************************************************************************************************************
+
+double LatencyHistogram::mean() const
+{
+    return m_iCount > 0 ? m_dSum / m_iCount : 0.0;
+}
+
+
+//*************************************************************************************************************
+
+qint64 LatencyHistogram::percentile(double p_dFraction) const
+{
+    if(m_iCount == 0)
+        return 0;
+
+    quint64 t_iRank = (quint64)(p_dFraction * m_iCount);
+    if(t_iRank >= m_iCount)
+        t_iRank = m_iCount - 1;
+
+    quint64 t_iSum = 0;
+    for(qint32 i = 0; i < NumBins; ++i)
+    {
+        t_iSum += m_aBins[i];
+        if(t_iSum > t_iRank)
+        {
+            qint64 t_iUpper = i == 0 ? 0 : ((qint64)1 << i) - 1;
+            return t_iUpper < m_iMax ? t_iUpper : m_iMax;
+        }
+    }
+
+    return m_iMax;
+}
+
+
+//*************************************************************************************************************
+
+QString LatencyHistogram::toString(const QString& p_sName, const QString& p_sUnit) const
+{
+    return QString("%1: n %2, mean %3 %4, median <= %5 %4, p99 <= %6 %4, max %7 %4")
+            .arg(p_sName)
+            .arg(m_iCount)
+            .arg(mean(), 0, 'f', 1)
+            .arg(p_sUnit)
+            .arg(percentile(0.5))
+            .arg(percentile(0.99))
+            .arg(m_iMax);
+}
+
+
+//*************************************************************************************************************
+
+qint64 LatencyHistogram::now()
+{
+    static QMutex s_qMutex;
+    static QAtomicInt s_iStarted(0);
+    static QElapsedTimer s_timer;
+    static qint64 s_iEpochUs = 0;
+
+    if(!s_iStarted.loadAcquire())
+    {
+        s_qMutex.lock();
+        if(!s_timer.isValid())
+        {
+            //start the monotonic clock at a millisecond edge of the system time
+            qint64 t_iMs = QDateTime::currentMSecsSinceEpoch();
+            qint64 t_iEdge;
+            while((t_iEdge = QDateTime::currentMSecsSinceEpoch()) == t_iMs)
+                ;
+            s_timer.start();
+            s_iEpochUs = t_iEdge * 1000;
+        }
+        s_iStarted.storeRelease(1);
+        s_qMutex.unlock();
+    }
+
+    return s_iEpochUs + s_timer.nsecsElapsed() / 1000;
+}
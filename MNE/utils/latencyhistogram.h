@@ -0,0 +1,178 @@
+//=============================================================================================================
+/**
+* @file     latencyhistogram.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>;
+* @version  1.0
+* @date     January, 2015
+*
+* @section  LICENSE
+*
+* Copyright (C) 2015, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    LatencyHistogram class declaration
+*
+*/
+
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "utils_global.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QString>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE UTILSLIB
+//=============================================================================================================
+
+namespace UTILSLIB
+{
+
+//=============================================================================================================
+/**
+* Histogram with logarithmic (power of two) bins, cheap enough to be filled for every block of a real-time
+* pipeline. Used for latencies in microseconds and for queue depths. Not thread safe.
+*
+* @brief Power of two histogram of latencies and queue depths
+*/
+class UTILSSHARED_EXPORT LatencyHistogram
+{
+public:
+    enum { NumBins = 32 };  /**< Bin i holds values in [2^(i-1), 2^i), bin 0 holds values < 1. */
+
+    //=========================================================================================================
+    /**
+    * Constructs an empty histogram.
+    */
+    LatencyHistogram();
+
+    //=========================================================================================================
+    /**
+    * Adds a value. Negative values are counted as 0.
+    *
+    * @param[in] p_iValue   The value, e.g. a latency in microseconds.
+    */
+    void add(qint64 p_iValue);
+
+    //=========================================================================================================
+    /**
+    * Resets the histogram.
+    */
+    void clear();
+
+    //=========================================================================================================
+    /**
+    * Number of added values.
+    *
+    * @return the number of values.
+    */
+    inline quint64 count() const;
+
+    //=========================================================================================================
+    /**
+    * Largest added value.
+    *
+    * @return the maximum.
+    */
+    inline qint64 max() const;
+
+    //=========================================================================================================
+    /**
+    * Mean of the added values.
+    *
+    * @return the mean, 0 if empty.
+    */
+    double mean() const;
+
+    //=========================================================================================================
+    /**
+    * Upper bound of the bin which contains the given percentile, e.g. 0.99 for the 99th percentile.
+    *
+    * @param[in] p_dFraction    The percentile as fraction in [0, 1].
+    *
+    * @return the upper bound of the percentile, limited to the maximum.
+    */
+    qint64 percentile(double p_dFraction) const;
+
+    //=========================================================================================================
+    /**
+    * One line summary: count, mean, median, 99th percentile and maximum.
+    *
+    * @param[in] p_sName    Name of the measured quantity.
+    * @param[in] p_sUnit    Unit of the values.
+    *
+    * @return the summary.
+    */
+    QString toString(const QString& p_sName, const QString& p_sUnit = QString("us")) const;
+
+    //=========================================================================================================
+    /**
+    * Current wall clock time in microseconds since the epoch, the time base of the block stamps. The clock is
+    * aligned to the millisecond edge of the system time once and then advances with the monotonic clock, so
+    * stamps of different processes on one host are comparable with microsecond resolution.
+    *
+    * @return the time in microseconds.
+    */
+    static qint64 now();
+
+private:
+    quint64 m_aBins[NumBins];   /**< The bin counts. */
+    quint64 m_iCount;           /**< Number of values. */
+    double  m_dSum;             /**< Sum of the values. */
+    qint64  m_iMax;             /**< Largest value. */
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+inline quint64 LatencyHistogram::count() const
+{
+    return m_iCount;
+}
+
+
+//*************************************************************************************************************
+
+inline qint64 LatencyHistogram::max() const
+{
+    return m_iMax;
+}
+
+} // NAMESPACE
+
+#endif // LATENCYHISTOGRAM_H
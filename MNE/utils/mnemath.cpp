@@ -49,6 +49,7 @@
 #include <iostream>
 #include <algorithm>    // std::sort
 #include <vector>       // std::vector
+#include <random>       // std::mt19937
 
 //DEBUG fstream
 //#include <fstream>
@@ -76,6 +77,11 @@ using namespace UTILSLIB;
 // DEFINE MEMBER METHODS
 //=============================================================================================================
 
+const double MNEMath::SvdGramTolerance = 1e-6;
+
+
+//*************************************************************************************************************
+
 VectorXd* MNEMath::combine_xyz(const VectorXd& vec)
 {
     if (vec.size() % 3 != 0)
@@ -438,3 +444,73 @@ MatrixXd MNEMath::rescale(const MatrixXd &data, const RowVectorXf &times, QPair<
 
     return data_out;
 }
+
+
+//*************************************************************************************************************
+
+void MNEMath::svd_gram(const MatrixXd &A, VectorXd &s, MatrixXd &U, MatrixXd &V, double tol)
+{
+    qint32 n = A.rows();
+
+    // Only the lower triangle of the Gram matrix is formed
+    MatrixXd t_matGram = MatrixXd::Zero(n, n);
+    t_matGram.selfadjointView<Lower>().rankUpdate(A);
+
+    SelfAdjointEigenSolver<MatrixXd> t_eigSolver(t_matGram);
+
+    // Eigenvalues are returned in ascending order -> reverse
+    VectorXd t_vecEig = t_eigSolver.eigenvalues().reverse();
+    U = t_eigSolver.eigenvectors().rowwise().reverse();
+
+    s = t_vecEig.cwiseMax(0.0).cwiseSqrt();
+
+    double t_dThreshold = s.size() > 0 ? s[0] * tol : 0.0;
+
+    V.noalias() = A.transpose() * U;
+    for(qint32 i = 0; i < s.size(); ++i)
+    {
+        if(s[i] > t_dThreshold)
+            V.col(i) /= s[i];
+        else
+        {
+            s[i] = 0.0;
+            V.col(i).setZero();
+        }
+    }
+}
+
+
+//*************************************************************************************************************
+
+void MNEMath::svd_randomized(const MatrixXd &A, qint32 rank, VectorXd &s, MatrixXd &U, MatrixXd &V, qint32 oversampling, qint32 n_iter, quint32 seed)
+{
+    qint32 l = std::min<qint32>(rank + oversampling, std::min<qint32>(A.rows(), A.cols()));
+    rank = std::min<qint32>(rank, l);
+
+    // Gaussian test matrix of a local generator, the result does not depend on the global rand() state
+    std::mt19937 t_generator(seed);
+    std::normal_distribution<double> t_normal(0.0, 1.0);
+    MatrixXd t_matOmega(A.cols(), l);
+    for(qint32 i = 0; i < t_matOmega.size(); ++i)
+        t_matOmega.data()[i] = t_normal(t_generator);
+
+    // Range finder with power iterations, re-orthonormalized in every step
+    MatrixXd t_matY = A * t_matOmega;
+    MatrixXd t_matQ = HouseholderQR<MatrixXd>(t_matY).householderQ() * MatrixXd::Identity(A.rows(), l);
+    for(qint32 i = 0; i < n_iter; ++i)
+    {
+        MatrixXd t_matZ = A.transpose() * t_matQ;
+        t_matZ = HouseholderQR<MatrixXd>(t_matZ).householderQ() * MatrixXd::Identity(A.cols(), l);
+        t_matY.noalias() = A * t_matZ;
+        t_matQ = HouseholderQR<MatrixXd>(t_matY).householderQ() * MatrixXd::Identity(A.rows(), l);
+    }
+
+    // Decompose the projected problem B = Q'*A (l x cols)
+    MatrixXd t_matB = t_matQ.transpose() * A;
+    MatrixXd t_matUb;
+    svd_gram(t_matB, s, t_matUb, V);
+
+    U = t_matQ * t_matUb.leftCols(rank);
+    s.conservativeResize(rank);
+    V.conservativeResize(V.rows(), rank);
+}
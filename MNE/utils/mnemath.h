@@ -103,6 +103,8 @@ class UTILSSHARED_EXPORT MNEMath
 public:
     typedef std::pair<int,int> IdxIntValue;         /**< Typedef of a pair of ints. */
 
+    static const double SvdGramTolerance;           /**< Default relative threshold of svd_gram for zero singular values. */
+
     //=========================================================================================================
     /**
     * Destroys the MNEMath object
@@ -261,6 +263,41 @@ public:
     */
     static MatrixXd rescale(const MatrixXd &data, const RowVectorXf &times, QPair<QVariant,QVariant> baseline, QString mode);
 
+    //=========================================================================================================
+    /**
+    * Thin singular value decomposition A = U*diag(s)*V' of a wide matrix (rows <= cols) computed via the
+    * eigendecomposition of the Gram matrix A*A' (rows x rows). Much faster than JacobiSVD when A has many
+    * more columns than rows. Singular values below tol * s.maxCoeff() are set to zero together with their
+    * right singular vectors. Since the Gram matrix squares the singular values, they are resolved only down to
+    * about sqrt(eps) * s.maxCoeff(); smaller thresholds let the noise of the null space through. Singular
+    * values are sorted in descending order.
+    *
+    * @param[in] A      Matrix to decompose (rows <= cols)
+    * @param[out] s     Singular values
+    * @param[out] U     Left singular vectors (rows x rows)
+    * @param[out] V     Right singular vectors (cols x rows)
+    * @param[in] tol    Relative threshold for zero singular values (optional, default = SvdGramTolerance = 1e-6)
+    */
+    static void svd_gram(const MatrixXd &A, VectorXd &s, MatrixXd &U, MatrixXd &V, double tol = SvdGramTolerance);
+
+    //=========================================================================================================
+    /**
+    * Randomized truncated singular value decomposition A ~ U*diag(s)*V' (Halko et al. 2011). The range of A
+    * is sampled with rank + oversampling Gaussian test vectors, refined with n_iter power iterations and the
+    * small projected problem is decomposed via svd_gram. Singular values are sorted in descending order. The test
+    * vectors are drawn from a generator seeded with seed, so the result is reproducible.
+    *
+    * @param[in] A              Matrix to decompose
+    * @param[in] rank           Number of singular triplets to compute
+    * @param[out] s             Singular values (rank)
+    * @param[out] U             Left singular vectors (rows x rank)
+    * @param[out] V             Right singular vectors (cols x rank)
+    * @param[in] oversampling   Number of additional test vectors (optional, default = 10)
+    * @param[in] n_iter         Number of power iterations (optional, default = 2)
+    * @param[in] seed           Seed of the Gaussian test vectors (optional, default = 0)
+    */
+    static void svd_randomized(const MatrixXd &A, qint32 rank, VectorXd &s, MatrixXd &U, MatrixXd &V, qint32 oversampling = 10, qint32 n_iter = 2, quint32 seed = 0);
+
     //=========================================================================================================
     /**
     * Sorts a vector (ascending order) in place and returns the track of the original indeces
@@ -0,0 +1,293 @@
+//=============================================================================================================
+/**
+* @file     streamingcovariance.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>;
+* @version  1.0
+* @date     January, 2015
+*
+* @section  LICENSE
+*
+* Copyright (C) 2015, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Implementation of the StreamingCovariance class.
+*
+*/
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "streamingcovariance.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace UTILSLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+StreamingCovariance::StreamingCovariance(Mode p_mode, qint64 p_iWindowSamples)
+: m_mode(p_mode)
+, m_iWindowSamples(p_iWindowSamples)
+, m_dWeight(0)
+{
+}
+
+
+//*************************************************************************************************************
+
+void StreamingCovariance::setMode(Mode p_mode, qint64 p_iWindowSamples)
+{
+    m_mode = p_mode;
+    m_iWindowSamples = p_iWindowSamples;
+    reset();
+}
+
+
+//*************************************************************************************************************
+
+void StreamingCovariance::reset()
+{
+    m_dWeight = 0;
+    m_vecMean.resize(0);
+    m_matM2.resize(0,0);
+
+    m_qListPaneWeights.clear();
+    m_qListPaneMeans.clear();
+    m_qListPaneM2.clear();
+}
+
+
+//*************************************************************************************************************
+
+void StreamingCovariance::update(const Ref<const MatrixXd>& p_matBlock)
+{
+    qint32 nchan = p_matBlock.rows();
+    qint32 nsamp = p_matBlock.cols();
+
+    if(nsamp == 0)
+        return;
+
+    if(numChannels() != 0 && numChannels() != nchan)
+        reset();
+
+    //
+    // Block statistics: center the block on its own mean -> rank-k update of the lower triangle
+    //
+    VectorXd t_vecMean = p_matBlock.rowwise().mean();
+    MatrixXd t_matCentered = p_matBlock.colwise() - t_vecMean;
+    MatrixXd t_matM2 = MatrixXd::Zero(nchan, nchan);
+    t_matM2.selfadjointView<Lower>().rankUpdate(t_matCentered);
+
+    switch(m_mode)
+    {
+    case SlidingWindow:
+    {
+        qint64 t_iPaneSamples = qMax(m_iWindowSamples / NumPanes, (qint64)1);
+
+        if(m_qListPaneWeights.isEmpty() || m_qListPaneWeights.last() >= t_iPaneSamples)
+        {
+            m_qListPaneWeights.append(0);
+            m_qListPaneMeans.append(VectorXd());
+            m_qListPaneM2.append(MatrixXd());
+        }
+
+        //merge into the newest pane
+        m_dWeight = m_qListPaneWeights.last();
+        m_vecMean.swap(m_qListPaneMeans.last());
+        m_matM2.swap(m_qListPaneM2.last());
+        mergeStats(nsamp, t_vecMean, t_matM2);
+        m_qListPaneWeights.last() = m_dWeight;
+        m_vecMean.swap(m_qListPaneMeans.last());
+        m_matM2.swap(m_qListPaneM2.last());
+
+        trimPanes();
+        break;
+    }
+    case ExponentialForgetting:
+        if(m_dWeight > 0 && m_iWindowSamples > 1)
+        {
+            //forget the older samples before merging, the samples within a block are weighted equally
+            double t_dForgetting = pow(1.0 - 1.0/(double)m_iWindowSamples, (double)nsamp);
+            m_dWeight *= t_dForgetting;
+            m_matM2 *= t_dForgetting;
+        }
+        mergeStats(nsamp, t_vecMean, t_matM2);
+        break;
+    default:
+        mergeStats(nsamp, t_vecMean, t_matM2);
+        break;
+    }
+}
+
+
+//*************************************************************************************************************
+
+void StreamingCovariance::merge(const StreamingCovariance& p_other)
+{
+    if(p_other.m_mode == SlidingWindow)
+    {
+        merge(p_other.mergedPanes());
+        return;
+    }
+
+    if(p_other.m_dWeight <= 0)
+        return;
+
+    if(numChannels() != 0 && numChannels() != p_other.m_vecMean.size())
+        reset();
+
+    if(m_mode == SlidingWindow)
+    {
+        //the merged samples become the newest pane
+        m_qListPaneWeights.append(p_other.m_dWeight);
+        m_qListPaneMeans.append(p_other.m_vecMean);
+        m_qListPaneM2.append(p_other.m_matM2);
+        trimPanes();
+        return;
+    }
+
+    mergeStats(p_other.m_dWeight, p_other.m_vecMean, p_other.m_matM2);
+}
+
+
+//*************************************************************************************************************
+
+double StreamingCovariance::weight() const
+{
+    return m_dWeight;
+}
+
+
+//*************************************************************************************************************
+
+VectorXd StreamingCovariance::mean() const
+{
+    if(m_mode == SlidingWindow)
+        return mergedPanes().m_vecMean;
+
+    return m_vecMean;
+}
+
+
+//*************************************************************************************************************
+
+MatrixXd StreamingCovariance::covariance() const
+{
+    if(m_mode == SlidingWindow)
+        return mergedPanes().covariance();
+
+    if(m_dWeight <= 1)
+        return MatrixXd();
+
+    MatrixXd t_matCov = m_matM2.selfadjointView<Lower>();
+    t_matCov /= (m_dWeight - 1);
+
+    return t_matCov;
+}
+
+
+//*************************************************************************************************************
+
+void StreamingCovariance::mergeStats(double p_dWeight, const VectorXd& p_vecMean, const MatrixXd& p_matM2)
+{
+    if(m_dWeight <= 0 || m_vecMean.size() == 0)
+    {
+        m_dWeight = p_dWeight;
+        m_vecMean = p_vecMean;
+        m_matM2 = p_matM2;
+        return;
+    }
+
+    //
+    // Chan et al.: M2 = M2_a + M2_b + delta*delta' * n_a*n_b/n
+    //
+    double t_dWeight = m_dWeight + p_dWeight;
+    VectorXd t_vecDelta = p_vecMean - m_vecMean;
+
+    m_vecMean += t_vecDelta * (p_dWeight / t_dWeight);
+    m_matM2.triangularView<Lower>() += p_matM2;
+    m_matM2.selfadjointView<Lower>().rankUpdate(t_vecDelta, m_dWeight * p_dWeight / t_dWeight);
+    m_dWeight = t_dWeight;
+}
+
+
+//*************************************************************************************************************
+
+qint32 StreamingCovariance::numChannels() const
+{
+    if(m_mode == SlidingWindow)
+    {
+        for(qint32 i = 0; i < m_qListPaneMeans.size(); ++i)
+            if(m_qListPaneMeans[i].size() > 0)
+                return m_qListPaneMeans[i].size();
+        return 0;
+    }
+
+    return m_vecMean.size();
+}
+
+
+//*************************************************************************************************************
+
+void StreamingCovariance::trimPanes()
+{
+    //drop the oldest panes which are not needed to cover the window
+    double t_dTotal = 0;
+    for(qint32 i = 0; i < m_qListPaneWeights.size(); ++i)
+        t_dTotal += m_qListPaneWeights[i];
+    while(m_qListPaneWeights.size() > 1 && t_dTotal - m_qListPaneWeights.first() >= m_iWindowSamples)
+    {
+        t_dTotal -= m_qListPaneWeights.first();
+        m_qListPaneWeights.removeFirst();
+        m_qListPaneMeans.removeFirst();
+        m_qListPaneM2.removeFirst();
+    }
+
+    m_dWeight = t_dTotal;
+    m_vecMean.resize(0);
+    m_matM2.resize(0,0);
+}
+
+
+//*************************************************************************************************************
+
+StreamingCovariance StreamingCovariance::mergedPanes() const
+{
+    StreamingCovariance t_merged;
+
+    for(qint32 i = 0; i < m_qListPaneWeights.size(); ++i)
+        if(m_qListPaneWeights[i] > 0)
+            t_merged.mergeStats(m_qListPaneWeights[i], m_qListPaneMeans[i], m_qListPaneM2[i]);
+
+    return t_merged;
+}
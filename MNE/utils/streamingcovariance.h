@@ -0,0 +1,220 @@
+//=============================================================================================================
+/**
+* @file     streamingcovariance.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>;
+* @version  1.0
+* @date     January, 2015
+*
+* @section  LICENSE
+*
+* Copyright (C) 2015, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    StreamingCovariance class declaration
+*
+*/
+
+
+#ifndef STREAMINGCOVARIANCE_H
+#define STREAMINGCOVARIANCE_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "utils_global.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QList>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE UTILSLIB
+//=============================================================================================================
+
+namespace UTILSLIB
+{
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+
+
+//=============================================================================================================
+/**
+* Streaming covariance estimation of multichannel data. Data blocks are centered on their own mean and merged
+* with the running mean and sum of squared deviations (Chan et al. pairwise update, the block version of
+* Welford's algorithm), which avoids the cancellation of sum(x*x') - n*mu*mu'. The squared deviations are
+* accumulated with symmetric rank-k updates into the lower triangle only. Not thread safe.
+*
+* @brief Streaming covariance estimation with cumulative, sliding window and exponential forgetting modes
+*/
+class UTILSSHARED_EXPORT StreamingCovariance
+{
+public:
+    //=========================================================================================================
+    /**
+    * Estimation modes.
+    */
+    enum Mode
+    {
+        Cumulative,             /**< All samples since the last reset. */
+        SlidingWindow,          /**< The last window samples, rounded up to a whole pane of window/NumPanes samples. */
+        ExponentialForgetting   /**< Each sample is weighted with a forgetting factor of 1 - 1/window per newer sample. */
+    };
+
+    enum { NumPanes = 8 };      /**< Number of panes a sliding window is divided into. */
+
+    //=========================================================================================================
+    /**
+    * Constructs an empty estimator.
+    *
+    * @param[in] p_mode             The estimation mode.
+    * @param[in] p_iWindowSamples   Window length (sliding window) or memory (exponential forgetting) in samples.
+    */
+    StreamingCovariance(Mode p_mode = Cumulative, qint64 p_iWindowSamples = 0);
+
+    //=========================================================================================================
+    /**
+    * Sets the estimation mode and resets the estimator.
+    *
+    * @param[in] p_mode             The estimation mode.
+    * @param[in] p_iWindowSamples   Window length (sliding window) or memory (exponential forgetting) in samples.
+    */
+    void setMode(Mode p_mode, qint64 p_iWindowSamples);
+
+    //=========================================================================================================
+    /**
+    * Discards all samples.
+    */
+    void reset();
+
+    //=========================================================================================================
+    /**
+    * Adds a data block. A block with a different number of channels resets the estimator.
+    *
+    * @param[in] p_matBlock     The data block, channels x samples.
+    */
+    void update(const Ref<const MatrixXd>& p_matBlock);
+
+    //=========================================================================================================
+    /**
+    * Merges the samples of another estimator into this one, e.g. of a block processed in parallel. A sliding
+    * window receives the merged samples as its newest pane. Estimators with a different number of channels
+    * reset this one.
+    *
+    * @param[in] p_other    The estimator to merge.
+    */
+    void merge(const StreamingCovariance& p_other);
+
+    //=========================================================================================================
+    /**
+    * Returns the (effective) number of samples of the estimate.
+    *
+    * @return the number of samples.
+    */
+    double weight() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the mean of the estimate.
+    *
+    * @return the channel means.
+    */
+    VectorXd mean() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the unbiased covariance estimate.
+    *
+    * @return the full symmetric covariance matrix, empty if less than two samples were added.
+    */
+    MatrixXd covariance() const;
+
+private:
+    //=========================================================================================================
+    /**
+    * Merges block statistics into the running statistics.
+    *
+    * @param[in] p_dWeight      Number of samples of the block.
+    * @param[in] p_vecMean      Mean of the block.
+    * @param[in] p_matM2        Sum of squared deviations of the block, lower triangle.
+    */
+    void mergeStats(double p_dWeight, const VectorXd& p_vecMean, const MatrixXd& p_matM2);
+
+    //=========================================================================================================
+    /**
+    * Returns the number of channels of the estimate, taken from the panes of a sliding window.
+    *
+    * @return the number of channels, 0 if no samples were added.
+    */
+    qint32 numChannels() const;
+
+    //=========================================================================================================
+    /**
+    * Drops the oldest panes of a sliding window which are not needed to cover the window and updates the
+    * number of samples.
+    */
+    void trimPanes();
+
+    //=========================================================================================================
+    /**
+    * Merges the panes of a sliding window into a cumulative estimator.
+    *
+    * @return the merged estimator.
+    */
+    StreamingCovariance mergedPanes() const;
+
+    Mode        m_mode;             /**< The estimation mode. */
+    qint64      m_iWindowSamples;   /**< Window length or memory in samples. */
+
+    double      m_dWeight;          /**< (Effective) number of samples. */
+    VectorXd    m_vecMean;          /**< Running mean. */
+    MatrixXd    m_matM2;            /**< Running sum of squared deviations from the mean, only the lower triangle is valid. */
+
+    QList<double>   m_qListPaneWeights; /**< Number of samples of each pane of the sliding window, the newest pane is filled. */
+    QList<VectorXd> m_qListPaneMeans;   /**< Mean of each pane. */
+    QList<MatrixXd> m_qListPaneM2;      /**< Sum of squared deviations of each pane, lower triangle. */
+};
+
+} // NAMESPACE
+
+#endif // STREAMINGCOVARIANCE_H
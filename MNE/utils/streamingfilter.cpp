@@ -0,0 +1,296 @@
+//=============================================================================================================
+/**
+* @file     streamingfilter.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>;
+* @version  1.0
+* @date     January, 2015
+*
+* @section  LICENSE
+*
+* Copyright (C) 2015, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Implementation of the StreamingFilter class.
+*
+*/
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "streamingfilter.h"
+#include "fftplancache.h"
+
+#include <math.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QList>
+#include <QThread>
+#include <QtConcurrent>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace UTILSLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+void FilterChunk::compute()
+{
+    pFilter->filterChannels(*pData, iFirstChannel, iNumChannels);
+}
+
+
+//*************************************************************************************************************
+
+StreamingFilter::StreamingFilter()
+: m_iNumTaps(0)
+, m_iFFTLength(0)
+, m_bMultithreaded(true)
+{
+}
+
+
+//*************************************************************************************************************
+
+StreamingFilter::StreamingFilter(const FilterData& p_filterData)
+: m_iNumTaps(0)
+, m_iFFTLength(0)
+, m_bMultithreaded(true)
+{
+    setFirCoefficients(p_filterData.m_dCoeffA);
+}
+
+
+//*************************************************************************************************************
+
+void StreamingFilter::setFirCoefficients(const RowVectorXd& p_vecCoeffs, qint32 p_iFFTLength)
+{
+    m_iNumTaps = p_vecCoeffs.cols();
+    if(m_iNumTaps == 0)
+    {
+        m_iFFTLength = 0;
+        m_vecFreqCoeffs = RowVectorXcd();
+        m_vecTapsReversed = RowVectorXd();
+        reset(m_matFirState.rows());
+        return;
+    }
+
+    if(p_iFFTLength < m_iNumTaps)
+    {
+        if(p_iFFTLength > 0)
+            printf("StreamingFilter: fft length %d is shorter than %d taps, the default is used.\n", p_iFFTLength, m_iNumTaps);//ToDo throw
+        p_iFFTLength = 64;
+        while(p_iFFTLength < 2*m_iNumTaps)
+            p_iFFTLength *= 2;
+    }
+    m_iFFTLength = p_iFFTLength;
+    m_vecTapsReversed = p_vecCoeffs.reverse();
+
+    RowVectorXd t_vecCoeffsZeroPad = RowVectorXd::Zero(m_iFFTLength);
+    t_vecCoeffsZeroPad.head(m_iNumTaps) = p_vecCoeffs;
+
+    FFTPlanCache::workspace(m_iFFTLength).fft.fwd(m_vecFreqCoeffs, t_vecCoeffsZeroPad);
+
+    reset(m_matFirState.rows());
+}
+
+
+//*************************************************************************************************************
+
+void StreamingFilter::setBiquads(const MatrixXd& p_matSos)
+{
+    m_matSos = p_matSos;
+    if(m_matSos.size() > 0 && m_matSos.cols() != 6)
+    {
+        printf("StreamingFilter: biquads need 6 coefficients per row, the IIR part is removed.\n");//ToDo throw
+        m_matSos = MatrixXd();
+    }
+
+    for(qint32 k = 0; k < m_matSos.rows(); ++k)
+        m_matSos.row(k) /= m_matSos(k,3);
+
+    reset(m_matFirState.rows());
+}
+
+
+//*************************************************************************************************************
+
+RowVectorXd StreamingFilter::designBiquad(BiquadType p_type, double p_dFreqNyq, double p_dQ)
+{
+    double w0 = M_PI * p_dFreqNyq;
+    double cosw0 = cos(w0);
+    double alpha = sin(w0) / (2.0*p_dQ);
+
+    RowVectorXd t_vecSos(6);
+    switch(p_type)
+    {
+        case LowPass:
+            t_vecSos << (1.0-cosw0)/2.0, 1.0-cosw0, (1.0-cosw0)/2.0, 1.0+alpha, -2.0*cosw0, 1.0-alpha;
+            break;
+        case HighPass:
+            t_vecSos << (1.0+cosw0)/2.0, -(1.0+cosw0), (1.0+cosw0)/2.0, 1.0+alpha, -2.0*cosw0, 1.0-alpha;
+            break;
+        case BandPass:
+            t_vecSos << alpha, 0.0, -alpha, 1.0+alpha, -2.0*cosw0, 1.0-alpha;
+            break;
+        case Notch:
+            t_vecSos << 1.0, -2.0*cosw0, 1.0, 1.0+alpha, -2.0*cosw0, 1.0-alpha;
+            break;
+    }
+
+    return t_vecSos / t_vecSos[3];
+}
+
+
+//*************************************************************************************************************
+
+void StreamingFilter::reset(qint32 p_iNumChannels)
+{
+    m_matFirState = MatrixXd::Zero(p_iNumChannels, m_iNumTaps > 0 ? m_iNumTaps-1 : 0);
+    m_matIirState = MatrixXd::Zero(p_iNumChannels, 2*m_matSos.rows());
+}
+
+
+//*************************************************************************************************************
+
+void StreamingFilter::filter(MatrixXd& p_matData)
+{
+    qint32 t_iNumChannels = p_matData.rows();
+    if(t_iNumChannels != m_matFirState.rows())
+        reset(t_iNumChannels);
+
+    if(t_iNumChannels == 0 || p_matData.cols() == 0 || (m_iNumTaps == 0 && m_matSos.rows() == 0))
+        return;
+
+    qint32 t_iChunkSize = m_bMultithreaded ? qMax(t_iNumChannels / (4*QThread::idealThreadCount()), 1) : t_iNumChannels;
+
+    QList<FilterChunk> t_qListChunks;
+    for(qint32 k = 0; k < t_iNumChannels; k += t_iChunkSize)
+    {
+        FilterChunk t_chunk;
+        t_chunk.pFilter = this;
+        t_chunk.pData = &p_matData;
+        t_chunk.iFirstChannel = k;
+        t_chunk.iNumChannels = k + t_iChunkSize > t_iNumChannels ? t_iNumChannels - k : t_iChunkSize;
+        t_qListChunks.append(t_chunk);
+    }
+
+    if(t_qListChunks.size() > 1)
+        QtConcurrent::blockingMap(t_qListChunks, &FilterChunk::compute);
+    else
+        t_qListChunks[0].compute();
+}
+
+
+//*************************************************************************************************************
+
+void StreamingFilter::filterChannels(MatrixXd& p_matData, qint32 p_iFirstChannel, qint32 p_iNumChannels)
+{
+    qint32 t_iNumSamples = p_matData.cols();
+
+    //
+    // FIR, overlap-save: each frame holds the state and up to fft length - state new samples, whose outputs are
+    // not affected by the circular wrap around. Short frames are convolved directly.
+    //
+    if(m_iNumTaps > 0)
+    {
+        qint32 t_iState = m_iNumTaps - 1;
+        qint32 t_iHop = m_iFFTLength - t_iState;
+        double t_dFFTCost = 4.0 * m_iFFTLength * log((double)m_iFFTLength) / log(2.0);  // forward and inverse transform per frame
+
+        FFTWorkspace& t_workspace = FFTPlanCache::workspace(m_iFFTLength);
+        RowVectorXd& t_vecFrame = t_workspace.vecTime;
+        RowVectorXcd& t_vecFreqData = t_workspace.vecFreq;
+
+        for(qint32 c = p_iFirstChannel; c < p_iFirstChannel + p_iNumChannels; ++c)
+        {
+            for(qint32 s = 0; s < t_iNumSamples; s += t_iHop)
+            {
+                qint32 n = qMin(t_iHop, t_iNumSamples - s);
+
+                t_vecFrame.head(t_iState) = m_matFirState.row(c);
+                t_vecFrame.segment(t_iState, n) = p_matData.row(c).segment(s, n);
+
+                if((double)n * m_iNumTaps < t_dFFTCost)
+                {
+                    for(qint32 i = 0; i < n; ++i)
+                        p_matData(c, s+i) = m_vecTapsReversed.dot(t_vecFrame.segment(i, m_iNumTaps));
+
+                    m_matFirState.row(c) = t_vecFrame.segment(n, t_iState);
+                }
+                else
+                {
+                    t_vecFrame.tail(m_iFFTLength - t_iState - n).setZero();
+
+                    t_workspace.fft.fwd(t_vecFreqData, t_vecFrame);
+                    m_matFirState.row(c) = t_vecFrame.segment(n, t_iState);
+
+                    // the frame is not needed anymore and takes the output
+                    t_vecFreqData = t_vecFreqData.cwiseProduct(m_vecFreqCoeffs);
+                    t_workspace.fft.inv(t_vecFrame, t_vecFreqData, m_iFFTLength);
+
+                    p_matData.row(c).segment(s, n) = t_vecFrame.segment(t_iState, n);
+                }
+            }
+        }
+    }
+
+    //
+    // IIR, direct form II transposed
+    //
+    for(qint32 k = 0; k < m_matSos.rows(); ++k)
+    {
+        double b0 = m_matSos(k,0), b1 = m_matSos(k,1), b2 = m_matSos(k,2);
+        double a1 = m_matSos(k,4), a2 = m_matSos(k,5);
+
+        for(qint32 c = p_iFirstChannel; c < p_iFirstChannel + p_iNumChannels; ++c)
+        {
+            double z1 = m_matIirState(c, 2*k);
+            double z2 = m_matIirState(c, 2*k+1);
+            for(qint32 i = 0; i < t_iNumSamples; ++i)
+            {
+                double x = p_matData(c,i);
+                double y = b0*x + z1;
+                z1 = b1*x - a1*y + z2;
+                z2 = b2*x - a2*y;
+                p_matData(c,i) = y;
+            }
+            m_matIirState(c, 2*k) = z1;
+            m_matIirState(c, 2*k+1) = z2;
+        }
+    }
+}
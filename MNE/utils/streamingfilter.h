@@ -0,0 +1,263 @@
+//=============================================================================================================
+/**
+* @file     streamingfilter.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>;
+* @version  1.0
+* @date     January, 2015
+*
+* @section  LICENSE
+*
+* Copyright (C) 2015, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    StreamingFilter class declaration
+*
+*/
+
+
+#ifndef STREAMINGFILTER_H
+#define STREAMINGFILTER_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "utils_global.h"
+#include "filterdata.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE UTILSLIB
+//=============================================================================================================
+
+namespace UTILSLIB
+{
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// FORWARD DECLARATIONS
+//=============================================================================================================
+
+class StreamingFilter;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STRUCTS
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* Range of channels which is filtered by one thread.
+*/
+struct FilterChunk
+{
+    StreamingFilter*    pFilter;        /**< The filter, whose state rows of the chunk are updated */
+    MatrixXd*           pData;          /**< The block, channels x samples */
+    qint32              iFirstChannel;  /**< First channel of the chunk */
+    qint32              iNumChannels;   /**< Number of channels in the chunk */
+
+    void compute();
+};
+
+
+//=============================================================================================================
+/**
+* Causal multichannel filter for continuous data which arrive in blocks. The FIR part is computed with the
+* overlap-save method: the frequency response is computed once, and the last taps-1 input samples of every channel
+* are kept as state, so that the output equals the linear convolution of the whole stream, independent of the
+* block size. Blocks which are too short to amortize an FFT are convolved directly. An optional cascade of biquads (second order sections, direct form II transposed) is applied after
+* the FIR part.
+*
+* @brief Stateful overlap-save FIR and biquad IIR filter bank
+*/
+class UTILSSHARED_EXPORT StreamingFilter
+{
+    friend struct FilterChunk;
+public:
+    //=========================================================================================================
+    /**
+    * Biquad types of designBiquad.
+    */
+    enum BiquadType
+    {
+        LowPass,
+        HighPass,
+        BandPass,       /**< 0 dB gain at the center frequency. */
+        Notch
+    };
+
+    //=========================================================================================================
+    /**
+    * Constructs a pass through filter.
+    */
+    StreamingFilter();
+
+    //=========================================================================================================
+    /**
+    * Constructs a streaming version of a designed FIR filter.
+    *
+    * @param[in] p_filterData   The filter, whose forward coefficients are used.
+    */
+    explicit StreamingFilter(const FilterData& p_filterData);
+
+    //=========================================================================================================
+    /**
+    * Sets the FIR coefficients and precomputes their frequency response. The state is reset.
+    *
+    * @param[in] p_vecCoeffs    The filter taps.
+    * @param[in] p_iFFTLength   FFT length, a power of 2 of at least the number of taps; 0 selects the next power
+    *                           of 2 of twice the number of taps.
+    */
+    void setFirCoefficients(const RowVectorXd& p_vecCoeffs, qint32 p_iFFTLength = 0);
+
+    //=========================================================================================================
+    /**
+    * Sets the biquad cascade. The state is reset.
+    *
+    * @param[in] p_matSos   One section per row: b0 b1 b2 a0 a1 a2. An empty matrix removes the IIR part.
+    */
+    void setBiquads(const MatrixXd& p_matSos);
+
+    //=========================================================================================================
+    /**
+    * Designs a biquad after the RBJ audio EQ cookbook.
+    *
+    * @param[in] p_type         The biquad type.
+    * @param[in] p_dFreqNyq     Corner or center frequency, relative to the Nyquist frequency.
+    * @param[in] p_dQ           Quality factor; 1/sqrt(2) gives a Butterworth response for low and high pass.
+    *
+    * @return the section: b0 b1 b2 a0 a1 a2, normalized to a0 = 1.
+    */
+    static RowVectorXd designBiquad(BiquadType p_type, double p_dFreqNyq, double p_dQ = 0.70710678118654752);
+
+    //=========================================================================================================
+    /**
+    * Sets the number of channels and clears the state.
+    *
+    * @param[in] p_iNumChannels     Number of channels.
+    */
+    void reset(qint32 p_iNumChannels);
+
+    //=========================================================================================================
+    /**
+    * Enables the channel parallel computation on the global thread pool.
+    *
+    * @param[in] p_bMultithreaded   Whether to filter the channels concurrently.
+    */
+    inline void setMultithreaded(bool p_bMultithreaded);
+
+    //=========================================================================================================
+    /**
+    * Filters the next block of the stream in place. The state is reset if the number of channels changed.
+    *
+    * @param[in, out] p_matData     The block, channels x samples of any length.
+    */
+    void filter(MatrixXd& p_matData);
+
+    //=========================================================================================================
+    /**
+    * Returns the FFT length of the overlap-save method.
+    *
+    * @return the fft length.
+    */
+    inline qint32 fftLength() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the group delay of a linear phase FIR part.
+    *
+    * @return the delay in samples.
+    */
+    inline double delay() const;
+
+private:
+    //=========================================================================================================
+    /**
+    * Filters a range of channels; the rows are independent.
+    *
+    * @param[in, out] p_matData         The block.
+    * @param[in] p_iFirstChannel        First channel of the range.
+    * @param[in] p_iNumChannels         Number of channels in the range.
+    */
+    void filterChannels(MatrixXd& p_matData, qint32 p_iFirstChannel, qint32 p_iNumChannels);
+
+    qint32          m_iNumTaps;         /**< Number of FIR taps. */
+    qint32          m_iFFTLength;       /**< FFT length of the overlap-save method. */
+    RowVectorXcd    m_vecFreqCoeffs;    /**< Frequency response of the zero padded taps, one sided. */
+    RowVectorXd     m_vecTapsReversed;  /**< The taps in reverse order, for the direct convolution of short blocks. */
+    MatrixXd        m_matSos;           /**< Biquads, one per row, normalized to a0 = 1. */
+    bool            m_bMultithreaded;   /**< Whether the channels are filtered concurrently. */
+
+    MatrixXd        m_matFirState;      /**< The last taps-1 input samples of every channel. */
+    MatrixXd        m_matIirState;      /**< Two delay elements per channel and section. */
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+inline void StreamingFilter::setMultithreaded(bool p_bMultithreaded)
+{
+    m_bMultithreaded = p_bMultithreaded;
+}
+
+
+//*************************************************************************************************************
+
+inline qint32 StreamingFilter::fftLength() const
+{
+    return m_iFFTLength;
+}
+
+
+//*************************************************************************************************************
+
+inline double StreamingFilter::delay() const
+{
+    return (m_iNumTaps - 1) / 2.0;
+}
+
+} // NAMESPACE
+
+#endif // STREAMINGFILTER_H
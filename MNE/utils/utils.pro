@@ -84,7 +84,12 @@ SOURCES += \
     mp/fixdictmp.cpp \
     selectionloader.cpp \
     minimizersimplex.cpp \
-    cosinefilter.cpp
+    cosinefilter.cpp \
+    latencyhistogram.cpp \
+    streamingcovariance.cpp \
+    welchpsd.cpp \
+    streamingfilter.cpp \
+    fftplancache.cpp
 
 HEADERS += \
     kmeans.h\
@@ -101,7 +106,12 @@ HEADERS += \
     selectionloader.h \
     layoutmaker.h \
     minimizersimplex.h \
-    cosinefilter.h
+    cosinefilter.h \
+    latencyhistogram.h \
+    streamingcovariance.h \
+    welchpsd.h \
+    streamingfilter.h \
+    fftplancache.h
 
 INCLUDEPATH += $${EIGEN_INCLUDE_DIR}
 INCLUDEPATH += $${MNE_INCLUDE_DIR}
@@ -112,4 +122,6 @@ header_files.path = $${MNE_INCLUDE_DIR}/utils
 
 INSTALLS += header_files
 
+CONFIG += c++11
+
 unix: QMAKE_CXXFLAGS += -isystem $$EIGEN_INCLUDE_DIR
@@ -0,0 +1,233 @@
+//=============================================================================================================
+/**
+* @file     welchpsd.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>;
+* @version  1.0
+* @date     January, 2015
+*
+* @section  LICENSE
+*
+* Copyright (C) 2015, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Implementation of the WelchPsd class.
+*
+*/
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "welchpsd.h"
+
+#include <math.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QList>
+#include <QThread>
+#include <QtConcurrent>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <unsupported/Eigen/FFT>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace UTILSLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+void PsdChunk::compute()
+{
+    if(bFloat)
+        computePeriodograms<float>();
+    else
+        computePeriodograms<double>();
+}
+
+
+//*************************************************************************************************************
+
+template<typename T>
+void PsdChunk::computePeriodograms()
+{
+    typedef Matrix<T, Dynamic, 1> VectorT;
+    typedef Matrix<std::complex<T>, Dynamic, 1> VectorCT;
+
+    qint32 t_iNumSamples = pDataT->rows();
+
+    // the plan is created with the first transform and reused for all channels of the chunk
+    Eigen::FFT<T> fft;
+    fft.SetFlag(fft.HalfSpectrum);
+
+    VectorT t_vecWindow = pWindow->cast<T>();
+    VectorT t_vecSegment(iFFTLength);
+    VectorCT t_vecFreqData(iFFTLength/2+1);
+    VectorT t_vecSum(iFFTLength/2+1);
+
+    for(qint32 c = iFirstChannel; c < iFirstChannel + iNumChannels; ++c)
+    {
+        t_vecSum.setZero();
+
+        for(qint32 s = 0; s < iNumSegments; ++s)
+        {
+            qint32 t_iFirst = s*iStep;
+            qint32 t_iCount = qMin(iFFTLength, t_iNumSamples - t_iFirst);
+
+            t_vecSegment.head(t_iCount) = pDataT->col(c).segment(t_iFirst, t_iCount).cast<T>().cwiseProduct(t_vecWindow.head(t_iCount));
+            if(t_iCount < iFFTLength)
+                t_vecSegment.tail(iFFTLength - t_iCount).setZero();
+
+            fft.fwd(t_vecFreqData, t_vecSegment);
+            t_vecSum += t_vecFreqData.cwiseAbs2();
+        }
+
+        pPsd->row(c) = t_vecSum.template cast<double>().transpose();
+    }
+}
+
+
+//*************************************************************************************************************
+
+WelchPsd::WelchPsd(qint32 p_iFFTLength, double p_dSFreq, double p_dOverlap)
+: m_bFloat(false)
+, m_bMultithreaded(true)
+{
+    setParameters(p_iFFTLength, p_dSFreq, p_dOverlap);
+}
+
+
+//*************************************************************************************************************
+
+void WelchPsd::setParameters(qint32 p_iFFTLength, double p_dSFreq, double p_dOverlap)
+{
+    m_iFFTLength = qMax(p_iFFTLength, 2);
+    m_dSFreq = p_dSFreq;
+    m_iStep = qMax((qint32)floor(m_iFFTLength*(1.0 - qBound(0.0, p_dOverlap, 0.99)) + 0.5), 1);
+
+    m_vecWindow = hanning(m_iFFTLength);
+    m_dWindowPower = m_vecWindow.squaredNorm();
+}
+
+
+//*************************************************************************************************************
+
+MatrixXd WelchPsd::compute(const MatrixXd& p_matData) const
+{
+    qint32 t_iNumChannels = p_matData.rows();
+    qint32 t_iNumSegments = numSegments(p_matData.cols());
+    qint32 t_iNumBins = m_iFFTLength/2+1;
+
+    MatrixXd t_matPsd(t_iNumChannels, t_iNumBins);
+    if(t_iNumChannels == 0 || t_iNumSegments == 0)
+        return t_matPsd;
+
+    // contiguous channels
+    MatrixXd t_matDataT = p_matData.transpose();
+
+    //
+    // Periodograms in chunks of channels
+    //
+    qint32 t_iChunkSize = m_bMultithreaded ? qMax(t_iNumChannels / (4*QThread::idealThreadCount()), 1) : t_iNumChannels;
+
+    QList<PsdChunk> t_qListChunks;
+    for(qint32 k = 0; k < t_iNumChannels; k += t_iChunkSize)
+    {
+        PsdChunk t_chunk;
+        t_chunk.pDataT = &t_matDataT;
+        t_chunk.pWindow = &m_vecWindow;
+        t_chunk.pPsd = &t_matPsd;
+        t_chunk.iFFTLength = m_iFFTLength;
+        t_chunk.iStep = m_iStep;
+        t_chunk.iNumSegments = t_iNumSegments;
+        t_chunk.iFirstChannel = k;
+        t_chunk.iNumChannels = k + t_iChunkSize > t_iNumChannels ? t_iNumChannels - k : t_iChunkSize;
+        t_chunk.bFloat = m_bFloat;
+        t_qListChunks.append(t_chunk);
+    }
+
+    if(t_qListChunks.size() > 1)
+        QtConcurrent::blockingMap(t_qListChunks, &PsdChunk::compute);
+    else
+        t_qListChunks[0].compute();
+
+    //
+    // Average and scale to a one sided density; DC and Nyquist are not doubled
+    //
+    t_matPsd /= m_dSFreq * m_dWindowPower * t_iNumSegments;
+    qint32 t_iNumDoubled = (m_iFFTLength % 2 == 0) ? t_iNumBins - 2 : t_iNumBins - 1;
+    t_matPsd.middleCols(1, t_iNumDoubled) *= 2.0;
+
+    return t_matPsd;
+}
+
+
+//*************************************************************************************************************
+
+qint32 WelchPsd::numSegments(qint32 p_iNumSamples) const
+{
+    if(p_iNumSamples <= 0)
+        return 0;
+    if(p_iNumSamples <= m_iFFTLength)
+        return 1;
+
+    return (p_iNumSamples - m_iFFTLength) / m_iStep + 1;
+}
+
+
+//*************************************************************************************************************
+
+VectorXd WelchPsd::binFrequencies(qint32 p_iFFTLength, double p_dSFreq)
+{
+    return VectorXd::LinSpaced(p_iFFTLength/2+1, 0, (p_iFFTLength/2) * p_dSFreq / p_iFFTLength);
+}
+
+
+//*************************************************************************************************************
+
+VectorXd WelchPsd::hanning(qint32 p_iLength)
+{
+    VectorXd t_vecWindow(p_iLength);
+    for(qint32 i = 0; i < p_iLength; ++i)
+        t_vecWindow[i] = 0.5 * (1.0 - cos(2.0*M_PI*(i+1) / (p_iLength+1)));
+
+    return t_vecWindow;
+}
@@ -0,0 +1,270 @@
+//=============================================================================================================
+/**
+* @file     welchpsd.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>;
+* @version  1.0
+* @date     January, 2015
+*
+* @section  LICENSE
+*
+* Copyright (C) 2015, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    WelchPsd class declaration
+*
+*/
+
+
+#ifndef WELCHPSD_H
+#define WELCHPSD_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "utils_global.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE UTILSLIB
+//=============================================================================================================
+
+namespace UTILSLIB
+{
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STRUCTS
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* Welch periodograms of a range of channels. One FFT plan is used for all channels of the chunk, the chunks cover
+* disjoint rows of the result and are computed concurrently.
+*/
+struct PsdChunk
+{
+    const MatrixXd* pDataT;         /**< Data, samples x channels */
+    const VectorXd* pWindow;        /**< Window, fft length */
+    MatrixXd*       pPsd;           /**< Summed periodograms, channels x bins; compute() writes the rows of the chunk */
+    qint32          iFFTLength;     /**< FFT length */
+    qint32          iStep;          /**< Samples between the starts of consecutive segments */
+    qint32          iNumSegments;   /**< Number of segments */
+    qint32          iFirstChannel;  /**< First channel of the chunk */
+    qint32          iNumChannels;   /**< Number of channels in the chunk */
+    bool            bFloat;         /**< Whether the FFTs are computed in single precision */
+
+    void compute();
+
+    template<typename T>
+    void computePeriodograms();
+};
+
+
+//=============================================================================================================
+/**
+* Power spectral density estimation after Welch: the data are split into overlapping segments, each segment is
+* weighted with a Hanning window and the squared magnitudes of their FFTs are averaged. The window and its power
+* are computed once per parameter set, the FFT plan once per channel chunk.
+*
+* @brief Welch power spectral density estimation of multichannel data
+*/
+class UTILSSHARED_EXPORT WelchPsd
+{
+public:
+    //=========================================================================================================
+    /**
+    * Constructs a Welch PSD estimator.
+    *
+    * @param[in] p_iFFTLength   Segment and FFT length in samples.
+    * @param[in] p_dSFreq       Sampling frequency in Hz.
+    * @param[in] p_dOverlap     Overlap of consecutive segments, in [0, 1).
+    */
+    WelchPsd(qint32 p_iFFTLength = 1024, double p_dSFreq = 1000.0, double p_dOverlap = 0.5);
+
+    //=========================================================================================================
+    /**
+    * Sets the segment parameters.
+    *
+    * @param[in] p_iFFTLength   Segment and FFT length in samples.
+    * @param[in] p_dSFreq       Sampling frequency in Hz.
+    * @param[in] p_dOverlap     Overlap of consecutive segments, in [0, 1).
+    */
+    void setParameters(qint32 p_iFFTLength, double p_dSFreq, double p_dOverlap = 0.5);
+
+    //=========================================================================================================
+    /**
+    * Selects single precision FFTs, which are faster and accurate enough for display purposes.
+    *
+    * @param[in] p_bFloat   Whether to use single precision.
+    */
+    inline void setFloatPrecision(bool p_bFloat);
+
+    //=========================================================================================================
+    /**
+    * Enables the channel parallel computation on the global thread pool.
+    *
+    * @param[in] p_bMultithreaded   Whether to compute the channels concurrently.
+    */
+    inline void setMultithreaded(bool p_bMultithreaded);
+
+    //=========================================================================================================
+    /**
+    * Estimates the one sided power spectral density. A recording shorter than the fft length is zero padded.
+    *
+    * @param[in] p_matData  The data, channels x samples.
+    *
+    * @return the power spectral density [unit^2/Hz], channels x (fft length/2 + 1).
+    */
+    MatrixXd compute(const MatrixXd& p_matData) const;
+
+    //=========================================================================================================
+    /**
+    * Returns the number of segments which are averaged for a recording.
+    *
+    * @param[in] p_iNumSamples  Length of the recording.
+    *
+    * @return the number of segments.
+    */
+    qint32 numSegments(qint32 p_iNumSamples) const;
+
+    //=========================================================================================================
+    /**
+    * Returns the segment and FFT length.
+    *
+    * @return the fft length.
+    */
+    inline qint32 fftLength() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the number of samples between the starts of consecutive segments.
+    *
+    * @return the segment step.
+    */
+    inline qint32 step() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the frequencies of the estimated bins.
+    *
+    * @return the bin frequencies [Hz].
+    */
+    inline VectorXd frequencies() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the frequencies of the bins of a one sided spectrum.
+    *
+    * @param[in] p_iFFTLength   The FFT length.
+    * @param[in] p_dSFreq       Sampling frequency in Hz.
+    *
+    * @return the bin frequencies [Hz], fft length/2 + 1 values.
+    */
+    static VectorXd binFrequencies(qint32 p_iFFTLength, double p_dSFreq);
+
+    //=========================================================================================================
+    /**
+    * Creates a symmetric Hanning window.
+    *
+    * @param[in] p_iLength  Window length.
+    *
+    * @return the window.
+    */
+    static VectorXd hanning(qint32 p_iLength);
+
+private:
+    qint32      m_iFFTLength;       /**< Segment and FFT length. */
+    double      m_dSFreq;           /**< Sampling frequency. */
+    qint32      m_iStep;            /**< Samples between the starts of consecutive segments. */
+    bool        m_bFloat;           /**< Whether the FFTs are computed in single precision. */
+    bool        m_bMultithreaded;   /**< Whether the channels are computed concurrently. */
+
+    VectorXd    m_vecWindow;        /**< The window. */
+    double      m_dWindowPower;     /**< Sum of the squared window samples. */
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+inline void WelchPsd::setFloatPrecision(bool p_bFloat)
+{
+    m_bFloat = p_bFloat;
+}
+
+
+//*************************************************************************************************************
+
+inline void WelchPsd::setMultithreaded(bool p_bMultithreaded)
+{
+    m_bMultithreaded = p_bMultithreaded;
+}
+
+
+//*************************************************************************************************************
+
+inline qint32 WelchPsd::fftLength() const
+{
+    return m_iFFTLength;
+}
+
+
+//*************************************************************************************************************
+
+inline qint32 WelchPsd::step() const
+{
+    return m_iStep;
+}
+
+
+//*************************************************************************************************************
+
+inline VectorXd WelchPsd::frequencies() const
+{
+    return binFrequencies(m_iFFTLength, m_dSFreq);
+}
+
+} // NAMESPACE
+
+#endif // WELCHPSD_H
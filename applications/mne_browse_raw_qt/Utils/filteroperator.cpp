@@ -148,13 +148,8 @@ void FilterOperator::fftTransformCoeffs()
     RowVectorXd t_coeffAzeroPad = RowVectorXd::Zero(m_iFFTlength);
     t_coeffAzeroPad.head(m_dCoeffA.cols()) = m_dCoeffA;
 
-    //generate fft object
-    Eigen::FFT<double> fft;
-    fft.SetFlag(fft.HalfSpectrum);
-
-    //fft-transform filter coeffs
-    m_dFFTCoeffA = RowVectorXcd::Zero(m_iFFTlength);
-    fft.fwd(m_dFFTCoeffA,t_coeffAzeroPad);
+    //fft-transform filter coeffs with the plan of this thread
+    FFTPlanCache::workspace(m_iFFTlength).fft.fwd(m_dFFTCoeffA,t_coeffAzeroPad);
 }
 
 
@@ -162,25 +157,22 @@ void FilterOperator::fftTransformCoeffs()
 
 RowVectorXd FilterOperator::applyFFTFilter(const RowVectorXd& data) const
 {
-    //Zero pad in front and back
-    RowVectorXd t_dataZeroPad = RowVectorXd::Zero(m_iFFTlength);
-    t_dataZeroPad.segment(m_iFFTlength/4-m_iFilterOrder/2, data.cols()) = data;
+    //The plan and the buffers are reused by all rows filtered in this thread
+    FFTWorkspace& t_workspace = FFTPlanCache::workspace(m_iFFTlength);
 
-    //generate fft object
-    Eigen::FFT<double> fft;
-    fft.SetFlag(fft.HalfSpectrum);
+    //Zero pad in front and back
+    t_workspace.vecTime.setZero();
+    t_workspace.vecTime.segment(m_iFFTlength/4-m_iFilterOrder/2, data.cols()) = data;
 
     //fft-transform data sequence
-    RowVectorXcd t_freqData;
-    fft.fwd(t_freqData,t_dataZeroPad);
+    t_workspace.fft.fwd(t_workspace.vecFreq,t_workspace.vecTime);
 
     //perform frequency-domain filtering
-    RowVectorXcd t_filteredFreq = m_dFFTCoeffA.array()*t_freqData.array();
+    t_workspace.vecFreq = t_workspace.vecFreq.cwiseProduct(m_dFFTCoeffA);
 
     //inverse-FFT
-    RowVectorXd t_filteredTime;
-    fft.inv(t_filteredTime,t_filteredFreq);
+    t_workspace.fft.inv(t_workspace.vecTime,t_workspace.vecFreq,m_iFFTlength);
 
     //Return filtered data still with zeros at front and end
-    return t_filteredTime;
+    return t_workspace.vecTime;
 }
@@ -66,6 +66,7 @@
 #include <mne/mne.h>
 #include <utils/parksmcclellan.h>
 #include <utils/cosinefilter.h>
+#include <utils/fftplancache.h>
 
 
 //*************************************************************************************************************
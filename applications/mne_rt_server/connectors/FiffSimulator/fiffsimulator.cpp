@@ -70,6 +70,7 @@
 #include <QtCore/QtPlugin>
 #include <QFile>
 #include <QCoreApplication>
+#include <QElapsedTimer>
 #include <QDebug>
 
 
@@ -91,6 +92,8 @@ const QString FiffSimulator::Commands::BUFSIZE      = "bufsize";
 const QString FiffSimulator::Commands::GETBUFSIZE   = "getbufsize";
 const QString FiffSimulator::Commands::ACCEL        = "accel";
 const QString FiffSimulator::Commands::GETACCEL     = "getaccel";
+const QString FiffSimulator::Commands::PRELOAD      = "preload";
+const QString FiffSimulator::Commands::CHANMULT     = "chanmult";
 const QString FiffSimulator::Commands::SIMFILE      = "simfile";
 
 
@@ -107,8 +110,11 @@ FiffSimulator::FiffSimulator()
 , m_AccelerationFactor(1.0)
 , m_TrueSamplingRate(0.0)
 , m_pRawMatrixBuffer(NULL)
+, m_bPreload(false)
+, m_uiChannelMultiplier(1)
 , m_bIsRunning(false)
 {
+    this->readConfig();
     this->init();
 }
 
@@ -239,6 +245,66 @@ void FiffSimulator::comGetAccel(Command p_command)
     }
 }
 
+//*************************************************************************************************************
+
+void FiffSimulator::comPreload(Command p_command)
+{
+    bool t_bPreload = p_command.pValues()[0].toInt() != 0;
+
+    bool t_bWasRunning = m_bIsRunning;
+
+    if(m_bIsRunning)
+    {
+        m_pFiffProducer->stop();
+        this->stop();
+    }
+
+    m_bPreload = t_bPreload;
+    if(!m_bPreload)
+    {
+        m_matPreloaded.resize(0,0);
+        m_sPreloadedPath.clear();
+    }
+
+    if(t_bWasRunning)
+        this->start();
+
+    QString str = QString("\t%1 preloaded playback\r\n\n").arg(m_bPreload ? "Enabled" : "Disabled");
+
+    m_commandManager[Commands::PRELOAD].reply(str);
+}
+
+
+//*************************************************************************************************************
+
+void FiffSimulator::comChanmult(Command p_command)
+{
+    quint32 t_uiMultiplier = p_command.pValues()[0].toUInt();
+
+    if(t_uiMultiplier > 0)
+    {
+        bool t_bWasRunning = m_bIsRunning;
+
+        if(m_bIsRunning)
+        {
+            m_pFiffProducer->stop();
+            this->stop();
+        }
+
+        m_uiChannelMultiplier = t_uiMultiplier;
+
+        if(t_bWasRunning)
+            this->start();
+
+        QString str = QString("\tSet channel multiplication factor to %1 (%2 channels), request the measurement info again\r\n\n").arg(t_uiMultiplier).arg(m_RawInfo.info.nchan*t_uiMultiplier);
+
+        m_commandManager[Commands::CHANMULT].reply(str);
+    }
+    else
+        m_commandManager[Commands::CHANMULT].reply("Channel multiplication factor not set\r\n");
+}
+
+
 //*************************************************************************************************************
 
 void FiffSimulator::comSimfile(Command p_command)
@@ -254,6 +320,8 @@ void FiffSimulator::comSimfile(Command p_command)
     {
         m_sResourceDataPath = p_command.pValues()[0].toString();
         m_RawInfo = FiffRawData();
+        m_matPreloaded.resize(0,0);
+        m_sPreloadedPath.clear();
 
         if (this->readRawInfo())
         {
@@ -288,6 +356,8 @@ void FiffSimulator::connectCommandManager()
     QObject::connect(&m_commandManager[Commands::GETBUFSIZE], &Command::executed, this, &FiffSimulator::comGetBufsize);
     QObject::connect(&m_commandManager[Commands::ACCEL], &Command::executed, this, &FiffSimulator::comAccel);
     QObject::connect(&m_commandManager[Commands::GETACCEL], &Command::executed, this, &FiffSimulator::comGetAccel);
+    QObject::connect(&m_commandManager[Commands::PRELOAD], &Command::executed, this, &FiffSimulator::comPreload);
+    QObject::connect(&m_commandManager[Commands::CHANMULT], &Command::executed, this, &FiffSimulator::comChanmult);
     QObject::connect(&m_commandManager[Commands::SIMFILE], &Command::executed, this, &FiffSimulator::comSimfile);
 }
 
@@ -310,7 +380,7 @@ const char* FiffSimulator::getName() const
 
 //*************************************************************************************************************
 
-void FiffSimulator::init()
+void FiffSimulator::readConfig()
 {
     //
     // Read cfg file
@@ -320,9 +390,15 @@ void FiffSimulator::init()
     {
         QTextStream in(&t_qFile);
         QString key = "simFile = ";
+        QString keyPreload = "preload = ";
+        QString keyChanMult = "chanMult = ";
         while (!in.atEnd()) {
             QString line = in.readLine();
-            if(line.contains(key, Qt::CaseInsensitive))
+            if(line.startsWith(keyPreload, Qt::CaseInsensitive))
+                m_bPreload = line.mid(keyPreload.size()).trimmed().toInt() != 0;
+            else if(line.startsWith(keyChanMult, Qt::CaseInsensitive))
+                m_uiChannelMultiplier = qMax(line.mid(keyChanMult.size()).trimmed().toUInt(), 1u);
+            else if(line.contains(key, Qt::CaseInsensitive))
             {
                 qint32 idx = line.indexOf(key);
                 idx += key.size();
@@ -341,7 +417,13 @@ void FiffSimulator::init()
         }
         t_qFile.close();
     }
+}
+
+
+//*************************************************************************************************************
 
+void FiffSimulator::init()
+{
     if(m_pRawMatrixBuffer)
         delete m_pRawMatrixBuffer;
     m_pRawMatrixBuffer = NULL;
@@ -357,8 +439,9 @@ bool FiffSimulator::start()
 {
     this->init();
 
-    // Start threads
-    m_pFiffProducer->start();
+    // Start threads - the preloaded playback does not need the producer
+    if(!m_bPreload)
+        m_pFiffProducer->start();
 
     QThread::start();
 
@@ -387,7 +470,7 @@ void FiffSimulator::info(qint32 ID)
         readRawInfo();
 
     if(!m_RawInfo.isEmpty())
-        emit remitMeasInfo(ID, m_RawInfo.info);
+        emit remitMeasInfo(ID, multipliedInfo());
 }
 
 
@@ -508,26 +591,145 @@ bool FiffSimulator::readRawInfo()
 }
 
 
+//*************************************************************************************************************
+
+bool FiffSimulator::preloadRawData()
+{
+    if(m_sPreloadedPath == m_sResourceDataPath && m_matPreloaded.cols() > 0)
+        return true;
+
+    // reopen file in this thread
+    QFile t_File(m_RawInfo.info.filename);
+    FiffStream::SPtr t_pStream(new FiffStream(&t_File));
+    m_RawInfo.file = t_pStream;
+
+    fiff_int_t from = m_RawInfo.first_samp;
+    fiff_int_t to = m_RawInfo.last_samp;
+    fiff_int_t quantum = qMax((fiff_int_t)ceil(10.0*m_TrueSamplingRate), (fiff_int_t)1);
+
+    m_matPreloaded.resize(m_RawInfo.info.nchan, to - from + 1);
+
+    MatrixXd data;
+    MatrixXd times;
+
+    for(fiff_int_t first = from; first <= to; first += quantum)
+    {
+        fiff_int_t last = qMin(first + quantum - 1, to);
+
+        if (!m_RawInfo.read_raw_segment(data,times,first,last))
+        {
+            printf("error during read_raw_segment\n");
+            m_matPreloaded.resize(0,0);
+            m_sPreloadedPath.clear();
+            return false;
+        }
+
+        m_matPreloaded.middleCols(first - from, last - first + 1) = data.cast<float>();
+    }
+
+    // the stream refers to the local file
+    m_RawInfo.file.clear();
+
+    m_sPreloadedPath = m_sResourceDataPath;
+
+    printf("\tPreloaded %d samples of %d channels (%.1f MB)\n", (int)m_matPreloaded.cols(), (int)m_matPreloaded.rows(), m_matPreloaded.size()*sizeof(float)/1048576.0);
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+FiffInfo FiffSimulator::multipliedInfo() const
+{
+    if(m_uiChannelMultiplier <= 1)
+        return m_RawInfo.info;
+
+    FiffInfo t_info = m_RawInfo.info;
+
+    qint32 nchan = m_RawInfo.info.nchan;
+    for(quint32 k = 1; k < m_uiChannelMultiplier; ++k)
+    {
+        QString t_sSuffix = QString("#%1").arg(k);
+        for(qint32 i = 0; i < nchan; ++i)
+        {
+            FiffChInfo t_chInfo = m_RawInfo.info.chs[i];
+            //channel names are limited to 15 characters
+            t_chInfo.ch_name = t_chInfo.ch_name.left(15 - t_sSuffix.size()) + t_sSuffix;
+            t_chInfo.scanno += k*nchan;
+            t_chInfo.logno += k*nchan;
+
+            t_info.chs.append(t_chInfo);
+            t_info.ch_names.append(t_chInfo.ch_name);
+        }
+    }
+    t_info.nchan = nchan*m_uiChannelMultiplier;
+
+    return t_info;
+}
+
+
 //*************************************************************************************************************
 
 void FiffSimulator::run()
 {
     m_bIsRunning = true;
 
-    float t_fSamplingFrequency = m_RawInfo.info.sfreq;
-    float t_fBuffSampleSize = (float)m_uiBufferSampleSize;
+    if(m_bPreload && !preloadRawData())
+    {
+        printf("Error: Not able to preload the simulation file!\n");
+        m_bIsRunning = false;
+        return;
+    }
 
-    quint32 uiSamplePeriod = (unsigned int) ((t_fBuffSampleSize/t_fSamplingFrequency)*1000000.0f);
+    double t_dSamplingFrequency = m_RawInfo.info.sfreq;
+    qint32 t_iNumChannels = m_RawInfo.info.nchan;
+    qint32 t_iNumSamples = m_uiBufferSampleSize;
+    qint32 t_iNumRows = t_iNumChannels*m_uiChannelMultiplier;
 
-//    quint32 count = 0;
+    qint64 t_iPlaybackPosition = 0;
+
+    //
+    // Pace by the monotonic clock: a buffer is emitted when its last sample is due. Being late does not
+    // accumulate, the following buffers catch up. After a stall of more than a second the clock is restarted
+    // instead of bursting.
+    //
+    QElapsedTimer t_timer;
+    t_timer.start();
+    qint64 t_iNumSamplesDue = 0;
 
     while(m_bIsRunning)
     {
-        QSharedPointer<Eigen::MatrixXf> t_pRawBuffer(new Eigen::MatrixXf(m_pRawMatrixBuffer->pop()));
-//        ++count;
-//        printf("%d raw buffer (%d x %d) generated\r\n", count, t_pRawBuffer->rows(), t_pRawBuffer->cols());
+        QSharedPointer<Eigen::MatrixXf> t_pRawBuffer(new Eigen::MatrixXf(t_iNumRows, t_iNumSamples));
+
+        if(m_bPreload)
+        {
+            //copy the quantum out of the preloaded data, wrapping around at the end of the file
+            qint64 t_iFill = 0;
+            while(t_iFill < t_iNumSamples)
+            {
+                qint64 t_iCount = qMin((qint64)t_iNumSamples - t_iFill, (qint64)m_matPreloaded.cols() - t_iPlaybackPosition);
+                t_pRawBuffer->block(0, t_iFill, t_iNumChannels, t_iCount) = m_matPreloaded.middleCols(t_iPlaybackPosition, t_iCount);
+                t_iFill += t_iCount;
+                t_iPlaybackPosition = (t_iPlaybackPosition + t_iCount) % m_matPreloaded.cols();
+            }
+        }
+        else
+            t_pRawBuffer->topRows(t_iNumChannels) = m_pRawMatrixBuffer->pop();
+
+        for(quint32 k = 1; k < m_uiChannelMultiplier; ++k)
+            t_pRawBuffer->middleRows(k*t_iNumChannels, t_iNumChannels) = t_pRawBuffer->topRows(t_iNumChannels);
+
+        t_iNumSamplesDue += t_iNumSamples;
+        qint64 t_iWait = (qint64)(t_iNumSamplesDue*1000000.0/t_dSamplingFrequency) - t_timer.nsecsElapsed()/1000;
+        if(t_iWait > 0)
+            usleep(t_iWait);
+        else if(t_iWait < -1000000)
+        {
+            t_timer.restart();
+            t_iNumSamplesDue = 0;
+        }
 
         emit remitRawBuffer(t_pRawBuffer);
-        usleep(uiSamplePeriod);
     }
 }
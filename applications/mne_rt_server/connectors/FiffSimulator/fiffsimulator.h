@@ -111,6 +111,8 @@ public:
         static const QString GETBUFSIZE;
         static const QString ACCEL;
         static const QString GETACCEL;
+        static const QString PRELOAD;
+        static const QString CHANMULT;
         static const QString SIMFILE;
     };
 
@@ -176,6 +178,22 @@ private:
     */
     void comGetAccel(Command p_command);
 
+    //=========================================================================================================
+    /**
+    * Enables or disables the preloaded playback
+    *
+    * @param[in] p_command  The preload command.
+    */
+    void comPreload(Command p_command);
+
+    //=========================================================================================================
+    /**
+    * Sets the channel multiplication factor
+    *
+    * @param[in] p_command  The channel multiplication command.
+    */
+    void comChanmult(Command p_command);
+
     //=========================================================================================================
     /**
     * Sets the fiff simulation file
@@ -186,6 +204,13 @@ private:
 
     //////////
 
+    //=========================================================================================================
+    /**
+    * Reads FiffSimulation.cfg. Called once on construction, so the values set by the simfile, preload and
+    * chanmult commands survive a restart of the connector.
+    */
+    void readConfig();
+
     //=========================================================================================================
     /**
     * Initialise the FiffSimulator.
@@ -194,6 +219,24 @@ private:
 
     bool readRawInfo();
 
+    //=========================================================================================================
+    /**
+    * Reads the whole simulation file once into m_matPreloaded. The file is read in chunks of a few seconds to
+    * keep the double precision temporaries small. Nothing is read when the file is already preloaded.
+    *
+    * @return true if the data are preloaded.
+    */
+    bool preloadRawData();
+
+    //=========================================================================================================
+    /**
+    * Returns the measurement info which is sent to the clients, the channels are multiplied by
+    * m_uiChannelMultiplier. The copies are renamed (e.g. "MEG 0113#1") and numbered after the original channels.
+    *
+    * @return the measurement info.
+    */
+    FiffInfo multipliedInfo() const;
+
     QMutex mutex;
 
     FiffProducer*   m_pFiffProducer;        /**< Holds the DataProducer.*/
@@ -205,6 +248,11 @@ private:
 
     RawMatrixBuffer* m_pRawMatrixBuffer;    /**< The Circular Raw Matrix Buffer. */
 
+    bool            m_bPreload;             /**< Whether the simulation file is played back from memory. */
+    quint32         m_uiChannelMultiplier;  /**< Number of copies of each channel in the emitted buffers. */
+    Eigen::MatrixXf m_matPreloaded;         /**< The preloaded simulation file, channels x samples. */
+    QString         m_sPreloadedPath;       /**< The file m_matPreloaded was read from. */
+
     bool            m_bIsRunning;
 };
 
@@ -0,0 +1,495 @@
+//=============================================================================================================
+/**
+* @file     fiffstreamclient.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Limin Sun <liminsun@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     January, 2015
+*
+* @section  LICENSE
+*
+* Copyright (C) 2015, Christoph Dinh, Limin Sun and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief     implementation of the FiffStreamClient Class.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "fiffstreamclient.h"
+#include "mne_rt_commands.h"
+#include "streamprofile.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Fiff INCLUDES
+//=============================================================================================================
+
+#include <utils/ioutils.h>
+#include <fiff/fiff_constants.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtNetwork>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <string.h>
+
+#ifdef Q_OS_UNIX
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace UTILSLIB;
+using namespace RTSERVER;
+using namespace FIFFLIB;
+
+
+const int maxIoVec = 64;        /**< Maximal number of queued blocks which are written by one scatter write. */
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+FiffStreamClient::FiffStreamClient(qint32 id, qintptr socketDescriptor, QObject *parent)
+: QObject(parent)
+, m_iDataClientId(id)
+, m_sDataClientAlias(QString(""))
+, m_iSocketDescriptor(socketDescriptor)
+, m_pTcpSocket(NULL)
+, m_bIsSendingRawBuffer(false)
+{
+}
+
+
+//*************************************************************************************************************
+
+FiffStreamClient::~FiffStreamClient()
+{
+    if(m_pTcpSocket)
+    {
+        m_pTcpSocket->disconnect(this);
+        m_pTcpSocket->abort();
+    }
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamClient::init()
+{
+    m_pTcpSocket = new QTcpSocket(this);
+    if (!m_pTcpSocket->setSocketDescriptor(m_iSocketDescriptor)) {
+        emit error(m_pTcpSocket->error());
+        emit clientDisconnected(m_iDataClientId);
+        return;
+    }
+
+    printf("FiffStreamClient (assigned ID %d) accepted from\n\tIP:\t%s\n\tPort:\t%d\n\n",
+           m_iDataClientId,
+           QHostAddress(m_pTcpSocket->peerAddress()).toString().toUtf8().constData(),
+           m_pTcpSocket->peerPort());
+
+    connect(m_pTcpSocket, &QTcpSocket::readyRead, this, &FiffStreamClient::readProc);
+    connect(m_pTcpSocket, &QTcpSocket::bytesWritten, this, &FiffStreamClient::onBytesWritten);
+    connect(m_pTcpSocket, &QTcpSocket::disconnected, this, &FiffStreamClient::onDisconnected);
+
+    //data which arrived before the notifications were connected
+    readProc();
+    flush();
+}
+
+
+//*************************************************************************************************************
+
+QString FiffStreamClient::getAlias() const
+{
+    QMutexLocker t_locker(&m_qMutex);
+    return m_sDataClientAlias;
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamClient::startMeas(qint32 ID)
+{
+    if(ID == m_iDataClientId)
+    {
+        qDebug() << "Activate raw buffer sending.";
+
+        QByteArray t_blockStart;
+        {
+            FiffStream t_FiffStreamOut(&t_blockStart, QIODevice::WriteOnly);
+            t_FiffStreamOut.start_block(FIFFB_RAW_DATA);
+        }
+        m_bIsSendingRawBuffer = true;
+
+        enqueueBlock(t_blockStart);
+    }
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamClient::stopMeas(qint32 ID)
+{
+    if(ID == m_iDataClientId || ID == -1)
+    {
+        qDebug() << "stop raw buffer sending.";
+
+        QByteArray t_blockEnd;
+        {
+            FiffStream t_FiffStreamOut(&t_blockEnd, QIODevice::WriteOnly);
+            t_FiffStreamOut.end_block(FIFFB_RAW_DATA);
+        }
+        m_bIsSendingRawBuffer = false;
+
+        enqueueBlock(t_blockEnd);
+    }
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamClient::sendMeasurementInfo(qint32 ID, FiffInfo p_fiffInfo)
+{
+    if(ID == m_iDataClientId)
+    {
+        QByteArray t_blockMeasInfo;
+        {
+            FiffStream t_FiffStreamOut(&t_blockMeasInfo, QIODevice::WriteOnly);
+            p_fiffInfo.writeToStream(&t_FiffStreamOut);
+        }
+
+        enqueueBlock(t_blockMeasInfo);
+    }
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamClient::sendRawBuffer(QByteArray p_blockRawBuffer)
+{
+    if(!m_bIsSendingRawBuffer || !m_sStreamProfileKey.isEmpty())
+        return;
+
+    m_qMutex.lock();
+    bool t_bQueued = m_sendQueue.enqueueRaw(p_blockRawBuffer);
+    m_qMutex.unlock();
+
+    if(!t_bQueued)
+    {
+        printf("FiffStreamClient (ID %d): send queue overflow, disconnecting slow client\r\n\n", m_iDataClientId);
+        if(m_pTcpSocket)
+            m_pTcpSocket->abort();
+        return;
+    }
+
+    flush();
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamClient::sendProfiledRawBuffer(QString p_sProfileKey, QByteArray p_blockRawBuffer)
+{
+    if(!m_bIsSendingRawBuffer || p_sProfileKey != m_sStreamProfileKey)
+        return;
+
+    m_qMutex.lock();
+    bool t_bQueued = m_sendQueue.enqueueRaw(p_blockRawBuffer);
+    m_qMutex.unlock();
+
+    if(!t_bQueued)
+    {
+        printf("FiffStreamClient (ID %d): send queue overflow, disconnecting slow client\r\n\n", m_iDataClientId);
+        if(m_pTcpSocket)
+            m_pTcpSocket->abort();
+        return;
+    }
+
+    flush();
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamClient::setSendQueue(SendQueue::SlowClientPolicy p_policy, qint64 p_iMaxBytes)
+{
+    QMutexLocker t_locker(&m_qMutex);
+    m_sendQueue.setPolicy(p_policy);
+    m_sendQueue.setMaxBytes(p_iMaxBytes);
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamClient::getSendQueueStats(SendQueue::Stats& p_stats, SendQueue::SlowClientPolicy& p_policy) const
+{
+    QMutexLocker t_locker(&m_qMutex);
+    p_stats = m_sendQueue.stats();
+    p_policy = m_sendQueue.policy();
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamClient::enqueueBlock(const QByteArray& p_blockSend)
+{
+    m_qMutex.lock();
+    m_sendQueue.enqueueControl(p_blockSend);
+    m_qMutex.unlock();
+
+    flush();
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamClient::flush()
+{
+    if(!m_pTcpSocket || m_pTcpSocket->state() != QAbstractSocket::ConnectedState)
+        return;
+
+    //
+    // The buffered socket has to be drained first to keep the order of the stream, writing is resumed in onBytesWritten
+    //
+    if(m_pTcpSocket->bytesToWrite() > 0)
+        return;
+
+    m_qMutex.lock();
+
+#ifdef Q_OS_UNIX
+    int t_iFlags = 0;
+#ifdef MSG_NOSIGNAL
+    t_iFlags = MSG_NOSIGNAL;
+#endif
+
+    while(!m_sendQueue.isEmpty())
+    {
+        //
+        // Gather the queued blocks into one scatter write
+        //
+        struct iovec t_iov[maxIoVec];
+        int t_iNumVec = 0;
+        qint64 t_iBytesRequested = 0;
+        for(qint32 i = 0; i < m_sendQueue.size() && t_iNumVec < maxIoVec; ++i)
+        {
+            qint32 t_iOffset = (i == 0) ? m_sendQueue.headOffset() : 0;
+            t_iov[t_iNumVec].iov_base = (void*)(m_sendQueue.at(i).constData() + t_iOffset);
+            t_iov[t_iNumVec].iov_len = m_sendQueue.at(i).size() - t_iOffset;
+            t_iBytesRequested += t_iov[t_iNumVec].iov_len;
+            ++t_iNumVec;
+        }
+
+        struct msghdr t_msg;
+        memset(&t_msg, 0, sizeof(t_msg));
+        t_msg.msg_iov = t_iov;
+        t_msg.msg_iovlen = t_iNumVec;
+
+        qint64 t_iBytesWritten = ::sendmsg(m_pTcpSocket->socketDescriptor(), &t_msg, t_iFlags);
+        if(t_iBytesWritten < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            if(errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+
+            m_qMutex.unlock();
+            printf("FiffStreamClient (ID %d): write failed (%s)\r\n\n", m_iDataClientId, strerror(errno));
+            m_pTcpSocket->abort();
+            return;
+        }
+
+        //drop the blocks which were written completely
+        m_sendQueue.consume(t_iBytesWritten);
+
+        //kernel send buffer is full
+        if(t_iBytesWritten < t_iBytesRequested)
+            break;
+    }
+#endif
+
+    //
+    // Hand the rest of the head block to the buffered socket, it is written as soon as the socket gets writable
+    //
+    QByteArray t_blockHead = m_sendQueue.takeFirst();
+
+    m_qMutex.unlock();
+
+    if(!t_blockHead.isEmpty())
+        m_pTcpSocket->write(t_blockHead);
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamClient::onBytesWritten(qint64 bytes)
+{
+    Q_UNUSED(bytes);
+
+    if(m_pTcpSocket->bytesToWrite() == 0)
+        flush();
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamClient::onDisconnected()
+{
+    m_qMutex.lock();
+    m_sendQueue.clear();
+    m_qMutex.unlock();
+
+    emit clientDisconnected(m_iDataClientId);
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamClient::readProc()
+{
+    FiffStream t_FiffStreamIn(m_pTcpSocket);
+
+    forever
+    {
+        if(!m_pPendingTag)
+        {
+            if(m_pTcpSocket->bytesAvailable() < (int)sizeof(qint32)*4)
+                return;
+
+            FiffTag::read_tag_info(&t_FiffStreamIn, m_pPendingTag, false);
+        }
+
+        //
+        // wait for the next readyRead until tag size data are available
+        //
+        if(m_pTcpSocket->bytesAvailable() < m_pPendingTag->size())
+            return;
+
+        FiffTag::read_tag_data(&t_FiffStreamIn, m_pPendingTag);
+
+        //
+        // Parse the tag
+        //
+        if(m_pPendingTag->kind == FIFF_MNE_RT_COMMAND)
+            parseCommand(m_pPendingTag);
+
+        m_pPendingTag.clear();
+    }
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamClient::parseCommand(FiffTag::SPtr p_pTag)
+{
+    if(p_pTag->size() >= 4)
+    {
+        qint32* t_pInt = (qint32*)p_pTag->data();
+        IOUtils::swap_intp(t_pInt);
+        qint32 t_iCmd = t_pInt[0];
+
+        if(t_iCmd == MNE_RT_SET_CLIENT_ALIAS)
+        {
+            //
+            // Set Client Alias
+            //
+            m_qMutex.lock();
+            m_sDataClientAlias = QString(p_pTag->mid(4, p_pTag->size()-4));
+            m_qMutex.unlock();
+            printf("FiffStreamClient (ID %d): new alias = '%s'\r\n\n", m_iDataClientId, getAlias().toUtf8().constData());
+        }
+        else if(t_iCmd == MNE_RT_GET_CLIENT_ID)
+        {
+            //
+            // Send Client ID
+            //
+            printf("FiffStreamClient (ID %d): send client ID %d\r\n\n", m_iDataClientId, m_iDataClientId);
+            writeClientId();
+        }
+        else if(t_iCmd == MNE_RT_SET_STREAM_PROFILE)
+        {
+            //
+            // Set Stream Profile
+            //
+            QString t_sKey = QString(p_pTag->mid(4, p_pTag->size()-4));
+            StreamProfile t_profile;
+            if(!StreamProfile::fromKey(t_sKey, t_profile))
+            {
+                printf("FiffStreamClient (ID %d): invalid stream profile '%s'\r\n\n", m_iDataClientId, t_sKey.toUtf8().constData());
+                return;
+            }
+
+            m_sStreamProfileKey = t_profile.isDefault() ? QString() : t_profile.key();
+
+            printf("FiffStreamClient (ID %d): stream profile = '%s'\r\n\n", m_iDataClientId, m_sStreamProfileKey.isEmpty() ? "default" : m_sStreamProfileKey.toUtf8().constData());
+            emit streamProfileChanged(m_iDataClientId, m_sStreamProfileKey);
+        }
+        else
+        {
+            printf("FiffStreamClient (ID %d): unknown command\r\n\n", m_iDataClientId);
+        }
+    }
+    else
+    {
+        printf("FiffStreamClient (ID %d): unknown command\r\n\n", m_iDataClientId);
+    }
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamClient::writeClientId()
+{
+    QByteArray t_blockClientId;
+    {
+        FiffStream t_FiffStreamOut(&t_blockClientId, QIODevice::WriteOnly);
+        t_FiffStreamOut.write_int(FIFF_MNE_RT_CLIENT_ID, &m_iDataClientId);
+    }
+
+    enqueueBlock(t_blockClientId);
+}
@@ -0,0 +1,235 @@
+//=============================================================================================================
+/**
+* @file     fiffstreamclient.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     January, 2015
+*
+* @section  LICENSE
+*
+* Copyright (C) 2015, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief     declaration of the FiffStreamClient Class.
+*
+*/
+
+#ifndef FIFFSTREAMCLIENT_H
+#define FIFFSTREAMCLIENT_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "sendqueue.h"
+
+#include <fiff/fiff_stream.h>
+#include <fiff/fiff_info.h>
+#include <fiff/fiff_tag.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QObject>
+#include <QTcpSocket>
+#include <QMutex>
+#include <QList>
+#include <QByteArray>
+#include <QSharedPointer>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE RTSERVER
+//=============================================================================================================
+
+namespace RTSERVER
+{
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS FiffStreamClient
+*
+* @brief The FiffStreamClient class serves one fiff data client from the event loop of a worker thread.
+*
+* In contrast to the FiffStreamThread no thread is occupied per client and nothing is polled: reading is
+* triggered by readyRead and writing by enqueued blocks and bytesWritten. Queued blocks are written with a
+* single scatter write (sendmsg) where available, otherwise block by block through the buffered socket.
+* All methods except the getters have to be called from the thread the client lives in, which is ensured
+* by connecting them to the FiffStreamServer signals with an automatic (queued) connection.
+*/
+class FiffStreamClient : public QObject
+{
+    Q_OBJECT
+public:
+    typedef QSharedPointer<FiffStreamClient> SPtr;               /**< Shared pointer type for FiffStreamClient. */
+    typedef QSharedPointer<const FiffStreamClient> ConstSPtr;    /**< Const shared pointer type for FiffStreamClient. */
+
+    //=========================================================================================================
+    /**
+    * Constructs a FiffStreamClient. The socket is not created before init() is called from the worker thread.
+    *
+    * @param[in] id                 The client id.
+    * @param[in] socketDescriptor   The native socket descriptor of the accepted connection.
+    * @param[in] parent             Parent QObject (has to be 0 when the client is moved to a worker thread).
+    */
+    FiffStreamClient(qint32 id, qintptr socketDescriptor, QObject *parent = 0);
+
+    //=========================================================================================================
+    /**
+    * Destroys the FiffStreamClient and closes the connection.
+    */
+    ~FiffStreamClient();
+
+    //=========================================================================================================
+    /**
+    * Creates the socket within the thread the client lives in and connects the socket notifications.
+    */
+    Q_INVOKABLE void init();
+
+    //=========================================================================================================
+    /**
+    * Returns the client id.
+    *
+    * @return the client id.
+    */
+    inline qint32 getID() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the client alias. Thread safe.
+    *
+    * @return the client alias.
+    */
+    QString getAlias() const;
+
+    //=========================================================================================================
+    /**
+    * Sets the slow client policy and the size of the send queue. Thread safe.
+    *
+    * @param[in] p_policy       Policy which is applied when a raw buffer does not fit into the send queue.
+    * @param[in] p_iMaxBytes    Maximal number of queued bytes.
+    */
+    void setSendQueue(SendQueue::SlowClientPolicy p_policy, qint64 p_iMaxBytes);
+
+    //=========================================================================================================
+    /**
+    * Returns the send queue counters and the slow client policy. Thread safe.
+    *
+    * @param[out] p_stats   The send queue counters.
+    * @param[out] p_policy  The slow client policy.
+    */
+    void getSendQueueStats(SendQueue::Stats& p_stats, SendQueue::SlowClientPolicy& p_policy) const;
+
+//public slots: --> in Qt 5 not anymore declared as slot
+    void startMeas(qint32 ID);
+    void stopMeas(qint32 ID);
+    void sendMeasurementInfo(qint32 ID, FiffInfo p_fiffInfo);
+    void sendRawBuffer(QByteArray p_blockRawBuffer);
+    void sendProfiledRawBuffer(QString p_sProfileKey, QByteArray p_blockRawBuffer);
+
+signals:
+    void clientDisconnected(qint32 id);
+    void error(QTcpSocket::SocketError socketError);
+
+    //=========================================================================================================
+    /**
+    * Emitted when the client requested a new stream profile.
+    *
+    * @param[in] id             ID of the client.
+    * @param[in] p_sProfileKey  Key of the requested profile; empty for the default full rate float stream.
+    */
+    void streamProfileChanged(qint32 id, QString p_sProfileKey);
+
+private:
+    //=========================================================================================================
+    /**
+    * Appends a serialised control block to the send queue and starts writing.
+    *
+    * @param[in] p_blockSend    The block to send.
+    */
+    void enqueueBlock(const QByteArray& p_blockSend);
+
+    //=========================================================================================================
+    /**
+    * Writes as much of the send queue as the socket accepts without blocking. The remainder of a partially
+    * written block is handed to the buffered socket, writing is resumed when it was written (bytesWritten).
+    */
+    void flush();
+
+    //=========================================================================================================
+    /**
+    * Reads all complete tags which are available at the socket. Incomplete tags are kept until the next
+    * readyRead.
+    */
+    void readProc();
+
+    void parseCommand(FiffTag::SPtr p_pTag);
+
+    void writeClientId();
+
+    void onBytesWritten(qint64 bytes);
+
+    void onDisconnected();
+
+    qint32 m_iDataClientId;                 /**< The client id. */
+    QString m_sDataClientAlias;             /**< The client alias. */
+    mutable QMutex m_qMutex;                /**< Guards the alias and the send queue, which are accessed from the server thread. */
+
+    qintptr m_iSocketDescriptor;            /**< The native socket descriptor. */
+    QTcpSocket* m_pTcpSocket;               /**< The socket, created in init(). */
+
+    SendQueue m_sendQueue;                  /**< Bounded queue of serialised blocks waiting to be written to the socket. */
+
+    FiffTag::SPtr m_pPendingTag;            /**< Tag whose header is read but whose data did not arrive yet. */
+
+    bool m_bIsSendingRawBuffer;             /**< Whether raw buffers are sent to this client. */
+
+    QString m_sStreamProfileKey;            /**< Key of the stream profile, empty for the default stream. Only used in the worker thread. */
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+inline qint32 FiffStreamClient::getID() const
+{
+    return m_iDataClientId;
+}
+
+} // NAMESPACE
+
+#endif // FIFFSTREAMCLIENT_H
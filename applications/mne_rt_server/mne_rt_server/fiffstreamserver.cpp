@@ -40,10 +40,19 @@
 
 #include "fiffstreamserver.h"
 #include "fiffstreamthread.h"
+#include "fiffstreamclient.h"
 
 #include "mne_rt_server.h"
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// Fiff INCLUDES
+//=============================================================================================================
+
+#include <fiff/fiff_constants.h>
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // STL INCLUDES
@@ -59,6 +68,7 @@
 
 using namespace RTSERVER;
 using namespace FIFFLIB;
+using namespace UTILSLIB;
 
 
 //*************************************************************************************************************
@@ -69,6 +79,11 @@ using namespace FIFFLIB;
 FiffStreamServer::FiffStreamServer(QObject *parent)
 : QTcpServer(parent)
 , m_iNextClientId(0)
+, m_iNextWorker(0)
+, m_slowClientPolicy(SendQueue::DROP_OLDEST)
+, m_iSendQueueMaxBytes(32*1024*1024)
+, m_bBlockStamps(false)
+, m_iSequence(0)
 {
 
 }
@@ -79,6 +94,76 @@ FiffStreamServer::FiffStreamServer(QObject *parent)
 FiffStreamServer::~FiffStreamServer()
 {
     emit closeFiffStreamServer();
+
+    //deferred deletes of the clients are processed when the worker threads finish
+    QMap<qint32, FiffStreamClient*>::iterator it;
+    for (it = m_qEventClientList.begin(); it != m_qEventClientList.end(); ++it)
+    {
+        it.value()->disconnect(this);
+        it.value()->deleteLater();
+    }
+    m_qEventClientList.clear();
+
+    for(qint32 i = 0; i < m_qListWorkerThreads.size(); ++i)
+    {
+        m_qListWorkerThreads[i]->quit();
+        m_qListWorkerThreads[i]->wait();
+        delete m_qListWorkerThreads[i];
+    }
+    m_qListWorkerThreads.clear();
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamServer::setEventLoopMode(qint32 p_iNumWorkers)
+{
+    if(this->isListening() || !m_qListWorkerThreads.isEmpty())
+    {
+        printf("FiffStreamServer: event loop mode has to be set once before listening.\n");//ToDo throw
+        return;
+    }
+
+    if(p_iNumWorkers < 1)
+        p_iNumWorkers = 1;
+
+    for(qint32 i = 0; i < p_iNumWorkers; ++i)
+    {
+        QThread* t_pWorkerThread = new QThread;
+        t_pWorkerThread->start();
+        m_qListWorkerThreads.append(t_pWorkerThread);
+    }
+
+    printf("FiffStreamServer: serving clients by %d worker event loops.\n", p_iNumWorkers);
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamServer::setSendQueueDefaults(SendQueue::SlowClientPolicy p_policy, qint64 p_iMaxBytes)
+{
+    m_slowClientPolicy = p_policy;
+    m_iSendQueueMaxBytes = p_iMaxBytes;
+
+    printf("FiffStreamServer: send queue of %lld KB per client, slow client policy '%s'.\n", p_iMaxBytes/1024, SendQueue::policyName(p_policy).toUtf8().constData());
+}
+
+
+//*************************************************************************************************************
+
+QMap<qint32, QString> FiffStreamServer::getClientAliases() const
+{
+    QMap<qint32, QString> t_qMapAliases;
+
+    QMap<qint32, FiffStreamThread*>::const_iterator i;
+    for (i = this->m_qClientList.begin(); i != this->m_qClientList.end(); ++i)
+        t_qMapAliases.insert(i.key(), i.value()->getAlias());
+
+    QMap<qint32, FiffStreamClient*>::const_iterator j;
+    for (j = this->m_qEventClientList.begin(); j != this->m_qEventClientList.end(); ++j)
+        t_qMapAliases.insert(j.key(), j.value()->getAlias());
+
+    return t_qMapAliases;
 }
 
 
@@ -89,10 +174,11 @@ void FiffStreamServer::comClist(Command p_command)
     //ToDo JSON
     QString t_sOutput("");
     t_sOutput.append("\tID\tAlias\r\n");
-    QMap<qint32, FiffStreamThread*>::iterator i;
-    for (i = this->m_qClientList.begin(); i != this->m_qClientList.end(); ++i)
+    QMap<qint32, QString> t_qMapAliases = this->getClientAliases();
+    QMap<qint32, QString>::iterator i;
+    for (i = t_qMapAliases.begin(); i != t_qMapAliases.end(); ++i)
     {
-        QString str = QString("\t%1\t%2\r\n").arg(i.key()).arg(i.value()->getAlias());
+        QString str = QString("\t%1\t%2\r\n").arg(i.key()).arg(i.value());
         t_sOutput.append(str);
     }
     t_sOutput.append("\n");
@@ -173,6 +259,106 @@ void FiffStreamServer::comStopAll(Command p_command)
 }
 
 
+//*************************************************************************************************************
+
+void FiffStreamServer::comClientStats(Command p_command)
+{
+    //ToDo JSON
+    QString t_sOutput("");
+    t_sOutput.append("\tID\tAlias\tPolicy\t\tQueued [KB]\tMax queued [KB]\tSent\tDropped\tDecimated\r\n");
+
+    SendQueue::Stats t_stats;
+    SendQueue::SlowClientPolicy t_policy;
+    QMap<qint32, QString> t_qMapAliases = this->getClientAliases();
+    QMap<qint32, QString>::iterator i;
+    for (i = t_qMapAliases.begin(); i != t_qMapAliases.end(); ++i)
+    {
+        if(m_qClientList.contains(i.key()))
+            m_qClientList[i.key()]->getSendQueueStats(t_stats, t_policy);
+        else
+            m_qEventClientList[i.key()]->getSendQueueStats(t_stats, t_policy);
+
+        QString str = QString("\t%1\t%2\t%3\t%4\t\t%5\t\t%6\t%7\t%8\r\n").arg(i.key()).arg(i.value()).arg(SendQueue::policyName(t_policy))
+                .arg(t_stats.numBytes/1024).arg(t_stats.maxNumBytes/1024).arg(t_stats.sent).arg(t_stats.dropped).arg(t_stats.decimated);
+        t_sOutput.append(str);
+    }
+    t_sOutput.append("\n");
+    qobject_cast<MNERTServer*>(this->parent())->getCommandManager()["clientstats"].reply(t_sOutput);
+
+    Q_UNUSED(p_command);
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamServer::comClientPolicy(Command p_command)
+{
+    qint32 t_id = -1;
+    QString t_sOutput("");
+    QString t_sAlias(p_command.pValues()[0].toString());
+    t_sOutput.append(parseToId(t_sAlias,t_id));
+
+    SendQueue::SlowClientPolicy t_policy;
+    if(!SendQueue::parsePolicy(p_command.pValues()[1].toString(), t_policy))
+    {
+        t_sOutput.append("\twarning: unknown policy, use drop-oldest, decimate or disconnect\r\n\n");
+    }
+    else if(t_id != -1)
+    {
+        if(m_qClientList.contains(t_id))
+            m_qClientList[t_id]->setSendQueue(t_policy, m_iSendQueueMaxBytes);
+        else
+            m_qEventClientList[t_id]->setSendQueue(t_policy, m_iSendQueueMaxBytes);
+
+        QString str = QString("\tFiffStreamClient (ID: %1) slow client policy is now '%2'\r\n\n").arg(t_id).arg(SendQueue::policyName(t_policy));
+        t_sOutput.append(str);
+    }
+    qobject_cast<MNERTServer*>(this->parent())->getCommandManager()["clientpolicy"].reply(t_sOutput);
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamServer::comLatency(Command p_command)
+{
+    //ToDo JSON
+    QString t_sOutput("");
+    t_sOutput.append(QString("\tblock stamps %1\r\n").arg(m_bBlockStamps ? "on" : "off"));
+    t_sOutput.append(QString("\t%1\r\n").arg(m_histForward.toString("forward")));
+
+    SendQueue::Stats t_stats;
+    SendQueue::SlowClientPolicy t_policy;
+    QMap<qint32, QString> t_qMapAliases = this->getClientAliases();
+    QMap<qint32, QString>::iterator i;
+    for (i = t_qMapAliases.begin(); i != t_qMapAliases.end(); ++i)
+    {
+        if(m_qClientList.contains(i.key()))
+            m_qClientList[i.key()]->getSendQueueStats(t_stats, t_policy);
+        else
+            m_qEventClientList[i.key()]->getSendQueueStats(t_stats, t_policy);
+
+        t_sOutput.append(QString("\tClient %1 (%2), dropped %3\r\n").arg(i.key()).arg(i.value()).arg(t_stats.dropped + t_stats.decimated));
+        t_sOutput.append(QString("\t\t%1\r\n").arg(t_stats.queueLatency.toString("queue latency")));
+        t_sOutput.append(QString("\t\t%1\r\n").arg(t_stats.queueDepth.toString("queue depth", "blocks")));
+    }
+    t_sOutput.append("\n");
+    qobject_cast<MNERTServer*>(this->parent())->getCommandManager()["latency"].reply(t_sOutput);
+
+    Q_UNUSED(p_command);
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamServer::comBlockStamps(Command p_command)
+{
+    m_bBlockStamps = p_command.pValues()[0].toInt() != 0;
+
+    QString t_sOutput = QString("\tblock stamps %1\r\n\n").arg(m_bBlockStamps ? "on" : "off");
+    qobject_cast<MNERTServer*>(this->parent())->getCommandManager()["blockstamps"].reply(t_sOutput);
+}
+
+
 //*************************************************************************************************************
 
 void FiffStreamServer::connectCommands()
@@ -185,6 +371,10 @@ void FiffStreamServer::connectCommands()
     QObject::connect(&t_pMNERTServer->getCommandManager()["start"], &Command::executed, this, &FiffStreamServer::comStart);
     QObject::connect(&t_pMNERTServer->getCommandManager()["stop"], &Command::executed, this, &FiffStreamServer::comStop);
     QObject::connect(&t_pMNERTServer->getCommandManager()["stop-all"], &Command::executed, this, &FiffStreamServer::comStopAll);
+    QObject::connect(&t_pMNERTServer->getCommandManager()["clientstats"], &Command::executed, this, &FiffStreamServer::comClientStats);
+    QObject::connect(&t_pMNERTServer->getCommandManager()["clientpolicy"], &Command::executed, this, &FiffStreamServer::comClientPolicy);
+    QObject::connect(&t_pMNERTServer->getCommandManager()["latency"], &Command::executed, this, &FiffStreamServer::comLatency);
+    QObject::connect(&t_pMNERTServer->getCommandManager()["blockstamps"], &Command::executed, this, &FiffStreamServer::comBlockStamps);
 
 //    t_pMNERTServer->getCommandManager().connectSlot(QString("clist"), this, &FiffStreamServer::comClist);
 //    t_pMNERTServer->getCommandManager().connectSlot(QString("measinfo"), this, &FiffStreamServer::comMeasinfo);
@@ -316,19 +506,21 @@ QByteArray FiffStreamServer::parseToId(QString& p_sRawId, qint32& p_iParsedId)
         bool t_isInt;
         qint32 t_id = p_sRawId.toInt(&t_isInt);
 
-        if(t_isInt && this->m_qClientList.contains(t_id))
+        QMap<qint32, QString> t_qMapAliases = this->getClientAliases();
+
+        if(t_isInt && t_qMapAliases.contains(t_id))
         {
             p_iParsedId = t_id;
         }
         else
         {
-            QMap<qint32, FiffStreamThread*>::iterator i;
-            for (i = this->m_qClientList.begin(); i != this->m_qClientList.end(); ++i)
+            QMap<qint32, QString>::iterator i;
+            for (i = t_qMapAliases.begin(); i != t_qMapAliases.end(); ++i)
             {
-                if(i.value()->getAlias().compare(p_sRawId) == 0)
+                if(i.value().compare(p_sRawId) == 0)
                 {
                     p_iParsedId = i.key();
-                    QString str = QString("\tconvert alias '%1' => %2\r\n").arg(i.value()->getAlias()).arg(i.key());
+                    QString str = QString("\tconvert alias '%1' => %2\r\n").arg(i.value()).arg(i.key());
                     t_blockCmdIdInfo.append(str);
                     break;
                 }
@@ -376,7 +568,120 @@ void FiffStreamServer::forwardMeasInfo(qint32 ID, FiffInfo p_fiffInfo)
 //ToDo increase preformance --> try inline
 void FiffStreamServer::forwardRawBuffer(QSharedPointer<Eigen::MatrixXf> m_pMatRawData)
 {
-    emit remitRawBuffer(m_pMatRawData);
+    if(m_qClientList.isEmpty() && m_qEventClientList.isEmpty())
+        return;
+
+    qint64 t_iArrival = LatencyHistogram::now();
+
+    //
+    // Serialise once - the implicitly shared block is not modified afterwards, so all clients send the same data
+    //
+    if(m_qClientList.size() + m_qEventClientList.size() > m_qMapClientProfiles.size())
+    {
+        QByteArray t_blockRawBuffer;
+        if(m_bBlockStamps)
+            t_blockRawBuffer = blockStamp(m_iSequence, t_iArrival);
+        ++m_iSequence;
+
+        {
+            FiffStream t_FiffStreamOut(&t_blockRawBuffer, QIODevice::WriteOnly);
+            t_FiffStreamOut.device()->seek(t_blockRawBuffer.size());
+            t_FiffStreamOut.write_float(FIFF_DATA_BUFFER,m_pMatRawData->data(),m_pMatRawData->rows()*m_pMatRawData->cols());
+        }
+
+        emit remitRawBuffer(t_blockRawBuffer);
+    }
+
+    //
+    // Encode once per profile - the encoders have to see every buffer to keep their filter state
+    //
+    QMap<QString, StreamEncoder::SPtr>::iterator it;
+    for(it = m_qMapEncoders.begin(); it != m_qMapEncoders.end(); ++it)
+    {
+        QByteArray t_blockProfiled = it.value()->encode(*m_pMatRawData);
+        if(!t_blockProfiled.isEmpty())
+        {
+            qint32& t_iSequence = m_qMapSequences[it.key()];
+            if(m_bBlockStamps)
+                t_blockProfiled.prepend(blockStamp(t_iSequence, t_iArrival));
+            ++t_iSequence;
+
+            emit remitProfiledRawBuffer(it.key(), t_blockProfiled);
+        }
+    }
+
+    m_histForward.add(LatencyHistogram::now() - t_iArrival);
+}
+
+
+//*************************************************************************************************************
+
+QByteArray FiffStreamServer::blockStamp(qint32 p_iSequence, qint64 p_iTime)
+{
+    //sequence and time in the fiffTimeRec convention (sec, usec)
+    fiff_int_t t_aStamp[3];
+    t_aStamp[0] = p_iSequence;
+    t_aStamp[1] = (fiff_int_t)(p_iTime / 1000000);
+    t_aStamp[2] = (fiff_int_t)(p_iTime % 1000000);
+
+    QByteArray t_blockStamp;
+    {
+        FiffStream t_FiffStreamOut(&t_blockStamp, QIODevice::WriteOnly);
+        t_FiffStreamOut.write_int(FIFF_MNE_RT_BLOCK_STAMP, t_aStamp, 3);
+    }
+
+    return t_blockStamp;
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamServer::setClientStreamProfile(qint32 id, QString p_sProfileKey)
+{
+    //a queued request can arrive after the client is gone
+    if(!p_sProfileKey.isEmpty() && !m_qClientList.contains(id) && !m_qEventClientList.contains(id))
+        return;
+
+    if(p_sProfileKey.isEmpty())
+        m_qMapClientProfiles.remove(id);
+    else
+        m_qMapClientProfiles.insert(id, p_sProfileKey);
+
+    //
+    // Create the encoders of new profiles and release the unused ones
+    //
+    QStringList t_qListUsedKeys = m_qMapClientProfiles.values();
+
+    QMap<QString, StreamEncoder::SPtr>::iterator it = m_qMapEncoders.begin();
+    while(it != m_qMapEncoders.end())
+    {
+        if(t_qListUsedKeys.contains(it.key()))
+            ++it;
+        else
+        {
+            m_qMapSequences.remove(it.key());
+            it = m_qMapEncoders.erase(it);
+        }
+    }
+
+    if(!p_sProfileKey.isEmpty() && !m_qMapEncoders.contains(p_sProfileKey))
+    {
+        StreamProfile t_profile;
+        if(StreamProfile::fromKey(p_sProfileKey, t_profile))
+            m_qMapEncoders.insert(p_sProfileKey, StreamEncoder::SPtr(new StreamEncoder(t_profile)));
+    }
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamServer::removeEventClient(qint32 id)
+{
+    FiffStreamClient* t_pClient = m_qEventClientList.take(id);
+    if(t_pClient)
+        t_pClient->deleteLater();
+
+    setClientStreamProfile(id, QString());
 }
 
 
@@ -384,7 +689,33 @@ void FiffStreamServer::forwardRawBuffer(QSharedPointer<Eigen::MatrixXf> m_pMatRa
 
 void FiffStreamServer::incomingConnection(qintptr socketDescriptor)
 {
+    if(isEventLoopMode())
+    {
+        //
+        // Assign the client round robin to the event loop of a worker thread
+        //
+        FiffStreamClient* t_pClient = new FiffStreamClient(m_iNextClientId, socketDescriptor);
+        t_pClient->setSendQueue(m_slowClientPolicy, m_iSendQueueMaxBytes);
+        t_pClient->moveToThread(m_qListWorkerThreads[m_iNextWorker]);
+        m_iNextWorker = (m_iNextWorker + 1) % m_qListWorkerThreads.size();
+
+        m_qEventClientList.insert(m_iNextClientId, t_pClient);
+        ++m_iNextClientId;
+
+        connect(this, &FiffStreamServer::remitMeasInfo, t_pClient, &FiffStreamClient::sendMeasurementInfo);
+        connect(this, &FiffStreamServer::remitRawBuffer, t_pClient, &FiffStreamClient::sendRawBuffer);
+        connect(this, &FiffStreamServer::remitProfiledRawBuffer, t_pClient, &FiffStreamClient::sendProfiledRawBuffer);
+        connect(this, &FiffStreamServer::startMeasFiffStreamClient, t_pClient, &FiffStreamClient::startMeas);
+        connect(this, &FiffStreamServer::stopMeasFiffStreamClient, t_pClient, &FiffStreamClient::stopMeas);
+        connect(t_pClient, &FiffStreamClient::clientDisconnected, this, &FiffStreamServer::removeEventClient);
+        connect(t_pClient, &FiffStreamClient::streamProfileChanged, this, &FiffStreamServer::setClientStreamProfile);
+
+        QMetaObject::invokeMethod(t_pClient, "init", Qt::QueuedConnection);
+        return;
+    }
+
     FiffStreamThread* t_pStreamThread = new FiffStreamThread(m_iNextClientId, socketDescriptor, this);
+    t_pStreamThread->setSendQueue(m_slowClientPolicy, m_iSendQueueMaxBytes);
 
     m_qClientList.insert(m_iNextClientId, t_pStreamThread);
     ++m_iNextClientId;
@@ -392,6 +723,7 @@ void FiffStreamServer::incomingConnection(qintptr socketDescriptor)
     //when thread has finished it gets deleted
     connect(t_pStreamThread, SIGNAL(finished()), t_pStreamThread, SLOT(deleteLater()));
     connect(this, SIGNAL(closeFiffStreamServer()), t_pStreamThread, SLOT(deleteLater()));
+    connect(t_pStreamThread, &FiffStreamThread::streamProfileChanged, this, &FiffStreamServer::setClientStreamProfile);
 
     t_pStreamThread->start();
 }
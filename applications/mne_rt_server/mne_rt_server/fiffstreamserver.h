@@ -41,6 +41,9 @@
 // MNE INCLUDES
 //=============================================================================================================
 
+#include "sendqueue.h"
+#include "streamencoder.h"
+
 #include <fiff/fiff_info.h>
 #include <rtCommand/commandmanager.h>
 
@@ -52,6 +55,9 @@
 
 #include <QStringList>
 #include <QTcpServer>
+#include <QThread>
+#include <QList>
+#include <QMap>
 
 
 //*************************************************************************************************************
@@ -77,6 +83,7 @@ using namespace RTCOMMANDLIB;
 //=============================================================================================================
 
 class FiffStreamThread;
+class FiffStreamClient;
 
 //=============================================================================================================
 /**
@@ -89,6 +96,7 @@ class FiffStreamServer : public QTcpServer//, public ICommandParser //OLD remove
     Q_OBJECT
 
     friend class FiffStreamThread;
+    friend class FiffStreamClient;
 
 public:
 
@@ -112,6 +120,61 @@ public:
     */
     void connectCommands();
 
+    //=========================================================================================================
+    /**
+    * Switches the server to the event loop mode: instead of a FiffStreamThread per client, all clients are
+    * served as FiffStreamClients by the event loops of a small number of worker threads. Has to be called
+    * before listen().
+    *
+    * @param[in] p_iNumWorkers  Number of worker threads (at least 1).
+    */
+    void setEventLoopMode(qint32 p_iNumWorkers);
+
+    //=========================================================================================================
+    /**
+    * Returns whether the clients are served by worker event loops.
+    *
+    * @return true if the event loop mode is active, false for one thread per client.
+    */
+    inline bool isEventLoopMode() const;
+
+    //=========================================================================================================
+    /**
+    * Sets the slow client policy and the send queue size which are assigned to new clients.
+    *
+    * @param[in] p_policy       Policy which is applied when a raw buffer does not fit into the send queue.
+    * @param[in] p_iMaxBytes    Maximal number of queued bytes per client.
+    */
+    void setSendQueueDefaults(SendQueue::SlowClientPolicy p_policy, qint64 p_iMaxBytes);
+
+    //=========================================================================================================
+    /**
+    * Returns the aliases of all connected clients of both modes.
+    *
+    * @return the aliases mapped to the client ids.
+    */
+    QMap<qint32, QString> getClientAliases() const;
+
+    //=========================================================================================================
+    /**
+    * Assigns a stream profile to a client. Clients with equal profiles share one StreamEncoder, encoders which
+    * are not used anymore are released.
+    *
+    * @param[in] id             ID of the client.
+    * @param[in] p_sProfileKey  Key of the profile (see StreamProfile); empty for the default stream.
+    */
+    void setClientStreamProfile(qint32 id, QString p_sProfileKey);
+
+    //=========================================================================================================
+    /**
+    * Enables the block stamps: every raw buffer is preceded by a FIFF_MNE_RT_BLOCK_STAMP tag which holds the
+    * sequence number of the buffer and its arrival time at the server, so that clients can measure their
+    * latency and detect lost buffers.
+    *
+    * @param[in] p_bEnable  Whether raw buffers are stamped.
+    */
+    inline void setBlockStamps(bool p_bEnable);
+
 //    virtual bool parseCommand(QStringList& p_sListCommand, QByteArray& p_blockOutputInfo);
 
 
@@ -123,6 +186,15 @@ public:
 
 //public slots: --> in Qt 5 not anymore declared as slot
     void forwardMeasInfo(qint32 ID, FiffInfo p_fiffInfo);
+
+    //=========================================================================================================
+    /**
+    * Serialises the raw buffer once into a FIFF_DATA_BUFFER tag and remits the resulting block to all
+    * FiffStreamThreads. The block is implicitly shared, every client enqueues the same bytes. The buffer is
+    * encoded once more per distinct stream profile and remitted with remitProfiledRawBuffer.
+    *
+    * @param[in] m_pMatRawData  The raw buffer to forward.
+    */
     void forwardRawBuffer(QSharedPointer<Eigen::MatrixXf> m_pMatRawData);
 
 signals:
@@ -132,7 +204,8 @@ signals:
     void stopMeasFiffStreamClient(qint32 ID);
 
     void remitMeasInfo(qint32 ID, FIFFLIB::FiffInfo p_fiffInfo);
-    void remitRawBuffer(QSharedPointer<Eigen::MatrixXf>);
+    void remitRawBuffer(QByteArray p_blockRawBuffer);
+    void remitProfiledRawBuffer(QString p_sProfileKey, QByteArray p_blockRawBuffer);
 
     void closeFiffStreamServer();
 
@@ -181,11 +254,77 @@ private:
     */
     void comStopAll(Command p_command);
 
+    //=========================================================================================================
+    /**
+    * Send queue counters of all fiff data clients
+    *
+    * @param[in] p_command  The client stats command.
+    */
+    void comClientStats(Command p_command);
+
+    //=========================================================================================================
+    /**
+    * Sets the slow client policy of a fiff data client
+    *
+    * @param[in] p_command  The client policy command.
+    */
+    void comClientPolicy(Command p_command);
+
+    //=========================================================================================================
+    /**
+    * Latency histograms of the server and of all fiff data clients
+    *
+    * @param[in] p_command  The latency command.
+    */
+    void comLatency(Command p_command);
+
+    //=========================================================================================================
+    /**
+    * Enables or disables the block stamps
+    *
+    * @param[in] p_command  The block stamps command.
+    */
+    void comBlockStamps(Command p_command);
+
+    //=========================================================================================================
+    /**
+    * Serialises a FIFF_MNE_RT_BLOCK_STAMP tag.
+    *
+    * @param[in] p_iSequence    Sequence number of the raw buffer.
+    * @param[in] p_iTime        Arrival time of the raw buffer [us since the epoch].
+    *
+    * @return the serialised tag.
+    */
+    static QByteArray blockStamp(qint32 p_iSequence, qint64 p_iTime);
+
     QByteArray parseToId(QString& p_sRawId, qint32& p_iParsedId);
 
+    //=========================================================================================================
+    /**
+    * Removes a disconnected event loop client.
+    *
+    * @param[in] id     The id of the disconnected client.
+    */
+    void removeEventClient(qint32 id);
+
     QMap<qint32, FiffStreamThread*> m_qClientList;
     qint32                          m_iNextClientId;
 
+    QMap<qint32, FiffStreamClient*> m_qEventClientList;     /**< Clients served by the worker event loops. */
+    QList<QThread*>                 m_qListWorkerThreads;   /**< Worker threads of the event loop mode, empty for one thread per client. */
+    qint32                          m_iNextWorker;          /**< Worker which gets the next client assigned. */
+
+    SendQueue::SlowClientPolicy     m_slowClientPolicy;     /**< Slow client policy of new clients. */
+    qint64                          m_iSendQueueMaxBytes;   /**< Send queue size of new clients. */
+
+    QMap<qint32, QString>                   m_qMapClientProfiles;   /**< Profile keys of the clients which do not receive the default stream. */
+    QMap<QString, StreamEncoder::SPtr>      m_qMapEncoders;         /**< One encoder per distinct profile key. */
+
+    bool                                    m_bBlockStamps;         /**< Whether raw buffers are preceded by a block stamp. */
+    qint32                                  m_iSequence;            /**< Sequence number of the next default raw buffer. */
+    QMap<QString, qint32>                   m_qMapSequences;        /**< Sequence number of the next raw buffer per profile key. */
+    UTILSLIB::LatencyHistogram              m_histForward;          /**< Time from the arrival of a raw buffer until all blocks were remitted [us]. */
+
 };
 
 
@@ -199,6 +338,22 @@ FiffStreamThread* FiffStreamServer::getClient(qint32 id)
     return m_qClientList[id];
 }
 
+
+//*************************************************************************************************************
+
+inline bool FiffStreamServer::isEventLoopMode() const
+{
+    return !m_qListWorkerThreads.isEmpty();
+}
+
+
+//*************************************************************************************************************
+
+inline void FiffStreamServer::setBlockStamps(bool p_bEnable)
+{
+    m_bBlockStamps = p_bEnable;
+}
+
 } // NAMESPACE
 
 #endif //FIFFSTREAMSERVER_H
@@ -42,6 +42,7 @@
 #include "fiffstreamthread.h"
 #include "fiffstreamserver.h"
 #include "mne_rt_commands.h"
+#include "streamprofile.h"
 
 
 //*************************************************************************************************************
@@ -95,7 +96,10 @@ FiffStreamThread::~FiffStreamThread()
     //Remove from client list
     FiffStreamServer* t_pFiffStreamServer = qobject_cast<FiffStreamServer*>(this->parent());
     if(t_pFiffStreamServer)
+    {
         t_pFiffStreamServer->m_qClientList.remove(m_iDataClientId);
+        t_pFiffStreamServer->setClientStreamProfile(m_iDataClientId, QString());
+    }
 
     m_bIsRunning = false;
     QThread::wait();
@@ -110,10 +114,14 @@ void FiffStreamThread::startMeas(qint32 ID)
     {
         qDebug() << "Activate raw buffer sending.";
 
+        QByteArray t_blockStart;
+        {
+            FiffStream t_FiffStreamOut(&t_blockStart, QIODevice::WriteOnly);
+            t_FiffStreamOut.start_block(FIFFB_RAW_DATA);
+        }
+
         m_qMutex.lock();
-        // ToDo send start meas
-        FiffStream t_FiffStreamOut(&m_qSendBlock, QIODevice::WriteOnly);
-        t_FiffStreamOut.start_block(FIFFB_RAW_DATA);
+        m_sendQueue.enqueueControl(t_blockStart);
         m_bIsSendingRawBuffer = true;
         m_qMutex.unlock();
     }
@@ -129,9 +137,14 @@ void FiffStreamThread::stopMeas(qint32 ID)
     {
         qDebug() << "stop raw buffer sending.";
 
+        QByteArray t_blockEnd;
+        {
+            FiffStream t_FiffStreamOut(&t_blockEnd, QIODevice::WriteOnly);
+            t_FiffStreamOut.end_block(FIFFB_RAW_DATA);
+        }
+
         m_qMutex.lock();
-        FiffStream t_FiffStreamOut(&m_qSendBlock, QIODevice::WriteOnly);
-        t_FiffStreamOut.end_block(FIFFB_RAW_DATA);
+        m_sendQueue.enqueueControl(t_blockEnd);
         m_bIsSendingRawBuffer = false;
         m_qMutex.unlock();
     }
@@ -164,6 +177,27 @@ void FiffStreamThread::parseCommand(FiffTag::SPtr p_pTag)
             printf("FiffStreamClient (ID %d): send client ID %d\r\n\n", m_iDataClientId, m_iDataClientId);
             writeClientId();
         }
+        else if(t_iCmd == MNE_RT_SET_STREAM_PROFILE)
+        {
+            //
+            // Set Stream Profile
+            //
+            QString t_sKey = QString(p_pTag->mid(4, p_pTag->size()-4));
+            StreamProfile t_profile;
+            if(!StreamProfile::fromKey(t_sKey, t_profile))
+            {
+                printf("FiffStreamClient (ID %d): invalid stream profile '%s'\r\n\n", m_iDataClientId, t_sKey.toUtf8().constData());
+                return;
+            }
+
+            m_qMutex.lock();
+            m_sStreamProfileKey = t_profile.isDefault() ? QString() : t_profile.key();
+            t_sKey = m_sStreamProfileKey;
+            m_qMutex.unlock();
+
+            printf("FiffStreamClient (ID %d): stream profile = '%s'\r\n\n", m_iDataClientId, t_sKey.isEmpty() ? "default" : t_sKey.toUtf8().constData());
+            emit streamProfileChanged(m_iDataClientId, t_sKey);
+        }
         else
         {
             printf("FiffStreamClient (ID %d): unknown command\r\n\n", m_iDataClientId);
@@ -178,19 +212,56 @@ void FiffStreamThread::parseCommand(FiffTag::SPtr p_pTag)
 
 //*************************************************************************************************************
 
-void FiffStreamThread::sendRawBuffer(QSharedPointer<Eigen::MatrixXf> m_pMatRawData)
+void FiffStreamThread::enqueueBlock(const QByteArray& p_blockSend)
+{
+    m_qMutex.lock();
+    m_sendQueue.enqueueControl(p_blockSend);
+    m_qMutex.unlock();
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamThread::setSendQueue(SendQueue::SlowClientPolicy p_policy, qint64 p_iMaxBytes)
+{
+    QMutexLocker t_locker(&m_qMutex);
+    m_sendQueue.setPolicy(p_policy);
+    m_sendQueue.setMaxBytes(p_iMaxBytes);
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamThread::getSendQueueStats(SendQueue::Stats& p_stats, SendQueue::SlowClientPolicy& p_policy)
+{
+    QMutexLocker t_locker(&m_qMutex);
+    p_stats = m_sendQueue.stats();
+    p_policy = m_sendQueue.policy();
+}
+
+
+//*************************************************************************************************************
+
+void FiffStreamThread::sendRawBuffer(QByteArray p_blockRawBuffer)
 {
-    if(m_bIsSendingRawBuffer)
+    m_qMutex.lock();
+    bool t_bIsDefaultProfile = m_sStreamProfileKey.isEmpty();
+    m_qMutex.unlock();
+
+    if(m_bIsSendingRawBuffer && t_bIsDefaultProfile)
     {
 //        qDebug() << "Send RawBuffer to client";
 
+        //block was already serialised by the server - only the reference is enqueued
         m_qMutex.lock();
-
-        FiffStream t_FiffStreamOut(&m_qSendBlock, QIODevice::WriteOnly);
-        t_FiffStreamOut.write_float(FIFF_DATA_BUFFER,m_pMatRawData->data(),m_pMatRawData->rows()*m_pMatRawData->cols());
-
+        bool t_bQueued = m_sendQueue.enqueueRaw(p_blockRawBuffer);
         m_qMutex.unlock();
 
+        if(!t_bQueued)
+        {
+            printf("FiffStreamClient (ID %d): send queue overflow, disconnecting slow client\r\n\n", m_iDataClientId);
+            m_bIsRunning = false;
+        }
     }
 //    else
 //    {
@@ -199,6 +270,27 @@ void FiffStreamThread::sendRawBuffer(QSharedPointer<Eigen::MatrixXf> m_pMatRawDa
 }
 
 
+//*************************************************************************************************************
+
+void FiffStreamThread::sendProfiledRawBuffer(QString p_sProfileKey, QByteArray p_blockRawBuffer)
+{
+    if(!m_bIsSendingRawBuffer)
+        return;
+
+    m_qMutex.lock();
+    bool t_bQueued = true;
+    if(p_sProfileKey == m_sStreamProfileKey)
+        t_bQueued = m_sendQueue.enqueueRaw(p_blockRawBuffer);
+    m_qMutex.unlock();
+
+    if(!t_bQueued)
+    {
+        printf("FiffStreamClient (ID %d): send queue overflow, disconnecting slow client\r\n\n", m_iDataClientId);
+        m_bIsRunning = false;
+    }
+}
+
+
 //*************************************************************************************************************
 
 //void FiffStreamThread::sendData(QTcpSocket& p_qTcpSocket)
@@ -225,9 +317,9 @@ void FiffStreamThread::sendMeasurementInfo(qint32 ID, FiffInfo p_fiffInfo)
 {
     if(ID == m_iDataClientId)
     {
-        m_qMutex.lock();
-
-        FiffStream t_FiffStreamOut(&m_qSendBlock, QIODevice::WriteOnly);
+        QByteArray t_blockMeasInfo;
+        {
+            FiffStream t_FiffStreamOut(&t_blockMeasInfo, QIODevice::WriteOnly);
 
 //        qint32 init_info[2];
 //        init_info[0] = FIFF_MNE_RT_CLIENT_ID;
@@ -237,10 +329,12 @@ void FiffStreamThread::sendMeasurementInfo(qint32 ID, FiffInfo p_fiffInfo)
 
 //FiffStream::start_writing_raw
 
-        p_fiffInfo.writeToStream(&t_FiffStreamOut);
-        m_qMutex.unlock();
+            p_fiffInfo.writeToStream(&t_FiffStreamOut);
+        }
+
+        enqueueBlock(t_blockMeasInfo);
 
-//        qDebug() << "MeasInfo Blocksize: " << m_qSendBlock.size();
+//        qDebug() << "MeasInfo Blocksize: " << t_blockMeasInfo.size();
     }
 }
 
@@ -249,9 +343,13 @@ void FiffStreamThread::sendMeasurementInfo(qint32 ID, FiffInfo p_fiffInfo)
 
 void FiffStreamThread::writeClientId()
 {
-    FiffStream t_FiffStreamOut(&m_qSendBlock, QIODevice::WriteOnly);
+    QByteArray t_blockClientId;
+    {
+        FiffStream t_FiffStreamOut(&t_blockClientId, QIODevice::WriteOnly);
+        t_FiffStreamOut.write_int(FIFF_MNE_RT_CLIENT_ID, &m_iDataClientId);
+    }
 
-    t_FiffStreamOut.write_int(FIFF_MNE_RT_CLIENT_ID, &m_iDataClientId);
+    enqueueBlock(t_blockClientId);
 }
 
 
@@ -304,6 +402,8 @@ void FiffStreamThread::run()
             this, &FiffStreamThread::sendMeasurementInfo);
     connect(t_pParentServer, &FiffStreamServer::remitRawBuffer,
             this, &FiffStreamThread::sendRawBuffer);
+    connect(t_pParentServer, &FiffStreamServer::remitProfiledRawBuffer,
+            this, &FiffStreamThread::sendProfiledRawBuffer);
     connect(t_pParentServer, &FiffStreamServer::startMeasFiffStreamClient,
             this, &FiffStreamThread::startMeas);
     connect(t_pParentServer, &FiffStreamServer::stopMeasFiffStreamClient,
@@ -330,26 +430,21 @@ void FiffStreamThread::run()
         //
         // Write available data
         //
+        // Blocks are only handed to the socket when its buffer drained, so a slow client is limited by the send queue
         m_qMutex.lock();
-        qint32 t_iBlockSize = m_qSendBlock.size();
-//        qDebug() << "data available" << t_iBlockSize;
-        if(t_iBlockSize > 0)
+        QList<QByteArray> t_qListSendBlocks;
+        if(t_qTcpSocket.bytesToWrite() == 0)
+            t_qListSendBlocks = m_sendQueue.takeAll();
+        m_qMutex.unlock();
+
+        for(qint32 i = 0; i < t_qListSendBlocks.size(); ++i)
         {
-            qint32 t_iBytesWritten = t_qTcpSocket.write(m_qSendBlock);
-//            qDebug() << ++i<< "[wrote bytes] " << t_iBytesWritten;
-            t_qTcpSocket.waitForBytesWritten();
-            if(t_iBytesWritten == t_iBlockSize)
-            {
-                m_qSendBlock.clear();
-            }
-            else
-            {
-                //we have to store bytes which were not written to the socket, due to writing limit
-                //m_qSendBlock = m_qSendBlock.mid(t_iBytesWritten, t_iBlockSize-t_iBytesWritten);
-                m_qSendBlock.remove(0,t_iBytesWritten); //higher performance then mid
-            }
+            if(t_qTcpSocket.write(t_qListSendBlocks[i]) < 0)
+                break;
         }
-        m_qMutex.unlock();
+
+        if(t_qTcpSocket.bytesToWrite() > 0)
+            t_qTcpSocket.waitForBytesWritten(10);
 
         //
         // Read: Wait 10ms for incomming tag header, read and continue
@@ -41,6 +41,8 @@
 // INCLUDES
 //=============================================================================================================
 
+#include "sendqueue.h"
+
 #include <fiff/fiff_stream.h>
 #include <fiff/fiff_info.h>
 
@@ -54,6 +56,8 @@
 #include <QTcpSocket>
 #include <QMutex>
 #include <QSharedPointer>
+#include <QList>
+#include <QByteArray>
 
 
 //*************************************************************************************************************
@@ -98,11 +102,47 @@ public:
 
     void writeClientId();
 
+    //=========================================================================================================
+    /**
+    * Appends a serialised control block to the send queue. The block is implicitly shared and not modified, so
+    * it is enqueued without copying.
+    *
+    * @param[in] p_blockSend    The block to send.
+    */
+    void enqueueBlock(const QByteArray& p_blockSend);
+
+    //=========================================================================================================
+    /**
+    * Sets the slow client policy and the size of the send queue.
+    *
+    * @param[in] p_policy       Policy which is applied when a raw buffer does not fit into the send queue.
+    * @param[in] p_iMaxBytes    Maximal number of queued bytes.
+    */
+    void setSendQueue(SendQueue::SlowClientPolicy p_policy, qint64 p_iMaxBytes);
+
+    //=========================================================================================================
+    /**
+    * Returns the send queue counters and the slow client policy. Thread safe.
+    *
+    * @param[out] p_stats   The send queue counters.
+    * @param[out] p_policy  The slow client policy.
+    */
+    void getSendQueueStats(SendQueue::Stats& p_stats, SendQueue::SlowClientPolicy& p_policy);
+
 //    void sendData(QTcpSocket& p_qTcpSocket);
 
 signals:
     void error(QTcpSocket::SocketError socketError);
 
+    //=========================================================================================================
+    /**
+    * Emitted when the client requested a new stream profile.
+    *
+    * @param[in] id             ID of the client.
+    * @param[in] p_sProfileKey  Key of the requested profile; empty for the default full rate float stream.
+    */
+    void streamProfileChanged(qint32 id, QString p_sProfileKey);
+
 private:
     qint32 m_iDataClientId;
     QString m_sDataClientAlias;
@@ -110,17 +150,20 @@ private:
     int m_iSocketDescriptor;
 
     QMutex m_qMutex;
-    QByteArray m_qSendBlock;
+    SendQueue m_sendQueue;                  /**< Bounded queue of serialised blocks waiting to be written to the socket. */
 
     bool m_bIsSendingRawBuffer;
 
+    QString m_sStreamProfileKey;            /**< Key of the stream profile of this client; empty for the default stream. */
+
     bool m_bIsRunning;
 
 //public slots: --> in Qt 5 not anymore declared as slot
     void startMeas(qint32 ID);
     void stopMeas(qint32 ID);
     void sendMeasurementInfo(qint32 ID, FiffInfo p_fiffInfo);
-    void sendRawBuffer(QSharedPointer<Eigen::MatrixXf> m_pMatRawData);
+    void sendRawBuffer(QByteArray p_blockRawBuffer);
+    void sendProfiledRawBuffer(QString p_sProfileKey, QByteArray p_blockRawBuffer);
     //void readToBuffer1();
 //    void readProc(QTcpSocket& p_qTcpSocket);
 };
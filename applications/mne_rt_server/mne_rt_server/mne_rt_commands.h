@@ -51,6 +51,7 @@ namespace RTSERVER
 
 #define MNE_RT_GET_CLIENT_ID        1       /**< Request client id at mne_rt_server */
 #define MNE_RT_SET_CLIENT_ALIAS     2       /**< Set client alias at mne_rt_server */
+#define MNE_RT_SET_STREAM_PROFILE   3       /**< Set stream profile (channel selection, decimation, format, compression) at mne_rt_server */
 
 } // NAMESPACE
 
@@ -84,6 +84,7 @@ MNERTServer::MNERTServer()
 {
     qRegisterMetaType<MatrixXf>("MatrixXf");
     qRegisterMetaType<QSharedPointer<Eigen::MatrixXf> >("QSharedPointer<Eigen::MatrixXf>");
+    qRegisterMetaType<FIFFLIB::FiffInfo>("FIFFLIB::FiffInfo");
 
     //
     // init mne_rt_server
@@ -123,6 +124,39 @@ MNERTServer::MNERTServer()
         m_commandServer.registerCommandManager(m_connectorManager.getConnectors()[i]->getCommandManager());
 
     // ### Run everything ###
+    //
+    // Data server mode: --event-loop [--workers=<n>] serves all fiff stream clients by worker event loops
+    //
+    QStringList t_qListArguments = QCoreApplication::arguments();
+    if(t_qListArguments.contains("--event-loop"))
+    {
+        qint32 t_iNumWorkers = 2;
+        for(qint32 i = 0; i < t_qListArguments.size(); ++i)
+            if(t_qListArguments[i].startsWith("--workers="))
+                t_iNumWorkers = t_qListArguments[i].mid(10).toInt();
+
+        m_fiffStreamServer.setEventLoopMode(t_iNumWorkers);
+    }
+
+    //
+    // Send queue per client: --send-queue=<MB> --slow-client=<drop-oldest|decimate|disconnect>
+    //
+    SendQueue::SlowClientPolicy t_slowClientPolicy = SendQueue::DROP_OLDEST;
+    qint64 t_iSendQueueMB = 32;
+    for(qint32 i = 0; i < t_qListArguments.size(); ++i)
+    {
+        if(t_qListArguments[i].startsWith("--send-queue="))
+            t_iSendQueueMB = t_qListArguments[i].mid(13).toInt();
+        else if(t_qListArguments[i].startsWith("--slow-client=") && !SendQueue::parsePolicy(t_qListArguments[i].mid(14), t_slowClientPolicy))
+            printf("Unknown slow client policy %s, using drop-oldest.\n", t_qListArguments[i].mid(14).toUtf8().constData());
+    }
+    m_fiffStreamServer.setSendQueueDefaults(t_slowClientPolicy, qMax(t_iSendQueueMB, (qint64)1)*1024*1024);
+
+    //
+    // Latency instrumentation: --block-stamps precedes every raw buffer by its sequence number and arrival time
+    //
+    m_fiffStreamServer.setBlockStamps(t_qListArguments.contains("--block-stamps"));
+
     //
     // Run instruction server
     //
@@ -316,6 +350,32 @@ void MNERTServer::init()
     QString t_sJsonCommand =
             "{"
             "   \"commands\": {"
+            "       \"blockstamps\": {"
+            "           \"description\": \"Enables (1) or disables (0) the sequence number and arrival time stamps of the raw buffers.\","
+            "           \"parameters\": {"
+            "               \"enable\": {"
+            "                   \"description\": \"1 or 0\","
+            "                   \"type\": \"int\" "
+            "               }"
+            "           }"
+            "        },"
+            "       \"clientpolicy\": {"
+            "           \"description\": \"Sets the slow client policy (drop-oldest, decimate or disconnect) of the specified FiffStreamClient.\","
+            "           \"parameters\": {"
+            "               \"id\": {"
+            "                   \"description\": \"ID/Alias\","
+            "                   \"type\": \"QString\" "
+            "               },"
+            "               \"policy\": {"
+            "                   \"description\": \"Slow client policy\","
+            "                   \"type\": \"QString\" "
+            "               }"
+            "           }"
+            "        },"
+            "       \"clientstats\": {"
+            "           \"description\": \"Prints and sends the send queue counters of all FiffStreamClients.\","
+            "           \"parameters\": {}"
+            "        },"
             "       \"clist\": {"
             "           \"description\": \"Prints and sends all available FiffStreamClients.\","
             "           \"parameters\": {}"
@@ -332,6 +392,10 @@ void MNERTServer::init()
             "           \"description\": \"Prints and sends this list.\","
             "           \"parameters\": {}"
             "        },"
+            "       \"latency\": {"
+            "           \"description\": \"Prints and sends the latency and queue depth histograms of the server and of all FiffStreamClients.\","
+            "           \"parameters\": {}"
+            "        },"
             "       \"measinfo\": {"
             "           \"description\": \"Sends the measurement info to the specified FiffStreamClient.\","
             "           \"parameters\": {"
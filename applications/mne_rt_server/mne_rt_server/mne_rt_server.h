@@ -160,4 +160,9 @@ inline CommandManager& MNERTServer::getCommandManager()
 Q_DECLARE_METATYPE(Eigen::MatrixXf);    /**< Provides QT META type declaration of the Eigen::MatrixXf type. For signal/slot usage.*/
 #endif
 
+#ifndef metatype_fiffinfo
+#define metatype_fiffinfo
+Q_DECLARE_METATYPE(FIFFLIB::FiffInfo);  /**< Provides QT META type declaration of the FIFFLIB::FiffInfo type. For queued signal/slot usage.*/
+#endif
+
 #endif // MNE_RT_SERVER_H
@@ -75,6 +75,10 @@ SOURCES += \
     mne_rt_server.cpp \
     fiffstreamserver.cpp \
     fiffstreamthread.cpp \
+    fiffstreamclient.cpp \
+    sendqueue.cpp \
+    streamprofile.cpp \
+    streamencoder.cpp \
     commandserver.cpp \
     commandthread.cpp
 
@@ -86,6 +90,10 @@ HEADERS += \
     mne_rt_server.h \
     fiffstreamserver.h \
     fiffstreamthread.h \
+    fiffstreamclient.h \
+    sendqueue.h \
+    streamprofile.h \
+    streamencoder.h \
     commandserver.h \
     commandthread.h \
     mne_rt_commands.h
@@ -0,0 +1,321 @@
+//=============================================================================================================
+/**
+* @file     sendqueue.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Limin Sun <liminsun@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     January, 2015
+*
+* @section  LICENSE
+*
+* Copyright (C) 2015, Christoph Dinh, Limin Sun and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief     implementation of the SendQueue Class.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "sendqueue.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace RTSERVER;
+
+
+const qint32 maxDecimation = 64;        /**< Maximal decimation factor of the DECIMATE policy. */
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+SendQueue::SendQueue(qint64 p_iMaxBytes, SlowClientPolicy p_policy)
+: m_iHeadOffset(0)
+, m_iNumBytes(0)
+, m_iMaxBytes(p_iMaxBytes)
+, m_policy(p_policy)
+, m_iDecimation(1)
+, m_iDecimationCounter(0)
+{
+    m_stats.enqueued = 0;
+    m_stats.sent = 0;
+    m_stats.dropped = 0;
+    m_stats.decimated = 0;
+    m_stats.numBlocks = 0;
+    m_stats.numBytes = 0;
+    m_stats.maxNumBytes = 0;
+}
+
+
+//*************************************************************************************************************
+
+void SendQueue::setPolicy(SlowClientPolicy p_policy)
+{
+    m_policy = p_policy;
+    m_iDecimation = 1;
+}
+
+
+//*************************************************************************************************************
+
+void SendQueue::setMaxBytes(qint64 p_iMaxBytes)
+{
+    m_iMaxBytes = p_iMaxBytes;
+}
+
+
+//*************************************************************************************************************
+
+bool SendQueue::enqueueRaw(const QByteArray& p_blockRawBuffer)
+{
+    if(p_blockRawBuffer.isEmpty())
+        return true;
+
+    qint64 t_iSize = p_blockRawBuffer.size();
+    bool t_bFits = m_iNumBytes + t_iSize <= m_iMaxBytes;
+
+    switch(m_policy)
+    {
+        case DROP_OLDEST:
+            if(!t_bFits && !dropOldest(t_iSize))
+            {
+                ++m_stats.dropped;
+                return true;
+            }
+            break;
+
+        case DECIMATE:
+            //raise the decimation as long as the queue is full, release it when the queue drained
+            if(!t_bFits)
+                m_iDecimation = qMin(2*m_iDecimation, maxDecimation);
+            else if(m_iNumBytes < m_iMaxBytes/4)
+                m_iDecimation = 1;
+
+            if(m_iDecimation > 1 && (m_iDecimationCounter++ % m_iDecimation) != 0)
+            {
+                ++m_stats.decimated;
+                return true;
+            }
+            if(!t_bFits)
+            {
+                ++m_stats.dropped;
+                return true;
+            }
+            break;
+
+        case DISCONNECT:
+            if(!t_bFits)
+            {
+                ++m_stats.dropped;
+                return false;
+            }
+            break;
+    }
+
+    append(p_blockRawBuffer, true);
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+void SendQueue::enqueueControl(const QByteArray& p_blockControl)
+{
+    if(!p_blockControl.isEmpty())
+        append(p_blockControl, false);
+}
+
+
+//*************************************************************************************************************
+
+void SendQueue::consume(qint64 p_iNumBytes)
+{
+    while(p_iNumBytes > 0 && !m_qListBlocks.isEmpty())
+    {
+        qint64 t_iHeadLeft = m_qListBlocks.first().size() - m_iHeadOffset;
+        if(p_iNumBytes >= t_iHeadLeft)
+        {
+            p_iNumBytes -= t_iHeadLeft;
+            removeFirst();
+            ++m_stats.sent;
+        }
+        else
+        {
+            m_iHeadOffset += p_iNumBytes;
+            m_iNumBytes -= p_iNumBytes;
+            p_iNumBytes = 0;
+        }
+    }
+}
+
+
+//*************************************************************************************************************
+
+QByteArray SendQueue::takeFirst()
+{
+    if(m_qListBlocks.isEmpty())
+        return QByteArray();
+
+    QByteArray t_blockHead = m_iHeadOffset > 0 ? m_qListBlocks.first().mid(m_iHeadOffset) : m_qListBlocks.first();
+    removeFirst();
+    ++m_stats.sent;
+
+    return t_blockHead;
+}
+
+
+//*************************************************************************************************************
+
+QList<QByteArray> SendQueue::takeAll()
+{
+    QList<QByteArray> t_qListBlocks;
+    while(!m_qListBlocks.isEmpty())
+        t_qListBlocks.append(takeFirst());
+
+    return t_qListBlocks;
+}
+
+
+//*************************************************************************************************************
+
+void SendQueue::clear()
+{
+    m_qListBlocks.clear();
+    m_qListIsRaw.clear();
+    m_qListEnqueueTimes.clear();
+    m_iHeadOffset = 0;
+    m_iNumBytes = 0;
+}
+
+
+//*************************************************************************************************************
+
+SendQueue::Stats SendQueue::stats() const
+{
+    Stats t_stats = m_stats;
+    t_stats.numBlocks = m_qListBlocks.size();
+    t_stats.numBytes = m_iNumBytes;
+
+    return t_stats;
+}
+
+
+//*************************************************************************************************************
+
+QString SendQueue::policyName(SlowClientPolicy p_policy)
+{
+    switch(p_policy)
+    {
+        case DROP_OLDEST:
+            return QString("drop-oldest");
+        case DECIMATE:
+            return QString("decimate");
+        case DISCONNECT:
+            return QString("disconnect");
+    }
+
+    return QString("");
+}
+
+
+//*************************************************************************************************************
+
+bool SendQueue::parsePolicy(const QString& p_sName, SlowClientPolicy& p_policy)
+{
+    if(p_sName.compare("drop-oldest", Qt::CaseInsensitive) == 0)
+        p_policy = DROP_OLDEST;
+    else if(p_sName.compare("decimate", Qt::CaseInsensitive) == 0)
+        p_policy = DECIMATE;
+    else if(p_sName.compare("disconnect", Qt::CaseInsensitive) == 0)
+        p_policy = DISCONNECT;
+    else
+        return false;
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+bool SendQueue::dropOldest(qint64 p_iNumBytes)
+{
+    //a partially written head has to be completed
+    qint32 i = m_iHeadOffset > 0 ? 1 : 0;
+    while(m_iNumBytes + p_iNumBytes > m_iMaxBytes && i < m_qListBlocks.size())
+    {
+        if(m_qListIsRaw[i])
+        {
+            m_iNumBytes -= m_qListBlocks[i].size();
+            m_qListBlocks.removeAt(i);
+            m_qListIsRaw.removeAt(i);
+            m_qListEnqueueTimes.removeAt(i);
+            ++m_stats.dropped;
+        }
+        else
+            ++i;
+    }
+
+    return m_iNumBytes + p_iNumBytes <= m_iMaxBytes;
+}
+
+
+//*************************************************************************************************************
+
+void SendQueue::append(const QByteArray& p_block, bool p_bIsRaw)
+{
+    if(p_bIsRaw)
+        m_stats.queueDepth.add(m_qListBlocks.size());
+
+    m_qListBlocks.append(p_block);
+    m_qListIsRaw.append(p_bIsRaw);
+    m_qListEnqueueTimes.append(UTILSLIB::LatencyHistogram::now());
+    m_iNumBytes += p_block.size();
+    ++m_stats.enqueued;
+
+    if(m_iNumBytes > m_stats.maxNumBytes)
+        m_stats.maxNumBytes = m_iNumBytes;
+}
+
+
+//*************************************************************************************************************
+
+void SendQueue::removeFirst()
+{
+    if(m_qListIsRaw.first())
+        m_stats.queueLatency.add(UTILSLIB::LatencyHistogram::now() - m_qListEnqueueTimes.first());
+
+    m_iNumBytes -= m_qListBlocks.first().size() - m_iHeadOffset;
+    m_qListBlocks.removeFirst();
+    m_qListIsRaw.removeFirst();
+    m_qListEnqueueTimes.removeFirst();
+    m_iHeadOffset = 0;
+}
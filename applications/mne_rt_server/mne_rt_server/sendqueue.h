@@ -0,0 +1,336 @@
+//=============================================================================================================
+/**
+* @file     sendqueue.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     January, 2015
+*
+* @section  LICENSE
+*
+* Copyright (C) 2015, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief     declaration of the SendQueue Class.
+*
+*/
+
+#ifndef SENDQUEUE_H
+#define SENDQUEUE_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MNE INCLUDES
+//=============================================================================================================
+
+#include <utils/latencyhistogram.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QList>
+#include <QByteArray>
+#include <QString>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE RTSERVER
+//=============================================================================================================
+
+namespace RTSERVER
+{
+
+//=============================================================================================================
+/**
+* DECLARE CLASS SendQueue
+*
+* @brief The SendQueue class is the bounded queue of serialised blocks waiting to be sent to one fiff data client.
+*
+* Only raw buffers count against the slow client policy, control blocks (start/end block, measurement info,
+* client id) are always queued. A block whose head was partially written is never dropped, so the stream stays
+* consistent. The queue is not thread safe, the owning client guards it.
+*/
+class SendQueue
+{
+public:
+    //=========================================================================================================
+    /**
+    * Policy which is applied when a raw buffer does not fit into the queue anymore.
+    */
+    enum SlowClientPolicy
+    {
+        DROP_OLDEST,    /**< The oldest queued raw buffers are dropped. */
+        DECIMATE,       /**< Only every n-th raw buffer is queued, n is doubled as long as the queue is full and reset when it drained. */
+        DISCONNECT      /**< The client gets disconnected. */
+    };
+
+    //=========================================================================================================
+    /**
+    * Counters of the queue.
+    */
+    struct Stats
+    {
+        quint64 enqueued;       /**< Number of queued blocks. */
+        quint64 sent;           /**< Number of blocks which were handed to the socket. */
+        quint64 dropped;        /**< Number of raw buffers which were dropped. */
+        quint64 decimated;      /**< Number of raw buffers which were skipped by decimation. */
+        qint32 numBlocks;       /**< Number of currently queued blocks. */
+        qint64 numBytes;        /**< Number of currently queued bytes. */
+        qint64 maxNumBytes;     /**< Maximal number of queued bytes so far. */
+        UTILSLIB::LatencyHistogram queueLatency;   /**< Time raw buffers spent in the queue until they were written [us]. */
+        UTILSLIB::LatencyHistogram queueDepth;     /**< Number of queued blocks when a raw buffer was enqueued. */
+    };
+
+    //=========================================================================================================
+    /**
+    * Constructs a SendQueue.
+    *
+    * @param[in] p_iMaxBytes    Maximal number of queued bytes.
+    * @param[in] p_policy       Policy when a raw buffer does not fit into the queue.
+    */
+    SendQueue(qint64 p_iMaxBytes = 32*1024*1024, SlowClientPolicy p_policy = DROP_OLDEST);
+
+    //=========================================================================================================
+    /**
+    * Sets the slow client policy.
+    *
+    * @param[in] p_policy   The new policy.
+    */
+    void setPolicy(SlowClientPolicy p_policy);
+
+    //=========================================================================================================
+    /**
+    * Returns the slow client policy.
+    *
+    * @return the slow client policy.
+    */
+    inline SlowClientPolicy policy() const;
+
+    //=========================================================================================================
+    /**
+    * Sets the maximal number of queued bytes.
+    *
+    * @param[in] p_iMaxBytes    Maximal number of queued bytes.
+    */
+    void setMaxBytes(qint64 p_iMaxBytes);
+
+    //=========================================================================================================
+    /**
+    * Returns the maximal number of queued bytes.
+    *
+    * @return the maximal number of queued bytes.
+    */
+    inline qint64 maxBytes() const;
+
+    //=========================================================================================================
+    /**
+    * Queues a serialised raw buffer and applies the slow client policy when it does not fit.
+    *
+    * @param[in] p_blockRawBuffer   The serialised raw buffer.
+    *
+    * @return false if the queue overflowed and the client has to be disconnected, true otherwise.
+    */
+    bool enqueueRaw(const QByteArray& p_blockRawBuffer);
+
+    //=========================================================================================================
+    /**
+    * Queues a control block, which is never dropped.
+    *
+    * @param[in] p_blockControl     The serialised control block.
+    */
+    void enqueueControl(const QByteArray& p_blockControl);
+
+    //=========================================================================================================
+    /**
+    * Returns whether no block is queued.
+    *
+    * @return true if the queue is empty.
+    */
+    inline bool isEmpty() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the number of queued blocks.
+    *
+    * @return the number of queued blocks.
+    */
+    inline qint32 size() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the queued block at position i.
+    *
+    * @param[in] i  Position in the queue.
+    *
+    * @return the block at position i.
+    */
+    inline const QByteArray& at(qint32 i) const;
+
+    //=========================================================================================================
+    /**
+    * Returns the number of bytes of the head block which are already written.
+    *
+    * @return the written bytes of the head block.
+    */
+    inline qint32 headOffset() const;
+
+    //=========================================================================================================
+    /**
+    * Removes p_iNumBytes written bytes from the front of the queue.
+    *
+    * @param[in] p_iNumBytes    Number of bytes which were written.
+    */
+    void consume(qint64 p_iNumBytes);
+
+    //=========================================================================================================
+    /**
+    * Removes the head block and returns its not yet written bytes.
+    *
+    * @return the remainder of the head block.
+    */
+    QByteArray takeFirst();
+
+    //=========================================================================================================
+    /**
+    * Removes all blocks and returns their not yet written bytes in order.
+    *
+    * @return the queued blocks.
+    */
+    QList<QByteArray> takeAll();
+
+    //=========================================================================================================
+    /**
+    * Drops all queued blocks without counting them.
+    */
+    void clear();
+
+    //=========================================================================================================
+    /**
+    * Returns the counters.
+    *
+    * @return the counters.
+    */
+    Stats stats() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the command name of a slow client policy.
+    *
+    * @param[in] p_policy   The policy.
+    *
+    * @return the name of the policy ("drop-oldest", "decimate" or "disconnect").
+    */
+    static QString policyName(SlowClientPolicy p_policy);
+
+    //=========================================================================================================
+    /**
+    * Parses the command name of a slow client policy.
+    *
+    * @param[in] p_sName    The name of the policy.
+    * @param[out] p_policy  The parsed policy.
+    *
+    * @return true if the name is known, false otherwise.
+    */
+    static bool parsePolicy(const QString& p_sName, SlowClientPolicy& p_policy);
+
+private:
+    //=========================================================================================================
+    /**
+    * Drops the oldest raw buffers until p_iNumBytes fit into the queue.
+    *
+    * @return true if p_iNumBytes fit into the queue.
+    */
+    bool dropOldest(qint64 p_iNumBytes);
+
+    void append(const QByteArray& p_block, bool p_bIsRaw);
+
+    void removeFirst();
+
+    QList<QByteArray>   m_qListBlocks;          /**< The queued blocks. */
+    QList<bool>         m_qListIsRaw;           /**< Whether the block at the same position is a raw buffer. */
+    QList<qint64>       m_qListEnqueueTimes;    /**< Time the block at the same position was enqueued [us]. */
+    qint32              m_iHeadOffset;          /**< Bytes of the head block which are already written. */
+    qint64              m_iNumBytes;            /**< Number of queued bytes, without the written bytes of the head block. */
+    qint64              m_iMaxBytes;            /**< Maximal number of queued bytes. */
+    SlowClientPolicy    m_policy;               /**< The slow client policy. */
+    qint32              m_iDecimation;          /**< Current decimation factor. */
+    quint32             m_iDecimationCounter;   /**< Counts the raw buffers for the decimation. */
+    Stats               m_stats;                /**< The counters. */
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+inline SendQueue::SlowClientPolicy SendQueue::policy() const
+{
+    return m_policy;
+}
+
+
+//*************************************************************************************************************
+
+inline qint64 SendQueue::maxBytes() const
+{
+    return m_iMaxBytes;
+}
+
+
+//*************************************************************************************************************
+
+inline bool SendQueue::isEmpty() const
+{
+    return m_qListBlocks.isEmpty();
+}
+
+
+//*************************************************************************************************************
+
+inline qint32 SendQueue::size() const
+{
+    return m_qListBlocks.size();
+}
+
+
+//*************************************************************************************************************
+
+inline const QByteArray& SendQueue::at(qint32 i) const
+{
+    return m_qListBlocks.at(i);
+}
+
+
+//*************************************************************************************************************
+
+inline qint32 SendQueue::headOffset() const
+{
+    return m_iHeadOffset;
+}
+
+} // NAMESPACE
+
+#endif // SENDQUEUE_H
@@ -0,0 +1,234 @@
+//=============================================================================================================
+/**
+* @file     streamencoder.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Limin Sun <liminsun@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     January, 2015
+*
+* @section  LICENSE
+*
+* Copyright (C) 2015, Christoph Dinh, Limin Sun and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief     implementation of the StreamEncoder Class.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "streamencoder.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Fiff INCLUDES
+//=============================================================================================================
+
+#include <fiff/fiff_constants.h>
+#include <fiff/fiff_stream.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <math.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace RTSERVER;
+using namespace FIFFLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+StreamEncoder::StreamEncoder(const StreamProfile& p_profile)
+: m_profile(p_profile)
+, m_iPhase(0)
+{
+    if(m_profile.decimation > 1)
+        designFilter();
+}
+
+
+//*************************************************************************************************************
+
+QByteArray StreamEncoder::encode(const MatrixXf& p_matRawBuffer)
+{
+    //
+    // Channel selection
+    //
+    const MatrixXf* t_pMatData = &p_matRawBuffer;
+    if(m_profile.sel.size() > 0)
+    {
+        qint32 t_iNumSel = 0;
+        for(qint32 i = 0; i < m_profile.sel.size(); ++i)
+            if(m_profile.sel[i] < p_matRawBuffer.rows())
+                ++t_iNumSel;
+
+        m_matSelected.resize(t_iNumSel, p_matRawBuffer.cols());
+        qint32 t_iRow = 0;
+        for(qint32 i = 0; i < m_profile.sel.size(); ++i)
+            if(m_profile.sel[i] < p_matRawBuffer.rows())
+                m_matSelected.row(t_iRow++) = p_matRawBuffer.row(m_profile.sel[i]);
+
+        t_pMatData = &m_matSelected;
+    }
+
+    //
+    // Anti-alias filter and decimation
+    //
+    if(m_profile.decimation > 1)
+    {
+        if(t_pMatData != &m_matSelected)
+            m_matSelected = p_matRawBuffer;
+        decimate();
+        t_pMatData = &m_matDecimated;
+    }
+
+    if(t_pMatData->cols() == 0 || t_pMatData->rows() == 0)
+        return QByteArray();
+
+    //
+    // Serialise
+    //
+    QByteArray t_blockData;
+    {
+        FiffStream t_FiffStreamOut(&t_blockData, QIODevice::WriteOnly);
+
+        //
+        // Every profiled buffer carries its scales: the client takes the number of channels from them, so
+        // buffers of the previous profile which are still on their way are decoded with their own layout
+        //
+        if(m_profile.format == StreamProfile::INT16)
+        {
+            //per channel scale which maps the largest magnitude of this buffer to the int16 range
+            VectorXf t_vecScales = t_pMatData->cwiseAbs().rowwise().maxCoeff() / 32767.0f;
+            for(qint32 i = 0; i < t_vecScales.size(); ++i)
+                if(t_vecScales[i] <= 0.0f)
+                    t_vecScales[i] = 1.0f;
+
+            Matrix<qint16, Dynamic, Dynamic> t_matShort(t_pMatData->rows(), t_pMatData->cols());
+            for(qint32 j = 0; j < t_pMatData->cols(); ++j)
+                for(qint32 i = 0; i < t_pMatData->rows(); ++i)
+                    t_matShort(i,j) = (qint16)floor((*t_pMatData)(i,j) / t_vecScales[i] + 0.5f);
+
+            t_FiffStreamOut.write_float(FIFF_MNE_RT_DATA_SCALES, t_vecScales.data(), t_vecScales.size());
+            t_FiffStreamOut.write_short(FIFF_DATA_BUFFER, t_matShort.data(), t_matShort.rows()*t_matShort.cols());
+        }
+        else
+        {
+            VectorXf t_vecScales = VectorXf::Ones(t_pMatData->rows());
+
+            t_FiffStreamOut.write_float(FIFF_MNE_RT_DATA_SCALES, t_vecScales.data(), t_vecScales.size());
+            t_FiffStreamOut.write_float(FIFF_DATA_BUFFER, t_pMatData->data(), t_pMatData->rows()*t_pMatData->cols());
+        }
+    }
+
+    if(!m_profile.compression)
+        return t_blockData;
+
+    //
+    // Wrap the tags into one compressed tag
+    //
+    QByteArray t_blockCompressed = qCompress(t_blockData);
+
+    QByteArray t_blockSend;
+    {
+        FiffStream t_FiffStreamOut(&t_blockSend, QIODevice::WriteOnly);
+        t_FiffStreamOut << (qint32)FIFF_MNE_RT_COMPRESSED;
+        t_FiffStreamOut << (qint32)FIFFT_VOID;
+        t_FiffStreamOut << (qint32)t_blockCompressed.size();
+        t_FiffStreamOut << (qint32)FIFFV_NEXT_SEQ;
+        t_FiffStreamOut.writeRawData(t_blockCompressed.constData(), t_blockCompressed.size());
+    }
+
+    return t_blockSend;
+}
+
+
+//*************************************************************************************************************
+
+void StreamEncoder::designFilter()
+{
+    //
+    // Windowed sinc, cutoff at 80% of the decimated Nyquist frequency
+    //
+    qint32 t_iNumTaps = 8 * m_profile.decimation + 1;
+    qint32 t_iCenter = t_iNumTaps / 2;
+    double t_dCutoff = 0.8 * 0.5 / m_profile.decimation;
+
+    m_vecFilter.resize(t_iNumTaps);
+    for(qint32 k = 0; k < t_iNumTaps; ++k)
+    {
+        double t_dX = k - t_iCenter;
+        double t_dSinc = (k == t_iCenter) ? 2.0 * t_dCutoff : sin(2.0 * M_PI * t_dCutoff * t_dX) / (M_PI * t_dX);
+        double t_dWindow = 0.54 - 0.46 * cos(2.0 * M_PI * k / (t_iNumTaps - 1));
+        m_vecFilter[k] = (float)(t_dSinc * t_dWindow);
+    }
+    m_vecFilter /= m_vecFilter.sum();
+}
+
+
+//*************************************************************************************************************
+
+void StreamEncoder::decimate()
+{
+    qint32 t_iNumTaps = m_vecFilter.size();
+    qint32 t_iRows = m_matSelected.rows();
+    qint32 t_iCols = m_matSelected.cols();
+
+    //channel count changed (or first buffer) -> start from silence
+    if(m_matHistory.rows() != t_iRows)
+    {
+        m_matHistory = MatrixXf::Zero(t_iRows, t_iNumTaps - 1);
+        m_iPhase = 0;
+    }
+
+    m_matExtended.resize(t_iRows, t_iNumTaps - 1 + t_iCols);
+    m_matExtended.leftCols(t_iNumTaps - 1) = m_matHistory;
+    m_matExtended.rightCols(t_iCols) = m_matSelected;
+
+    //
+    // Only the kept samples are filtered: y[t] = sum_k h[k] x[t-k], x[t] is column t + taps - 1 of the extended buffer
+    //
+    qint32 t_iNumOut = t_iCols > m_iPhase ? (t_iCols - m_iPhase + m_profile.decimation - 1) / m_profile.decimation : 0;
+    m_matDecimated.resize(t_iRows, t_iNumOut);
+    for(qint32 j = 0; j < t_iNumOut; ++j)
+        m_matDecimated.col(j) = m_matExtended.middleCols(m_iPhase + j * m_profile.decimation, t_iNumTaps) * m_vecFilter;
+
+    m_iPhase += t_iNumOut * m_profile.decimation - t_iCols;
+
+    m_matHistory = m_matExtended.rightCols(t_iNumTaps - 1);
+}
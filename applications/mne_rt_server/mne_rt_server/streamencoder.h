@@ -0,0 +1,161 @@
+//=============================================================================================================
+/**
+* @file     streamencoder.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     January, 2015
+*
+* @section  LICENSE
+*
+* Copyright (C) 2015, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief     declaration of the StreamEncoder Class.
+*
+*/
+
+#ifndef STREAMENCODER_H
+#define STREAMENCODER_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "streamprofile.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QByteArray>
+#include <QSharedPointer>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE RTSERVER
+//=============================================================================================================
+
+namespace RTSERVER
+{
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS StreamEncoder
+*
+* @brief The StreamEncoder class serialises raw buffers according to a StreamProfile.
+*
+* The FiffStreamServer keeps one encoder per distinct profile, so clients with the same profile share the
+* encoded block. Decimation uses a windowed sinc low pass (Hamming) whose state is carried over from buffer to
+* buffer, only the kept output samples are computed.
+*/
+class StreamEncoder
+{
+public:
+    typedef QSharedPointer<StreamEncoder> SPtr;               /**< Shared pointer type for StreamEncoder. */
+    typedef QSharedPointer<const StreamEncoder> ConstSPtr;    /**< Const shared pointer type for StreamEncoder. */
+
+    //=========================================================================================================
+    /**
+    * Constructs a StreamEncoder.
+    *
+    * @param[in] p_profile  The profile to encode.
+    */
+    explicit StreamEncoder(const StreamProfile& p_profile);
+
+    //=========================================================================================================
+    /**
+    * Returns the profile of the encoder.
+    *
+    * @return the profile.
+    */
+    inline const StreamProfile& profile() const;
+
+    //=========================================================================================================
+    /**
+    * Encodes the next raw buffer. Channel indices of the selection which exceed the number of rows are skipped.
+    * The data buffer is always preceded by its per channel scales (FIFF_MNE_RT_DATA_SCALES), ones for float
+    * samples, which tell the client the number of sent channels.
+    *
+    * @param[in] p_matRawBuffer     The raw buffer (channels x samples).
+    *
+    * @return the serialised tags, empty if no decimated sample falls into this buffer.
+    */
+    QByteArray encode(const MatrixXf& p_matRawBuffer);
+
+private:
+    //=========================================================================================================
+    /**
+    * Designs the anti-alias low pass for the decimation factor of the profile.
+    */
+    void designFilter();
+
+    //=========================================================================================================
+    /**
+    * Low pass filters and decimates m_matSelected into m_matDecimated.
+    */
+    void decimate();
+
+    StreamProfile   m_profile;          /**< The encoded profile. */
+
+    VectorXf        m_vecFilter;        /**< Anti-alias filter taps (symmetric). */
+    MatrixXf        m_matHistory;       /**< Last samples of the previous buffer, length of the filter - 1. */
+    qint32          m_iPhase;           /**< Position of the next kept sample relative to the next buffer. */
+
+    MatrixXf        m_matSelected;      /**< Selected channels of the current buffer. */
+    MatrixXf        m_matExtended;      /**< History followed by the current buffer. */
+    MatrixXf        m_matDecimated;     /**< Filtered and decimated buffer. */
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+inline const StreamProfile& StreamEncoder::profile() const
+{
+    return m_profile;
+}
+
+} // NAMESPACE
+
+#endif // STREAMENCODER_H
@@ -0,0 +1,158 @@
+//=============================================================================================================
+/**
+* @file     streamprofile.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Limin Sun <liminsun@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     January, 2015
+*
+* @section  LICENSE
+*
+* Copyright (C) 2015, Christoph Dinh, Limin Sun and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief     implementation of the StreamProfile Class.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "streamprofile.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QStringList>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace RTSERVER;
+
+
+const qint32 maxStreamDecimation = 64;      /**< Maximal decimation factor of a stream profile. */
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+StreamProfile::StreamProfile()
+: decimation(1)
+, format(FLOAT32)
+, compression(false)
+{
+}
+
+
+//*************************************************************************************************************
+
+bool StreamProfile::isDefault() const
+{
+    return sel.size() == 0 && decimation == 1 && format == FLOAT32 && !compression;
+}
+
+
+//*************************************************************************************************************
+
+QString StreamProfile::key() const
+{
+    QString t_sKey("sel=");
+    for(qint32 i = 0; i < sel.size(); ++i)
+    {
+        if(i > 0)
+            t_sKey.append(",");
+        t_sKey.append(QString::number(sel[i]));
+    }
+    t_sKey.append(QString(";dec=%1").arg(decimation));
+    t_sKey.append(format == INT16 ? ";fmt=int16" : ";fmt=float");
+    t_sKey.append(compression ? ";cmp=1" : ";cmp=0");
+
+    return t_sKey;
+}
+
+
+//*************************************************************************************************************
+
+bool StreamProfile::fromKey(const QString& p_sKey, StreamProfile& p_profile)
+{
+    StreamProfile t_profile;
+
+    QStringList t_qListFields = p_sKey.split(";", QString::SkipEmptyParts);
+    for(qint32 i = 0; i < t_qListFields.size(); ++i)
+    {
+        QStringList t_qListField = t_qListFields[i].split("=");
+        if(t_qListField.size() != 2)
+            return false;
+
+        QString t_sName = t_qListField[0].simplified();
+        QString t_sValue = t_qListField[1].simplified();
+        bool t_bOk = true;
+
+        if(t_sName.compare("sel") == 0)
+        {
+            QStringList t_qListSel = t_sValue.split(",", QString::SkipEmptyParts);
+            t_profile.sel.resize(t_qListSel.size());
+            for(qint32 j = 0; j < t_qListSel.size() && t_bOk; ++j)
+                t_profile.sel[j] = t_qListSel[j].toInt(&t_bOk);
+            if(t_bOk && t_profile.sel.size() > 0 && t_profile.sel.minCoeff() < 0)
+                t_bOk = false;
+        }
+        else if(t_sName.compare("dec") == 0)
+        {
+            t_profile.decimation = t_sValue.toInt(&t_bOk);
+            if(t_profile.decimation < 1 || t_profile.decimation > maxStreamDecimation)
+                t_bOk = false;
+        }
+        else if(t_sName.compare("fmt") == 0)
+        {
+            if(t_sValue.compare("float") == 0)
+                t_profile.format = FLOAT32;
+            else if(t_sValue.compare("int16") == 0)
+                t_profile.format = INT16;
+            else
+                t_bOk = false;
+        }
+        else if(t_sName.compare("cmp") == 0)
+        {
+            t_profile.compression = t_sValue.toInt(&t_bOk) != 0;
+        }
+        else
+            t_bOk = false;
+
+        if(!t_bOk)
+            return false;
+    }
+
+    p_profile = t_profile;
+    return true;
+}
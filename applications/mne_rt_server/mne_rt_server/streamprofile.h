@@ -0,0 +1,136 @@
+//=============================================================================================================
+/**
+* @file     streamprofile.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     January, 2015
+*
+* @section  LICENSE
+*
+* Copyright (C) 2015, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief     declaration of the StreamProfile Class.
+*
+*/
+
+#ifndef STREAMPROFILE_H
+#define STREAMPROFILE_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QString>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE RTSERVER
+//=============================================================================================================
+
+namespace RTSERVER
+{
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS StreamProfile
+*
+* @brief The StreamProfile class describes how raw buffers are sent to a fiff data client.
+*
+* A client negotiates its profile with the MNE_RT_SET_STREAM_PROFILE command. The command data is the profile
+* key "sel=<i,j,...>;dec=<n>;fmt=<float|int16>;cmp=<0|1>", fields which are left out keep their default:
+* all channels, no decimation, float and no compression.
+*/
+class StreamProfile
+{
+public:
+    //=========================================================================================================
+    /**
+    * Sample format of the sent raw buffers.
+    */
+    enum DataFormat
+    {
+        FLOAT32,    /**< FIFFT_FLOAT data buffer, preceded by unit scales (FIFF_MNE_RT_DATA_SCALES). */
+        INT16       /**< FIFFT_SHORT data buffer, preceded by the per channel scales (FIFF_MNE_RT_DATA_SCALES). */
+    };
+
+    //=========================================================================================================
+    /**
+    * Constructs the default profile.
+    */
+    StreamProfile();
+
+    //=========================================================================================================
+    /**
+    * Returns whether this is the default profile, i.e. the full float raw buffer.
+    *
+    * @return true if this is the default profile.
+    */
+    bool isDefault() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the canonical key of the profile. Equal profiles have equal keys.
+    *
+    * @return the profile key.
+    */
+    QString key() const;
+
+    //=========================================================================================================
+    /**
+    * Parses a profile key.
+    *
+    * @param[in] p_sKey         The profile key.
+    * @param[out] p_profile     The parsed profile.
+    *
+    * @return true if the key is valid, false otherwise.
+    */
+    static bool fromKey(const QString& p_sKey, StreamProfile& p_profile);
+
+public:
+    VectorXi    sel;            /**< Selected channel indices, empty for all channels. */
+    qint32      decimation;     /**< Decimation factor, the data are low pass filtered before. */
+    DataFormat  format;         /**< Sample format. */
+    bool        compression;    /**< Whether the tags are sent zlib compressed (FIFF_MNE_RT_COMPRESSED). */
+};
+
+} // NAMESPACE
+
+#endif // STREAMPROFILE_H
@@ -408,12 +408,15 @@ void BCI::updateSensor(XMEASLIB::NewMeasurement::SPtr pMeasurement)
         // Only process data when fiff info has been initialised in run() method
         if(m_bProcessData)
         {
-            MatrixXd t_mat(pRTMSA->getNumChannels(), pRTMSA->getMultiArraySize());
-
-            for(unsigned char i = 0; i < pRTMSA->getMultiArraySize(); ++i)
-                t_mat.col(i) = pRTMSA->getMultiSampleArray()[i];
+            // Decode the samples directly into the ring buffer
+            Map<MatrixXd> t_mat = m_pBCIBuffer_Sensor->acquireWriteSlot();
+            if(t_mat.rows() == pRTMSA->getNumChannels() && t_mat.cols() == pRTMSA->getMultiArraySize())
+            {
+                for(unsigned char i = 0; i < pRTMSA->getMultiArraySize(); ++i)
+                    t_mat.col(i) = pRTMSA->getMultiSampleArray()[i];
 
-            m_pBCIBuffer_Sensor->push(&t_mat);
+                m_pBCIBuffer_Sensor->commit();
+            }
         }
     }
 }
@@ -433,12 +436,15 @@ void BCI::updateSource(XMEASLIB::NewMeasurement::SPtr pMeasurement)
 
         if(m_bProcessData)
         {
-            MatrixXd t_mat(pRTSE->getValue().size(), pRTSE->getArraySize());
-
-            for(unsigned char i = 0; i < pRTSE->getArraySize(); ++i)
-                t_mat.col(i) = pRTSE->getStc().data.col(i);
+            // Decode the source estimates directly into the ring buffer
+            Map<MatrixXd> t_mat = m_pBCIBuffer_Source->acquireWriteSlot();
+            if(t_mat.rows() == pRTSE->getValue().size() && t_mat.cols() == pRTSE->getArraySize())
+            {
+                for(unsigned char i = 0; i < pRTSE->getArraySize(); ++i)
+                    t_mat.col(i) = pRTSE->getStc().data.col(i);
 
-            m_pBCIBuffer_Source->push(&t_mat);
+                m_pBCIBuffer_Source->commit();
+            }
         }
     }
 }
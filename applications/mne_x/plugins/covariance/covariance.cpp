@@ -231,12 +231,15 @@ void Covariance::update(XMEASLIB::NewMeasurement::SPtr pMeasurement)
 
         if(m_bProcessData)
         {
-            MatrixXd t_mat;
-
             for(qint32 i = 0; i < pRTMSA->getMultiArraySize(); ++i)
             {
-                t_mat = pRTMSA->getMultiSampleArray()[i];
-                m_pCovarianceBuffer->push(&t_mat);
+                // Copy the block directly into the ring buffer
+                Map<MatrixXd> t_mat = m_pCovarianceBuffer->acquireWriteSlot();
+                if(t_mat.rows() == pRTMSA->getMultiSampleArray()[i].rows() && t_mat.cols() == pRTMSA->getMultiSampleArray()[i].cols())
+                {
+                    t_mat = pRTMSA->getMultiSampleArray()[i];
+                    m_pCovarianceBuffer->commit();
+                }
             }
         }
     }
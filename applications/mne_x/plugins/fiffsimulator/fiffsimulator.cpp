@@ -120,6 +120,9 @@ void FiffSimulator::init()
     //init channels when fiff info is available
     connect(this, &FiffSimulator::fiffInfoAvailable, this, &FiffSimulator::initConnector);
 
+    //hand projector changes of the displays to the operator of the acquisition thread
+    connect(&m_projectorTimer, &QTimer::timeout, this, &FiffSimulator::updateProjectors);
+
     //Try to connect the cmd client on start up using localhost connection
     this->connectCmdClient();
 }
@@ -295,6 +298,17 @@ void FiffSimulator::requestInfo()
 }
 
 
+//*************************************************************************************************************
+
+void FiffSimulator::updateProjectors()
+{
+    QMutexLocker locker(&m_qMutex);
+
+    if(m_pRtProjOp && m_pFiffInfo)
+        m_pRtProjOp->setProjectors(m_pFiffInfo->projs, m_pFiffInfo->bads);
+}
+
+
 //*************************************************************************************************************
 
 bool FiffSimulator::start()
@@ -312,6 +326,7 @@ bool FiffSimulator::start()
         // Buffer
         m_qMutex.lock();
         m_pRawMatrixBuffer_In = QSharedPointer<RawMatrixBuffer>(new RawMatrixBuffer(8,m_pFiffInfo->nchan,m_iBufferSize));
+        m_pRtProjOp = RtProjOp::SPtr(new RtProjOp(m_pFiffInfo));
         m_bIsRunning = true;
         m_qMutex.unlock();
 
@@ -320,6 +335,8 @@ bool FiffSimulator::start()
 
         m_pFiffSimulatorProducer->start();
 
+        m_projectorTimer.start(200);
+
         while(!m_pFiffSimulatorProducer->m_bFlagMeasuring)
             msleep(1);
 
@@ -339,6 +356,8 @@ bool FiffSimulator::start()
 
 bool FiffSimulator::stop()
 {
+    m_projectorTimer.stop();
+
     if(m_pFiffSimulatorProducer->isRunning())
         m_pFiffSimulatorProducer->stop();
 
@@ -357,6 +376,18 @@ bool FiffSimulator::stop()
         m_pRTMSA_FiffSimulator->data()->clear();
     }
 
+    m_qMutexArrivalTimes.lock();
+    m_qQueueArrivalTimes.clear();
+    m_qMutexArrivalTimes.unlock();
+
+    if(m_histEndToEnd.count() > 0)
+    {
+        printf("%s\n", m_histEndToEnd.toString("end to end latency").toLatin1().constData());
+        printf("%s\n", m_histQueueDepth.toString("queued slots", "").toLatin1().constData());
+    }
+    m_histEndToEnd.clear();
+    m_histQueueDepth.clear();
+
     return true;
 }
 
@@ -392,6 +423,7 @@ QWidget* FiffSimulator::setupWidget()
 void FiffSimulator::run()
 {
     MatrixXf matValue;
+    MatrixXd t_matValue;
     while(true)
     {
         {
@@ -402,7 +434,32 @@ void FiffSimulator::run()
         //pop matrix
         matValue = m_pRawMatrixBuffer_In->pop();
 
+        qint64 t_iArrivalTime = 0;
+        m_qMutexArrivalTimes.lock();
+        if(!m_qQueueArrivalTimes.isEmpty())
+        {
+            t_iArrivalTime = m_qQueueArrivalTimes.dequeue();
+            m_histQueueDepth.add(m_qQueueArrivalTimes.size());
+        }
+        m_qMutexArrivalTimes.unlock();
+
+        //compensation and SSP of the active projectors, all plugins receive the cleaned data
+        t_matValue = matValue.cast<double>();
+        m_pRtProjOp->apply(t_matValue);
+
         //emit values
-        m_pRTMSA_FiffSimulator->data()->setValue(matValue.cast<double>());
+        m_pRTMSA_FiffSimulator->data()->setValue(t_matValue);
+
+        //latency of stamped buffers (mne_rt_server --block-stamps)
+        if(t_iArrivalTime > 0)
+        {
+            m_histEndToEnd.add(LatencyHistogram::now() - t_iArrivalTime);
+            if(m_histEndToEnd.count() % 1000 == 0)
+            {
+                printf("%s\n", m_histEndToEnd.toString("end to end latency").toLatin1().constData());
+                printf("%s\n", m_pFiffSimulatorProducer->m_pRtDataClient->getLatencyHistogram().toString("server to client latency").toLatin1().constData());
+                printf("%s\n", m_histQueueDepth.toString("queued slots", "").toLatin1().constData());
+            }
+        }
     }
 }
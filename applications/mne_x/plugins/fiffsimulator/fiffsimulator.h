@@ -64,6 +64,9 @@
 //=============================================================================================================
 
 #include <rtClient/rtcmdclient.h>
+#include <rtInv/rtprojop.h>
+
+#include <utils/latencyhistogram.h>
 
 
 //*************************************************************************************************************
@@ -74,6 +77,7 @@
 #include <QtWidgets>
 #include <QVector>
 #include <QTimer>
+#include <QQueue>
 
 
 //*************************************************************************************************************
@@ -93,6 +97,7 @@ namespace FiffSimulatorPlugin
 using namespace MNEX;
 using namespace IOBuffer;
 using namespace RTCLIENTLIB;
+using namespace RTINVLIB;
 using namespace FIFFLIB;
 using namespace XMEASLIB;
 
@@ -194,6 +199,13 @@ public:
     */
     void requestInfo();
 
+    //=========================================================================================================
+    /**
+    * Hands a copy of the projectors and the bad channels to the compensation and SSP operator. Runs in the GUI
+    * thread, which is the only one editing the measurement info.
+    */
+    void updateProjectors();
+
 signals:
     //=========================================================================================================
     /**
@@ -245,11 +257,19 @@ private:
     qint32          m_iBufferSize;                          /**< The raw data buffer size.*/
 
     QTimer          m_cmdConnectionTimer;                   /**< Timer for convinient command client connection. When timer times out a connection is tried to be established. */
+    QTimer          m_projectorTimer;                       /**< Timer which hands the projector selection of the GUI to m_pRtProjOp. */
 
     QSharedPointer<RawMatrixBuffer> m_pRawMatrixBuffer_In;  /**< Holds incoming raw data. */
 
+    RtProjOp::SPtr                  m_pRtProjOp;            /**< Compensation and SSP, applied before the data are emitted.*/
+
     bool                            m_bIsRunning;           /**< Whether FiffSimulator is running.*/
 
+    QMutex                          m_qMutexArrivalTimes;   /**< Guards the arrival times, which are pushed by the producer.*/
+    QQueue<qint64>                  m_qQueueArrivalTimes;   /**< Server arrival time of the newest buffer of each committed slot [us], 0 if unstamped.*/
+    UTILSLIB::LatencyHistogram      m_histEndToEnd;         /**< Latency from the server arrival until the slot is emitted [us].*/
+    UTILSLIB::LatencyHistogram      m_histQueueDepth;       /**< Number of committed slots waiting when a slot is popped.*/
+
 };
 
 } // NAMESPACE
@@ -58,6 +58,7 @@ CONFIG(debug, debug|release) {
             -lMNE$${MNE_LIB_VERSION}Fiffd \
             -lMNE$${MNE_LIB_VERSION}RtCommandd \
             -lMNE$${MNE_LIB_VERSION}RtClientd \
+            -lMNE$${MNE_LIB_VERSION}RtInvd \
             -lxMeasd \
             -lxDispd \
             -lmne_xd
@@ -70,6 +71,7 @@ else {
             -lMNE$${MNE_LIB_VERSION}Fiff \
             -lMNE$${MNE_LIB_VERSION}RtCommand \
             -lMNE$${MNE_LIB_VERSION}RtClient \
+            -lMNE$${MNE_LIB_VERSION}RtInv \
             -lxMeas \
             -lxDisp \
             -lmne_x
@@ -192,7 +192,8 @@ void FiffSimulatorProducer::run()
     //
     // Inits
     //
-    MatrixXf t_matRawBuffer;
+    qint32 t_iSlotFill = 0;
+    qint32 t_iNumBuffers = 0;
 
     fiff_int_t kind;
 
@@ -221,13 +222,32 @@ void FiffSimulatorProducer::run()
 
         if(m_bFlagMeasuring)
         {
-            m_pRtDataClient->readRawBuffer(m_pFiffSimulator->m_pFiffInfo->nchan, t_matRawBuffer, kind);
+            //read the queued buffers directly into the next slot of the ring buffer, it is published when it is full
+            Map<MatrixXf> t_matSlot = m_pFiffSimulator->m_pRawMatrixBuffer_In->acquireWriteSlot();
+            if(t_matSlot.size() == 0)
+                continue;
+
+            qint32 t_iNumSamples = m_pRtDataClient->readRawBuffers(t_matSlot.rows(),
+                                                                   t_matSlot.data() + t_iSlotFill*t_matSlot.rows(),
+                                                                   t_matSlot.cols() - t_iSlotFill,
+                                                                   t_iNumBuffers,
+                                                                   kind);
 
             if(kind == FIFF_DATA_BUFFER)
             {
-                to += t_matRawBuffer.cols();
-                from += t_matRawBuffer.cols();
-                m_pFiffSimulator->m_pRawMatrixBuffer_In->push(&t_matRawBuffer);
+                to += t_iNumSamples;
+                from += t_iNumSamples;
+
+                t_iSlotFill += t_iNumSamples;
+                if(t_iSlotFill == t_matSlot.cols())
+                {
+                    m_pFiffSimulator->m_qMutexArrivalTimes.lock();
+                    m_pFiffSimulator->m_qQueueArrivalTimes.enqueue(m_pRtDataClient->getLastArrivalTime());
+                    m_pFiffSimulator->m_qMutexArrivalTimes.unlock();
+
+                    m_pFiffSimulator->m_pRawMatrixBuffer_In->commit();
+                    t_iSlotFill = 0;
+                }
             }
             else if(FIFF_DATA_BUFFER == FIFF_BLOCK_END)
                 m_bFlagMeasuring = false;
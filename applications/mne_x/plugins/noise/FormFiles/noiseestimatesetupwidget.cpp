@@ -74,6 +74,7 @@ NoiseEstimateSetupWidget::NoiseEstimateSetupWidget(NoiseEstimate* toolbox, QWidg
     connect(ui.m_qComboBoxnFFT, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this, &NoiseEstimateSetupWidget::chgnFFT);
     connect(ui.m_qSpinDataLen, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &NoiseEstimateSetupWidget::chgDataLen);
     connect(ui.m_cb_logscale, static_cast<void (QCheckBox::*)(bool)>(&QCheckBox::clicked), this, &NoiseEstimateSetupWidget::chgXAxisType);
+    connect(ui.m_cb_sliding, static_cast<void (QCheckBox::*)(bool)>(&QCheckBox::clicked), this, &NoiseEstimateSetupWidget::chgSliding);
 
 }
 
@@ -114,6 +115,9 @@ void NoiseEstimateSetupWidget::init()
     else
         ui.m_cb_logscale->setChecked(true);
 
+    //set up the update mode of the spectrum
+    ui.m_cb_sliding->setChecked(m_pNoiseEstimate->m_bSliding);
+
 }
 
 
@@ -148,3 +152,10 @@ void NoiseEstimateSetupWidget::chgXAxisType()
     qDebug() << "setup widget scale type" << m_pNoiseEstimate->m_x_scale_type ;
 }
 
+
+//*************************************************************************************************************
+
+void NoiseEstimateSetupWidget::chgSliding()
+{
+    m_pNoiseEstimate->m_bSliding = ui.m_cb_sliding->isChecked();
+}
@@ -116,6 +116,7 @@ public:
     void chgnFFT(int idx);
     void chgDataLen(int idx);
     void chgXAxisType();
+    void chgSliding();
 
 private slots:
 
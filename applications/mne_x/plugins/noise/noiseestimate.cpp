@@ -75,6 +75,7 @@ NoiseEstimate::NoiseEstimate()
 , m_iFFTlength(16384)
 , m_DataLen(6)
 , m_x_scale_type(0)
+, m_bSliding(true)
 {
 }
 
@@ -111,6 +112,7 @@ void NoiseEstimate::init()
     m_iFFTlength = settings.value(QString("Plugin/%1/FFTLength").arg(this->getName()), 16384).toInt();
     m_DataLen = settings.value(QString("Plugin/%1/DataLen").arg(this->getName()), 6).toInt();
     m_x_scale_type = settings.value(QString("Plugin/%1/ScaleType").arg(this->getName()), 0).toInt();
+    m_bSliding = settings.value(QString("Plugin/%1/Sliding").arg(this->getName()), true).toBool();
 
     // Input
     m_pRTMSAInput = PluginInputData<NewRealTimeMultiSampleArray>::create(this, "Noise Estimatge In", "Noise Estimate input data");
@@ -143,6 +145,7 @@ void NoiseEstimate::unload()
     settings.setValue(QString("Plugin/%1/FFTLength").arg(this->getName()), m_iFFTlength);
     settings.setValue(QString("Plugin/%1/DataLen").arg(this->getName()), m_DataLen);
     settings.setValue(QString("Plugin/%1/ScaleType").arg(this->getName()), m_x_scale_type);
+    settings.setValue(QString("Plugin/%1/Sliding").arg(this->getName()), m_bSliding);
 }
 
 
@@ -266,12 +269,15 @@ void NoiseEstimate::update(XMEASLIB::NewMeasurement::SPtr pMeasurement)
 
         if(m_bProcessData)
         {
-            MatrixXd t_mat;
-
             for(qint32 i = 0; i < pRTMSA->getMultiArraySize(); ++i)
             {
-                t_mat = pRTMSA->getMultiSampleArray()[i];
-                m_pBuffer->push(&t_mat);
+                // Copy the block directly into the ring buffer
+                Map<MatrixXd> t_mat = m_pBuffer->acquireWriteSlot();
+                if(t_mat.rows() == pRTMSA->getMultiSampleArray()[i].rows() && t_mat.cols() == pRTMSA->getMultiSampleArray()[i].cols())
+                {
+                    t_mat = pRTMSA->getMultiSampleArray()[i];
+                    m_pBuffer->commit();
+                }
             }
         }
     }
@@ -321,6 +327,7 @@ void NoiseEstimate::run()
     qDebug()<<"+++++++++++segments :"<<segments<< "m_DataLen"<<m_DataLen<<"m_Fs"<<m_Fs<<"++++++++++++++++++++++++";
 
     m_pRtNoise = RtNoise::SPtr(new RtNoise(m_iFFTlength, m_pFiffInfo, segments));
+    m_pRtNoise->setSpectrumMode(m_bSliding ? RtNoise::SlidingSpectrum : RtNoise::BatchSpectrum);
     connect(m_pRtNoise.data(), &RtNoise::SpecCalculated, this, &NoiseEstimate::appendNoiseSpectrum);
 
     // Start Spectrum estimation
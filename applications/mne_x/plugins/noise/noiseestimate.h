@@ -206,6 +206,7 @@ private:
     qint32 m_iFFTlength;    /**< number of bins for FFT */
     float m_DataLen;        /**< the length of data used for spectrum calculation */
     qint8 m_x_scale_type;   /**< Type of x-axis scale: normal (0) or log (1) */
+    bool m_bSliding;        /**< If the spectrum is updated with every block instead of once per data length */
 
     QMutex m_qMutex;       /**< mutex for spectrum */
 
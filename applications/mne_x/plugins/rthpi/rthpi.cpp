@@ -48,6 +48,7 @@
 
 #include <QtCore/QtPlugin>
 #include <QDebug>
+#include <QMutexLocker>
 
 
 //*************************************************************************************************************
@@ -71,7 +72,11 @@ RtHpi::RtHpi()
 , m_pRTMSAInput(NULL)
 , m_pRTMSAOutput(NULL)
 , m_pRtHpiBuffer(CircularMatrixBuffer<double>::SPtr())
+, m_bCoilFreqsChanged(true)
+, m_bDevHeadTransValid(false)
 {
+    // Default frequencies of four coil continuous HPI
+    m_vecCoilFreqs << 293.0 << 307.0 << 314.0 << 321.0;
 }
 
 
@@ -149,6 +154,12 @@ bool RtHpi::start()
 
     m_bIsRunning = true;
 
+    // Head position tracking starts anew from the digitized positions
+    m_qMutex.lock();
+    m_bCoilFreqsChanged = true;
+    m_bDevHeadTransValid = false;
+    m_qMutex.unlock();
+
     // Start threads
     QThread::start();
 
@@ -224,12 +235,15 @@ void RtHpi::update(XMEASLIB::NewMeasurement::SPtr pMeasurement)
 
         if(m_bProcessData)
         {
-            MatrixXd t_mat;
-
             for(qint32 i = 0; i < pRTMSA->getMultiArraySize(); ++i)
             {
-                t_mat = pRTMSA->getMultiSampleArray()[i];
-                m_pRtHpiBuffer->push(&t_mat);
+                // Copy the block directly into the ring buffer
+                Map<MatrixXd> t_mat = m_pRtHpiBuffer->acquireWriteSlot();
+                if(t_mat.rows() == pRTMSA->getMultiSampleArray()[i].rows() && t_mat.cols() == pRTMSA->getMultiSampleArray()[i].cols())
+                {
+                    t_mat = pRTMSA->getMultiSampleArray()[i];
+                    m_pRtHpiBuffer->commit();
+                }
             }
         }
     }
@@ -237,6 +251,26 @@ void RtHpi::update(XMEASLIB::NewMeasurement::SPtr pMeasurement)
 
 
 
+//*************************************************************************************************************
+
+void RtHpi::setCoilFrequencies(const QVector<double>& p_vecCoilFreqs)
+{
+    QMutexLocker locker(&m_qMutex);
+    m_vecCoilFreqs = p_vecCoilFreqs;
+    m_bCoilFreqsChanged = true;
+}
+
+
+//*************************************************************************************************************
+
+bool RtHpi::getDevHeadTrans(FiffCoordTrans& p_devHeadTrans) const
+{
+    QMutexLocker locker(&m_qMutex);
+    p_devHeadTrans = m_devHeadTrans;
+    return m_bDevHeadTransValid;
+}
+
+
 //*************************************************************************************************************
 
 void RtHpi::run()
@@ -256,7 +290,24 @@ void RtHpi::run()
             /* Dispatch the inputs */
             MatrixXd t_mat = m_pRtHpiBuffer->pop();
 
-            //ToDo: Implement your algorithm here
+            m_qMutex.lock();
+            if(m_bCoilFreqsChanged)
+            {
+                m_pRtHpiFit = RtHpiFit::SPtr(new RtHpiFit(m_pFiffInfo, m_vecCoilFreqs));
+                m_bCoilFreqsChanged = false;
+            }
+            m_qMutex.unlock();
+
+            // Track the head position; the data are passed on unchanged
+            if(m_pRtHpiFit->update(t_mat) && m_pRtHpiFit->isTransValid())
+            {
+                m_qMutex.lock();
+                m_devHeadTrans = m_pRtHpiFit->devHeadTrans();
+                m_bDevHeadTransValid = true;
+                m_qMutex.unlock();
+
+                emit devHeadTransAvailable();
+            }
 
             for(qint32 i = 0; i < t_mat.cols(); ++i)
                 m_pRTMSAOutput->data()->setValue(t_mat.col(i));
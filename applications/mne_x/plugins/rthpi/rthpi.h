@@ -55,6 +55,15 @@
 //=============================================================================================================
 
 #include <fiff/fiff_info.h>
+#include <fiff/fiff_coord_trans.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// RTINV INCLUDES
+//=============================================================================================================
+
+#include <rtInv/rthpifit.h>
 
 
 //*************************************************************************************************************
@@ -82,6 +91,8 @@ namespace RtHpiPlugin
 using namespace MNEX;
 using namespace XMEASLIB;
 using namespace IOBuffer;
+using namespace FIFFLIB;
+using namespace RTINVLIB;
 
 
 //*************************************************************************************************************
@@ -145,6 +156,25 @@ public:
 
     void update(XMEASLIB::NewMeasurement::SPtr pMeasurement);
 
+    //=========================================================================================================
+    /**
+    * Sets the frequencies of the HPI coils, in the order of the digitized coil positions. The coil fitting is
+    * set up anew with the next block.
+    *
+    * @param[in] p_vecCoilFreqs     Frequencies of the HPI coils in Hz.
+    */
+    void setCoilFrequencies(const QVector<double>& p_vecCoilFreqs);
+
+    //=========================================================================================================
+    /**
+    * Returns the most recent device to head transform estimated from the HPI coils.
+    *
+    * @param[out] p_devHeadTrans    The device to head transform.
+    *
+    * @return true if a transform was estimated since the start.
+    */
+    bool getDevHeadTrans(FiffCoordTrans& p_devHeadTrans) const;
+
 signals:
     //=========================================================================================================
     /**
@@ -152,6 +182,12 @@ signals:
     */
     void fiffInfoAvailable();
 
+    //=========================================================================================================
+    /**
+    * Emitted when a new device to head transform was estimated.
+    */
+    void devHeadTransAvailable();
+
 protected:
     virtual void run();
 
@@ -170,6 +206,13 @@ private:
 
     CircularMatrixBuffer<double>::SPtr   m_pRtHpiBuffer;    /**< Holds incoming data.*/
 
+    RtHpiFit::SPtr  m_pRtHpiFit;                            /**< Continuous HPI coil fitting, created in the processing thread.*/
+    QVector<double> m_vecCoilFreqs;                         /**< Frequencies of the HPI coils in Hz.*/
+    bool            m_bCoilFreqsChanged;                    /**< Whether the coil fitting has to be set up anew.*/
+    FiffCoordTrans  m_devHeadTrans;                         /**< Most recent device to head transform.*/
+    bool            m_bDevHeadTransValid;                   /**< Whether m_devHeadTrans was estimated.*/
+    mutable QMutex  m_qMutex;                               /**< Guards the coil frequencies and the transform.*/
+
     bool m_bIsRunning;      /**< If source lab is running */
     bool m_bProcessData;    /**< If data should be received for processing */
 };
@@ -49,8 +49,6 @@
 
 #include <QtCore/QtPlugin>
 #include <QDebug>
-#include <QFuture>
-#include <QtConcurrent/QtConcurrentMap>
 #include <QSettings>
 
 RtSssAlgo rsss;
@@ -266,17 +264,6 @@ void RtSss::update(XMEASLIB::NewMeasurement::SPtr pMeasurement)
 }
 
 
-//*************************************************************************************************************
-
-
-MatrixXd rt_sss(const MatrixXd &p_mat)
-{
-    MatrixXd out;
-    out = rsss.getSSSRR(p_mat);
-    return out;
-}
-
-
 //*************************************************************************************************************
 
 void RtSss::run()
@@ -363,8 +350,8 @@ void RtSss::run()
     {
 //        if (m_bIsHeadMov)
 //        {
+            // Only rebuilds when the sensor geometry, the origin or the expansion orders changed
             lineqn = rsss.buildLinearEqn();
-            qDebug() << "rebuilt SSS linear equation .....";
 //            m_bIsHeadMov = false;
 //        }
 //        else
@@ -391,20 +378,9 @@ void RtSss::run()
                 }
 //            in_mat_used = in_mat.block(0,0,nmegchanused,in_mat.cols());
 
-            // Implement Concurrent mapreduced for parallel processing
-            // divide the in_mat_used into 2 or 4 matrices, which renders 50ms or 25ms data
-            QList<MatrixXd> list_in_mat;
-            qint32 nSubSample = 20;
-            qint32 nThread = in_mat.cols() / nSubSample;
-
-            for(qint32 ith = 0; ith < nThread; ++ ith)
-                list_in_mat.append(in_mat_used.block(0,ith*nSubSample,nmegchanused,nSubSample));
-
-            QFuture<MatrixXd> res = QtConcurrent::mapped(list_in_mat, rt_sss);
-            res.waitForFinished();
-
-            for(qint32 ith = 0; ith < nThread; ++ ith)
-                in_mat_used.block(0,ith*nSubSample,nmegchanused,nSubSample)= res.resultAt(ith);
+            // Apply SSS to the whole block by the precomputed projection; this is the OLS solution, the robust
+            // regression of getSSSRR is no longer applied per block
+            in_mat_used = rsss.getSSSProj(in_mat_used);
 
             // Replace raw signal by SSS signal
             for(qint32 i = 0, k = 0; i < nmegchan; ++i)
@@ -429,50 +405,3 @@ void RtSss::run()
     qDebug() << "rtSSS stopped.";
 }
 
-
-
-//
-// A possible way of passing parameters to QtConcurrent::mapped
-
-//QFuture<MatrixXd> thumbnails = QtConcurrent::mapped(list_in_mat, rsss.getSSSRR);
-
-
-//class obj
-//{
-//    MatrixXd data;
-//    int lineq1;
-//    int lineq2;
-//    int lineq3;
-//    int lineq4;
-
-//    MatrixXd getSSSRR()
-//    {
-
-//        lineq1;
-//        lineq2;
-//        lineq3;
-//        lineq4;
-//        MatrixXd res;
-//        return res;
-//    }
-//};
-
-
-//QList<obj> qListObj;
-
-////            {
-//obj obj0;
-//obj0.data = list_in_mat(0);
-//obj0.lineq1 = 0; obj0.lineq2 = 0; obj0.lineq3 = 0; obj0.lineq4 = 0;
-
-//obj obj1;
-//obj1.data = list_in_mat(1);
-//obj1.lineq1 = 0; obj1.lineq2 = 0; obj1.lineq3 = 1; obj1.lineq4 = 0;
-
-//qListObj << obj0;
-//qListObj << obj1;
-////            }
-
-//QFuture<MatrixXd> thumbnails = QtConcurrent::mapped(qListObj, &obj::getSSSRR);
-
-
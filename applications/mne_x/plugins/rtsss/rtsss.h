@@ -96,6 +96,10 @@ using namespace IOBuffer;
 /**
 * DECLARE CLASS RTSSS
 *
+* The MEG channels are reconstructed from the internal SSS expansion by the OLS projection of RtSssAlgo::getSSSProj.
+* Former versions applied the robust regression of RtSssAlgo::getSSSRR, so the output differs where the data
+* contain outliers.
+*
 * @brief The RtSss class provides a rtsss algorithm structure.
 */
 //class DUMMYTOOLBOXSHARED_EXPORT DummyToolbox : public IAlgorithm
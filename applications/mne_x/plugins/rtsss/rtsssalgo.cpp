@@ -39,11 +39,17 @@
 #include "rtsssalgo.h"
 #include <QFuture>
 #include <QtConcurrent/QtConcurrentMap>
+#include <limits>
 //#include "FormFiles/rtssssetupwidget.h"
 
 RtSssAlgo::RtSssAlgo()
+: NumMEGChan(0)
+, NumCoil(0)
+, NumBadCoil(0)
+, EqnValid(false)
 {
-
+    // Set origin of head(?) coordinate
+    Origin << 0.0, 0.0, 0.04;
 }
 
 RtSssAlgo::~RtSssAlgo()
@@ -59,6 +65,10 @@ MatrixXd RtSssAlgo::buildLinearEqn()
     qint32 LIn, LOut;
 //    MatrixXd EqnInRR, EqnOutRR, EqnIn, EqnOut;
 
+    // The equations only change with the sensor geometry, the origin and the expansion orders
+    if (isEqnCurrent())
+        return CoilScale.asDiagonal();
+
 //    int MagScale;
 //    int MACHINE_TYPE = VECTORVIEW;
 
@@ -122,7 +132,6 @@ MatrixXd RtSssAlgo::buildLinearEqn()
     if ((0 < CoilGrad.sum()) && (CoilGrad.sum() < NumCoil))  MagScale = 100;
     else MagScale = 1;
 
-    VectorXd CoilScale;
     CoilScale.setOnes(NumCoil);
     for(int i=0; i<NumCoil; i++)
     {
@@ -161,6 +170,14 @@ MatrixXd RtSssAlgo::buildLinearEqn()
 
 //    std::cout << "building SSS linear equation .....finished !" << endl;
 
+    getSSSPinv();
+
+    EqnCoilT = CoilT;
+    EqnCoilNk = CoilNk;
+    EqnOrigin = Origin;
+    EqnOrder << LInRR, LOutRR, LInOLS, LOutOLS;
+    EqnValid = true;
+
 //    return LinEqn;
     return CoilScale.asDiagonal();
 }
@@ -178,12 +195,18 @@ void RtSssAlgo::setSSSParameter(QList<int> expansionOrder)
     LOutOLS = expansionOrder[3];
 }
 
-void RtSssAlgo::setMEGInfo(FiffInfo::SPtr fiffInfo)
+void RtSssAlgo::setOrigin(const Vector3d& origin)
 {
+    Origin = origin;
+}
 
-    // Set origin of head(?) coordinate
-    Origin.resize(3);
-    Origin << 0.0, 0.0, 0.04;
+void RtSssAlgo::setMEGInfo(FiffInfo::SPtr fiffInfo)
+{
+    // Coil information is collected anew
+    CoilT.clear();
+    CoilName.clear();
+    CoilRk.clear();
+    CoilWk.clear();
 
 //    // Find the number of MEG channels
 //    qint32 nmegchan = 0;
@@ -738,7 +761,7 @@ void RtSssAlgo::getSphereToCartesianVector()
 MatrixXd RtSssAlgo::getSSSRR(MatrixXd EqnB)
 {
     int NumBIn, NumBOut, NumCoil, NumExp;
-    MatrixXd EqnRRInv, EqnInv, SSSIn, SSSOut, Weight; //, ErrRel;
+    MatrixXd SSSIn, SSSOut, Weight; //, ErrRel;
     VectorXd ErrRel;
     double RR_K1, RR_K2, RR_K3;
     double eqn_scale0, eqn_scale;
@@ -759,8 +782,7 @@ MatrixXd RtSssAlgo::getSSSRR(MatrixXd EqnB)
     NumCoil = EqnB.rows();
     NumExp = EqnB.cols();
 
-    EqnRRInv = (EqnARR.transpose() * EqnARR).inverse();
-    EqnInv = (EqnA.transpose() * EqnA).inverse();
+    // EqnRRInv and EqnInv are precomputed by buildLinearEqn
 
     SSSIn.setZero(NumCoil,NumExp);
     SSSOut.setZero(NumCoil,NumExp);
@@ -832,7 +854,7 @@ MatrixXd RtSssAlgo::getSSSRR(MatrixXd EqnB)
             diagMat = (1 / eqn_D.array()).matrix().asDiagonal();
 //            cout << "diagMat ************************" << i+1 << endl << diagMat.rows() << " x" << diagMat.cols() << endl;
 
-            sol_X = EqnRRInv * temp_M - temp_N * (diagMat + eqn_Y * temp_N).inverse() * (temp_N.transpose() * temp_M);
+            sol_X = EqnRRInv * temp_M - temp_N * (diagMat + eqn_Y * temp_N).partialPivLu().solve(temp_N.transpose() * temp_M);
             eqn_err = (EqnARR * sol_X - EqnB.col(i)).cwiseAbs();
             eqn_scale = qMin(eqn_scale0, RR_K3 * qSqrt((Weight.col(i).array() * eqn_err.array() * eqn_err.array()).mean()));
             eqn_err = eqn_err / eqn_scale;
@@ -855,7 +877,7 @@ MatrixXd RtSssAlgo::getSSSRR(MatrixXd EqnB)
 //        diagMat = eqn_D.asDiagonal();
 //        diagMat = 1 / diagMat.array();
         diagMat = (1 / eqn_D.array()).matrix().asDiagonal();
-        sol_X = EqnInv * temp_M - temp_N * (diagMat + eqn_Y * temp_N).inverse() * (temp_N.transpose() * temp_M);
+        sol_X = EqnInv * temp_M - temp_N * (diagMat + eqn_Y * temp_N).partialPivLu().solve(temp_N.transpose() * temp_M);
 
         ErrRel(i) = (EqnA * sol_X - EqnB.col(i)).norm() / EqnB.col(i).norm();
 
@@ -902,38 +924,24 @@ MatrixXd RtSssAlgo::getSSSRR(MatrixXd EqnB)
 //QList<MatrixXd> RtSssAlgo::getSSSOLS(MatrixXd EqnB)
 MatrixXd RtSssAlgo::getSSSOLS(MatrixXd EqnB)
 {
-    int NumBIn, NumBOut, NumCoil, NumExp;
-    MatrixXd EqnRRInv, EqnInv, SSSIn, SSSOut;
-    MatrixXd sol_X, sol_in, sol_out;
+    int NumBIn, NumBOut;
+    MatrixXd SSSIn, SSSOut;
+    MatrixXd sol_X;
     VectorXd ErrRel;
     QList<MatrixXd> OLSsss;
 
 //  % initialization
     NumBIn = EqnIn.cols();
     NumBOut = EqnOut.cols();
-    NumCoil = EqnB.rows();
-    NumExp = EqnB.cols();
-
-    EqnRRInv = (EqnA.transpose() * EqnA).inverse();
-    SSSIn.setZero(NumCoil,NumExp);
-    SSSOut.setZero(NumCoil,NumExp);
-    ErrRel.setZero(NumExp);
-
-    for (int i=0; i<NumExp; i++)
-    {
-//      % solve OLS solution
-        sol_X = EqnRRInv * (EqnA.transpose() * EqnB.col(i));
 
-        ErrRel(i) = (EqnA * sol_X - EqnB.col(i)).norm() / EqnB.col(i).norm();
+//  % solve OLS solution of all samples with the precomputed pseudo-inverse
+    sol_X = EqnPinv * EqnB;
 
-        sol_in = sol_X.block(0,0,NumBIn,1);
+    ErrRel = ((EqnA * sol_X - EqnB).colwise().norm().array() / EqnB.colwise().norm().array()).transpose();
 
-        sol_out = sol_X.block(NumBIn,0, NumBOut,1);    // probably NumBIn+0 is correct.  Please debug !!!!
-
-//      % recover internal/external MEG siganl
-        SSSIn.col(i) = EqnIn * sol_in;
-        SSSOut.col(i) = EqnOut * sol_out;
-    }
+//  % recover internal/external MEG siganl
+    SSSIn = EqnIn * sol_X.topRows(NumBIn);
+    SSSOut = EqnOut * sol_X.middleRows(NumBIn, NumBOut);
 
     OLSsss.append(SSSIn);
     OLSsss.append(SSSOut);
@@ -943,6 +951,70 @@ MatrixXd RtSssAlgo::getSSSOLS(MatrixXd EqnB)
     return SSSIn;
 }
 
+//%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+//% SSS by the precomputed OLS projection
+//%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+//% MEGData(i,j):     MEG signal, not scaled
+//%                   i: i-th coil
+//%                   j: j-th sample in time domain
+//%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+//% SSSIn(i,j):       internal MEG signal recovered by SSS, equal to the
+//%                   SSSIn of getSSSOLS(CoilScale * MEGData)
+//%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+MatrixXd RtSssAlgo::getSSSProj(const MatrixXd& MEGData)
+{
+    return SSSProj * MEGData;
+}
+
+//%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+//% Check whether the linear equations were built for the current sensor
+//% geometry, origin and expansion orders
+//%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+bool RtSssAlgo::isEqnCurrent()
+{
+    if (!EqnValid || EqnOrigin != Origin || EqnOrder != Vector4i(LInRR, LOutRR, LInOLS, LOutOLS)
+            || EqnCoilNk.size() != CoilNk.size() || EqnCoilNk != CoilNk || EqnCoilT.size() != CoilT.size())
+        return false;
+
+    for(int i=0; i<CoilT.size(); i++)
+        if (EqnCoilT[i] != CoilT[i])
+            return false;
+
+    return true;
+}
+
+//%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+//% Pseudo-inverses of the SSS equations from their SVDs
+//% -- (A'*A)^-1 = V*S^-2*V' and pinv(A) = V*S^-1*U' do not square the
+//%    condition number as forming and inverting A'*A does
+//% -- singular values below max(size)*eps*S(1) are truncated as in pinv.m
+//%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+void RtSssAlgo::getSSSPinv()
+{
+    VectorXd s_inv;
+    double tol;
+
+    JacobiSVD<MatrixXd> svd(EqnA, ComputeThinU | ComputeThinV);
+    s_inv = svd.singularValues();
+    tol = qMax(EqnA.rows(), EqnA.cols()) * std::numeric_limits<double>::epsilon() * s_inv(0);
+    for(int i=0; i<s_inv.size(); i++)
+        s_inv(i) = s_inv(i) > tol ? 1.0/s_inv(i) : 0.0;
+
+    EqnPinv = svd.matrixV() * s_inv.asDiagonal() * svd.matrixU().transpose();
+    EqnInv = svd.matrixV() * s_inv.array().square().matrix().asDiagonal() * svd.matrixV().transpose();
+
+    JacobiSVD<MatrixXd> svdRR(EqnARR, ComputeThinV);
+    s_inv = svdRR.singularValues();
+    tol = qMax(EqnARR.rows(), EqnARR.cols()) * std::numeric_limits<double>::epsilon() * s_inv(0);
+    for(int i=0; i<s_inv.size(); i++)
+        s_inv(i) = s_inv(i) > tol ? 1.0/s_inv(i) : 0.0;
+
+    EqnRRInv = svdRR.matrixV() * s_inv.array().square().matrix().asDiagonal() * svdRR.matrixV().transpose();
+
+//  % internal signal of the scaled data: EqnIn * sol_in = EqnIn * pinv(A)(1:NumBIn,:) * CoilScale * MEGData
+    SSSProj = EqnIn * EqnPinv.topRows(EqnIn.cols()) * CoilScale.asDiagonal();
+}
+
 // Return number of meg channels
 qint32 RtSssAlgo::getNumMEGChanUsed()
 {
@@ -1005,10 +1077,10 @@ MatrixXd legendre(int l, VectorXd x)
 }
 
 
-float plgndr(int l, int m, float x)
+double plgndr(int l, int m, double x)
 {
 //    void nrerror(char error_text[]);
-    float fact,pll,pmm,pmmp1,somx2;
+    double fact,pll,pmm,pmmp1,somx2;
     int i,ll;
 
     if (m < 0 || m > l || fabs(x) > 1.0)
@@ -76,7 +76,7 @@ using namespace FIFFLIB;
 typedef std::complex<double> cplxd;
 
 MatrixXd legendre(int, VectorXd);
-float plgndr(int l, int m, float x);
+double plgndr(int l, int m, double x);
 double factorial(int);
 //QList<MatrixXd> getSSSRR(MatrixXd, MatrixXd, MatrixXd, MatrixXd, MatrixXd);
 VectorXd hypot(VectorXd, VectorXd);
@@ -107,10 +107,14 @@ public:
 //    QList<MatrixXd> getSSSOLS(MatrixXd EqnB);
     MatrixXd getSSSOLS(MatrixXd EqnB);
 
+    // SSS of a block of unscaled MEG data (used coils x samples) by the precomputed OLS projection
+    MatrixXd getSSSProj(const MatrixXd& MEGData);
+
     QList<MatrixXd> getLinEqn();
 
     void setMEGInfo(FiffInfo::SPtr fiffinfo);
     void setSSSParameter(QList<int>);
+    void setOrigin(const Vector3d& origin);
     qint32 getNumMEGChan();
     qint32 getNumMEGChanUsed();
     qint32 getNumMEGBadChan();
@@ -126,6 +130,8 @@ private:
     void getCartesianToSpherCoordinate(VectorXd, VectorXd, VectorXd);
     void getSphereToCartesianVector();
     int strmatch(char, char);
+    bool isEqnCurrent();
+    void getSSSPinv();
 
     qint32 NumMEGChan, NumCoil, NumBadCoil;
     VectorXi BadChan;
@@ -141,6 +147,17 @@ private:
     MatrixXd BInX, BInY, BInZ, BOutX, BOutY, BOutZ;
     MatrixXd EqnInRR, EqnOutRR, EqnIn, EqnOut, EqnARR, EqnA, EqnB;
 
+    // Cache of the linear equations, which only depend on the sensor geometry, the origin and the expansion orders
+    bool EqnValid;
+    QList<MatrixXd> EqnCoilT;
+    VectorXi EqnCoilNk;
+    Vector3d EqnOrigin;
+    Vector4i EqnOrder;
+    VectorXd CoilScale;
+    MatrixXd EqnRRInv, EqnInv;      // (EqnARR'*EqnARR)^-1 and (EqnA'*EqnA)^-1 from the SVD
+    MatrixXd EqnPinv;               // pseudo-inverse of EqnA
+    MatrixXd SSSProj;               // EqnIn * internal rows of EqnPinv * CoilScale, used coils x used coils
+
     VectorXd R, PHI, THETA;
     VectorXd R_X, R_Y, R_Z;
     VectorXd PHI_X, PHI_Y, PHI_Z;
@@ -36,6 +36,8 @@
 
 #include "frequencyspectrummodel.h"
 
+#include <utils/welchpsd.h>
+
 #include <QDebug>
 #include <QBrush>
 #include <QThread>
@@ -47,6 +49,7 @@
 //=============================================================================================================
 
 using namespace XDISPLIB;
+using namespace UTILSLIB;
 
 
 //*************************************************************************************************************
@@ -208,19 +211,17 @@ void FrequencySpectrumModel::addData(const MatrixXd &data)
 
     if(m_vecFreqScale.size() != m_dataCurrent.cols() && m_pFiffInfo)
     {
-        double freqRes = (m_pFiffInfo->sfreq/2) / m_dataCurrent.cols();
+        // one sided spectrum of an even fft length: the last bin is the nyquist frequency
+        VectorXd t_vecFreqs = WelchPsd::binFrequencies(2*(m_dataCurrent.cols()-1), m_pFiffInfo->sfreq);
         double k = 1.0;
         m_vecFreqScale.resize(1,m_dataCurrent.cols());
 
-        double currFreq = 0;
         for(qint32 i = 0; i < m_dataCurrent.cols(); ++i)
         {
             if (m_iScaleType) //log
-                m_vecFreqScale[i] = log10(currFreq+k);
+                m_vecFreqScale[i] = log10(t_vecFreqs[i]+k);
             else // normal
-                m_vecFreqScale[i] = currFreq;
-
-            currFreq += freqRes;
+                m_vecFreqScale[i] = t_vecFreqs[i];
         }
 
         double max = m_vecFreqScale.maxCoeff();
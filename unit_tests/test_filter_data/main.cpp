@@ -0,0 +1,167 @@
+//=============================================================================================================
+/**
+* @file     main.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     January, 2015
+*
+* @section  LICENSE
+*
+* Copyright (C) 2015, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Checks the multi row FFT filtering of FilterData and the workspaces of FFTPlanCache.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <utils/filterdata.h>
+#include <utils/fftplancache.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtCore/QCoreApplication>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+using namespace UTILSLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Methods
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* FilterData::applyFFTFilter of a matrix against the single row version, for enough rows to be distributed over
+* several threads and for a single row. Returns the number of failed checks.
+*/
+qint32 checkMatrixFilter(FilterData& p_filter, qint32 p_iNumRows, qint32 p_iNumSamples)
+{
+    MatrixXd t_matData = MatrixXd::Random(p_iNumRows, p_iNumSamples);
+
+    MatrixXd t_matRef(p_iNumRows, p_filter.m_iFFTlength - p_filter.m_iFilterOrder);
+    for(qint32 i = 0; i < p_iNumRows; ++i)
+    {
+        RowVectorXd t_vecRow = t_matData.row(i);
+        t_matRef.row(i) = p_filter.applyFFTFilter(t_vecRow);
+    }
+
+    MatrixXd t_matFiltered = t_matData;
+    p_filter.applyFFTFilter(t_matFiltered);
+
+    double t_dError = t_matFiltered.rows() == t_matRef.rows() && t_matFiltered.cols() == t_matRef.cols() ? (t_matFiltered - t_matRef).cwiseAbs().maxCoeff() : 1.0;
+    bool t_bOk = t_dError < 1e-12;
+    printf("%3d rows of %4d samples, fft length %4d: max deviation from the single row filter %e; %s\n", p_iNumRows, p_iNumSamples, p_filter.m_iFFTlength, t_dError, t_bOk ? "ok" : "failed");
+
+    return t_bOk ? 0 : 1;
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* A workspace in use survives the eviction of other lengths, as long as fewer than MaxLengths other lengths are
+* requested. Returns the number of failed checks.
+*/
+qint32 checkWorkspaceEviction()
+{
+    FFTPlanCache::clear();
+
+    FFTWorkspace& t_workspace = FFTPlanCache::workspace(64);
+    t_workspace.vecTime.setConstant(1.0);
+
+    //fill the cache, then evict the other lengths twice over; the workspace in use is requested in between
+    bool t_bOk = true;
+    for(qint32 k = 0; k < 3; ++k)
+    {
+        for(qint32 i = 1; i < FFTPlanCache::MaxLengths; ++i)
+            FFTPlanCache::workspace(64 + 2*(k*FFTPlanCache::MaxLengths + i));
+
+        t_bOk = t_bOk && &FFTPlanCache::workspace(64) == &t_workspace;
+    }
+    t_bOk = t_bOk && t_workspace.vecTime.size() == 64 && t_workspace.vecTime.isConstant(1.0);
+
+    printf("Workspace in use kept while %d lengths were evicted: %s\n", 2*(FFTPlanCache::MaxLengths-1), t_bOk ? "ok" : "failed");
+
+    FFTPlanCache::clear();
+
+    return t_bOk ? 0 : 1;
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    srand(0);
+
+    FilterData t_filterBpf("BPF", FilterData::BPF, 80, 0.2, 0.1, 0.05, 1024);
+    FilterData t_filterLpf("LPF", FilterData::LPF, 128, 0.3, 0.0, 0.05, 512);
+
+    qint32 t_iErrors = checkMatrixFilter(t_filterBpf, 306, 1024 - 80);
+    t_iErrors += checkMatrixFilter(t_filterBpf, 1, 1024 - 80);
+    t_iErrors += checkMatrixFilter(t_filterBpf, 40, 300);
+    t_iErrors += checkMatrixFilter(t_filterLpf, 306, 512 - 128);
+    t_iErrors += checkWorkspaceEviction();
+
+    printf("%d errors\n", t_iErrors);
+
+    return t_iErrors == 0 ? 0 : 1;
+}
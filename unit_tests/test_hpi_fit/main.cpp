@@ -0,0 +1,422 @@
+//=============================================================================================================
+/**
+* @file     main.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     January, 2015
+*
+* @section  LICENSE
+*
+* Copyright (C) 2015, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Continuous HPI coil fitting on synthetic Neuromag 306 channel data.
+*
+*/
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <rtInv/rthpifit.h>
+#include <fiff/fiff_info.h>
+#include <fiff/fiff_constants.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtCore/QCoreApplication>
+#include <QElapsedTimer>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+using namespace FIFFLIB;
+using namespace RTINVLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Methods
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* Neuromag like sensor array: 102 triplets of two orthogonal planar gradiometers and one magnetometer on a
+* helmet shaped cap of 12 cm radius around the device origin.
+*/
+FiffInfo::SPtr createInfo(double p_dSFreq)
+{
+    FiffInfo::SPtr t_pInfo(new FiffInfo);
+    t_pInfo->sfreq = p_dSFreq;
+
+    qint32 t_iNumPos = 102;
+    for(qint32 i = 0; i < t_iNumPos; ++i)
+    {
+        // spiral on the cap, down to 20 degrees below the equator
+        double t_dCosTheta = 1.0 - (i + 0.5) / t_iNumPos * 1.34;
+        double t_dSinTheta = sqrt(1.0 - t_dCosTheta*t_dCosTheta);
+        double t_dPhi = i * M_PI * (3.0 - sqrt(5.0));
+
+        Vector3d t_vecEz(t_dSinTheta*cos(t_dPhi), t_dSinTheta*sin(t_dPhi), t_dCosTheta);
+        Vector3d t_vecEx = Vector3d::UnitZ().cross(t_vecEz);
+        t_vecEx = t_vecEx.norm() > 1e-6 ? t_vecEx.normalized() : Vector3d::UnitX();
+        Vector3d t_vecEy = t_vecEz.cross(t_vecEx);
+
+        for(qint32 k = 0; k < 3; ++k)
+        {
+            FiffChInfo t_chInfo;
+            t_chInfo.kind = FIFFV_MEG_CH;
+            t_chInfo.coord_frame = FIFFV_COORD_DEVICE;
+            t_chInfo.ch_name = QString("MEG%1%2").arg(i+1, 3, 10, QChar('0')).arg(k+1);
+            t_chInfo.coil_type = k < 2 ? FIFFV_COIL_VV_PLANAR_T1 : FIFFV_COIL_VV_MAG_T3;
+            t_chInfo.unit = k < 2 ? FIFF_UNIT_T_M : FIFF_UNIT_T;
+
+            Vector3d t_vecX = k == 1 ? t_vecEy : t_vecEx;
+            Vector3d t_vecY = t_vecEz.cross(t_vecX);
+            t_chInfo.loc.segment<3>(0) = 0.12 * t_vecEz;
+            t_chInfo.loc.segment<3>(3) = t_vecX;
+            t_chInfo.loc.segment<3>(6) = t_vecY;
+            t_chInfo.loc.segment<3>(9) = t_vecEz;
+
+            t_pInfo->chs.append(t_chInfo);
+            t_pInfo->ch_names.append(t_chInfo.ch_name);
+        }
+    }
+    t_pInfo->nchan = t_pInfo->chs.size();
+
+    // Coils on the scalp, head coordinates
+    double t_aCoils[4][3] = {{-0.04, 0.07, 0.04}, {0.04, 0.07, 0.04}, {-0.06, -0.03, 0.06}, {0.06, -0.03, 0.06}};
+    for(qint32 i = 0; i < 4; ++i)
+    {
+        FiffDigPoint t_digPoint;
+        t_digPoint.kind = FIFFV_POINT_HPI;
+        t_digPoint.ident = i+1;
+        t_digPoint.coord_frame = FIFFV_COORD_HEAD;
+        for(qint32 k = 0; k < 3; ++k)
+            t_digPoint.r[k] = t_aCoils[i][k];
+        t_pInfo->dig.append(t_digPoint);
+    }
+
+    return t_pInfo;
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* Head to device transform of a rotation about the device z-axis and a translation.
+*/
+Matrix4d headDevTrans(double p_dAngleDeg, const Vector3d& p_vecShift)
+{
+    Matrix4d t_matTrans = Matrix4d::Identity();
+    t_matTrans.topLeftCorner<3,3>() = AngleAxisd(p_dAngleDeg * M_PI / 180.0, Vector3d::UnitZ()).toRotationMatrix();
+    t_matTrans.topRightCorner<3,1>() = Vector3d(0.0, 0.005, -0.03) + p_vecShift;
+    return t_matTrans;
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* Field of a magnetic dipole, integrated over the coils of each MEG channel.
+*/
+VectorXd dipoleField(const FiffInfo& p_info, const Vector3d& p_vecPos, const Vector3d& p_vecMoment)
+{
+    VectorXd t_vecField(p_info.nchan);
+    for(qint32 c = 0; c < p_info.nchan; ++c)
+    {
+        const FiffChInfo& t_chInfo = p_info.chs[c];
+        Vector3d t_vecNormal = t_chInfo.loc.segment<3>(9);
+
+        double t_dBaseline = t_chInfo.unit == FIFF_UNIT_T_M ? 0.0168 : 0.0;
+        t_vecField[c] = 0;
+        for(qint32 s = (t_dBaseline > 0 ? -1 : 1); s <= 1; s += 2)
+        {
+            Vector3d r = t_chInfo.loc.segment<3>(0) + s*0.5*t_dBaseline*t_chInfo.loc.segment<3>(3) - p_vecPos;
+            double d = r.norm();
+            double b = 1e-7 * t_vecNormal.dot(3.0*p_vecMoment.dot(r)*r/(d*d) - p_vecMoment) / (d*d*d);
+            t_vecField[c] += t_dBaseline > 0 ? s*b/t_dBaseline : b;
+        }
+    }
+    return t_vecField;
+}
+
+
+//*************************************************************************************************************
+
+double gaussian()
+{
+    double u1 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    double u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return sqrt(-2.0*log(u1)) * cos(2.0*M_PI*u2);
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* Synthetic raw data: the coils at their frequencies plus white sensor noise, a 10 Hz background and drifting
+* offsets.
+*/
+class HpiSimulator
+{
+public:
+    HpiSimulator(FiffInfo::SPtr p_pInfo, const QVector<double>& p_vecFreqs)
+    : m_pInfo(p_pInfo)
+    , m_vecFreqs(p_vecFreqs)
+    , m_iSample(0)
+    {
+        for(qint32 i = 0; i < m_vecFreqs.size(); ++i)
+            m_qListMoments.append(2e-9 * Vector3d::Random().normalized());
+        m_vecOffsets = 1e-10 * VectorXd::Random(m_pInfo->nchan);
+        m_vecBackground = dipoleField(*m_pInfo, Vector3d(0.0, 0.0, 0.04), Vector3d(2e-8, 1e-8, 0.0));
+    }
+
+    MatrixXd block(qint32 p_iNumSamples, const Matrix4d& p_matHeadDev, MatrixX3d& p_matCoilDev)
+    {
+        qint32 t_iNumCoils = m_vecFreqs.size();
+        p_matCoilDev.resize(t_iNumCoils, 3);
+
+        MatrixXd t_matPatterns(m_pInfo->nchan, t_iNumCoils);
+        for(qint32 j = 0; j < t_iNumCoils; ++j)
+        {
+            Vector3d t_vecHead(m_pInfo->dig[j].r[0], m_pInfo->dig[j].r[1], m_pInfo->dig[j].r[2]);
+            Vector3d t_vecDev = p_matHeadDev.topLeftCorner<3,3>() * t_vecHead + p_matHeadDev.topRightCorner<3,1>();
+            p_matCoilDev.row(j) = t_vecDev.transpose();
+            t_matPatterns.col(j) = dipoleField(*m_pInfo, t_vecDev, p_matHeadDev.topLeftCorner<3,3>() * m_qListMoments[j]);
+        }
+
+        MatrixXd t_matData(m_pInfo->nchan, p_iNumSamples);
+        for(qint32 s = 0; s < p_iNumSamples; ++s, ++m_iSample)
+        {
+            double t_dTime = m_iSample / m_pInfo->sfreq;
+            VectorXd t_vecWaves(t_iNumCoils);
+            for(qint32 j = 0; j < t_iNumCoils; ++j)
+                t_vecWaves[j] = cos(2*M_PI*m_vecFreqs[j]*t_dTime + j);
+
+            t_matData.col(s) = t_matPatterns * t_vecWaves + m_vecBackground * sin(2*M_PI*10.0*t_dTime) + m_vecOffsets * (1.0 + 0.1*t_dTime);
+            for(qint32 c = 0; c < m_pInfo->nchan; ++c)
+                t_matData(c,s) += (m_pInfo->chs[c].unit == FIFF_UNIT_T_M ? 1e-11 : 1e-13) * gaussian();
+        }
+
+        return t_matData;
+    }
+
+private:
+    FiffInfo::SPtr      m_pInfo;
+    QVector<double>     m_vecFreqs;
+    QList<Vector3d>     m_qListMoments;
+    VectorXd            m_vecOffsets;
+    VectorXd            m_vecBackground;
+    qint64              m_iSample;
+};
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* Largest distance between the fitted and the true coil positions, and the deviation of the estimated head to
+* device transform from the true one, measured as the largest displacement of the coils.
+*/
+void compare(const RtHpiFit& p_hpiFit, const MatrixX3d& p_matCoilDev, const Matrix4d& p_matHeadDev, const FiffInfo& p_info, double& p_dCoilError, double& p_dTransError)
+{
+    p_dCoilError = (p_hpiFit.coilPositions() - p_matCoilDev).rowwise().norm().maxCoeff();
+
+    p_dTransError = 1.0;
+    if(!p_hpiFit.isTransValid())
+        return;
+
+    Matrix4d t_matHeadDev = p_hpiFit.devHeadTrans().invtrans.cast<double>();
+    p_dTransError = 0;
+    for(qint32 j = 0; j < p_hpiFit.numCoils(); ++j)
+    {
+        Vector4d t_vecHead(p_info.dig[j].r[0], p_info.dig[j].r[1], p_info.dig[j].r[2], 1.0);
+        p_dTransError = qMax(p_dTransError, (t_matHeadDev * t_vecHead - p_matHeadDev * t_vecHead).norm());
+    }
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* The function main marks the entry point of the program.
+* By default, main has the storage class extern.
+*
+* @param [in] argc (argument count) is an integer that indicates how many arguments were entered on the command line when the program was started.
+* @param [in] argv (argument vector) is an array of pointers to arrays of character objects. The array objects are null-terminated strings, representing the arguments that were entered on the command line when the program was started.
+* @return the value that was set to exit() (which is 0 if exit() is called via quit()).
+*/
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    srand(1);
+
+    double t_dSFreq = 1000.0;
+    qint32 t_iBlockSize = 50;
+    QVector<double> t_vecFreqs;
+    t_vecFreqs << 293.0 << 307.0 << 314.0 << 321.0;
+
+    FiffInfo::SPtr t_pInfo = createInfo(t_dSFreq);
+    qint32 t_iErrors = 0;
+
+    //
+    // Warm start: the initial head position is known to within a few mm
+    //
+    {
+        Matrix4d t_matTrue = headDevTrans(0.0, Vector3d::Zero());
+        Matrix4d t_matInitial = headDevTrans(2.0, Vector3d(0.004, 0.0, 0.0));
+        t_pInfo->dev_head_t.from = FIFFV_COORD_DEVICE;
+        t_pInfo->dev_head_t.to = FIFFV_COORD_HEAD;
+        t_pInfo->dev_head_t.trans = t_matInitial.inverse().cast<float>();
+        t_pInfo->dev_head_t.invtrans = t_matInitial.cast<float>();
+
+        HpiSimulator t_simulator(t_pInfo, t_vecFreqs);
+        RtHpiFit t_hpiFit(t_pInfo, t_vecFreqs);
+        t_hpiFit.setTimeBudget(10);
+
+        //
+        // Stationary head, then 4 mm and 3 degrees of movement within one second, then stationary again
+        //
+        qint32 t_iNumBlocks = (qint32)(4.0 * t_dSFreq) / t_iBlockSize;
+        qint32 t_iMoveStart = t_iNumBlocks / 4, t_iMoveEnd = t_iNumBlocks / 2;
+
+        double t_dMaxTime = 0, t_dSumTime = 0;
+        qint32 t_iNumFits = 0;
+        double t_dCoilError = 0, t_dTransError = 0;
+        for(qint32 b = 0; b < t_iNumBlocks; ++b)
+        {
+            double t_dProgress = qBound(0.0, (double)(b - t_iMoveStart) / (t_iMoveEnd - t_iMoveStart), 1.0);
+            t_matTrue = headDevTrans(3.0 * t_dProgress, Vector3d(0.0, 0.004, 0.0) * t_dProgress);
+
+            MatrixX3d t_matCoilDev;
+            MatrixXd t_matBlock = t_simulator.block(t_iBlockSize, t_matTrue, t_matCoilDev);
+
+            QElapsedTimer t_timer;
+            t_timer.start();
+            bool t_bFitted = t_hpiFit.update(t_matBlock);
+            double t_dTime = t_timer.nsecsElapsed() * 1e-6;
+
+            if(!t_bFitted)
+                continue;
+
+            t_dMaxTime = qMax(t_dMaxTime, t_dTime);
+            t_dSumTime += t_dTime;
+            ++t_iNumFits;
+
+            compare(t_hpiFit, t_matCoilDev, t_matTrue, *t_pInfo, t_dCoilError, t_dTransError);
+
+            if(b == t_iMoveStart - 1 || b == t_iNumBlocks - 1)
+            {
+                printf("%s: coil error %.3f mm, transform error %.3f mm, min gof %.4f, transform fit %.3f mm\n", b < t_iMoveStart ? "stationary" : "after movement",
+                       t_dCoilError*1000.0, t_dTransError*1000.0, t_hpiFit.goodnessOfFit().minCoeff(), t_hpiFit.transError()*1000.0);
+                if(t_dCoilError > 0.001 || t_dTransError > 0.001 || t_hpiFit.goodnessOfFit().minCoeff() < 0.98)
+                    ++t_iErrors;
+            }
+        }
+        printf("306 channels, %d coils, block %d: %.3f ms mean, %.3f ms max per update\n", t_hpiFit.numCoils(), t_iBlockSize, t_dSumTime / t_iNumFits, t_dMaxTime);
+    }
+
+    //
+    // Cold start: no initial head position, the coils are found from the field patterns
+    //
+    {
+        t_pInfo->dev_head_t = FiffCoordTrans();
+        Matrix4d t_matTrue = headDevTrans(-5.0, Vector3d(0.002, -0.003, 0.004));
+
+        HpiSimulator t_simulator(t_pInfo, t_vecFreqs);
+        RtHpiFit t_hpiFit(t_pInfo, t_vecFreqs);
+
+        double t_dCoilError = 0, t_dTransError = 0;
+        for(qint32 b = 0; b < 20; ++b)
+        {
+            MatrixX3d t_matCoilDev;
+            MatrixXd t_matBlock = t_simulator.block(t_iBlockSize, t_matTrue, t_matCoilDev);
+            if(t_hpiFit.update(t_matBlock))
+                compare(t_hpiFit, t_matCoilDev, t_matTrue, *t_pInfo, t_dCoilError, t_dTransError);
+        }
+
+        printf("cold start: coil error %.3f mm, transform error %.3f mm\n", t_dCoilError*1000.0, t_dTransError*1000.0);
+        if(t_dCoilError > 0.001 || t_dTransError > 0.001)
+            ++t_iErrors;
+    }
+
+    //
+    // Budget: a budget smaller than one fit still fits one coil per block
+    //
+    {
+        HpiSimulator t_simulator(t_pInfo, t_vecFreqs);
+        RtHpiFit t_hpiFit(t_pInfo, t_vecFreqs);
+        t_hpiFit.setTimeBudget(0);
+
+        qint32 t_iMaxFitted = 0;
+        for(qint32 b = 0; b < 20; ++b)
+        {
+            MatrixX3d t_matCoilDev;
+            if(t_hpiFit.update(t_simulator.block(t_iBlockSize, headDevTrans(0.0, Vector3d::Zero()), t_matCoilDev)))
+                t_iMaxFitted = qMax(t_iMaxFitted, t_hpiFit.numFittedCoils());
+        }
+
+        printf("zero budget: at most %d coil fitted per block\n", t_iMaxFitted);
+        if(t_iMaxFitted != 1)
+            ++t_iErrors;
+    }
+
+    return t_iErrors == 0 ? 0 : 1;
+}
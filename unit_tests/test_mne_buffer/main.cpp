@@ -0,0 +1,674 @@
+//=============================================================================================================
+/**
+* @file     main.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     January, 2015
+*
+* @section  LICENSE
+*
+* Copyright (C) 2012, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Throughput and latency benchmark of the circular matrix buffers.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <generics/circularmatrixbuffer.h>
+#include <generics/circularmatrixbuffer_old.h>
+#include <generics/broadcastmatrixbuffer.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtCore/QCoreApplication>
+#include <QtConcurrent>
+#include <QElapsedTimer>
+#include <QThreadPool>
+#include <QThread>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+using namespace IOBuffer;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Methods
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* Pushes p_iNumBlocks blocks to the buffer. The block number is stored in the first element, the push time in
+* p_pPushTimes.
+*/
+template<typename T>
+void produce(T* p_pBuffer, qint32 p_iNumBlocks, QElapsedTimer* p_pTimer, qint64* p_pPushTimes)
+{
+    MatrixXf t_matBlock = MatrixXf::Random(p_pBuffer->rows(), p_pBuffer->cols());
+    for(qint32 i = 0; i < p_iNumBlocks; ++i)
+    {
+        t_matBlock(0,0) = (float)i;
+        p_pPushTimes[i] = p_pTimer->nsecsElapsed();
+        p_pBuffer->push(&t_matBlock);
+    }
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* Same as produce, but writes the blocks directly into the borrowed buffer slots.
+*/
+void produceInPlace(CircularMatrixBuffer<float>* p_pBuffer, qint32 p_iNumBlocks, QElapsedTimer* p_pTimer, qint64* p_pPushTimes)
+{
+    MatrixXf t_matBlock = MatrixXf::Random(p_pBuffer->rows(), p_pBuffer->cols());
+    for(qint32 i = 0; i < p_iNumBlocks; ++i)
+    {
+        Map<MatrixXf> t_slot = p_pBuffer->acquireWriteSlot();
+        t_slot = t_matBlock;
+        t_slot(0,0) = (float)i;
+        p_pPushTimes[i] = p_pTimer->nsecsElapsed();
+        p_pBuffer->commit();
+    }
+}
+
+
+//*************************************************************************************************************
+
+qint32 benchmarkInPlace(qint32 p_iNumBlocks, qint32 p_iRows, qint32 p_iCols, qint32 p_iNumSlots)
+{
+    CircularMatrixBuffer<float> t_buffer(p_iNumSlots, p_iRows, p_iCols);
+
+    std::vector<qint64> t_vecPushTimes(p_iNumBlocks);
+    std::vector<qint64> t_vecLatencies(p_iNumBlocks);
+
+    QElapsedTimer t_timer;
+    t_timer.start();
+
+    QFuture<void> t_future = QtConcurrent::run(produceInPlace, &t_buffer, p_iNumBlocks, &t_timer, &t_vecPushTimes[0]);
+
+    qint32 t_iErrors = 0;
+    double t_dSum = 0;
+    for(qint32 i = 0; i < p_iNumBlocks; ++i)
+    {
+        Map<const MatrixXf> t_slot = t_buffer.acquireReadSlot();
+        qint64 t_iPopTime = t_timer.nsecsElapsed();
+        qint32 t_iBlock = (qint32)t_slot(0,0);
+        // Touch the block like a consumer would
+        t_dSum += t_slot.sum();
+        t_buffer.release();
+        if(t_iBlock != i)
+            ++t_iErrors;
+        else
+            t_vecLatencies[i] = t_iPopTime - t_vecPushTimes[i];
+    }
+    qint64 t_iTotal = t_timer.nsecsElapsed();
+
+    t_future.waitForFinished();
+
+    std::sort(t_vecLatencies.begin(), t_vecLatencies.end());
+
+    double t_dSeconds = t_iTotal * 1e-9;
+    double t_dMBytes = (double)p_iNumBlocks * p_iRows * p_iCols * sizeof(float) / (1024.0*1024.0);
+    printf("%-26s %5d x %4d, %3d slots: %9.0f blocks/s %8.1f MB/s | latency [us] median %7.1f p99 %8.1f max %9.1f | errors %d (%g)\n",
+           "CircularMatrixBuffer slots", p_iRows, p_iCols, p_iNumSlots,
+           p_iNumBlocks / t_dSeconds, t_dMBytes / t_dSeconds,
+           t_vecLatencies[p_iNumBlocks/2] * 1e-3, t_vecLatencies[(p_iNumBlocks*99)/100] * 1e-3, t_vecLatencies[p_iNumBlocks-1] * 1e-3,
+           t_iErrors, t_dSum);
+
+    return t_iErrors;
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* Fan-out of one stream: pushes p_iNumBlocks blocks to one CircularMatrixBuffer per consumer.
+*/
+void produceFanOut(QList<CircularMatrixBuffer<float>::SPtr>* p_pBuffers, qint32 p_iNumBlocks)
+{
+    MatrixXf t_matBlock = MatrixXf::Random(p_pBuffers->at(0)->rows(), p_pBuffers->at(0)->cols());
+    for(qint32 i = 0; i < p_iNumBlocks; ++i)
+    {
+        t_matBlock(0,0) = (float)i;
+        for(qint32 j = 0; j < p_pBuffers->size(); ++j)
+            p_pBuffers->at(j)->push(&t_matBlock);
+    }
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* Fan-out of one stream: pushes p_iNumBlocks blocks once to the broadcast buffer.
+*/
+void produceBroadcast(BroadcastMatrixBuffer<float>* p_pBuffer, qint32 p_iNumBlocks, qint32 p_iRows, qint32 p_iCols)
+{
+    MatrixXf t_matBlock = MatrixXf::Random(p_iRows, p_iCols);
+    for(qint32 i = 0; i < p_iNumBlocks; ++i)
+    {
+        t_matBlock(0,0) = (float)i;
+        p_pBuffer->push(&t_matBlock);
+    }
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* Consumes p_iNumBlocks blocks of a circular buffer and returns the number of blocks out of order.
+*/
+qint32 consumeCircular(CircularMatrixBuffer<float>::SPtr p_pBuffer, qint32 p_iNumBlocks)
+{
+    qint32 t_iErrors = 0;
+    for(qint32 i = 0; i < p_iNumBlocks; ++i)
+        if((qint32)p_pBuffer->pop()(0,0) != i)
+            ++t_iErrors;
+    return t_iErrors;
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* Consumes broadcast blocks until the last one and returns the number of blocks out of order.
+*/
+qint32 consumeBroadcast(BroadcastMatrixBuffer<float>* p_pBuffer, qint32 p_iId, qint32 p_iNumBlocks)
+{
+    qint32 t_iErrors = 0;
+    qint32 t_iLast = -1;
+    while(t_iLast < p_iNumBlocks - 1)
+    {
+        BroadcastMatrixBuffer<float>::BlockSPtr t_pBlock = p_pBuffer->pop(p_iId);
+        qint32 t_iBlock = (qint32)(*t_pBlock)(0,0);
+        if(t_iBlock <= t_iLast)
+            ++t_iErrors;
+        t_iLast = t_iBlock;
+    }
+    return t_iErrors;
+}
+
+
+//*************************************************************************************************************
+
+qint32 benchmarkFanOut(qint32 p_iNumBlocks, qint32 p_iRows, qint32 p_iCols, qint32 p_iNumConsumers)
+{
+    // Every consumer blocks a pool thread
+    if(QThreadPool::globalInstance()->maxThreadCount() < p_iNumConsumers)
+        QThreadPool::globalInstance()->setMaxThreadCount(p_iNumConsumers);
+
+    QElapsedTimer t_timer;
+
+    //
+    // One circular buffer per consumer
+    //
+    QList<CircularMatrixBuffer<float>::SPtr> t_qListBuffers;
+    for(qint32 j = 0; j < p_iNumConsumers; ++j)
+        t_qListBuffers.append(CircularMatrixBuffer<float>::SPtr(new CircularMatrixBuffer<float>(8, p_iRows, p_iCols)));
+
+    t_timer.start();
+    QList<QFuture<qint32> > t_qListConsumers;
+    for(qint32 j = 0; j < p_iNumConsumers; ++j)
+        t_qListConsumers.append(QtConcurrent::run(consumeCircular, t_qListBuffers[j], p_iNumBlocks));
+    produceFanOut(&t_qListBuffers, p_iNumBlocks);
+    qint32 t_iErrors = 0;
+    for(qint32 j = 0; j < p_iNumConsumers; ++j)
+        t_iErrors += t_qListConsumers[j].result();
+    qint32 t_iTotalErrors = t_iErrors;
+    double t_dSeconds = t_timer.nsecsElapsed() * 1e-9;
+
+    printf("%-26s %5d x %4d, %d consumers: %9.0f blocks/s | errors %d\n", "CircularMatrixBuffer", p_iRows, p_iCols, p_iNumConsumers, p_iNumBlocks / t_dSeconds, t_iErrors);
+
+    //
+    // One broadcast buffer
+    //
+    BroadcastMatrixBuffer<float> t_broadcast(8);
+    QList<qint32> t_qListIds;
+    for(qint32 j = 0; j < p_iNumConsumers; ++j)
+        t_qListIds.append(t_broadcast.addConsumer(BroadcastMatrixBuffer<float>::BLOCK));
+
+    t_timer.start();
+    t_qListConsumers.clear();
+    for(qint32 j = 0; j < p_iNumConsumers; ++j)
+        t_qListConsumers.append(QtConcurrent::run(consumeBroadcast, &t_broadcast, t_qListIds[j], p_iNumBlocks));
+    produceBroadcast(&t_broadcast, p_iNumBlocks, p_iRows, p_iCols);
+    t_iErrors = 0;
+    for(qint32 j = 0; j < p_iNumConsumers; ++j)
+        t_iErrors += t_qListConsumers[j].result();
+    t_iTotalErrors += t_iErrors;
+    t_dSeconds = t_timer.nsecsElapsed() * 1e-9;
+
+    printf("%-26s %5d x %4d, %d consumers: %9.0f blocks/s | errors %d | max lag", "BroadcastMatrixBuffer", p_iRows, p_iCols, p_iNumConsumers, p_iNumBlocks / t_dSeconds, t_iErrors);
+    for(qint32 j = 0; j < p_iNumConsumers; ++j)
+        printf(" %llu", t_broadcast.stats(t_qListIds[j]).maxLag);
+    printf("\n");
+
+    return t_iTotalErrors;
+}
+
+
+//*************************************************************************************************************
+
+template<typename T>
+qint32 benchmark(const char* p_sName, qint32 p_iNumBlocks, qint32 p_iRows, qint32 p_iCols, qint32 p_iNumSlots)
+{
+    T t_buffer(p_iNumSlots, p_iRows, p_iCols);
+
+    std::vector<qint64> t_vecPushTimes(p_iNumBlocks);
+    std::vector<qint64> t_vecLatencies(p_iNumBlocks);
+
+    QElapsedTimer t_timer;
+    t_timer.start();
+
+    QFuture<void> t_future = QtConcurrent::run(produce<T>, &t_buffer, p_iNumBlocks, &t_timer, &t_vecPushTimes[0]);
+
+    qint32 t_iErrors = 0;
+    for(qint32 i = 0; i < p_iNumBlocks; ++i)
+    {
+        MatrixXf t_matBlock = t_buffer.pop();
+        qint64 t_iPopTime = t_timer.nsecsElapsed();
+        qint32 t_iBlock = (qint32)t_matBlock(0,0);
+        if(t_iBlock != i)
+            ++t_iErrors;
+        else
+            t_vecLatencies[i] = t_iPopTime - t_vecPushTimes[i];
+    }
+    qint64 t_iTotal = t_timer.nsecsElapsed();
+
+    t_future.waitForFinished();
+
+    std::sort(t_vecLatencies.begin(), t_vecLatencies.end());
+
+    double t_dSeconds = t_iTotal * 1e-9;
+    double t_dMBytes = (double)p_iNumBlocks * p_iRows * p_iCols * sizeof(float) / (1024.0*1024.0);
+    printf("%-26s %5d x %4d, %3d slots: %9.0f blocks/s %8.1f MB/s | latency [us] median %7.1f p99 %8.1f max %9.1f | errors %d\n",
+           p_sName, p_iRows, p_iCols, p_iNumSlots,
+           p_iNumBlocks / t_dSeconds, t_dMBytes / t_dSeconds,
+           t_vecLatencies[p_iNumBlocks/2] * 1e-3, t_vecLatencies[(p_iNumBlocks*99)/100] * 1e-3, t_vecLatencies[p_iNumBlocks-1] * 1e-3,
+           t_iErrors);
+
+    return t_iErrors;
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* Returns a random block whose first element holds the block number.
+*/
+MatrixXf numberedBlock(qint32 p_iNumber, qint32 p_iRows, qint32 p_iCols)
+{
+    MatrixXf t_matBlock = MatrixXf::Random(p_iRows, p_iCols);
+    t_matBlock(0,0) = (float)p_iNumber;
+    return t_matBlock;
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* Pushes one block, used to run a push which waits on a full buffer in another thread.
+*/
+void pushOne(CircularMatrixBuffer<float>* p_pBuffer, MatrixXf p_matBlock)
+{
+    p_pBuffer->push(&p_matBlock);
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* Pops one block, used to run a pop which waits on an empty buffer in another thread.
+*/
+MatrixXf popOne(CircularMatrixBuffer<float>* p_pBuffer)
+{
+    return p_pBuffer->pop();
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* Checks the pause and release semantics of CircularMatrixBuffer and the copies across the end of the ring.
+*
+* @return the number of failed checks.
+*/
+qint32 testCircularSemantics()
+{
+    qint32 t_iErrors = 0;
+    qint32 t_iRows = 4, t_iCols = 5, t_iNumSlots = 3;
+
+    //
+    // Wrap: fill levels 1..3 cycle, so the ring indices wrap around the slots and the doubled index range
+    //
+    {
+        CircularMatrixBuffer<float> t_buffer(t_iNumSlots, t_iRows, t_iCols);
+        QList<MatrixXf> t_qListPushed;
+        qint32 t_iNumPopped = 0, t_iMismatches = 0;
+        for(qint32 i = 0; i < 50; ++i)
+        {
+            qint32 t_iFill = i % t_iNumSlots + 1;
+            for(qint32 k = 0; k < t_iFill; ++k)
+            {
+                t_qListPushed.append(numberedBlock(t_qListPushed.size(), t_iRows, t_iCols));
+                t_buffer.push(&t_qListPushed.last());
+            }
+            for(qint32 k = 0; k < t_iFill; ++k, ++t_iNumPopped)
+                if(t_buffer.pop() != t_qListPushed[t_iNumPopped])
+                    ++t_iMismatches;
+        }
+        printf("CircularMatrixBuffer wrap: %d blocks through %d slots, %d mismatches\n", t_iNumPopped, t_iNumSlots, t_iMismatches);
+        if(t_iMismatches != 0)
+            ++t_iErrors;
+    }
+
+    //
+    // releaseFromPush: only possible on a full buffer, the waiting push drops its block
+    //
+    {
+        CircularMatrixBuffer<float> t_buffer(t_iNumSlots, t_iRows, t_iCols);
+        bool t_bReleasedNotFull = t_buffer.releaseFromPush();
+        for(qint32 i = 0; i < t_iNumSlots; ++i)
+        {
+            MatrixXf t_matBlock = numberedBlock(i, t_iRows, t_iCols);
+            t_buffer.push(&t_matBlock);
+        }
+
+        QFuture<void> t_future = QtConcurrent::run(pushOne, &t_buffer, numberedBlock(t_iNumSlots, t_iRows, t_iCols));
+        QThread::msleep(50);
+        bool t_bWaited = !t_future.isFinished();
+        bool t_bReleased = t_buffer.releaseFromPush();
+        t_future.waitForFinished();
+
+        bool t_bOrder = true;
+        for(qint32 i = 0; i < t_iNumSlots; ++i)
+            t_bOrder &= (qint32)t_buffer.pop()(0,0) == i;
+        // The dropped block did not enter the ring -> the buffer is empty now
+        bool t_bEmpty = t_buffer.releaseFromPop();
+
+        printf("CircularMatrixBuffer releaseFromPush: not full %d, push waited %d, released %d, order %d, dropped %d\n", t_bReleasedNotFull, t_bWaited, t_bReleased, t_bOrder, t_bEmpty);
+        if(t_bReleasedNotFull || !t_bWaited || !t_bReleased || !t_bOrder || !t_bEmpty)
+            ++t_iErrors;
+    }
+
+    //
+    // releaseFromPop: only possible on an empty buffer, the waiting pop returns a zero matrix
+    //
+    {
+        CircularMatrixBuffer<float> t_buffer(t_iNumSlots, t_iRows, t_iCols);
+        MatrixXf t_matBlock = numberedBlock(7, t_iRows, t_iCols);
+        t_buffer.push(&t_matBlock);
+        bool t_bReleasedNotEmpty = t_buffer.releaseFromPop();
+        bool t_bFirst = t_buffer.pop() == t_matBlock;
+
+        QFuture<MatrixXf> t_future = QtConcurrent::run(popOne, &t_buffer);
+        QThread::msleep(50);
+        bool t_bWaited = !t_future.isFinished();
+        bool t_bReleased = t_buffer.releaseFromPop();
+        MatrixXf t_matReleased = t_future.result();
+        bool t_bZero = t_matReleased.rows() == t_iRows && t_matReleased.cols() == t_iCols && t_matReleased.isZero(0.0f);
+
+        printf("CircularMatrixBuffer releaseFromPop: not empty %d, first %d, pop waited %d, released %d, zero matrix %d\n", t_bReleasedNotEmpty, t_bFirst, t_bWaited, t_bReleased, t_bZero);
+        if(t_bReleasedNotEmpty || !t_bFirst || !t_bWaited || !t_bReleased || !t_bZero)
+            ++t_iErrors;
+    }
+
+    //
+    // pause: pushes are skipped and pops return zero matrices without waiting, stored blocks are kept
+    //
+    {
+        CircularMatrixBuffer<float> t_buffer(t_iNumSlots, t_iRows, t_iCols);
+        MatrixXf t_matBlock0 = numberedBlock(1, t_iRows, t_iCols);
+        t_buffer.push(&t_matBlock0);
+
+        t_buffer.pause(true);
+        MatrixXf t_matSkipped = numberedBlock(2, t_iRows, t_iCols);
+        for(qint32 i = 0; i < 2*t_iNumSlots; ++i)
+            t_buffer.push(&t_matSkipped);
+        bool t_bZero = t_buffer.pop().isZero(0.0f);
+        t_buffer.pause(false);
+
+        MatrixXf t_matBlock1 = numberedBlock(3, t_iRows, t_iCols);
+        t_buffer.push(&t_matBlock1);
+        bool t_bKept = t_buffer.pop() == t_matBlock0 && t_buffer.pop() == t_matBlock1;
+        bool t_bSkipped = t_buffer.releaseFromPop();
+
+        printf("CircularMatrixBuffer pause: zero matrix %d, stored blocks kept %d, pushes skipped %d\n", t_bZero, t_bKept, t_bSkipped);
+        if(!t_bZero || !t_bKept || !t_bSkipped)
+            ++t_iErrors;
+    }
+
+    return t_iErrors;
+}
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* Pops p_iNumBlocks broadcast blocks with a pause before every pop and returns the delivered block numbers.
+*/
+QList<qint32> consumeSlowly(BroadcastMatrixBuffer<float>* p_pBuffer, qint32 p_iId, qint32 p_iNumBlocks)
+{
+    QList<qint32> t_qListDelivered;
+    for(qint32 i = 0; i < p_iNumBlocks; ++i)
+    {
+        QThread::msleep(2);
+        t_qListDelivered.append((qint32)(*p_pBuffer->pop(p_iId))(0,0));
+    }
+    return t_qListDelivered;
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* Checks the slow consumer policies of BroadcastMatrixBuffer: the counters and the delivered block numbers.
+*
+* @return the number of failed checks.
+*/
+qint32 testBroadcastPolicies()
+{
+    qint32 t_iErrors = 0;
+    qint32 t_iRows = 4, t_iCols = 5, t_iNumSlots = 4, t_iNumBlocks = 30;
+
+    //
+    // DROP_OLDEST and SKIP_TO_LATEST: a slow consumer reads once every third push, a fast BLOCK consumer after
+    // every push. Both run in this thread, so the expected ring content of the slow consumer is known exactly.
+    //
+    for(qint32 p = 0; p < 2; ++p)
+    {
+        BroadcastMatrixBuffer<float>::SlowConsumerPolicy t_policy = p == 0 ? BroadcastMatrixBuffer<float>::DROP_OLDEST : BroadcastMatrixBuffer<float>::SKIP_TO_LATEST;
+        const char* t_sPolicy = p == 0 ? "DROP_OLDEST" : "SKIP_TO_LATEST";
+
+        BroadcastMatrixBuffer<float> t_broadcast(t_iNumSlots);
+        qint32 t_iFast = t_broadcast.addConsumer(BroadcastMatrixBuffer<float>::BLOCK);
+        qint32 t_iSlow = t_broadcast.addConsumer(t_policy);
+
+        // Reference: unread block numbers of the slow consumer
+        std::vector<qint32> t_vecUnread;
+        quint64 t_iDropped = 0, t_iMaxLag = 0;
+        QList<qint32> t_qListExpected, t_qListDelivered;
+        qint32 t_iFastMismatches = 0;
+
+        for(qint32 i = 0; i < t_iNumBlocks; ++i)
+        {
+            MatrixXf t_matBlock = numberedBlock(i, t_iRows, t_iCols);
+            t_broadcast.push(&t_matBlock);
+
+            if((qint32)t_vecUnread.size() == t_iNumSlots)
+            {
+                t_vecUnread.erase(t_vecUnread.begin());
+                ++t_iDropped;
+            }
+            t_vecUnread.push_back(i);
+            t_iMaxLag = std::max(t_iMaxLag, (quint64)t_vecUnread.size());
+
+            if((qint32)(*t_broadcast.pop(t_iFast))(0,0) != i)
+                ++t_iFastMismatches;
+
+            // Slow consumer: one pop every third push, drain after the last one
+            bool t_bLast = i == t_iNumBlocks - 1;
+            if(i % 3 == 2 || t_bLast)
+            {
+                do
+                {
+                    if(t_policy == BroadcastMatrixBuffer<float>::SKIP_TO_LATEST)
+                    {
+                        t_iDropped += t_vecUnread.size() - 1;
+                        t_vecUnread.erase(t_vecUnread.begin(), t_vecUnread.end() - 1);
+                    }
+                    t_qListExpected.append(t_vecUnread.front());
+                    t_vecUnread.erase(t_vecUnread.begin());
+                    t_qListDelivered.append((qint32)(*t_broadcast.pop(t_iSlow))(0,0));
+                }
+                while(t_bLast && !t_vecUnread.empty());
+            }
+        }
+
+        BroadcastMatrixBuffer<float>::ConsumerStats t_fast = t_broadcast.stats(t_iFast);
+        BroadcastMatrixBuffer<float>::ConsumerStats t_slow = t_broadcast.stats(t_iSlow);
+
+        bool t_bFast = t_iFastMismatches == 0 && t_fast.received == (quint64)t_iNumBlocks && t_fast.dropped == 0 && t_fast.lag == 0 && t_fast.maxLag == 1;
+        bool t_bSequence = t_qListDelivered == t_qListExpected && t_qListDelivered.last() == t_iNumBlocks - 1;
+        bool t_bCounters = t_slow.received == (quint64)t_qListExpected.size() && t_slow.dropped == t_iDropped && t_slow.lag == 0 && t_slow.maxLag == t_iMaxLag
+                && t_slow.dropped > 0 && t_slow.received + t_slow.dropped == (quint64)t_iNumBlocks;
+
+        printf("BroadcastMatrixBuffer %-14s: received %llu, dropped %llu, max lag %llu | fast consumer %d, sequence %d, counters %d\n",
+               t_sPolicy, t_slow.received, t_slow.dropped, t_slow.maxLag, t_bFast, t_bSequence, t_bCounters);
+        if(!t_bFast || !t_bSequence || !t_bCounters)
+            ++t_iErrors;
+    }
+
+    //
+    // BLOCK: a consumer which sleeps before every pop holds back the producer instead of missing blocks
+    //
+    {
+        BroadcastMatrixBuffer<float> t_broadcast(t_iNumSlots);
+        qint32 t_iSlow = t_broadcast.addConsumer(BroadcastMatrixBuffer<float>::BLOCK);
+
+        QFuture<QList<qint32> > t_future = QtConcurrent::run(consumeSlowly, &t_broadcast, t_iSlow, t_iNumBlocks);
+        for(qint32 i = 0; i < t_iNumBlocks; ++i)
+        {
+            MatrixXf t_matBlock = numberedBlock(i, t_iRows, t_iCols);
+            t_broadcast.push(&t_matBlock);
+        }
+        QList<qint32> t_qListDelivered = t_future.result();
+
+        bool t_bSequence = t_qListDelivered.size() == t_iNumBlocks;
+        for(qint32 i = 0; t_bSequence && i < t_iNumBlocks; ++i)
+            t_bSequence = t_qListDelivered[i] == i;
+
+        BroadcastMatrixBuffer<float>::ConsumerStats t_slow = t_broadcast.stats(t_iSlow);
+        bool t_bCounters = t_slow.received == (quint64)t_iNumBlocks && t_slow.dropped == 0 && t_slow.lag == 0 && t_slow.maxLag == (quint64)t_iNumSlots;
+
+        printf("BroadcastMatrixBuffer %-14s: received %llu, dropped %llu, max lag %llu | sequence %d, counters %d\n",
+               "BLOCK", t_slow.received, t_slow.dropped, t_slow.maxLag, t_bSequence, t_bCounters);
+        if(!t_bSequence || !t_bCounters)
+            ++t_iErrors;
+    }
+
+    return t_iErrors;
+}
+
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* The function main marks the entry point of the program.
+* By default, main has the storage class extern.
+*
+* @param [in] argc (argument count) is an integer that indicates how many arguments were entered on the command line when the program was started.
+* @param [in] argv (argument vector) is an array of pointers to arrays of character objects. The array objects are null-terminated strings, representing the arguments that were entered on the command line when the program was started.
+* @return the value that was set to exit() (which is 0 if exit() is called via quit()).
+*/
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    qint32 t_iErrors = testCircularSemantics();
+    t_iErrors += testBroadcastPolicies();
+
+    // Typical realtime block sizes: Neuromag 306 channels + stim/misc, BabyMEG 400 channels
+    qint32 t_aRows[] = {315, 315, 400};
+    qint32 t_aCols[] = {10, 100, 200};
+
+    for(qint32 i = 0; i < 3; ++i)
+    {
+        qint32 t_iNumBlocks = 2000000 / (t_aRows[i]*t_aCols[i]) * 50;
+        t_iErrors += benchmark<CircularMatrixBuffer_old<float> >("CircularMatrixBuffer_old", t_iNumBlocks, t_aRows[i], t_aCols[i], 8);
+        t_iErrors += benchmark<CircularMatrixBuffer<float> >("CircularMatrixBuffer", t_iNumBlocks, t_aRows[i], t_aCols[i], 8);
+        t_iErrors += benchmarkInPlace(t_iNumBlocks, t_aRows[i], t_aCols[i], 8);
+    }
+
+    // Fan-out of one raw stream to several algorithms
+    for(qint32 i = 0; i < 3; ++i)
+        t_iErrors += benchmarkFanOut(2000000 / (t_aRows[i]*t_aCols[i]) * 50, t_aRows[i], t_aCols[i], 4);
+
+    return t_iErrors == 0 ? 0 : 1;
+}
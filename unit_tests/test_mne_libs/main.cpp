@@ -113,5 +113,26 @@ int main(int argc, char *argv[])
     testStart(testName);
     testResult = t_TestMneLibs.checkFwdRead();
     testEnd(testName,testResult);
+    //
+    // Inverse operator decomposition test
+    //
+    testName = QString("Inverse Decomposition");
+    testStart(testName);
+    testResult = t_TestMneLibs.checkInverseDecomposition();
+    testEnd(testName,testResult);
+    //
+    // Whitened gain test
+    //
+    testName = QString("Whiten Gain");
+    testStart(testName);
+    testResult = t_TestMneLibs.checkWhitenGain();
+    testEnd(testName,testResult);
+    //
+    // Selective FWD read test
+    //
+    testName = QString("Selective Read FWD");
+    testStart(testName);
+    testResult = t_TestMneLibs.checkFwdSelectiveRead();
+    testEnd(testName,testResult);
     return a.exec();
 }
@@ -47,6 +47,8 @@
 //=============================================================================================================
 
 #include <mne/mne.h>
+#include <fs/label.h>
+#include <utils/mnemath.h>
 
 
 //*************************************************************************************************************
@@ -56,6 +58,8 @@
 
 using namespace MNEUNITTESTS;
 using namespace MNELIB;
+using namespace FSLIB;
+using namespace UTILSLIB;
 
 
 //*************************************************************************************************************
@@ -132,3 +136,245 @@ bool TestMNELibs::checkFwdRead()
         return false;
     }
 }
+
+
+//*************************************************************************************************************
+
+bool TestMNELibs::checkInverseDecomposition()
+{
+    qint32 nchan = 306;
+    qint32 nsrc = 3*2000;
+    double eps = 1e-8;
+
+    srand(0);
+
+    VectorXd s;
+    MatrixXd U, V;
+
+    //
+    // Simulated whitened gain: rank reduced by 3 projectors
+    //
+    qint32 nproj = 3;
+    MatrixXd gain = MatrixXd::Random(nchan, nsrc);
+    MatrixXd proj = MatrixXd::Random(nchan, nproj);
+    proj = HouseholderQR<MatrixXd>(proj).householderQ() * MatrixXd::Identity(nchan, nproj);
+    gain -= proj * (proj.transpose() * gain);
+
+    qint32 rank = nchan - nproj;
+
+    JacobiSVD<MatrixXd> svd(gain, ComputeThinU | ComputeThinV);
+    VectorXd s_ref = svd.singularValues().head(rank);
+    MatrixXd P_ref = svd.matrixU().leftCols(rank) * svd.matrixU().leftCols(rank).transpose();
+
+    // Gram matrix
+    MNEMath::svd_gram(gain, s, U, V);
+    double err_s = (s.head(rank) - s_ref).norm() / s_ref.norm();
+    double err_P = (U.leftCols(rank) * U.leftCols(rank).transpose() - P_ref).norm() / P_ref.norm();
+    double err_A = (U * s.asDiagonal() * V.transpose() - gain).norm() / gain.norm();
+    bool null_zero = s.tail(nchan - rank).isZero(0.0) && V.rightCols(nchan - rank).isZero(0.0);
+    printf("Gram (rank %d): singular values %e; signal subspace %e; reconstruction %e; null space zeroed %d\n", rank, err_s, err_P, err_A, null_zero);
+    if(err_s > eps || err_P > eps || err_A > eps || !null_zero)
+    {
+        printf("Gram decomposition differs from the full SVD!\n");
+        emit checkupFailed(2);
+        return false;
+    }
+
+    //
+    // Low rank gain with decaying singular values, rank well below the number of channels
+    //
+    rank = 60;
+    VectorXd s_sim(rank);
+    for(qint32 i = 0; i < rank; ++i)
+        s_sim[i] = pow(10.0, -2.0 * i / rank);
+    MatrixXd U_sim = HouseholderQR<MatrixXd>(MatrixXd::Random(nchan, rank)).householderQ() * MatrixXd::Identity(nchan, rank);
+    MatrixXd V_sim = HouseholderQR<MatrixXd>(MatrixXd::Random(nsrc, rank)).householderQ() * MatrixXd::Identity(nsrc, rank);
+    gain = U_sim * s_sim.asDiagonal() * V_sim.transpose();
+
+    s_ref = s_sim;
+    P_ref = U_sim * U_sim.transpose();
+
+    // Gram matrix
+    MNEMath::svd_gram(gain, s, U, V);
+    err_s = (s.head(rank) - s_ref).norm() / s_ref.norm();
+    err_P = (U.leftCols(rank) * U.leftCols(rank).transpose() - P_ref).norm() / P_ref.norm();
+    err_A = (U * s.asDiagonal() * V.transpose() - gain).norm() / gain.norm();
+    null_zero = s.tail(nchan - rank).isZero(0.0) && V.rightCols(nchan - rank).isZero(0.0);
+    printf("Gram (rank %d): singular values %e; signal subspace %e; reconstruction %e; null space zeroed %d\n", rank, err_s, err_P, err_A, null_zero);
+    if(err_s > eps || err_P > eps || err_A > eps || !null_zero)
+    {
+        printf("Gram decomposition differs from the full SVD!\n");
+        emit checkupFailed(2);
+        return false;
+    }
+
+    // Randomized: 5 triplets more than the rank are requested, the sketch (rank + 15) is far from spanning all channels
+    qint32 nextra = 5;
+    MNEMath::svd_randomized(gain, rank + nextra, s, U, V);
+    err_s = (s.head(rank) - s_ref).norm() / s_ref.norm();
+    err_P = (U.leftCols(rank) * U.leftCols(rank).transpose() - P_ref).norm() / P_ref.norm();
+    err_A = (U * s.asDiagonal() * V.transpose() - gain).norm() / gain.norm();
+    null_zero = s.size() == rank + nextra && s.tail(nextra).isZero(0.0) && V.rightCols(nextra).isZero(0.0);
+    printf("Randomized (rank %d): singular values %e; signal subspace %e; reconstruction %e; null space zeroed %d\n", rank, err_s, err_P, err_A, null_zero);
+    if(err_s > eps || err_P > eps || err_A > eps || !null_zero)
+    {
+        printf("Randomized decomposition differs from the full SVD!\n");
+        emit checkupFailed(2);
+        return false;
+    }
+
+    // The test vectors come from a local generator: the result does not depend on the global rand() state
+    VectorXd s_repeat;
+    MatrixXd U_repeat, V_repeat;
+    rand();
+    MNEMath::svd_randomized(gain, rank + nextra, s_repeat, U_repeat, V_repeat);
+    bool repeatable = s_repeat == s && U_repeat == U && V_repeat == V;
+    printf("Randomized repeated after rand(): identical %d\n", repeatable);
+    if(!repeatable)
+    {
+        printf("Randomized decomposition is not reproducible!\n");
+        emit checkupFailed(2);
+        return false;
+    }
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+bool TestMNELibs::checkWhitenGain()
+{
+    qint32 nchan = 40;
+    qint32 nsrc = 3*700;    // several chunks of whiten_gain
+    double eps = 1e-12;
+
+    srand(0);
+
+    MatrixXd gain = MatrixXd::Random(nchan, nsrc);
+    VectorXd source_std = VectorXd::Random(nsrc).cwiseAbs();
+
+    //
+    // Square and PCA (fewer rows than channels) whitener
+    //
+    for(qint32 nrows = nchan; nrows >= nchan - 5; nrows -= 5)
+    {
+        MatrixXd whitener = MatrixXd::Random(nrows, nchan);
+        MatrixXd ref = whitener * gain * source_std.asDiagonal();
+
+        MatrixXd t_matGain = gain;
+        double trace_GRGT;
+        bool ok = MNEForwardSolution::whiten_gain(t_matGain, whitener, source_std, trace_GRGT);
+        double err_G = ok && t_matGain.rows() == nrows ? (t_matGain - ref).norm() / ref.norm() : 1.0;
+        double err_T = fabs(trace_GRGT - ref.squaredNorm()) / ref.squaredNorm();
+        printf("Whitener %d x %d: success %d; gain %e; trace %e\n", nrows, nchan, ok, err_G, err_T);
+        if(!ok || err_G > eps || err_T > eps)
+        {
+            printf("Whitened gain differs from the dense product!\n");
+            emit checkupFailed(3);
+            return false;
+        }
+    }
+
+    //
+    // Failures: dimension mismatch (gain unchanged) and a vanishing gain
+    //
+    MatrixXd t_matGain = gain;
+    double trace_GRGT;
+    bool failed_dim = !MNEForwardSolution::whiten_gain(t_matGain, MatrixXd::Random(nchan, nchan + 1), source_std, trace_GRGT) && t_matGain == gain;
+    bool failed_zero = !MNEForwardSolution::whiten_gain(t_matGain, MatrixXd::Identity(nchan, nchan), VectorXd::Zero(nsrc), trace_GRGT);
+    printf("Dimension mismatch reported %d; vanishing gain reported %d\n", failed_dim, failed_zero);
+    if(!failed_dim || !failed_zero)
+    {
+        printf("whiten_gain failure not reported!\n");
+        emit checkupFailed(3);
+        return false;
+    }
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+bool TestMNELibs::checkFwdSelectiveRead()
+{
+    QString t_sFileName = "./MNE-sample-data/MEG/sample/sample_audvis-meg-eeg-oct-6-fwd.fif";
+
+    MNEForwardSolution t_FullFwd;
+    QFile t_FileFull(t_sFileName);
+    if(!MNE::read_forward_solution(t_FileFull, t_FullFwd))
+    {
+        emit checkupFailed(4);
+        return false;
+    }
+
+    //
+    // Right hemisphere labels are offset by the number of left hemisphere sources, not by the label size
+    //
+    qint32 nuse_lh = t_FullFwd.src[0].vertno.size();
+    VectorXi t_vecVertices(2);
+    t_vecVertices << t_FullFwd.src[1].vertno[0], t_FullFwd.src[1].vertno[5];
+    Label t_labelRh(t_vecVertices, MatrixX3f::Zero(2,3), VectorXd::Zero(2), 1, "rh.test");
+    VectorXi t_vecSel;
+    t_FullFwd.src.label_src_vertno_sel(t_labelRh, t_vecSel);
+    bool offset_ok = t_vecSel.size() == 2 && t_vecSel[0] == nuse_lh && t_vecSel[1] == nuse_lh + 5;
+    printf("Right hemisphere label selection offset by %d left hemisphere sources: %d\n", nuse_lh, offset_ok);
+    if(!offset_ok)
+    {
+        printf("Right hemisphere label selects the wrong sources!\n");
+        emit checkupFailed(4);
+        return false;
+    }
+
+    //
+    // Channel selection while decoding vs. full read and pick_channels
+    //
+    QStringList include, exclude;
+    for(qint32 i = 0; i < t_FullFwd.info.ch_names.size(); i += 3)
+        include << t_FullFwd.info.ch_names[i];
+    exclude << include[1] << include[10];
+
+    MNEForwardSolution t_PickedFwd = t_FullFwd.pick_channels(include, exclude);
+    MNEForwardSolution t_SelFwd;
+    QFile t_FileSel(t_sFileName);
+    bool ok = MNEForwardSolution::read(t_FileSel, t_SelFwd, false, false, include, exclude);
+    bool equal = ok && t_SelFwd.sol->data.rows() == t_PickedFwd.sol->data.rows() && t_SelFwd.sol->data.cols() == t_PickedFwd.sol->data.cols()
+            && t_SelFwd.sol->data == t_PickedFwd.sol->data && t_SelFwd.sol->row_names == t_PickedFwd.sol->row_names
+            && t_SelFwd.info.ch_names == t_PickedFwd.info.ch_names && t_SelFwd.nchan == t_PickedFwd.nchan;
+    printf("Channel selection (%d channels): equal to pick_channels %d\n", t_PickedFwd.nchan, equal);
+    if(!equal)
+    {
+        printf("Selective read differs from pick_channels!\n");
+        emit checkupFailed(4);
+        return false;
+    }
+
+    //
+    // Region selection while decoding vs. full read and pick_regions, labels in both hemispheres
+    //
+    QList<Label> t_qListLabels;
+    for(qint32 h = 0; h < 2; ++h)
+    {
+        VectorXi t_vecLabelVertices(100);
+        for(qint32 i = 0; i < 100; ++i)
+            t_vecLabelVertices[i] = t_FullFwd.src[h].vertno[7*i+h];
+        t_qListLabels << Label(t_vecLabelVertices, MatrixX3f::Zero(100,3), VectorXd::Zero(100), h, QString("%1.test").arg(h == 0 ? "lh" : "rh"));
+    }
+
+    t_PickedFwd = t_FullFwd.pick_regions(t_qListLabels);
+    QFile t_FileRegions(t_sFileName);
+    ok = MNEForwardSolution::read(t_FileRegions, t_SelFwd, t_qListLabels);
+    equal = ok && t_SelFwd.nsource == t_PickedFwd.nsource && t_SelFwd.nchan == t_PickedFwd.nchan
+            && t_SelFwd.sol->data.rows() == t_PickedFwd.sol->data.rows() && t_SelFwd.sol->data.cols() == t_PickedFwd.sol->data.cols()
+            && t_SelFwd.sol->data == t_PickedFwd.sol->data && t_SelFwd.source_rr == t_PickedFwd.source_rr;
+    printf("Region selection (%d sources): equal to pick_regions %d\n", t_PickedFwd.nsource, equal);
+    if(!equal)
+    {
+        printf("Selective read differs from pick_regions!\n");
+        emit checkupFailed(4);
+        return false;
+    }
+
+    return true;
+}
@@ -90,6 +90,41 @@ public:
     */
     bool checkFwdRead();
 
+    //=========================================================================================================
+    /**
+    * Test ID #2
+    *
+    * Checks the fast decompositions used by make_inverse_operator (MNEMath::svd_gram and
+    * MNEMath::svd_randomized) against the full SVD of simulated whitened gain matrices, including a gain whose
+    * rank is well below the number of channels, and checks that the null space is zeroed
+    *
+    * @return true if successful false otherwise
+    */
+    bool checkInverseDecomposition();
+
+    //=========================================================================================================
+    /**
+    * Test ID #3
+    *
+    * Checks MNEForwardSolution::whiten_gain with a square and a PCA whitener against the dense product and
+    * checks that mismatching dimensions and a vanishing gain are reported as failures
+    *
+    * @return true if successful false otherwise
+    */
+    bool checkWhitenGain();
+
+    //=========================================================================================================
+    /**
+    * Test ID #4
+    *
+    * Checks that reading a forward solution with a channel or region selection gives the same result as the
+    * full read followed by pick_channels or pick_regions, and that right hemisphere label selections are
+    * offset by the number of left hemisphere sources
+    *
+    * @return true if successful false otherwise
+    */
+    bool checkFwdSelectiveRead();
+
 signals:
     void checkupFailed(int ID);
 
@@ -0,0 +1,222 @@
+//=============================================================================================================
+/**
+* @file     main.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     January, 2015
+*
+* @section  LICENSE
+*
+* Copyright (C) 2012, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Benchmark of RtDataClient::readRawBuffer against the batched RtDataClient::readRawBuffers, reading
+*           from a running mne_rt_server with the FiffSimulator connector at accelerated sampling rates.
+*
+*/
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <fiff/fiff_constants.h>
+#include <fiff/fiff_info.h>
+#include <rtClient/rtcmdclient.h>
+#include <rtClient/rtdataclient.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <stdio.h>
+#include <time.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtCore/QCoreApplication>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QThread>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+using namespace FIFFLIB;
+using namespace RTCLIENTLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Methods
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* Streams p_iMsecs milliseconds from the FiffSimulator connector, which sends buffers of p_iBufSize samples with
+* p_fAccel times its original sampling rate, and prints the received rate and the client CPU time per buffer.
+* With p_bBatched the buffers are read by readRawBuffers into a preallocated matrix of p_iBatchSamples, otherwise
+* by readRawBuffer one by one.
+*/
+void benchmarkRead(QString p_sHost, bool p_bBatched, qint32 p_iBufSize, float p_fAccel, qint32 p_iMsecs, qint32 p_iBatchSamples)
+{
+    RtCmdClient t_cmdClient;
+    t_cmdClient.connectToHost(p_sHost);
+    if(!t_cmdClient.waitForConnected(1000))
+    {
+        printf("Could not connect to mne_rt_server at %s\n", p_sHost.toUtf8().constData());
+        return;
+    }
+
+    RtDataClient t_dataClient;
+    t_dataClient.connectToHost(p_sHost);
+    t_dataClient.waitForConnected(1000);
+    qint32 t_iClientId = t_dataClient.getClientId();
+
+    t_cmdClient.requestCommands();
+    if(!t_cmdClient.hasCommand("accel"))
+    {
+        printf("The FiffSimulator connector is not active.\n");
+        return;
+    }
+
+    t_cmdClient["bufsize"].pValues()[0].setValue(p_iBufSize);
+    t_cmdClient["bufsize"].send();
+    t_cmdClient["accel"].pValues()[0].setValue(p_fAccel);
+    t_cmdClient["accel"].send();
+
+    t_cmdClient["measinfo"].pValues()[0].setValue(t_iClientId);
+    t_cmdClient["measinfo"].send();
+    FiffInfo::SPtr t_pFiffInfo = t_dataClient.readInfo();
+    qint32 t_iNumChannels = t_pFiffInfo->nchan;
+
+    t_cmdClient["start"].pValues()[0].setValue(t_iClientId);
+    t_cmdClient["start"].send();
+
+    //
+    // Read
+    //
+    MatrixXf t_matRawBuffer;
+    MatrixXf t_matBatch(t_iNumChannels, p_iBatchSamples);
+    fiff_int_t kind;
+
+    qint32 t_iNumRead = 0;
+    qint32 t_iNumBuffers = 0;
+    qint32 t_iNumCalls = 0;
+
+    QElapsedTimer t_timer;
+    t_timer.start();
+    clock_t t_cpuStart = clock();
+
+    while(t_timer.elapsed() < p_iMsecs)
+    {
+        if(p_bBatched)
+        {
+            qint32 t_iNumBatchBuffers = 0;
+            qint32 t_iSamples = t_dataClient.readRawBuffers(t_matBatch, t_iNumBatchBuffers, kind);
+            if(kind == FIFF_DATA_BUFFER)
+            {
+                t_iNumRead += t_iSamples;
+                t_iNumBuffers += t_iNumBatchBuffers;
+            }
+        }
+        else
+        {
+            t_dataClient.readRawBuffer(t_iNumChannels, t_matRawBuffer, kind);
+            if(kind == FIFF_DATA_BUFFER)
+            {
+                t_iNumRead += t_matRawBuffer.cols();
+                ++t_iNumBuffers;
+            }
+        }
+        ++t_iNumCalls;
+    }
+
+    double t_dCpuSecs = ((double)(clock() - t_cpuStart)) / CLOCKS_PER_SEC;
+    double t_dWallSecs = t_timer.nsecsElapsed() * 1e-9;
+
+    t_cmdClient["stop"].pValues()[0].setValue(t_iClientId);
+    t_cmdClient["stop"].send();
+
+    t_dataClient.disconnectFromHost();
+    t_cmdClient.disconnectFromHost();
+
+    printf("%-9s %4d ch x %5d samples, accel %5.1f: %9.0f samples/s received, %6.1f us CPU per buffer, %5.2f buffers per call\n",
+           p_bBatched ? "batched" : "single", t_iNumChannels, p_iBufSize, p_fAccel,
+           t_iNumRead / t_dWallSecs, t_iNumBuffers > 0 ? t_dCpuSecs * 1e6 / t_iNumBuffers : 0.0,
+           t_iNumCalls > 0 ? ((double)t_iNumBuffers) / t_iNumCalls : 0.0);
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* The function main marks the entry point of the program.
+* By default, main has the storage class extern.
+*
+* @param [in] argc (argument count) is an integer that indicates how many arguments were entered on the command line when the program was started.
+* @param [in] argv (argument vector) is an array of pointers to arrays of character objects. The array objects are null-terminated strings, representing the arguments that were entered on the command line when the program was started.
+* @return the value that was set to exit() (which is 0 if exit() is called via quit()).
+*/
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    // mne_rt_server host, FiffSimulator has to be the active connector
+    QString t_sHost = a.arguments().size() > 1 ? a.arguments()[1] : QString("127.0.0.1");
+
+    // small buffers at increasing rates: the per buffer overhead dominates
+    float t_aAccel[] = {1.0f, 10.0f, 50.0f};
+
+    for(qint32 i = 0; i < 3; ++i)
+    {
+        benchmarkRead(t_sHost, false, 10, t_aAccel[i], 5000, 1000);
+        QThread::msleep(500);
+        benchmarkRead(t_sHost, true, 10, t_aAccel[i], 5000, 1000);
+        QThread::msleep(500);
+    }
+
+    return 0;
+}
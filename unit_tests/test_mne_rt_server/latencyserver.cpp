@@ -0,0 +1,108 @@
+//=============================================================================================================
+/**
+* @file     latencyserver.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Limin Sun <liminsun@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     January, 2015
+*
+* @section  LICENSE
+*
+* Copyright (C) 2015, Christoph Dinh, Limin Sun and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief     implementation of the LatencyServer Class.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "latencyserver.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace RTSERVER;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+LatencyServer::LatencyServer(qint32 p_iNumWorkers, QObject *parent)
+: QTcpServer(parent)
+{
+    for(qint32 i = 0; i < p_iNumWorkers; ++i)
+    {
+        QThread* t_pWorkerThread = new QThread;
+        t_pWorkerThread->start();
+        m_qListWorkerThreads.append(t_pWorkerThread);
+    }
+}
+
+
+//*************************************************************************************************************
+
+LatencyServer::~LatencyServer()
+{
+    for(qint32 i = 0; i < m_qListClients.size(); ++i)
+        m_qListClients[i]->deleteLater();
+    m_qListClients.clear();
+
+    for(qint32 i = 0; i < m_qListWorkerThreads.size(); ++i)
+    {
+        m_qListWorkerThreads[i]->quit();
+        m_qListWorkerThreads[i]->wait();
+        delete m_qListWorkerThreads[i];
+    }
+}
+
+
+//*************************************************************************************************************
+
+void LatencyServer::startAll()
+{
+    for(qint32 i = 0; i < m_qListClients.size(); ++i)
+        emit startMeasFiffStreamClient(m_qListClients[i]->getID());
+}
+
+
+//*************************************************************************************************************
+
+void LatencyServer::incomingConnection(qintptr socketDescriptor)
+{
+    FiffStreamClient* t_pClient = new FiffStreamClient(m_qListClients.size(), socketDescriptor);
+    t_pClient->moveToThread(m_qListWorkerThreads[m_qListClients.size() % m_qListWorkerThreads.size()]);
+    m_qListClients.append(t_pClient);
+
+    connect(this, &LatencyServer::remitRawBuffer, t_pClient, &FiffStreamClient::sendRawBuffer);
+    connect(this, &LatencyServer::startMeasFiffStreamClient, t_pClient, &FiffStreamClient::startMeas);
+
+    QMetaObject::invokeMethod(t_pClient, "init", Qt::QueuedConnection);
+}
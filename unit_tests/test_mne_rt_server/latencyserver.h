@@ -0,0 +1,137 @@
+//=============================================================================================================
+/**
+* @file     latencyserver.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     January, 2015
+*
+* @section  LICENSE
+*
+* Copyright (C) 2015, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief     declaration of the LatencyServer Class.
+*
+*/
+
+#ifndef LATENCYSERVER_H
+#define LATENCYSERVER_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <fiffstreamclient.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QTcpServer>
+#include <QThread>
+#include <QList>
+#include <QByteArray>
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS LatencyServer
+*
+* @brief The LatencyServer class serves local FiffStreamClients from worker event loops, the same way the
+*        FiffStreamServer does in event loop mode, without the connectors and commands of mne_rt_server.
+*/
+class LatencyServer : public QTcpServer
+{
+    Q_OBJECT
+public:
+    //=========================================================================================================
+    /**
+    * Constructs a LatencyServer.
+    *
+    * @param[in] p_iNumWorkers  Number of worker threads serving the clients.
+    * @param[in] parent         Parent QObject.
+    */
+    LatencyServer(qint32 p_iNumWorkers, QObject *parent = 0);
+
+    //=========================================================================================================
+    /**
+    * Destroys the clients and stops the worker threads.
+    */
+    ~LatencyServer();
+
+    //=========================================================================================================
+    /**
+    * Returns the number of accepted clients.
+    *
+    * @return the number of accepted clients.
+    */
+    inline qint32 numClients() const;
+
+    //=========================================================================================================
+    /**
+    * Activates raw buffer sending for all accepted clients.
+    */
+    void startAll();
+
+    //=========================================================================================================
+    /**
+    * Remits a serialised raw buffer to all clients.
+    *
+    * @param[in] p_blockRawBuffer   The serialised raw buffer.
+    */
+    inline void broadcast(const QByteArray& p_blockRawBuffer);
+
+signals:
+    void startMeasFiffStreamClient(qint32 ID);
+    void remitRawBuffer(QByteArray p_blockRawBuffer);
+
+protected:
+    void incomingConnection(qintptr socketDescriptor);
+
+private:
+    QList<QThread*> m_qListWorkerThreads;                   /**< The worker threads. */
+    QList<RTSERVER::FiffStreamClient*> m_qListClients;      /**< The accepted clients. */
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+inline qint32 LatencyServer::numClients() const
+{
+    return m_qListClients.size();
+}
+
+
+//*************************************************************************************************************
+
+inline void LatencyServer::broadcast(const QByteArray& p_blockRawBuffer)
+{
+    emit remitRawBuffer(p_blockRawBuffer);
+}
+
+#endif // LATENCYSERVER_H
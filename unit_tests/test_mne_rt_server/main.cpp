@@ -0,0 +1,266 @@
+//=============================================================================================================
+/**
+* @file     main.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     January, 2015
+*
+* @section  LICENSE
+*
+* Copyright (C) 2012, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Latency benchmark of the mne_rt_server data clients (raw buffer acquired -> bytes received by N local clients).
+*
+*/
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "latencyserver.h"
+
+#include <fiff/fiff_constants.h>
+#include <fiff/fiff_stream.h>
+#include <fiff/fiff_tag.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtCore/QCoreApplication>
+#include <QtConcurrent>
+#include <QtNetwork>
+#include <QElapsedTimer>
+#include <QThreadPool>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+using namespace FIFFLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Methods
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* Blocks until p_iNumBytes are available at the socket.
+*/
+bool waitForBytes(QTcpSocket& p_qTcpSocket, qint64 p_iNumBytes)
+{
+    while(p_qTcpSocket.bytesAvailable() < p_iNumBytes)
+        if(!p_qTcpSocket.waitForReadyRead(5000))
+            return false;
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* Local data client: reads p_iNumBuffers raw buffers and stores the latency of each buffer (acquisition until
+* the complete tag is received). The buffer number is stored in the first element of each raw buffer.
+*/
+void receive(quint16 p_iPort, qint32 p_iNumBuffers, QElapsedTimer* p_pTimer, const qint64* p_pPushTimes, qint64* p_pLatencies)
+{
+    QTcpSocket t_qTcpSocket;
+    t_qTcpSocket.connectToHost(QHostAddress::LocalHost, p_iPort);
+    if(!t_qTcpSocket.waitForConnected(5000))
+    {
+        printf("Client could not connect: %s\n", t_qTcpSocket.errorString().toUtf8().constData());
+        return;
+    }
+
+    FiffStream t_FiffStreamIn(&t_qTcpSocket);
+
+    qint32 t_iReceived = 0;
+    while(t_iReceived < p_iNumBuffers)
+    {
+        FiffTag::SPtr t_pTag;
+        if(!waitForBytes(t_qTcpSocket, (int)sizeof(qint32)*4))
+            break;
+        FiffTag::read_tag_info(&t_FiffStreamIn, t_pTag, false);
+
+        if(!waitForBytes(t_qTcpSocket, t_pTag->size()))
+            break;
+        FiffTag::read_tag_data(&t_FiffStreamIn, t_pTag);
+
+        if(t_pTag->kind == FIFF_DATA_BUFFER)
+        {
+            qint64 t_iReceiveTime = p_pTimer->nsecsElapsed();
+            qint32 t_iBuffer = (qint32)t_pTag->toFloat()[0];
+            if(t_iBuffer >= 0 && t_iBuffer < p_iNumBuffers)
+                p_pLatencies[t_iBuffer] = t_iReceiveTime - p_pPushTimes[t_iBuffer];
+            ++t_iReceived;
+        }
+    }
+
+    t_qTcpSocket.disconnectFromHost();
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* Streams p_iNumBuffers raw buffers of p_iRows x p_iCols every p_iIntervalUs microseconds to p_iNumClients
+* local clients, which are served by p_iNumWorkers worker event loops.
+*/
+void benchmarkLatency(qint32 p_iNumClients, qint32 p_iNumWorkers, qint32 p_iNumBuffers, qint32 p_iRows, qint32 p_iCols, qint32 p_iIntervalUs)
+{
+    LatencyServer t_server(p_iNumWorkers);
+    if(!t_server.listen(QHostAddress::LocalHost, 0))
+    {
+        printf("Unable to start the latency server: %s\n", t_server.errorString().toUtf8().constData());
+        return;
+    }
+
+    std::vector<qint64> t_vecPushTimes(p_iNumBuffers, 0);
+    std::vector<qint64> t_vecLatencies(p_iNumBuffers*p_iNumClients, -1);
+
+    QElapsedTimer t_timer;
+    t_timer.start();
+
+    // every blocking client occupies a pool thread
+    if(QThreadPool::globalInstance()->maxThreadCount() < p_iNumClients)
+        QThreadPool::globalInstance()->setMaxThreadCount(p_iNumClients);
+
+    QList<QFuture<void> > t_qListFutures;
+    for(qint32 i = 0; i < p_iNumClients; ++i)
+        t_qListFutures.append(QtConcurrent::run(receive, t_server.serverPort(), p_iNumBuffers, &t_timer, (const qint64*)&t_vecPushTimes[0], &t_vecLatencies[i*p_iNumBuffers]));
+
+    //
+    // Accept all clients
+    //
+    QElapsedTimer t_timerAccept;
+    t_timerAccept.start();
+    while(t_server.numClients() < p_iNumClients && t_timerAccept.elapsed() < 5000)
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+
+    t_server.startAll();
+
+    //
+    // Acquire: stamp, serialise once and remit - as FiffStreamServer::forwardRawBuffer does
+    //
+    MatrixXf t_matRawBuffer = MatrixXf::Random(p_iRows, p_iCols);
+    for(qint32 i = 0; i < p_iNumBuffers; ++i)
+    {
+        t_matRawBuffer(0,0) = (float)i;
+        t_vecPushTimes[i] = t_timer.nsecsElapsed();
+
+        QByteArray t_blockRawBuffer;
+        {
+            FiffStream t_FiffStreamOut(&t_blockRawBuffer, QIODevice::WriteOnly);
+            t_FiffStreamOut.write_float(FIFF_DATA_BUFFER, t_matRawBuffer.data(), t_matRawBuffer.rows()*t_matRawBuffer.cols());
+        }
+        t_server.broadcast(t_blockRawBuffer);
+
+        QThread::usleep(p_iIntervalUs);
+    }
+
+    for(qint32 i = 0; i < t_qListFutures.size(); ++i)
+        t_qListFutures[i].waitForFinished();
+
+    //
+    // Statistics over all clients
+    //
+    std::vector<qint64> t_vecReceived;
+    t_vecReceived.reserve(t_vecLatencies.size());
+    for(size_t i = 0; i < t_vecLatencies.size(); ++i)
+        if(t_vecLatencies[i] >= 0)
+            t_vecReceived.push_back(t_vecLatencies[i]);
+
+    qint32 t_iLost = (qint32)(t_vecLatencies.size() - t_vecReceived.size());
+    if(t_vecReceived.empty())
+    {
+        printf("%3d clients, %d workers: no buffers received\n", p_iNumClients, p_iNumWorkers);
+        return;
+    }
+
+    std::sort(t_vecReceived.begin(), t_vecReceived.end());
+    size_t n = t_vecReceived.size();
+    printf("%3d clients, %d workers, %4d x %4d every %5d us: latency [us] median %7.1f p99 %8.1f max %9.1f | lost %d\n",
+           p_iNumClients, p_iNumWorkers, p_iRows, p_iCols, p_iIntervalUs,
+           t_vecReceived[n/2] * 1e-3, t_vecReceived[(n*99)/100] * 1e-3, t_vecReceived[n-1] * 1e-3,
+           t_iLost);
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* The function main marks the entry point of the program.
+* By default, main has the storage class extern.
+*
+* @param [in] argc (argument count) is an integer that indicates how many arguments were entered on the command line when the program was started.
+* @param [in] argv (argument vector) is an array of pointers to arrays of character objects. The array objects are null-terminated strings, representing the arguments that were entered on the command line when the program was started.
+* @return the value that was set to exit() (which is 0 if exit() is called via quit()).
+*/
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    // Neuromag 306 channels + stim/misc: 10 samples every ms (10 kHz) and 100 samples every 10 ms (10 kHz)
+    qint32 t_aClients[] = {1, 4, 8, 16};
+
+    for(qint32 i = 0; i < 4; ++i)
+        benchmarkLatency(t_aClients[i], 2, 1000, 315, 10, 1000);
+
+    for(qint32 i = 0; i < 4; ++i)
+        benchmarkLatency(t_aClients[i], 2, 200, 315, 100, 10000);
+
+    return 0;
+}
@@ -0,0 +1,346 @@
+//=============================================================================================================
+/**
+* @file     main.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     January, 2015
+*
+* @section  LICENSE
+*
+* Copyright (C) 2015, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Checks the CTF compensator of FiffInfo and RtProjOp against dense operators.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <fiff/fiff_constants.h>
+#include <fiff/fiff_info.h>
+#include <fiff/fiff_proj.h>
+#include <fiff/fiff_ctf_comp.h>
+#include <fiff/fiff_named_matrix.h>
+#include <rtInv/rtprojop.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+#include <Eigen/QR>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtCore/QCoreApplication>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+using namespace FIFFLIB;
+using namespace RTINVLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Methods
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* CTF-style measurement info: MEG channels at the given compensation grade, one EEG channel in between and the
+* reference channels at the end. The compensator of grade 3 has one row per MEG channel, stored in reverse
+* channel order, and one column per reference channel, so neither its rows nor its size match the channels.
+*
+* @param[in] p_iNumMeg      Number of MEG channels.
+* @param[in] p_iNumRefs     Number of compensation reference channels.
+* @param[in] p_iGrade       Compensation grade of the MEG channels.
+* @param[out] p_matC        The compensator of grade 3 expanded to nchan x nchan.
+*
+* @return the measurement info.
+*/
+FiffInfo::SPtr ctfInfo(qint32 p_iNumMeg, qint32 p_iNumRefs, qint32 p_iGrade, MatrixXd& p_matC)
+{
+    FiffInfo::SPtr t_pInfo(new FiffInfo());
+
+    qint32 t_iEeg = p_iNumMeg / 2;
+    for(qint32 i = 0; i < p_iNumMeg + 1 + p_iNumRefs; ++i)
+    {
+        FiffChInfo t_ch;
+        if(i < p_iNumMeg + 1 && i != t_iEeg)
+        {
+            t_ch.kind = FIFFV_MEG_CH;
+            t_ch.coil_type = (p_iGrade << 16) + 5001;
+            t_ch.ch_name = QString("MEG%1").arg(i < t_iEeg ? i : i - 1, 3, 10, QChar('0'));
+        }
+        else if(i == t_iEeg)
+        {
+            t_ch.kind = FIFFV_EEG_CH;
+            t_ch.ch_name = QString("EEG001");
+        }
+        else
+        {
+            t_ch.kind = FIFFV_REF_MEG_CH;
+            t_ch.coil_type = 5001;
+            t_ch.ch_name = QString("REF%1").arg(i - p_iNumMeg - 1, 2, 10, QChar('0'));
+        }
+        t_pInfo->chs.append(t_ch);
+        t_pInfo->ch_names.append(t_ch.ch_name);
+    }
+    t_pInfo->nchan = t_pInfo->chs.size();
+
+    QStringList t_qListRows, t_qListCols;
+    for(qint32 i = p_iNumMeg - 1; i >= 0; --i)
+        t_qListRows << QString("MEG%1").arg(i, 3, 10, QChar('0'));
+    for(qint32 i = 0; i < p_iNumRefs; ++i)
+        t_qListCols << QString("REF%1").arg(i, 2, 10, QChar('0'));
+
+    MatrixXd t_matData = 0.1 * MatrixXd::Random(p_iNumMeg, p_iNumRefs);
+
+    FiffCtfComp t_comp;
+    t_comp.kind = 3;
+    t_comp.save_calibrated = false;
+    t_comp.data = FiffNamedMatrix::SDPtr(new FiffNamedMatrix(p_iNumMeg, p_iNumRefs, t_qListRows, t_qListCols, t_matData));
+    t_pInfo->comps.append(t_comp);
+
+    p_matC = MatrixXd::Zero(t_pInfo->nchan, t_pInfo->nchan);
+    for(qint32 r = 0; r < p_iNumMeg; ++r)
+        for(qint32 c = 0; c < p_iNumRefs; ++c)
+            p_matC(t_pInfo->ch_names.indexOf(t_qListRows[r]), t_pInfo->ch_names.indexOf(t_qListCols[c])) = t_matData(r, c);
+
+    return t_pInfo;
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* Adds a projector with p_iNumVec random vectors over the MEG channels.
+*/
+void addProjector(FiffInfo::SPtr& p_pInfo, qint32 p_iNumVec, bool p_bActive)
+{
+    QStringList t_qListMeg;
+    for(qint32 i = 0; i < p_pInfo->nchan; ++i)
+        if(p_pInfo->chs[i].kind == FIFFV_MEG_CH)
+            t_qListMeg << p_pInfo->ch_names[i];
+
+    QStringList t_qListRows;
+    for(qint32 v = 0; v < p_iNumVec; ++v)
+        t_qListRows << QString("PCA-v%1").arg(v+1);
+
+    FiffNamedMatrix t_data(p_iNumVec, t_qListMeg.size(), t_qListRows, t_qListMeg, MatrixXd::Random(p_iNumVec, t_qListMeg.size()));
+    p_pInfo->projs.append(FiffProj(FIFFV_PROJ_ITEM_FIELD, p_bActive, QString("proj %1").arg(p_pInfo->projs.size()), t_data));
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* Dense projector I - U*U' of the active projectors with the bad channels zeroed, U orthonormalised by a QR
+* decomposition instead of the SVD of FiffProj::make_projector.
+*/
+MatrixXd denseProjector(const FiffInfo::SPtr& p_pInfo)
+{
+    qint32 nchan = p_pInfo->nchan;
+
+    MatrixXd t_matVecs(nchan, 0);
+    for(qint32 k = 0; k < p_pInfo->projs.size(); ++k)
+    {
+        const FiffProj& t_proj = p_pInfo->projs[k];
+        if(!t_proj.active)
+            continue;
+
+        qint32 t_iOffset = t_matVecs.cols();
+        t_matVecs.conservativeResize(nchan, t_iOffset + t_proj.data->nrow);
+        t_matVecs.rightCols(t_proj.data->nrow).setZero();
+        for(qint32 i = 0; i < t_proj.data->ncol; ++i)
+        {
+            qint32 c = p_pInfo->ch_names.indexOf(t_proj.data->col_names[i]);
+            if(c >= 0 && !p_pInfo->bads.contains(t_proj.data->col_names[i]))
+                t_matVecs.block(c, t_iOffset, 1, t_proj.data->nrow) = t_proj.data->data.col(i).transpose();
+        }
+    }
+
+    MatrixXd t_matP = MatrixXd::Identity(nchan, nchan);
+    if(t_matVecs.cols() > 0)
+    {
+        HouseholderQR<MatrixXd> t_qr(t_matVecs);
+        MatrixXd t_matU = t_qr.householderQ() * MatrixXd::Identity(nchan, t_matVecs.cols());
+        t_matP -= t_matU * t_matU.transpose();
+    }
+    return t_matP;
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* FiffInfo::make_compensator on a CTF-style info: all channels are returned if the compensation channels are
+* kept, the rows of the compensator are matched by name. Returns the number of failed checks.
+*/
+qint32 checkMakeCompensator()
+{
+    qint32 t_iErrors = 0;
+
+    MatrixXd t_matC;
+    FiffInfo::SPtr t_pInfo = ctfInfo(20, 4, 0, t_matC);
+    qint32 nchan = t_pInfo->nchan;
+    MatrixXd t_matI = MatrixXd::Identity(nchan, nchan);
+
+    //grade 0 -> 3, compensation channels kept: (I - C) with all nchan rows
+    FiffCtfComp t_comp;
+    bool t_bOk = t_pInfo->make_compensator(0, 3, t_comp, false);
+    double t_dErr = t_bOk && t_comp.data->data.rows() == nchan ? (t_comp.data->data - (t_matI - t_matC)).norm() : 1.0;
+    t_bOk = t_bOk && t_dErr < 1e-12;
+    printf("make_compensator 0 -> 3, all channels: %e; %s\n", t_dErr, t_bOk ? "ok" : "failed");
+    if(!t_bOk)
+        ++t_iErrors;
+
+    //grade 3 -> 0: (I + C)
+    t_bOk = t_pInfo->make_compensator(3, 0, t_comp, false);
+    t_dErr = t_bOk && t_comp.data->data.rows() == nchan ? (t_comp.data->data - (t_matI + t_matC)).norm() : 1.0;
+    t_bOk = t_bOk && t_dErr < 1e-12;
+    printf("make_compensator 3 -> 0, all channels: %e; %s\n", t_dErr, t_bOk ? "ok" : "failed");
+    if(!t_bOk)
+        ++t_iErrors;
+
+    //compensation channels excluded: the rows of the MEG and EEG channels only
+    t_bOk = t_pInfo->make_compensator(0, 3, t_comp, true);
+    MatrixXd t_matRef(nchan, nchan);
+    qint32 t_iRows = 0;
+    for(qint32 k = 0; k < nchan; ++k)
+        if(t_pInfo->chs[k].kind != FIFFV_REF_MEG_CH)
+            t_matRef.row(t_iRows++) = t_matI.row(k) - t_matC.row(k);
+    t_matRef.conservativeResize(t_iRows, nchan);
+    t_dErr = t_bOk && t_comp.data->data.rows() == t_iRows ? (t_comp.data->data - t_matRef).norm() : 1.0;
+    t_bOk = t_bOk && t_dErr < 1e-12;
+    printf("make_compensator 0 -> 3, compensation channels excluded: %e; %s\n", t_dErr, t_bOk ? "ok" : "failed");
+    if(!t_bOk)
+        ++t_iErrors;
+
+    //unknown grade
+    t_bOk = !t_pInfo->make_compensator(0, 2, t_comp, false);
+    printf("make_compensator 0 -> 2 without a grade 2 compensator fails: %s\n", t_bOk ? "ok" : "failed");
+    if(!t_bOk)
+        ++t_iErrors;
+
+    return t_iErrors;
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* RtProjOp::apply against the dense (I - U*U')*(I + D) for a CTF-style info of grade 3 which is decompensated.
+* Returns the number of failed checks.
+*/
+qint32 checkApply(qint32 p_iNumMeg, qint32 p_iNumRefs, const char* p_sName)
+{
+    qint32 t_iErrors = 0;
+
+    MatrixXd t_matC;
+    FiffInfo::SPtr t_pInfo = ctfInfo(p_iNumMeg, p_iNumRefs, 3, t_matC);
+    qint32 nchan = t_pInfo->nchan;
+    addProjector(t_pInfo, 1, true);
+    addProjector(t_pInfo, 1, false);
+    t_pInfo->bads << t_pInfo->ch_names[1];
+
+    RtProjOp t_projOp(t_pInfo, 0);
+    MatrixXd t_matData = MatrixXd::Random(nchan, 50);
+
+    //grade 3 -> 0: I + C1 with C1 = C
+    MatrixXd t_matComp = MatrixXd::Identity(nchan, nchan) + t_matC;
+
+    MatrixXd t_matOut = t_matData;
+    t_projOp.apply(t_matOut);
+    double t_dErr = (t_matOut - denseProjector(t_pInfo) * t_matComp * t_matData).norm() / t_matData.norm();
+    bool t_bOk = t_dErr < 1e-12 && t_projOp.numProjectionVectors() == 1 && t_projOp.compensationGrade() == 0;
+    printf("RtProjOp %s, 1 projection vector: %e; %s\n", p_sName, t_dErr, t_bOk ? "ok" : "failed");
+    if(!t_bOk)
+        ++t_iErrors;
+
+    //the operator works on copies: changes of the info are only seen after setProjectors
+    t_pInfo->projs[1].active = true;
+    t_matOut = t_matData;
+    t_projOp.apply(t_matOut);
+    t_bOk = t_projOp.numProjectionVectors() == 1;
+
+    t_projOp.setProjectors(t_pInfo->projs, t_pInfo->bads);
+    t_matOut = t_matData;
+    t_projOp.apply(t_matOut);
+    t_dErr = (t_matOut - denseProjector(t_pInfo) * t_matComp * t_matData).norm() / t_matData.norm();
+    t_bOk = t_bOk && t_dErr < 1e-12 && t_projOp.numProjectionVectors() == 2;
+    printf("RtProjOp %s, 2 projection vectors after setProjectors: %e; %s\n", p_sName, t_dErr, t_bOk ? "ok" : "failed");
+    if(!t_bOk)
+        ++t_iErrors;
+
+    return t_iErrors;
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    srand(0);
+
+    qint32 t_iErrors = checkMakeCompensator();
+    //low rank form throughout: 3 refs + 2*2 vectors < 44 channels
+    t_iErrors += checkApply(40, 3, "44 channels");
+    //dense form once both projectors are active: 3 refs + 2*2 vectors >= 7 channels
+    t_iErrors += checkApply(3, 3, "7 channels");
+
+    printf("%d errors\n", t_iErrors);
+
+    return t_iErrors == 0 ? 0 : 1;
+}
@@ -0,0 +1,278 @@
+//=============================================================================================================
+/**
+* @file     main.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     January, 2015
+*
+* @section  LICENSE
+*
+* Copyright (C) 2015, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Tests the cached SSS projection of the rtSss plugin algorithm on Vectorview and BabyMEG layouts.
+*
+*/
+
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <rtsssalgo.h>
+#include <fiff/fiff_info.h>
+#include <fiff/fiff_constants.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtCore/QCoreApplication>
+#include <QElapsedTimer>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+using namespace FIFFLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Methods
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* Appends p_iNumPos sensor positions on a spiral over a helmet shaped cap of radius p_dRadius around
+* (0,0,0.04), down to 20 degrees below the equator. For each position one channel per coil type is appended,
+* planar gradiometers of the same position are orthogonal to each other.
+*/
+void appendSensors(FiffInfo& p_info, qint32 p_iNumPos, double p_dRadius, const QList<fiff_int_t>& p_qListCoilTypes)
+{
+    for(qint32 i = 0; i < p_iNumPos; ++i)
+    {
+        double t_dCosTheta = 1.0 - (i + 0.5) / p_iNumPos * 1.34;
+        double t_dSinTheta = sqrt(1.0 - t_dCosTheta*t_dCosTheta);
+        double t_dPhi = i * M_PI * (3.0 - sqrt(5.0));
+
+        Vector3d t_vecEz(t_dSinTheta*cos(t_dPhi), t_dSinTheta*sin(t_dPhi), t_dCosTheta);
+        Vector3d t_vecEx = Vector3d::UnitZ().cross(t_vecEz).normalized();
+        Vector3d t_vecEy = t_vecEz.cross(t_vecEx);
+
+        for(qint32 k = 0; k < p_qListCoilTypes.size(); ++k)
+        {
+            FiffChInfo t_chInfo;
+            t_chInfo.kind = FIFFV_MEG_CH;
+            t_chInfo.coil_type = p_qListCoilTypes[k];
+            t_chInfo.ch_name = QString("MEG%1").arg(p_info.chs.size()+1, 4, 10, QChar('0'));
+
+            Vector3d t_vecX = k == 1 ? t_vecEy : t_vecEx;
+            t_chInfo.coil_trans.setIdentity();
+            t_chInfo.coil_trans.block<3,1>(0,0) = t_vecX;
+            t_chInfo.coil_trans.block<3,1>(0,1) = t_vecEz.cross(t_vecX);
+            t_chInfo.coil_trans.block<3,1>(0,2) = t_vecEz;
+            t_chInfo.coil_trans.block<3,1>(0,3) = Vector3d(0.0, 0.0, 0.04) + p_dRadius * t_vecEz;
+
+            p_info.chs.append(t_chInfo);
+            p_info.ch_names.append(t_chInfo.ch_name);
+        }
+    }
+    p_info.nchan = p_info.chs.size();
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* Vectorview: 102 triplets of two planar gradiometers and one magnetometer.
+*/
+FiffInfo::SPtr createVectorview()
+{
+    FiffInfo::SPtr t_pInfo(new FiffInfo);
+    appendSensors(*t_pInfo, 102, 0.12, QList<fiff_int_t>() << 3012 << 3012 << 3024);
+    return t_pInfo;
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* BabyMEG: 270 magnetometers of the inner layer and 105 magnetometers of the outer layer.
+*/
+FiffInfo::SPtr createBabyMEG()
+{
+    FiffInfo::SPtr t_pInfo(new FiffInfo);
+    appendSensors(*t_pInfo, 270, 0.09, QList<fiff_int_t>() << 7002);
+    appendSensors(*t_pInfo, 105, 0.12, QList<fiff_int_t>() << 7003);
+    return t_pInfo;
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* Builds the SSS equations of a layout, times the first and the cached build and the SSS of one block, and
+* checks the projection.
+*
+* @return the number of failed checks.
+*/
+qint32 testLayout(const char* p_sName, FiffInfo::SPtr p_pInfo, qint32 p_iBlockSize)
+{
+    qint32 t_iErrors = 0;
+    QElapsedTimer t_timer;
+
+    RtSssAlgo t_rtSss;
+    t_rtSss.setMEGInfo(p_pInfo);
+    t_rtSss.setSSSParameter(QList<int>() << 5 << 4 << 8 << 4);
+
+    t_timer.start();
+    MatrixXd t_matCoilScale = t_rtSss.buildLinearEqn();
+    double t_dBuildTime = t_timer.nsecsElapsed() * 1e-6;
+
+    t_timer.start();
+    t_rtSss.buildLinearEqn();
+    double t_dCachedTime = t_timer.nsecsElapsed() * 1e-6;
+
+    QList<MatrixXd> t_qListLinEqn = t_rtSss.getLinEqn();
+    MatrixXd t_matEqnIn = t_qListLinEqn[0];
+    MatrixXd t_matEqnOut = t_qListLinEqn[1];
+    qint32 t_iNumCoil = t_matEqnIn.rows();
+
+    //
+    // Internal and external signal of random multipole moments, unscaled
+    //
+    MatrixXd t_matIn = t_matEqnIn * MatrixXd::Random(t_matEqnIn.cols(), p_iBlockSize);
+    MatrixXd t_matOut = 10.0 * t_matEqnOut * MatrixXd::Random(t_matEqnOut.cols(), p_iBlockSize);
+    MatrixXd t_matData = t_matIn + t_matOut;
+
+    t_timer.start();
+    MatrixXd t_matSSS = t_rtSss.getSSSProj(t_matData);
+    double t_dProjTime = t_timer.nsecsElapsed() * 1e-6;
+
+    // Per sample OLS with the explicit inverse of the normal equations, as done before the equations were cached
+    t_timer.start();
+    MatrixXd t_matEqnA = t_qListLinEqn[3];
+    MatrixXd t_matEqnInv = (t_matEqnA.transpose() * t_matEqnA).inverse();
+    MatrixXd t_matScaledData = t_matCoilScale * t_matData;
+    MatrixXd t_matSSSInv(t_iNumCoil, p_iBlockSize);
+    for(qint32 i = 0; i < p_iBlockSize; ++i)
+        t_matSSSInv.col(i) = t_matEqnIn * (t_matEqnInv * (t_matEqnA.transpose() * t_matScaledData.col(i))).head(t_matEqnIn.cols());
+    double t_dInvTime = t_timer.nsecsElapsed() * 1e-6;
+
+    double t_dInError = (t_matSSS - t_matIn).norm() / t_matIn.norm();
+    double t_dOLSError = (t_matSSS - t_rtSss.getSSSOLS(t_matScaledData)).norm() / t_matSSS.norm();
+
+    printf("%s (%d coils, block %d): build %.1f ms, cached build %.3f ms, projection %.3f ms, explicit inverse %.3f ms\n",
+           p_sName, t_iNumCoil, p_iBlockSize, t_dBuildTime, t_dCachedTime, t_dProjTime, t_dInvTime);
+    printf("%s: internal signal error %.2e, deviation from OLS %.2e, explicit inverse error %.2e\n",
+           p_sName, t_dInError, t_dOLSError, (t_matSSSInv - t_matIn).norm() / t_matIn.norm());
+
+    if(t_dInError > 1e-6 || t_dOLSError > 1e-10 || t_dCachedTime > 0.1 * t_dBuildTime)
+        ++t_iErrors;
+
+    //
+    // A homogeneous field is external: it is seen by the magnetometers only and removed
+    //
+    VectorXd t_vecHomogeneous(t_iNumCoil);
+    for(qint32 i = 0, k = 0; i < p_pInfo->nchan; ++i)
+        if(p_pInfo->chs[i].kind == FIFFV_MEG_CH)
+            t_vecHomogeneous(k++) = p_pInfo->chs[i].coil_type == 3012 ? 0.0 : Vector3d(1e-9, -2e-9, 3e-9).dot(p_pInfo->chs[i].coil_trans.block<3,1>(0,2));
+
+    double t_dOutResidual = t_rtSss.getSSSProj(t_vecHomogeneous).norm() / t_vecHomogeneous.norm();
+    printf("%s: residual of a homogeneous field %.2e\n", p_sName, t_dOutResidual);
+    if(t_dOutResidual > 1e-2)
+        ++t_iErrors;
+
+    //
+    // Moving the sensors with respect to the origin rebuilds the equations
+    //
+    t_rtSss.setOrigin(Vector3d(0.0, 0.005, 0.04));
+    t_timer.start();
+    t_rtSss.buildLinearEqn();
+    double t_dRebuildTime = t_timer.nsecsElapsed() * 1e-6;
+
+    t_qListLinEqn = t_rtSss.getLinEqn();
+    t_matIn = t_qListLinEqn[0] * MatrixXd::Random(t_qListLinEqn[0].cols(), 1);
+    t_dInError = (t_rtSss.getSSSProj(t_matIn) - t_matIn).norm() / t_matIn.norm();
+    printf("%s: rebuild after origin change %.1f ms, internal signal error %.2e\n", p_sName, t_dRebuildTime, t_dInError);
+    if(t_dInError > 1e-6 || (t_qListLinEqn[0] - t_matEqnIn).norm() == 0.0)
+        ++t_iErrors;
+
+    return t_iErrors;
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* The function main marks the entry point of the program.
+* By default, main has the storage class extern.
+*
+* @param [in] argc (argument count) is an integer that indicates how many arguments were entered on the command line when the program was started.
+* @param [in] argv (argument vector) is an array of pointers to arrays of character objects. The array objects are null-terminated strings, representing the arguments that were entered on the command line when the program was started.
+* @return the value that was set to exit() (which is 0 if exit() is called via quit()).
+*/
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    srand(1);
+
+    qint32 t_iErrors = 0;
+    t_iErrors += testLayout("Vectorview", createVectorview(), 100);
+    t_iErrors += testLayout("BabyMEG", createBabyMEG(), 100);
+
+    return t_iErrors == 0 ? 0 : 1;
+}
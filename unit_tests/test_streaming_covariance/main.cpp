@@ -0,0 +1,396 @@
+//=============================================================================================================
+/**
+* @file     main.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     January, 2015
+*
+* @section  LICENSE
+*
+* Copyright (C) 2015, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Checks the streaming covariance estimation against batch two-pass covariances.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <utils/streamingcovariance.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtCore/QCoreApplication>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+using namespace UTILSLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Methods
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* Batch two-pass covariance: the mean first, then the unbiased covariance of the centered data.
+*/
+MatrixXd batchCovariance(const MatrixXd& p_matData)
+{
+    MatrixXd t_matCentered = p_matData.colwise() - p_matData.rowwise().mean();
+    return t_matCentered * t_matCentered.transpose() / (double)(p_matData.cols() - 1);
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* Two-pass covariance of weighted samples, unbiased in the sense of StreamingCovariance: M2 / (sum(w) - 1).
+*/
+MatrixXd weightedCovariance(const MatrixXd& p_matData, const VectorXd& p_vecWeights)
+{
+    double t_dWeight = p_vecWeights.sum();
+    VectorXd t_vecMean = p_matData * p_vecWeights / t_dWeight;
+    MatrixXd t_matCentered = p_matData.colwise() - t_vecMean;
+    return t_matCentered * p_vecWeights.asDiagonal() * t_matCentered.transpose() / (t_dWeight - 1);
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* Relative Frobenius error of a covariance, 1 if the sizes differ.
+*/
+double relError(const MatrixXd& p_matCov, const MatrixXd& p_matRef)
+{
+    if(p_matCov.rows() != p_matRef.rows() || p_matCov.cols() != p_matRef.cols())
+        return 1.0;
+    return (p_matCov - p_matRef).norm() / p_matRef.norm();
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* Feeds p_matData in blocks of p_iBlockSize samples (the last block may be shorter).
+*/
+void feed(StreamingCovariance& p_cov, const MatrixXd& p_matData, qint32 p_iBlockSize)
+{
+    for(qint32 j = 0; j < p_matData.cols(); j += p_iBlockSize)
+        p_cov.update(p_matData.middleCols(j, qMin(p_iBlockSize, (qint32)p_matData.cols() - j)));
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* Cumulative estimates for several block sizes, including single samples. Returns the number of failed checks.
+*/
+qint32 checkBlockSizes(const MatrixXd& p_matData)
+{
+    qint32 t_iErrors = 0;
+    MatrixXd t_matRef = batchCovariance(p_matData);
+    VectorXd t_vecRef = p_matData.rowwise().mean();
+
+    qint32 t_aBlockSizes[] = {1, 7, 100, (qint32)p_matData.cols()};
+    for(qint32 i = 0; i < 4; ++i)
+    {
+        StreamingCovariance t_cov;
+        feed(t_cov, p_matData, t_aBlockSizes[i]);
+
+        double t_dErrCov = relError(t_cov.covariance(), t_matRef);
+        double t_dErrMean = (t_cov.mean() - t_vecRef).norm() / t_vecRef.norm();
+        bool t_bOk = t_cov.weight() == p_matData.cols() && t_dErrCov < 1e-12 && t_dErrMean < 1e-12;
+        printf("Cumulative, block size %4d: covariance %e; mean %e; %s\n", t_aBlockSizes[i], t_dErrCov, t_dErrMean, t_bOk ? "ok" : "failed");
+        if(!t_bOk)
+            ++t_iErrors;
+    }
+
+    return t_iErrors;
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* Merges independently built estimators: cumulative into cumulative, a sliding window into a cumulative one and
+* a cumulative one into a sliding window. Returns the number of failed checks.
+*/
+qint32 checkMerge(const MatrixXd& p_matData)
+{
+    qint32 t_iErrors = 0;
+
+    //three parts of different lengths, fed with different block sizes
+    qint32 t_iFirst = 300, t_iSecond = 450;
+    qint32 t_iThird = p_matData.cols() - t_iFirst - t_iSecond;
+    StreamingCovariance t_covA, t_covB, t_covC, t_covEmpty;
+    feed(t_covA, p_matData.leftCols(t_iFirst), 1);
+    feed(t_covB, p_matData.middleCols(t_iFirst, t_iSecond), 50);
+    feed(t_covC, p_matData.rightCols(t_iThird), 13);
+
+    t_covEmpty.merge(t_covA);
+    t_covEmpty.merge(t_covB);
+    t_covEmpty.merge(t_covC);
+    double t_dErr = relError(t_covEmpty.covariance(), batchCovariance(p_matData));
+    bool t_bOk = t_covEmpty.weight() == p_matData.cols() && t_dErr < 1e-12;
+    printf("Merge of 3 cumulative estimators: covariance %e; %s\n", t_dErr, t_bOk ? "ok" : "failed");
+    if(!t_bOk)
+        ++t_iErrors;
+
+    //sliding window into cumulative: only the window of the merged estimator counts
+    StreamingCovariance t_covWindow(StreamingCovariance::SlidingWindow, 400);
+    feed(t_covWindow, p_matData, 25);
+    qint32 t_iWindow = (qint32)t_covWindow.weight();
+    StreamingCovariance t_covCumulative;
+    t_covCumulative.merge(t_covWindow);
+    t_dErr = relError(t_covCumulative.covariance(), batchCovariance(p_matData.rightCols(t_iWindow)));
+    t_bOk = t_covCumulative.weight() == t_iWindow && t_dErr < 1e-12;
+    printf("Merge of a sliding window (%d samples) into a cumulative estimator: covariance %e; %s\n", t_iWindow, t_dErr, t_bOk ? "ok" : "failed");
+    if(!t_bOk)
+        ++t_iErrors;
+
+    //cumulative into sliding window: the merged samples are the newest pane, older panes drop out of the window
+    qint32 t_iMerged = 150;
+    StreamingCovariance t_covSliding(StreamingCovariance::SlidingWindow, 800), t_covD;
+    feed(t_covSliding, p_matData.leftCols(1000), 25);
+    feed(t_covD, p_matData.middleCols(1000, t_iMerged), 13);
+    t_covSliding.merge(t_covD);
+    t_iWindow = (qint32)t_covSliding.weight();
+    t_dErr = relError(t_covSliding.covariance(), batchCovariance(p_matData.middleCols(1000 + t_iMerged - t_iWindow, t_iWindow)));
+    t_bOk = t_iWindow >= 800 + t_iMerged - 100 && t_iWindow < 800 + t_iMerged && t_dErr < 1e-12;
+    printf("Merge of a cumulative estimator into a sliding window (%d samples): covariance %e; %s\n", t_iWindow, t_dErr, t_bOk ? "ok" : "failed");
+    if(!t_bOk)
+        ++t_iErrors;
+
+    //a different number of channels resets the sliding window
+    StreamingCovariance t_covOther;
+    t_covOther.update(p_matData.topRows(4));
+    t_covSliding.merge(t_covOther);
+    t_bOk = t_covSliding.weight() == p_matData.cols() && t_covSliding.covariance().rows() == 4;
+    printf("Merge of an estimator with 4 channels into a sliding window: %s\n", t_bOk ? "reset, ok" : "failed");
+    if(!t_bOk)
+        ++t_iErrors;
+
+    return t_iErrors;
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* Sliding window estimates against the covariance of the last window samples. The window covers whole panes,
+* so it holds between window and window + pane + block size samples. Returns the number of failed checks.
+*/
+qint32 checkSlidingWindow(const MatrixXd& p_matData)
+{
+    qint32 t_iErrors = 0;
+    qint32 t_iWindowSamples = 800;
+    qint32 t_iPaneSamples = t_iWindowSamples / StreamingCovariance::NumPanes;
+
+    qint32 t_aBlockSizes[] = {1, 25, 33};
+    for(qint32 i = 0; i < 3; ++i)
+    {
+        StreamingCovariance t_cov(StreamingCovariance::SlidingWindow, t_iWindowSamples);
+
+        double t_dMaxErr = 0;
+        bool t_bOk = true;
+        for(qint32 j = 0; j < p_matData.cols(); j += t_aBlockSizes[i])
+        {
+            qint32 t_iNum = qMin(t_aBlockSizes[i], (qint32)p_matData.cols() - j);
+            t_cov.update(p_matData.middleCols(j, t_iNum));
+
+            qint32 t_iWeight = (qint32)t_cov.weight();
+            if(j + t_iNum < t_iWindowSamples)
+                t_bOk &= t_iWeight == j + t_iNum;
+            else
+                t_bOk &= t_iWeight >= t_iWindowSamples && t_iWeight < t_iWindowSamples + t_iPaneSamples + t_aBlockSizes[i];
+
+            //check every few hundred samples
+            if(t_iWeight > 1 && (j / t_aBlockSizes[i]) % (300 / t_aBlockSizes[i] + 1) == 0)
+                t_dMaxErr = qMax(t_dMaxErr, relError(t_cov.covariance(), batchCovariance(p_matData.middleCols(j + t_iNum - t_iWeight, t_iWeight))));
+        }
+        t_bOk &= t_dMaxErr < 1e-12;
+        printf("Sliding window %d, block size %2d: covariance %e; %s\n", t_iWindowSamples, t_aBlockSizes[i], t_dMaxErr, t_bOk ? "ok" : "failed");
+        if(!t_bOk)
+            ++t_iErrors;
+
+        //a different number of channels resets the estimator
+        t_cov.update(p_matData.topLeftCorner(4, 10));
+        if(t_cov.weight() != 10 || t_cov.covariance().rows() != 4)
+        {
+            printf("Sliding window, block size %2d: no reset on a different number of channels\n", t_aBlockSizes[i]);
+            ++t_iErrors;
+        }
+    }
+
+    return t_iErrors;
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* Exponential forgetting against an explicitly weighted two-pass covariance: a sample is weighted with
+* (1 - 1/memory)^k, k being the number of samples of the newer blocks. Returns the number of failed checks.
+*/
+qint32 checkExponentialForgetting(const MatrixXd& p_matData)
+{
+    qint32 t_iErrors = 0;
+    qint32 t_iMemory = 500;
+    double t_dLambda = 1.0 - 1.0/t_iMemory;
+
+    qint32 t_aBlockSizes[] = {1, 40, 33};
+    for(qint32 i = 0; i < 3; ++i)
+    {
+        StreamingCovariance t_cov(StreamingCovariance::ExponentialForgetting, t_iMemory);
+        feed(t_cov, p_matData, t_aBlockSizes[i]);
+
+        qint32 t_iNumSamples = p_matData.cols();
+        VectorXd t_vecWeights(t_iNumSamples);
+        for(qint32 j = 0; j < t_iNumSamples; j += t_aBlockSizes[i])
+        {
+            qint32 t_iEnd = qMin(j + t_aBlockSizes[i], t_iNumSamples);
+            t_vecWeights.segment(j, t_iEnd - j).setConstant(pow(t_dLambda, (double)(t_iNumSamples - t_iEnd)));
+        }
+
+        double t_dErrCov = relError(t_cov.covariance(), weightedCovariance(p_matData, t_vecWeights));
+        double t_dErrWeight = fabs(t_cov.weight() - t_vecWeights.sum()) / t_vecWeights.sum();
+        bool t_bOk = t_dErrCov < 1e-12 && t_dErrWeight < 1e-12;
+        printf("Exponential forgetting %d, block size %2d: covariance %e; weight %e (%.1f samples); %s\n", t_iMemory, t_aBlockSizes[i], t_dErrCov, t_dErrWeight, t_cov.weight(), t_bOk ? "ok" : "failed");
+        if(!t_bOk)
+            ++t_iErrors;
+    }
+
+    return t_iErrors;
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* Data with a large DC offset: the streaming estimate has to stay accurate where the one-pass formula
+* sum(x*x') - n*mu*mu' cancels. Returns the number of failed checks.
+*/
+qint32 checkDCOffset(const MatrixXd& p_matData)
+{
+    MatrixXd t_matOffset = p_matData.array() + 1e7;
+    MatrixXd t_matRef = batchCovariance(p_matData);     //the covariance does not depend on the offset
+
+    StreamingCovariance t_cov;
+    feed(t_cov, t_matOffset, 10);
+    double t_dErrStreaming = relError(t_cov.covariance(), t_matRef);
+
+    //one-pass sums, accumulated block by block as a streaming implementation of it would do
+    qint32 n = t_matOffset.cols();
+    MatrixXd t_matSum = MatrixXd::Zero(t_matOffset.rows(), t_matOffset.rows());
+    VectorXd t_vecSum = VectorXd::Zero(t_matOffset.rows());
+    for(qint32 j = 0; j < n; j += 10)
+    {
+        t_matSum += t_matOffset.middleCols(j, 10) * t_matOffset.middleCols(j, 10).transpose();
+        t_vecSum += t_matOffset.middleCols(j, 10).rowwise().sum();
+    }
+    VectorXd t_vecMean = t_vecSum / n;
+    MatrixXd t_matOnePass = (t_matSum - n * t_vecMean * t_vecMean.transpose()) / (double)(n - 1);
+    double t_dErrOnePass = relError(t_matOnePass, t_matRef);
+
+    bool t_bOk = t_dErrStreaming < 1e-8 && t_dErrStreaming * 1e3 < t_dErrOnePass;
+    printf("DC offset 1e7: streaming covariance %e; one-pass sum(x*x') - n*mu*mu' %e; %s\n", t_dErrStreaming, t_dErrOnePass, t_bOk ? "ok" : "failed");
+
+    return t_bOk ? 0 : 1;
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* The function main marks the entry point of the program.
+* By default, main has the storage class extern.
+*
+* @param [in] argc (argument count) is an integer that indicates how many arguments were entered on the command line when the program was started.
+* @param [in] argv (argument vector) is an array of pointers to arrays of character objects. The array objects are null-terminated strings, representing the arguments that were entered on the command line when the program was started.
+* @return the value that was set to exit() (which is 0 if exit() is called via quit()).
+*/
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    srand(0);
+
+    //correlated channels with different means
+    qint32 t_iNumChannels = 16;
+    MatrixXd t_matMixing = MatrixXd::Random(t_iNumChannels, t_iNumChannels);
+    MatrixXd t_matData = t_matMixing * MatrixXd::Random(t_iNumChannels, 2000);
+    t_matData.colwise() += 5.0 * VectorXd::Random(t_iNumChannels);
+
+    qint32 t_iErrors = checkBlockSizes(t_matData);
+    t_iErrors += checkMerge(t_matData);
+    t_iErrors += checkSlidingWindow(t_matData);
+    t_iErrors += checkExponentialForgetting(t_matData);
+    t_iErrors += checkDCOffset(t_matData);
+
+    printf("%d errors\n", t_iErrors);
+
+    return t_iErrors == 0 ? 0 : 1;
+}
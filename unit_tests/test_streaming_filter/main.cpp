@@ -0,0 +1,223 @@
+//=============================================================================================================
+/**
+* @file     main.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     January, 2015
+*
+* @section  LICENSE
+*
+* Copyright (C) 2015, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Block size independence and throughput of the streaming filter.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <utils/streamingfilter.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <stdio.h>
+#include <math.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtCore/QCoreApplication>
+#include <QElapsedTimer>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+using namespace UTILSLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Methods
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* Reference: causal FIR by direct convolution followed by the biquads, sample by sample, of the whole stream.
+*/
+MatrixXd referenceFilter(const MatrixXd& p_matData, const RowVectorXd& p_vecTaps, const MatrixXd& p_matSos)
+{
+    MatrixXd t_matOut = MatrixXd::Zero(p_matData.rows(), p_matData.cols());
+    for(qint32 c = 0; c < p_matData.rows(); ++c)
+        for(qint32 i = 0; i < p_matData.cols(); ++i)
+            for(qint32 k = 0; k < p_vecTaps.cols() && k <= i; ++k)
+                t_matOut(c,i) += p_vecTaps[k]*p_matData(c,i-k);
+
+    for(qint32 s = 0; s < p_matSos.rows(); ++s)
+    {
+        RowVectorXd b = p_matSos.row(s).head(3) / p_matSos(s,3);
+        RowVectorXd a = p_matSos.row(s).tail(3) / p_matSos(s,3);
+        MatrixXd t_matIn = t_matOut;
+        for(qint32 c = 0; c < p_matData.rows(); ++c)
+            for(qint32 i = 0; i < p_matData.cols(); ++i)
+            {
+                double y = b[0]*t_matIn(c,i);
+                if(i >= 1) y += b[1]*t_matIn(c,i-1) - a[1]*t_matOut(c,i-1);
+                if(i >= 2) y += b[2]*t_matIn(c,i-2) - a[2]*t_matOut(c,i-2);
+                t_matOut(c,i) = y;
+            }
+    }
+
+    return t_matOut;
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* Filters the stream in blocks of the given sizes and returns the maximal deviation from the reference.
+*/
+double checkBlockSizes(const MatrixXd& p_matData, const MatrixXd& p_matReference, StreamingFilter& p_filter, qint32 p_iBlockSize)
+{
+    p_filter.reset(p_matData.rows());
+
+    MatrixXd t_matOut(p_matData.rows(), p_matData.cols());
+    qint32 t_iBlock = 0;
+    for(qint32 s = 0; s < p_matData.cols(); s += t_iBlock)
+    {
+        // p_iBlockSize 0: varying block sizes
+        t_iBlock = p_iBlockSize > 0 ? p_iBlockSize : 1 + (s*7919) % 613;
+        t_iBlock = qMin(t_iBlock, (qint32)p_matData.cols() - s);
+
+        MatrixXd t_matBlock = p_matData.middleCols(s, t_iBlock);
+        p_filter.filter(t_matBlock);
+        t_matOut.middleCols(s, t_iBlock) = t_matBlock;
+    }
+
+    return (t_matOut - p_matReference).cwiseAbs().maxCoeff();
+}
+
+
+//*************************************************************************************************************
+
+void benchmark(qint32 p_iNumChannels, qint32 p_iBlockSize, qint32 p_iNumTaps)
+{
+    StreamingFilter t_filter;
+    t_filter.setFirCoefficients(RowVectorXd::Random(p_iNumTaps));
+
+    MatrixXd t_matBlock = MatrixXd::Random(p_iNumChannels, p_iBlockSize);
+    qint32 t_iNumBlocks = 100;
+
+    for(qint32 k = 0; k < 2; ++k)
+    {
+        t_filter.setMultithreaded(k == 1);
+        t_filter.reset(p_iNumChannels);
+
+        QElapsedTimer t_timer;
+        t_timer.start();
+        for(qint32 i = 0; i < t_iNumBlocks; ++i)
+            t_filter.filter(t_matBlock);
+        double t_dTime = t_timer.nsecsElapsed()*1e-6 / t_iNumBlocks;
+
+        printf("%4d channels, block %5d, %4d taps, fft length %5d, %s: %8.3f ms per block\n", p_iNumChannels, p_iBlockSize, p_iNumTaps, t_filter.fftLength(), k == 1 ? "mt" : "st", t_dTime);
+    }
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* The function main marks the entry point of the program.
+* By default, main has the storage class extern.
+*
+* @param [in] argc (argument count) is an integer that indicates how many arguments were entered on the command line when the program was started.
+* @param [in] argv (argument vector) is an array of pointers to arrays of character objects. The array objects are null-terminated strings, representing the arguments that were entered on the command line when the program was started.
+* @return the value that was set to exit() (which is 0 if exit() is called via quit()).
+*/
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    //
+    // Block size independence
+    //
+    MatrixXd t_matData = MatrixXd::Random(8, 5000);
+    RowVectorXd t_vecTaps = RowVectorXd::Random(101);
+
+    MatrixXd t_matSos(2, 6);
+    t_matSos.row(0) = StreamingFilter::designBiquad(StreamingFilter::HighPass, 0.01);
+    t_matSos.row(1) = StreamingFilter::designBiquad(StreamingFilter::Notch, 0.1, 30.0);
+
+    StreamingFilter t_filter;
+    t_filter.setFirCoefficients(t_vecTaps);
+    t_filter.setBiquads(t_matSos);
+
+    MatrixXd t_matReference = referenceFilter(t_matData, t_vecTaps, t_matSos);
+
+    qint32 t_iErrors = 0;
+    qint32 t_aBlockSizes[] = {1, 7, 100, 256, 1000, 5000, 0};
+    for(qint32 i = 0; i < 7; ++i)
+    {
+        double t_dError = checkBlockSizes(t_matData, t_matReference, t_filter, t_aBlockSizes[i]);
+        if(t_dError > 1e-9)
+            ++t_iErrors;
+        printf("block size %4d: max deviation from the direct filter %g\n", t_aBlockSizes[i], t_dError);
+    }
+
+    //
+    // Throughput, Neuromag 306 channels
+    //
+    qint32 t_aBenchBlocks[] = {10, 100, 1000};
+    for(qint32 i = 0; i < 3; ++i)
+    {
+        benchmark(306, t_aBenchBlocks[i], 129);
+        benchmark(306, t_aBenchBlocks[i], 1025);
+    }
+
+    return t_iErrors == 0 ? 0 : 1;
+}
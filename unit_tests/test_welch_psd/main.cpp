@@ -0,0 +1,229 @@
+//=============================================================================================================
+/**
+* @file     main.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     January, 2015
+*
+* @section  LICENSE
+*
+* Copyright (C) 2015, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Benchmark and sanity check of the Welch power spectral density estimation.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <utils/welchpsd.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <stdio.h>
+#include <math.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+#include <unsupported/Eigen/FFT>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtCore/QCoreApplication>
+#include <QElapsedTimer>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+using namespace UTILSLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Methods
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* Spectrum estimation as it was done in RtNoise before: non overlapping segments, a new FFT object per channel
+* and segment and element wise windowing.
+*/
+MatrixXd legacySpectrum(const MatrixXd& p_matData, qint32 p_iFFTLength, double p_dSFreq)
+{
+    VectorXd t_vecWindow = WelchPsd::hanning(p_iFFTLength);
+    qint32 t_iNumSamples = p_matData.cols();
+    qint32 nb = t_iNumSamples/p_iFFTLength + 1;
+
+    MatrixXd t_matSum = MatrixXd::Zero(p_matData.rows(), p_iFFTLength/2+1);
+    MatrixXd t_mat(p_matData.rows(), p_iFFTLength);
+    for(qint32 n = 0; n < nb; ++n)
+    {
+        for(qint32 ii = 0; ii < p_matData.rows(); ++ii)
+            for(qint32 jj = 0; jj < p_iFFTLength; ++jj)
+                t_mat(ii,jj) = jj+n*p_iFFTLength < t_iNumSamples ? p_matData(ii,jj+n*p_iFFTLength) : 0.0;
+
+        for(qint32 i = 0; i < t_mat.rows(); ++i)
+        {
+            RowVectorXd t_data = t_mat.row(i);
+            for(qint32 lk = 0; lk < p_iFFTLength; ++lk)
+                t_data[lk] *= t_vecWindow[lk];
+
+            Eigen::FFT<double> fft;
+            fft.SetFlag(fft.HalfSpectrum);
+            RowVectorXcd t_freqData(p_iFFTLength/2+1);
+            fft.fwd(t_freqData, t_data);
+
+            for(qint32 j = 0; j < p_iFFTLength/2+1; ++j)
+                t_matSum(i,j) += std::abs(t_freqData(j)) / (p_dSFreq*p_iFFTLength);
+        }
+    }
+
+    return t_matSum / nb;
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* Checks the estimate with a sine in white noise: the peak has to be found at the sine frequency and the integral
+* of the density has to match the variance of the signal (Parseval). Returns the number of failed checks.
+*/
+qint32 checkWelchPsd(bool p_bFloat)
+{
+    double t_dSFreq = 1000.0;
+    double t_dFreq = 50.0;
+    double t_dAmp = 2.0;
+    qint32 t_iNumSamples = 20000;
+
+    MatrixXd t_matData = MatrixXd::Random(4, t_iNumSamples);
+    for(qint32 i = 0; i < t_iNumSamples; ++i)
+        t_matData(0,i) += t_dAmp*sin(2.0*M_PI*t_dFreq*i/t_dSFreq);
+
+    WelchPsd t_welch(1000, t_dSFreq, 0.5);
+    t_welch.setFloatPrecision(p_bFloat);
+    MatrixXd t_matPsd = t_welch.compute(t_matData);
+    VectorXd t_vecFreqs = t_welch.frequencies();
+    double t_dFreqRes = t_vecFreqs[1] - t_vecFreqs[0];
+
+    qint32 t_iErrors = 0;
+
+    qint32 t_iPeak;
+    t_matPsd.row(0).maxCoeff(&t_iPeak);
+    if(fabs(t_vecFreqs[t_iPeak] - t_dFreq) > t_dFreqRes)
+        ++t_iErrors;
+
+    for(qint32 c = 0; c < t_matData.rows(); ++c)
+    {
+        RowVectorXd t_vecCentered = t_matData.row(c).array() - t_matData.row(c).mean();
+        double t_dVariance = t_vecCentered.squaredNorm() / t_iNumSamples;
+        double t_dPower = t_matPsd.row(c).tail(t_matPsd.cols()-1).sum() * t_dFreqRes;
+        if(fabs(t_dPower - t_dVariance) > 0.05*t_dVariance)
+            ++t_iErrors;
+    }
+
+    printf("Welch PSD %s: peak at %.1f Hz (expected %.1f Hz), %d errors\n", p_bFloat ? "float " : "double", t_vecFreqs[t_iPeak], t_dFreq, t_iErrors);
+
+    return t_iErrors;
+}
+
+
+//*************************************************************************************************************
+
+void benchmark(qint32 p_iNumChannels, double p_dSFreq, double p_dSeconds)
+{
+    qint32 t_iFFTLength = (qint32)p_dSFreq;
+    MatrixXd t_matData = MatrixXd::Random(p_iNumChannels, (qint32)(p_dSFreq*p_dSeconds));
+
+    QElapsedTimer t_timer;
+
+    t_timer.start();
+    MatrixXd t_matLegacy = legacySpectrum(t_matData, t_iFFTLength, p_dSFreq);
+    double t_dLegacy = t_timer.nsecsElapsed()*1e-6;
+
+    printf("%4d channels, %5.0f Hz, %4.0f s, fft length %5d: legacy %8.1f ms |", p_iNumChannels, p_dSFreq, p_dSeconds, t_iFFTLength, t_dLegacy);
+
+    WelchPsd t_welch(t_iFFTLength, p_dSFreq, 0.5);
+    for(qint32 k = 0; k < 4; ++k)
+    {
+        bool t_bFloat = k % 2 == 1;
+        bool t_bMultithreaded = k >= 2;
+        t_welch.setFloatPrecision(t_bFloat);
+        t_welch.setMultithreaded(t_bMultithreaded);
+
+        t_timer.start();
+        MatrixXd t_matPsd = t_welch.compute(t_matData);
+        double t_dTime = t_timer.nsecsElapsed()*1e-6;
+
+        printf(" %s %s %8.1f ms |", t_bMultithreaded ? "mt" : "st", t_bFloat ? "float " : "double", t_dTime);
+    }
+    printf(" %d segments\n", t_welch.numSegments(t_matData.cols()));
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* The function main marks the entry point of the program.
+* By default, main has the storage class extern.
+*
+* @param [in] argc (argument count) is an integer that indicates how many arguments were entered on the command line when the program was started.
+* @param [in] argv (argument vector) is an array of pointers to arrays of character objects. The array objects are null-terminated strings, representing the arguments that were entered on the command line when the program was started.
+* @return the value that was set to exit() (which is 0 if exit() is called via quit()).
+*/
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    qint32 t_iErrors = checkWelchPsd(false) + checkWelchPsd(true);
+
+    // Neuromag 306 channels, 10 s of data, 1 Hz resolution
+    double t_aSFreqs[] = {1000.0, 2000.0, 5000.0};
+    for(qint32 i = 0; i < 3; ++i)
+        benchmark(306, t_aSFreqs[i], 10.0);
+
+    return t_iErrors == 0 ? 0 : 1;
+}
@@ -40,9 +40,19 @@ TEMPLATE = subdirs
 SUBDIRS += \
     test_mne_libs \
     test_mne_rt \
+    test_mne_buffer \
+    test_mne_rt_server \
+    test_mne_rt_client \
     mne_x_plugin_com \
     test_mne_future \
-    test_ssp
+    test_ssp \
+    test_welch_psd \
+    test_streaming_filter \
+    test_filter_data \
+    test_streaming_covariance \
+    test_rtprojop \
+    test_hpi_fit \
+    test_rtsss
 
 contains(MNECPP_CONFIG, withGui) {
     SUBDIRS += \